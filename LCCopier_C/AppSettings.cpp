@@ -0,0 +1,152 @@
+#include "AppSettings.h"
+#include <array>
+
+#define SETTINGS_HEADER_BYTES 16  // magic, version, reserved, payload length, CRC-32
+
+// Tag numbers are stored in the registry: never reuse or renumber one.
+enum SettingsTag : uint16_t {
+	TagDarkMode = 1,
+	TagSetTop = 2,
+	TagSetInvisible = 3,
+	TagMiddleButtonPaste = 4,
+	TagMiddleButtonReplaceAll = 5,
+	TagIncrementalPaste = 6,
+	TagTransparency = 7,
+	TagAutoCopyHotkey = 8,
+	TagAutoDeleteHotkey = 9,
+	TagTextSize = 10,
+	TagTextColor = 11,
+	TagBgColor = 12,
+	TagSelectedBgColor = 13,
+	TagTranscriptLog = 14,
+	TagTranscriptFlushMs = 15,
+	TagTranscriptRotateMB = 16,
+};
+
+static void PutU16(std::vector<uint8_t>& out, uint16_t value) {
+	out.push_back((uint8_t)value);
+	out.push_back((uint8_t)(value >> 8));
+}
+
+static void PutU32(std::vector<uint8_t>& out, uint32_t value) {
+	for (int shift = 0; shift < 32; shift += 8) out.push_back((uint8_t)(value >> shift));
+}
+
+static uint16_t GetU16(const uint8_t* p) {
+	return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static uint32_t GetU32(const uint8_t* p) {
+	return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void PutValue(std::vector<uint8_t>& out, SettingsTag tag, uint32_t value) {
+	PutU16(out, tag);
+	PutU16(out, 4);
+	PutU32(out, value);
+}
+
+// Hotkeys pack into one value: virtual key in the low 16 bits, modifiers above.
+static uint32_t PackHotkey(const HotkeyConfig& hk) {
+	return (hk.vkCode & 0xFFFF) | (hk.ctrl ? 1u << 16 : 0) | (hk.shift ? 1u << 17 : 0) | (hk.alt ? 1u << 18 : 0) | (hk.win ? 1u << 19 : 0);
+}
+
+static HotkeyConfig UnpackHotkey(uint32_t value) {
+	HotkeyConfig hk = {};
+	hk.vkCode = value & 0xFFFF;
+	hk.ctrl = (value & 1u << 16) != 0;
+	hk.shift = (value & 1u << 17) != 0;
+	hk.alt = (value & 1u << 18) != 0;
+	hk.win = (value & 1u << 19) != 0;
+	return hk;
+}
+
+uint32_t Crc32(const uint8_t* data, size_t size) {
+	static const std::array<uint32_t, 256> table = [] {
+		std::array<uint32_t, 256> t = {};
+		for (uint32_t i = 0; i < 256; i++) {
+			uint32_t c = i;
+			for (int k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			t[i] = c;
+		}
+		return t;
+	}();
+	uint32_t crc = 0xFFFFFFFFu;
+	for (size_t i = 0; i < size; i++) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	return crc ^ 0xFFFFFFFFu;
+}
+
+std::vector<uint8_t> SerializeSettings(const AppSettings& settings) {
+	std::vector<uint8_t> payload;
+	PutValue(payload, TagDarkMode, settings.darkMode);
+	PutValue(payload, TagSetTop, settings.setTop);
+	PutValue(payload, TagSetInvisible, settings.setInvisible);
+	PutValue(payload, TagMiddleButtonPaste, settings.middleButtonPaste);
+	PutValue(payload, TagMiddleButtonReplaceAll, settings.middleButtonReplaceAll);
+	PutValue(payload, TagIncrementalPaste, settings.incrementalPaste);
+	PutValue(payload, TagTransparency, (uint32_t)settings.transparency);
+	PutValue(payload, TagAutoCopyHotkey, PackHotkey(settings.autoCopyHotkey));
+	PutValue(payload, TagAutoDeleteHotkey, PackHotkey(settings.autoDeleteHotkey));
+	PutValue(payload, TagTextSize, (uint32_t)settings.textSize);
+	PutValue(payload, TagTextColor, settings.textColor);
+	PutValue(payload, TagBgColor, settings.bgColor);
+	PutValue(payload, TagSelectedBgColor, settings.selectedBgColor);
+	PutValue(payload, TagTranscriptLog, settings.transcriptLog);
+	PutValue(payload, TagTranscriptFlushMs, (uint32_t)settings.transcriptFlushMs);
+	PutValue(payload, TagTranscriptRotateMB, (uint32_t)settings.transcriptRotateMB);
+
+	std::vector<uint8_t> out;
+	out.reserve(SETTINGS_HEADER_BYTES + payload.size());
+	PutU32(out, SETTINGS_BLOB_MAGIC);
+	PutU16(out, SETTINGS_BLOB_VERSION);
+	PutU16(out, 0);
+	PutU32(out, (uint32_t)payload.size());
+	PutU32(out, Crc32(payload.data(), payload.size()));
+	out.insert(out.end(), payload.begin(), payload.end());
+	return out;
+}
+
+bool DeserializeSettings(const uint8_t* data, size_t size, AppSettings& settings) {
+	if (size < SETTINGS_HEADER_BYTES || size > SETTINGS_BLOB_MAX_BYTES) return false;
+	uint16_t version = GetU16(data + 4);
+	uint32_t payloadBytes = GetU32(data + 8);
+	if (GetU32(data) != SETTINGS_BLOB_MAGIC || version == 0 || version > SETTINGS_BLOB_VERSION || GetU16(data + 6) != 0) return false;
+	if (payloadBytes != size - SETTINGS_HEADER_BYTES) return false;
+	const uint8_t* payload = data + SETTINGS_HEADER_BYTES;
+	if (Crc32(payload, payloadBytes) != GetU32(data + 12)) return false;
+
+	// Decode into a copy so a malformed entry leaves the caller's settings alone.
+	AppSettings decoded = settings;
+	for (size_t pos = 0; pos < payloadBytes;) {
+		if (payloadBytes - pos < 4) return false;
+		uint16_t tag = GetU16(payload + pos);
+		uint16_t length = GetU16(payload + pos + 2);
+		pos += 4;
+		if (length > payloadBytes - pos) return false;
+		const uint8_t* value = payload + pos;
+		pos += length;
+		if (length != 4) continue;  // a value shape this version does not know
+		uint32_t v = GetU32(value);
+		switch (tag) {
+		case TagDarkMode: decoded.darkMode = v != 0; break;
+		case TagSetTop: decoded.setTop = v != 0; break;
+		case TagSetInvisible: decoded.setInvisible = v != 0; break;
+		case TagMiddleButtonPaste: decoded.middleButtonPaste = v != 0; break;
+		case TagMiddleButtonReplaceAll: decoded.middleButtonReplaceAll = v != 0; break;
+		case TagIncrementalPaste: decoded.incrementalPaste = v != 0; break;
+		case TagTransparency: decoded.transparency = (int)v; break;
+		case TagAutoCopyHotkey: decoded.autoCopyHotkey = UnpackHotkey(v); break;
+		case TagAutoDeleteHotkey: decoded.autoDeleteHotkey = UnpackHotkey(v); break;
+		case TagTextSize: decoded.textSize = (int)v; break;
+		case TagTextColor: decoded.textColor = v; break;
+		case TagBgColor: decoded.bgColor = v; break;
+		case TagSelectedBgColor: decoded.selectedBgColor = v; break;
+		case TagTranscriptLog: decoded.transcriptLog = v != 0; break;
+		case TagTranscriptFlushMs: decoded.transcriptFlushMs = (int)v; break;
+		case TagTranscriptRotateMB: decoded.transcriptRotateMB = (int)v; break;
+		default: break;  // written by a newer version
+		}
+	}
+	settings = decoded;
+	return true;
+}
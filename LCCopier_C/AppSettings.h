@@ -0,0 +1,49 @@
+#pragma once
+// Settings and their registry format (no Windows headers, so the serializer
+// builds and round-trips on Linux too). The whole AppSettings is stored as
+// one binary value: a header with format version, payload length and CRC-32,
+// then tag-length-value entries. Unknown tags are skipped and missing ones
+// keep their defaults, so settings can be added without a version bump; the
+// version changes only when an existing tag changes meaning.
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#define SETTINGS_BLOB_MAGIC      0x5453434Cu  // "LCST"
+#define SETTINGS_BLOB_VERSION    1
+#define SETTINGS_BLOB_MAX_BYTES  1024          // far above what the current tags need
+
+struct HotkeyConfig {
+	bool ctrl;
+	bool shift;
+	bool alt;
+	bool win;
+	uint32_t vkCode;
+};
+
+struct AppSettings {
+	bool darkMode;
+	bool setTop;
+	bool setInvisible;
+	bool middleButtonPaste;
+	bool middleButtonReplaceAll;
+	bool incrementalPaste;
+	int transparency;
+	HotkeyConfig autoCopyHotkey;
+	HotkeyConfig autoDeleteHotkey;
+	int textSize;
+	uint32_t textColor;         // COLORREF
+	uint32_t bgColor;
+	uint32_t selectedBgColor;
+	// Transcript log; registry only, no dialog controls.
+	bool transcriptLog;
+	int transcriptFlushMs;
+	int transcriptRotateMB;
+};
+
+std::vector<uint8_t> SerializeSettings(const AppSettings& settings);
+// False, leaving settings untouched, for a blob with the wrong magic, a newer
+// version, a bad length or checksum. Fields without a tag keep their value.
+bool DeserializeSettings(const uint8_t* data, size_t size, AppSettings& settings);
+
+uint32_t Crc32(const uint8_t* data, size_t size);
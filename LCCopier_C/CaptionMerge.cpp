@@ -0,0 +1,262 @@
+#include "CaptionMerge.h"
+#include "CaptionText.h"
+#include <algorithm>
+#include <cwctype>
+
+#define REPEAT_HASH_BASE   0x100000001B3ull
+#define REPEAT_TABLE_SLOTS 4096  // power of two, at least twice the windows indexed at once
+
+static uint64_t FoldedUnit(wchar_t ch) {
+	return (uint64_t)std::towlower(ch);
+}
+
+// Hash of the REPEAT_MIN_CHARS units ending at end.
+static uint64_t WindowHash(const std::wstring& text, size_t end) {
+	uint64_t hash = 0;
+	for (size_t i = end - REPEAT_MIN_CHARS; i < end; i++) hash = hash * REPEAT_HASH_BASE + FoldedUnit(text[i]);
+	return hash;
+}
+
+size_t RepeatIndex::Home(uint64_t hash) const {
+	// The polynomial hash mixes poorly into its low bits; take the high ones.
+	return (size_t)((hash * 0x9E3779B97F4A7C15ull) >> 52) & (REPEAT_TABLE_SLOTS - 1);
+}
+
+size_t RepeatIndex::Find(uint64_t hash) const {
+	size_t slot = Home(hash);
+	while (m_latest[slot].end && m_latest[slot].hash != hash) slot = (slot + 1) & (REPEAT_TABLE_SLOTS - 1);
+	return slot;
+}
+
+// Drop window from the table if it is still the latest occurrence of its hash.
+// An earlier occurrence it had replaced is forgotten too; that only costs a
+// missed repeat.
+void RepeatIndex::Forget(const Window& window) {
+	size_t hole = Find(window.hash);
+	if (m_latest[hole].end != window.end) return;
+	// Backward shift: pull later entries of the probe run into the hole unless
+	// that would put them before their home slot.
+	for (size_t slot = (hole + 1) & (REPEAT_TABLE_SLOTS - 1); m_latest[slot].end; slot = (slot + 1) & (REPEAT_TABLE_SLOTS - 1)) {
+		size_t home = Home(m_latest[slot].hash);
+		if (((slot - home) & (REPEAT_TABLE_SLOTS - 1)) >= ((slot - hole) & (REPEAT_TABLE_SLOTS - 1))) {
+			m_latest[hole] = m_latest[slot];
+			hole = slot;
+		}
+	}
+	m_latest[hole].end = 0;
+}
+
+void RepeatIndex::Clear() {
+	for (Window& slot : m_latest) slot.end = 0;
+	m_first = 0;
+	m_count = 0;
+	m_indexedEnd = 0;
+}
+
+void RepeatIndex::OnEdit(const HistoryEdit& edit, const std::wstring& history) {
+	if (edit.Empty()) return;
+	if (m_latest.empty()) {
+		m_latest.assign(REPEAT_TABLE_SLOTS, Window{ 0, 0 });
+		m_windows.assign(REPEAT_WINDOW + 1, Window{ 0, 0 });
+	}
+	// Windows reaching into the edited range no longer exist.
+	while (m_count && m_windows[(m_first + m_count - 1) % m_windows.size()].end > edit.offset) {
+		Forget(m_windows[(m_first + m_count - 1) % m_windows.size()]);
+		m_count--;
+	}
+	m_indexedEnd = (std::min)(m_indexedEnd, edit.offset);
+	// Nor do the ones that fell out of the last REPEAT_WINDOW units; dropped
+	// first, so the ring never holds more than REPEAT_WINDOW + 1 windows.
+	while (m_count && m_windows[m_first].end + REPEAT_WINDOW < history.length()) {
+		Forget(m_windows[m_first]);
+		m_first = (m_first + 1) % m_windows.size();
+		m_count--;
+	}
+
+	// Windows that would be evicted right away are not hashed.
+	size_t end = (std::max)(m_indexedEnd + 1, (size_t)REPEAT_MIN_CHARS);
+	if (history.length() > REPEAT_WINDOW) end = (std::max)(end, history.length() - REPEAT_WINDOW);
+	if (end <= history.length()) {
+		uint64_t power = 1;
+		for (int i = 1; i < REPEAT_MIN_CHARS; i++) power *= REPEAT_HASH_BASE;
+		uint64_t hash = WindowHash(history, end);
+		for (;;) {
+			Window window{ hash, end };
+			m_windows[(m_first + m_count++) % m_windows.size()] = window;
+			m_latest[Find(hash)] = window;
+			if (++end > history.length()) break;
+			hash = (hash - FoldedUnit(history[end - 1 - REPEAT_MIN_CHARS]) * power) * REPEAT_HASH_BASE + FoldedUnit(history[end - 1]);
+		}
+	}
+	m_indexedEnd = history.length();
+}
+
+size_t RepeatIndex::LongestRepeat(const std::wstring& history, const std::wstring& text, size_t& matchEnd) const {
+	if (text.length() < REPEAT_MIN_CHARS || m_latest.empty()) return 0;
+	size_t latest = m_latest[Find(WindowHash(text, REPEAT_MIN_CHARS))].end;
+	if (!latest || latest > history.length()) return 0;
+	size_t start = latest - REPEAT_MIN_CHARS;
+	size_t length = 0;
+	while (length < text.length() && start + length < history.length() &&
+		FoldedUnit(history[start + length]) == FoldedUnit(text[length])) length++;
+	if (length < REPEAT_MIN_CHARS) return 0;  // hash collision
+	matchEnd = start + length;
+	return length;
+}
+
+// Nothing but spaces and punctuation after offset: a revision can drop it.
+static bool OnlyPunctuationAfter(const std::wstring& history, size_t offset) {
+	for (size_t i = offset; i < history.length(); i++) {
+		if (std::iswalnum(history[i])) return false;
+	}
+	return true;
+}
+
+HistoryEdit ReplaceHistoryTail(std::wstring& history, size_t offset, std::wstring_view newTail) {
+	if (offset > history.length()) offset = history.length();
+	size_t common = 0;
+	size_t oldTailLen = history.length() - offset;
+	size_t limit = (std::min)(oldTailLen, newTail.length());
+	while (common < limit && history[offset + common] == newTail[common]) common++;
+	HistoryEdit edit;
+	edit.offset = offset + common;
+	edit.removed = oldTailLen - common;
+	edit.inserted = newTail.length() - common;
+	if (!edit.Empty()) {
+		history.replace(edit.offset, edit.removed, newTail, common, edit.inserted);
+	}
+	return edit;
+}
+
+// Case-folded copies of the snapshots being aligned. Kept per thread (the UI
+// thread, each capture worker) and reused, so they stop allocating once they
+// have grown to the caption length.
+struct MergeScratch {
+	std::wstring currentLower;
+	std::wstring previousLower;
+};
+static thread_local MergeScratch t_scratch;
+
+static void FoldInto(std::wstring& out, const std::wstring& text) {
+	out.assign(text);
+	FoldCase(out);
+}
+
+// Last occurrence in lower (folded) of text[start, start + length), folded.
+static size_t FindFolded(const std::wstring& lower, const std::wstring& text, size_t start, size_t length) {
+	for (size_t pos = lower.length() >= length ? lower.length() - length + 1 : 0; pos-- > 0;) {
+		size_t i = 0;
+		while (i < length && (wchar_t)FoldedUnit(text[start + i]) == lower[pos + i]) i++;
+		if (i == length) return pos;
+	}
+	return std::wstring::npos;
+}
+
+static HistoryEdit MergeSnapshot(std::wstring& history, std::wstring& previousCaption, const std::wstring& currentText,
+	const RepeatIndex* repeats) {
+	HistoryEdit edit;
+	if (previousCaption.empty()) {
+		edit = ReplaceHistoryTail(history, 0, currentText);
+		previousCaption = currentText;
+		return edit;
+	}
+	size_t prevLen = previousCaption.length();
+	size_t currLen = currentText.length();
+	if (currLen < prevLen) {
+		previousCaption = currentText;
+		return edit;
+	}
+	if (currLen <= prevLen + 1) {
+		previousCaption = currentText;
+		return edit;
+	}
+	const size_t patternLen = 20;
+	if (prevLen < patternLen) {
+		// Too short to align: the caption just started. If it was merged already,
+		// history ends with it; otherwise it restarted after a pause, and the
+		// new utterance follows what history has.
+		size_t tail = history.length() - prevLen;
+		if (history.length() >= prevLen && history.compare(tail, prevLen, previousCaption) == 0) {
+			edit = ReplaceHistoryTail(history, tail, currentText);
+		}
+		else if (history.empty()) {
+			edit = ReplaceHistoryTail(history, 0, currentText);
+		}
+		else {
+			edit.offset = history.length();
+			edit.inserted = currentText.length() + 1;
+			history += L' ';
+			history += currentText;
+		}
+		previousCaption = currentText;
+		return edit;
+	}
+	size_t maxShift = (std::min)(prevLen - patternLen, (size_t)200);
+	const std::wstring& currentLower = t_scratch.currentLower;
+	const std::wstring& previousLower = t_scratch.previousLower;
+	FoldInto(t_scratch.currentLower, currentText);
+	FoldInto(t_scratch.previousLower, previousCaption);
+
+	// The pattern is previousCaption[patternStart, patternStart + patternLen);
+	// the new part, currentText[newPart..].
+	size_t patternStart = 0;
+	size_t newPart = std::wstring::npos;
+	for (size_t shift = 0; shift <= maxShift; shift++) {
+		patternStart = prevLen - shift - patternLen;
+		newPart = currentLower.rfind(previousLower.data() + patternStart, std::wstring::npos, patternLen);
+		if (newPart != std::wstring::npos) break;
+	}
+	if (newPart != std::wstring::npos) {
+		size_t hpos = history.rfind(previousCaption.data() + patternStart, std::wstring::npos, patternLen);
+		if (hpos != std::wstring::npos) {
+			edit = ReplaceHistoryTail(history, hpos, std::wstring_view(currentText).substr(newPart));
+		}
+		else {
+			// The pattern came from a snapshot that was never merged (it was
+			// shorter, a line having scrolled away): continue after the end of
+			// history where the snapshot has it.
+			size_t historyEnd = history.length() >= patternLen ?
+				FindFolded(currentLower, history, history.length() - patternLen, patternLen) : std::wstring::npos;
+			if (historyEnd != std::wstring::npos) newPart = historyEnd + patternLen;
+			edit.offset = history.length();
+			edit.inserted = currentText.length() - newPart;
+			history.append(currentText, newPart, std::wstring::npos);
+		}
+	}
+	else {
+		size_t matchEnd = 0;
+		size_t repeat = repeats ? repeats->LongestRepeat(history, currentText, matchEnd) : 0;
+		if (repeat && OnlyPunctuationAfter(history, matchEnd)) {
+			// The reset re-emitted the end of history: continue from there.
+			edit = ReplaceHistoryTail(history, matchEnd - repeat, currentText);
+		}
+		else {
+			// Older text again: append only what follows it, from a word start.
+			if (repeat < currentText.length() && !std::iswspace(currentText[repeat])) {
+				while (repeat > 0 && !std::iswspace(currentText[repeat - 1])) repeat--;
+				if (repeat < REPEAT_MIN_CHARS) repeat = 0;
+			}
+			if (repeat) {
+				while (repeat < currentText.length() && std::iswspace(currentText[repeat])) repeat++;
+				if (repeat == currentText.length()) {
+					// Nothing new. previousCaption stays on the end of history, so the
+					// next snapshot cannot align against this repeat in the middle.
+					return edit;
+				}
+			}
+			edit.offset = history.length();
+			edit.inserted = currentText.length() - repeat + 1;
+			history += L' ';
+			history.append(currentText, repeat, std::wstring::npos);
+		}
+	}
+	previousCaption = currentText;
+	return edit;
+}
+
+HistoryEdit MergeCaptionSnapshot(std::wstring& history, std::wstring& previousCaption, const std::wstring& currentText,
+	RepeatIndex* repeats) {
+	HistoryEdit edit = MergeSnapshot(history, previousCaption, currentText, repeats);
+	if (repeats) repeats->OnEdit(edit, history);
+	return edit;
+}
@@ -0,0 +1,66 @@
+#pragma once
+// Portable caption merge: folds successive Live Caption snapshots into one
+// growing history. No Windows headers, so it can be exercised headlessly.
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// What a merge did to the history: units [offset, offset + removed) were
+// replaced by `inserted` new units. Everything before offset is unchanged.
+struct HistoryEdit {
+	size_t offset = 0;
+	size_t removed = 0;
+	size_t inserted = 0;
+	bool Empty() const { return removed == 0 && inserted == 0; }
+};
+
+#define REPEAT_WINDOW     2048  // units at the end of history that RepeatIndex covers
+#define REPEAT_MIN_CHARS  24    // shortest repeat worth suppressing; also the hash window
+
+// Rolling hash of every REPEAT_MIN_CHARS-unit window (case-folded) in the last
+// REPEAT_WINDOW units of history, so a snapshot that cannot be aligned can be
+// checked for text history already has. Updating it costs time in proportion
+// to the units an edit inserts; a lookup, to the length of the snapshot.
+// Storage is fixed-size and allocated on first use, so updates never allocate.
+class RepeatIndex {
+public:
+	void Clear();
+	// Keep in step with history; MergeCaptionSnapshot does this for its edits.
+	void OnEdit(const HistoryEdit& edit, const std::wstring& history);
+	// Length of the longest prefix of text found in the indexed history (0 if
+	// shorter than REPEAT_MIN_CHARS), compared case-insensitively. matchEnd is
+	// where that occurrence ends in history.
+	size_t LongestRepeat(const std::wstring& history, const std::wstring& text, size_t& matchEnd) const;
+
+private:
+	struct Window {
+		uint64_t hash;
+		size_t end;  // 0: empty slot (a window ends at REPEAT_MIN_CHARS or later)
+	};
+	size_t Home(uint64_t hash) const;
+	size_t Find(uint64_t hash) const;
+	void Forget(const Window& window);
+
+	// Open-addressed, linear probing: window hash -> end of its latest occurrence.
+	std::vector<Window> m_latest;
+	// Ring of the indexed windows, by end.
+	std::vector<Window> m_windows;
+	size_t m_first = 0;
+	size_t m_count = 0;
+	size_t m_indexedEnd = 0;  // windows ending at or before this are indexed
+};
+
+// Merge the current Live Caption text into history. previousCaption is the
+// snapshot seen on the last call and is updated. Returns the minimal tail edit
+// applied to history (an empty edit when the snapshot added nothing).
+// With repeats, a snapshot that cannot be aligned (an ASR reset) only adds
+// what history does not already end with; repeats is updated for every edit.
+// Case folding uses per-thread scratch buffers, so once those and history have
+// grown to their working size a merge does not allocate.
+HistoryEdit MergeCaptionSnapshot(std::wstring& history, std::wstring& previousCaption, const std::wstring& currentText,
+	RepeatIndex* repeats = nullptr);
+
+// Replace history[offset..] with newTail, skipping the prefix both already share.
+HistoryEdit ReplaceHistoryTail(std::wstring& history, size_t offset, std::wstring_view newTail);
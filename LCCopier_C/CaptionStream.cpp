@@ -0,0 +1,201 @@
+#include "CaptionStream.h"
+#include "CaptionText.h"
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+
+void StreamSubscription::PushLocked(StreamFrame&& frame) {
+	m_queuedBytes += frame.text.size() * sizeof(wchar_t);
+	m_queue.push_back(std::move(frame));
+}
+
+bool StreamSubscription::Wait(std::vector<StreamFrame>& out, uint32_t timeoutMs) {
+	std::unique_lock<std::mutex> lock(m_lock);
+	m_ready.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] { return m_closed || !m_queue.empty(); });
+	if (m_closed) return false;
+	for (StreamFrame& frame : m_queue) out.push_back(std::move(frame));
+	m_queue.clear();
+	m_queuedBytes = 0;
+	return true;
+}
+
+void StreamSubscription::Close() {
+	std::lock_guard<std::mutex> lock(m_lock);
+	m_closed = true;
+	m_ready.notify_all();
+}
+
+bool StreamSubscription::Closed() {
+	std::lock_guard<std::mutex> lock(m_lock);
+	return m_closed;
+}
+
+CaptionStream::CaptionStream(size_t queueBytes, StreamOverflow overflow)
+	: m_queueBytes(queueBytes), m_overflow(overflow),
+	m_session((uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count()) {
+}
+
+void CaptionStream::Publish(const HistoryEdit& edit, const std::wstring& history) {
+	if (edit.Empty()) return;
+	uint64_t seq = ++m_seq;
+	m_edits[seq % STREAM_EDIT_LOG] = EditMark{ seq, edit.offset };
+
+	std::lock_guard<std::mutex> lock(m_lock);
+	if (m_subscribers.empty()) return;
+	StreamFrame frame;
+	frame.seq = seq;
+	frame.offset = (std::min)(edit.offset, history.size());
+	frame.text.assign(history, frame.offset, std::wstring::npos);
+
+	for (auto it = m_subscribers.begin(); it != m_subscribers.end();) {
+		StreamSubscription& s = **it;
+		bool drop = false;
+		{
+			std::lock_guard<std::mutex> subscriberLock(s.m_lock);
+			if (s.m_closed) {
+				drop = true;
+			}
+			else if (s.m_started) {
+				if (s.m_queuedBytes + frame.text.size() * sizeof(wchar_t) <= m_queueBytes) {
+					s.PushLocked(StreamFrame(frame));
+				}
+				else if (m_overflow == StreamOverflow::Coalesce) {
+					// The reader is behind: fold everything it has not read into one frame.
+					// A reader that never caught up with its first frame may take the whole
+					// transcript; after that the tail has to fit the budget.
+					size_t low = frame.offset;
+					bool first = false;
+					for (const StreamFrame& queued : s.m_queue) {
+						low = (std::min)(low, queued.offset);
+						first = first || queued.first;
+					}
+					if (!first && (history.size() - low) * sizeof(wchar_t) > m_queueBytes) {
+						drop = true;
+					}
+					else {
+						s.m_queue.clear();
+						s.m_queuedBytes = 0;
+						StreamFrame merged;
+						merged.seq = seq;
+						merged.offset = low;
+						merged.text.assign(history, low, std::wstring::npos);
+						merged.first = first;
+						s.PushLocked(std::move(merged));
+						m_coalesced++;
+					}
+				}
+				else {
+					drop = true;
+				}
+				if (!drop) s.m_ready.notify_one();
+			}
+			if (drop && !s.m_closed) {
+				s.m_closed = true;
+				s.m_ready.notify_all();
+				m_disconnected++;
+			}
+		}
+		if (drop) it = m_subscribers.erase(it);
+		else ++it;
+	}
+}
+
+size_t CaptionStream::ResumeOffset(const StreamSubscription& s) const {
+	if (s.m_resumeSession != m_session || s.m_resumeSeq > m_seq) return 0;
+	if (m_seq - s.m_resumeSeq >= STREAM_EDIT_LOG) return 0;
+	// Everything the client has below the lowest offset edited since its seq is still valid.
+	size_t offset = s.m_resumeOffset;
+	for (uint64_t seq = s.m_resumeSeq + 1; seq <= m_seq; seq++) {
+		offset = (std::min)(offset, m_edits[seq % STREAM_EDIT_LOG].offset);
+	}
+	return offset;
+}
+
+void CaptionStream::Service(const std::wstring& history) {
+	std::lock_guard<std::mutex> lock(m_lock);
+	if (!m_pending) return;
+	m_pending = false;
+	for (const std::shared_ptr<StreamSubscription>& s : m_subscribers) {
+		std::lock_guard<std::mutex> subscriberLock(s->m_lock);
+		if (s->m_started || s->m_closed) continue;
+		StreamFrame frame;
+		frame.seq = m_seq;
+		frame.offset = (std::min)(ResumeOffset(*s), history.size());
+		frame.text.assign(history, frame.offset, std::wstring::npos);
+		frame.first = true;
+		s->PushLocked(std::move(frame));
+		s->m_started = true;
+		s->m_ready.notify_one();
+	}
+}
+
+std::shared_ptr<StreamSubscription> CaptionStream::Subscribe(uint64_t session, uint64_t seq, size_t resumeOffset) {
+	std::lock_guard<std::mutex> lock(m_lock);
+	if (m_subscribers.size() >= STREAM_MAX_SUBSCRIBERS) return nullptr;
+	auto s = std::make_shared<StreamSubscription>();
+	s->m_resumeSession = session;
+	s->m_resumeSeq = seq;
+	s->m_resumeOffset = resumeOffset;
+	m_subscribers.push_back(s);
+	m_pending = true;
+	m_subscribes++;
+	return s;
+}
+
+void CaptionStream::Unsubscribe(const std::shared_ptr<StreamSubscription>& subscription) {
+	if (!subscription) return;
+	subscription->Close();
+	std::lock_guard<std::mutex> lock(m_lock);
+	m_subscribers.erase(std::remove(m_subscribers.begin(), m_subscribers.end(), subscription), m_subscribers.end());
+}
+
+std::wstring CaptionStream::Describe() {
+	std::lock_guard<std::mutex> lock(m_lock);
+	wchar_t line[160];
+	swprintf(line, 160, L"stream: %zu subscribers, %llu subscribes, %llu coalesced, %llu disconnected, seq %llu\r\n",
+		m_subscribers.size(), (unsigned long long)m_subscribes, (unsigned long long)m_coalesced,
+		(unsigned long long)m_disconnected, (unsigned long long)m_seq);
+	std::wstring out = line;
+	for (size_t i = 0; i < m_subscribers.size(); i++) {
+		StreamSubscription& s = *m_subscribers[i];
+		std::lock_guard<std::mutex> subscriberLock(s.m_lock);
+		swprintf(line, 160, L"  #%zu: %zu frames, %zu bytes queued\r\n", i, s.m_queue.size(), s.m_queuedBytes);
+		out += line;
+	}
+	return out;
+}
+
+void CaptionStream::EncodeFrame(const StreamFrame& frame, uint64_t session, std::string& out) {
+	char head[96];
+	if (frame.first) {
+		snprintf(head, sizeof(head), "{\"session\":%" PRIu64 ",\"seq\":%" PRIu64 ",\"offset\":%zu,\"text\":\"",
+			session, frame.seq, frame.offset);
+	}
+	else {
+		snprintf(head, sizeof(head), "{\"seq\":%" PRIu64 ",\"offset\":%zu,\"text\":\"", frame.seq, frame.offset);
+	}
+	out += head;
+	const std::wstring& text = frame.text;
+	for (size_t i = 0; i < text.size();) {
+		uint32_t cp = NextCodePoint(text, i);
+		switch (cp) {
+		case '"': out += "\\\""; break;
+		case '\\': out += "\\\\"; break;
+		case '\n': out += "\\n"; break;
+		case '\r': out += "\\r"; break;
+		case '\t': out += "\\t"; break;
+		default:
+			if (cp < 0x20) {
+				char escape[8];
+				snprintf(escape, sizeof(escape), "\\u%04x", cp);
+				out += escape;
+			}
+			else {
+				AppendUtf8(out, cp);
+			}
+		}
+	}
+	out += "\"}\n";
+}
@@ -0,0 +1,103 @@
+#pragma once
+// Portable fan-out of transcript edits to local subscribers (StreamServer is
+// the transport). The caption thread publishes every HistoryEdit; each
+// subscriber has its own bounded queue, drained by a transport thread, so a
+// slow reader never blocks the caption pipeline.
+//
+// Every frame means "truncate your copy of the transcript to offset, then
+// append text". Offsets count wchar_t units of the history (UTF-16 code
+// units on Windows); the text itself goes out as UTF-8. Frames compose: any
+// run of queued frames collapses into one (lowest offset, current tail),
+// which is what happens when a queue overflows.
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "CaptionMerge.h"
+
+#define STREAM_QUEUE_BYTES       (256 * 1024)  // per subscriber, UTF-16 text bytes queued
+#define STREAM_MAX_SUBSCRIBERS   8
+#define STREAM_EDIT_LOG          1024          // recent edit offsets kept for resuming
+
+enum class StreamOverflow {
+	Coalesce,    // replace the queue with one frame covering everything it held
+	Disconnect,  // drop the subscriber; it can reconnect and resume
+};
+
+struct StreamFrame {
+	uint64_t seq = 0;      // sequence number of the last edit this frame includes
+	size_t offset = 0;
+	std::wstring text;
+	bool first = false;    // the frame that answers a subscribe (carries the session id)
+};
+
+class CaptionStream;
+
+// One subscriber's queue. Created by CaptionStream::Subscribe and shared with
+// the transport thread that drains it.
+class StreamSubscription {
+public:
+	// Transport side: wait up to timeoutMs for frames and move them into out.
+	// Returns false once the subscription is closed.
+	bool Wait(std::vector<StreamFrame>& out, uint32_t timeoutMs);
+	void Close();
+	bool Closed();
+
+private:
+	friend class CaptionStream;
+	void PushLocked(StreamFrame&& frame);
+
+	std::mutex m_lock;
+	std::condition_variable m_ready;
+	std::deque<StreamFrame> m_queue;
+	size_t m_queuedBytes = 0;
+	bool m_closed = false;
+	bool m_started = false;        // the resume frame has been queued
+	uint64_t m_resumeSession = 0;
+	uint64_t m_resumeSeq = 0;
+	size_t m_resumeOffset = 0;
+};
+
+class CaptionStream {
+public:
+	explicit CaptionStream(size_t queueBytes = STREAM_QUEUE_BYTES, StreamOverflow overflow = StreamOverflow::Coalesce);
+
+	// Caption thread. history is the transcript after the edit was applied.
+	void Publish(const HistoryEdit& edit, const std::wstring& history);
+	// Caption thread, once per poll tick: answers pending subscribes.
+	void Service(const std::wstring& history);
+
+	// Transport threads. A client that saw (session, seq) with a transcript
+	// of resumeOffset units gets only what changed since; anything it cannot
+	// prove (other session, edit log overrun) gets the whole transcript.
+	// Returns nullptr when STREAM_MAX_SUBSCRIBERS are connected.
+	std::shared_ptr<StreamSubscription> Subscribe(uint64_t session, uint64_t seq, size_t resumeOffset);
+	void Unsubscribe(const std::shared_ptr<StreamSubscription>& subscription);
+
+	uint64_t Session() const { return m_session; }
+	std::wstring Describe();
+
+	// One JSON object per line, UTF-8:
+	//   {"seq":N,"offset":N,"text":"..."}  (the first frame also has "session")
+	static void EncodeFrame(const StreamFrame& frame, uint64_t session, std::string& out);
+
+private:
+	size_t ResumeOffset(const StreamSubscription& s) const;
+
+	const size_t m_queueBytes;
+	const StreamOverflow m_overflow;
+	const uint64_t m_session;
+	std::mutex m_lock;  // subscriber list; never held while waiting on a subscriber
+	std::vector<std::shared_ptr<StreamSubscription>> m_subscribers;
+	bool m_pending = false;  // a subscriber is waiting for Service()
+	uint64_t m_seq = 0;      // caption thread only
+	struct EditMark { uint64_t seq; size_t offset; };
+	EditMark m_edits[STREAM_EDIT_LOG] = {};  // ring, caption thread only
+	uint64_t m_coalesced = 0;
+	uint64_t m_disconnected = 0;
+	uint64_t m_subscribes = 0;
+};
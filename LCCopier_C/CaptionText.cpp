@@ -0,0 +1,204 @@
+#include "CaptionText.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cwchar>
+#include <cwctype>
+
+void FoldCase(std::wstring& s) {
+	std::transform(s.begin(), s.end(), s.begin(), ::towlower);
+}
+
+int FindWordStart(const std::wstring& text, int pos) {
+	if (text.empty() || pos <= 0) return 0;
+	if (pos >= (int)text.length()) pos = (int)text.length() - 1;
+	while (pos > 0) {
+		wchar_t ch = text[pos - 1];
+		if (ch == L' ' || ch == L'\t' || ch == L'\r' || ch == L'\n' || ch == L'.' || ch == L',' || ch == L'!' || ch == L'?') {
+			break;
+		}
+		pos--;
+	}
+	return pos;
+}
+
+// Case-insensitive comparisons against lower-case needles, without folding a
+// copy of the text: these run on every UIA node and window of every poll.
+static wchar_t FoldedUnit(wchar_t ch) {
+	if (ch < 0x80) return ch >= L'A' && ch <= L'Z' ? (wchar_t)(ch + 32) : ch;
+	return (wchar_t)::towlower(ch);
+}
+
+static bool StartsWithFolded(const wchar_t* text, const wchar_t* lower) {
+	for (; *lower; text++, lower++) {
+		if (!*text || FoldedUnit(*text) != *lower) return false;
+	}
+	return true;
+}
+
+static bool ContainsFolded(const wchar_t* text, const wchar_t* lower) {
+	for (; *text; text++) {
+		if (FoldedUnit(*text) == lower[0] && StartsWithFolded(text + 1, lower + 1)) return true;
+	}
+	return false;
+}
+
+static bool EqualsFolded(const wchar_t* text, const wchar_t* lower) {
+	return StartsWithFolded(text, lower) && !text[wcslen(lower)];
+}
+
+bool IsUiChrome(const wchar_t* name) {
+	if (!name || !*name) return true;
+	if (ContainsFolded(name, L"live caption")) return true;
+	if (EqualsFolded(name, L"settings") || EqualsFolded(name, L"position") || EqualsFolded(name, L"preferences")) return true;
+	if (ContainsFolded(name, L"caption style")) return true;
+	if (StartsWithFolded(name, L"edit") && wcslen(name) <= 5) return true;
+	return false;
+}
+
+bool IsLiveCaptionTitle(const wchar_t* title) {
+	if (!title || !*title) return false;
+	return ContainsFolded(title, L"live caption");
+}
+
+uint32_t NextCodePoint(const std::wstring& text, size_t& i) {
+	uint32_t cp = (uint32_t)text[i++];
+	if (cp >= 0xD800 && cp <= 0xDBFF && i < text.size() && text[i] >= 0xDC00 && text[i] <= 0xDFFF) {
+		return 0x10000 + ((cp - 0xD800) << 10) + ((uint32_t)text[i++] - 0xDC00);
+	}
+	if (cp >= 0xD800 && cp <= 0xDFFF) return 0xFFFD;
+	return cp;
+}
+
+void AppendUtf8(std::string& out, uint32_t cp) {
+	if (cp < 0x80) {
+		out += (char)cp;
+	}
+	else if (cp < 0x800) {
+		out += (char)(0xC0 | (cp >> 6));
+		out += (char)(0x80 | (cp & 0x3F));
+	}
+	else if (cp < 0x10000) {
+		out += (char)(0xE0 | (cp >> 12));
+		out += (char)(0x80 | ((cp >> 6) & 0x3F));
+		out += (char)(0x80 | (cp & 0x3F));
+	}
+	else {
+		out += (char)(0xF0 | (cp >> 18));
+		out += (char)(0x80 | ((cp >> 12) & 0x3F));
+		out += (char)(0x80 | ((cp >> 6) & 0x3F));
+		out += (char)(0x80 | (cp & 0x3F));
+	}
+}
+
+void AppendUtf8(std::string& out, const std::wstring& text, size_t start, size_t length) {
+	size_t end = length == std::wstring::npos || start + length > text.size() ? text.size() : start + length;
+	for (size_t i = start; i < end;) AppendUtf8(out, NextCodePoint(text, i));
+}
+
+uint32_t NextUtf8CodePoint(const char* bytes, size_t size, size_t& i) {
+	unsigned char c = (unsigned char)bytes[i];
+	size_t extra = c < 0x80 ? 0 : c >= 0xF0 && c < 0xF8 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : 4;
+	uint32_t cp = extra == 0 ? c : extra == 1 ? (c & 0x1F) : extra == 2 ? (c & 0x0F) : (c & 0x07);
+	bool valid = extra < 4;  // 4: stray continuation byte or invalid lead
+	for (size_t k = 1; valid && k <= extra; k++) {
+		if (i + k >= size || ((unsigned char)bytes[i + k] & 0xC0) != 0x80) valid = false;
+		else cp = (cp << 6) | ((unsigned char)bytes[i + k] & 0x3F);
+	}
+	if (!valid || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+		i++;
+		return 0xFFFD;
+	}
+	i += 1 + extra;
+	return cp;
+}
+
+std::wstring DecodeUtf8(const std::string& bytes) {
+	std::wstring out;
+	out.reserve(bytes.size());
+	for (size_t i = 0; i < bytes.size();) {
+		uint32_t cp = NextUtf8CodePoint(bytes.data(), bytes.size(), i);
+		if (sizeof(wchar_t) == 2 && cp >= 0x10000) {
+			out += (wchar_t)(0xD800 + ((cp - 0x10000) >> 10));
+			out += (wchar_t)(0xDC00 + ((cp - 0x10000) & 0x3FF));
+		}
+		else {
+			out += (wchar_t)cp;
+		}
+	}
+	return out;
+}
+
+// Letters and digits outside the BMP are not terms where wchar_t is 16 bits;
+// towlower and iswalnum cannot see them there.
+static bool IsTermChar(uint32_t cp) {
+	if (cp > 0xFFFF && sizeof(wchar_t) == 2) return false;
+	return cp == '\'' || std::iswalnum((wint_t)cp);
+}
+
+bool NextUtf8Term(const char* bytes, size_t size, size_t& i, std::string& term, size_t& termStart) {
+	while (i < size) {
+		term.clear();
+		while (i < size) {
+			size_t start = i;
+			uint32_t cp = NextUtf8CodePoint(bytes, size, i);
+			if (!IsTermChar(cp)) {
+				if (!term.empty()) {
+					i = start;
+					break;
+				}
+				continue;
+			}
+			if (term.empty()) termStart = start;
+			AppendUtf8(term, (uint32_t)std::towlower((wint_t)cp));
+		}
+		// Apostrophes join words ("don't") but do not make a term on their own.
+		while (!term.empty() && term.back() == '\'') term.pop_back();
+		while (!term.empty() && term.front() == '\'') {
+			term.erase(0, 1);
+			termStart++;
+		}
+		if (!term.empty()) return true;
+	}
+	return false;
+}
+
+void AppendSnapshotLine(std::string& out, uint64_t ms, const std::wstring& text) {
+	char head[32];
+	snprintf(head, sizeof(head), "%" PRIu64 "\t", ms);
+	out += head;
+	for (size_t i = 0; i < text.size();) {
+		uint32_t cp = NextCodePoint(text, i);
+		switch (cp) {
+		case '\\': out += "\\\\"; break;
+		case '\t': out += "\\t"; break;
+		case '\n': out += "\\n"; break;
+		case '\r': out += "\\r"; break;
+		default: AppendUtf8(out, cp);
+		}
+	}
+	out += '\n';
+}
+
+bool ParseSnapshotLine(const std::string& line, uint64_t& ms, std::wstring& text) {
+	size_t tab = line.find('\t');
+	if (tab == std::string::npos || tab == 0) return false;
+	char* end = nullptr;
+	ms = strtoull(line.c_str(), &end, 10);
+	if (end != line.c_str() + tab) return false;
+	std::string raw;
+	for (size_t i = tab + 1; i < line.size(); i++) {
+		char ch = line[i];
+		if (ch == '\r' || ch == '\n') break;
+		if (ch == '\\' && i + 1 < line.size()) {
+			char e = line[++i];
+			raw += e == 't' ? '\t' : e == 'n' ? '\n' : e == 'r' ? '\r' : e;
+		}
+		else {
+			raw += ch;
+		}
+	}
+	text = DecodeUtf8(raw);
+	return true;
+}
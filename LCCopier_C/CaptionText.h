@@ -0,0 +1,39 @@
+#pragma once
+// Portable text helpers for captions and the UIA tree (no Windows headers).
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Lower-case s in place, the way the caption matching compares text.
+void FoldCase(std::wstring& s);
+
+// Start of the word containing pos (after the last space, line break or
+// sentence punctuation before it). pos past the end is clamped.
+int FindWordStart(const std::wstring& text, int pos);
+
+// True for names of Live Caption's own UI elements (window title, menus, the
+// settings panel), which must not be mistaken for caption text.
+bool IsUiChrome(const wchar_t* name);
+
+// True for a top-level window title that belongs to Live Caption.
+bool IsLiveCaptionTitle(const wchar_t* title);
+
+// Code point at text[i], advancing i past it. Where wchar_t is UTF-16
+// (Windows) surrogate pairs are joined; a lone surrogate becomes U+FFFD.
+uint32_t NextCodePoint(const std::wstring& text, size_t& i);
+void AppendUtf8(std::string& out, uint32_t codePoint);
+void AppendUtf8(std::string& out, const std::wstring& text, size_t start = 0, size_t length = std::wstring::npos);
+// Code point at bytes[i], advancing i past it. Malformed sequences become
+// U+FFFD, one byte at a time.
+uint32_t NextUtf8CodePoint(const char* bytes, size_t size, size_t& i);
+// Malformed sequences become U+FFFD.
+std::wstring DecodeUtf8(const std::string& bytes);
+// Next search term at or after bytes[i]: a run of letters, digits and
+// apostrophes, lower-cased, as UTF-8. termStart is its byte offset. Advances i
+// past the term; false at the end of the text.
+bool NextUtf8Term(const char* bytes, size_t size, size_t& i, std::string& term, size_t& termStart);
+
+// Recorded snapshot streams (--record, bench tools): one snapshot per line,
+// "<ms>\t<text>", UTF-8, with backslash, tab and line breaks escaped.
+void AppendSnapshotLine(std::string& out, uint64_t ms, const std::wstring& text);
+bool ParseSnapshotLine(const std::string& line, uint64_t& ms, std::wstring& text);
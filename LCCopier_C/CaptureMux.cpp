@@ -0,0 +1,223 @@
+#include "CaptureMux.h"
+#include <algorithm>
+#include <chrono>
+
+static uint64_t NowMs() {
+	return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct CaptureMux::Source {
+	CaptureSourceSpec spec;
+	// Schedule, under m_lock.
+	uint64_t dueMs = 0;
+	bool busy = false;
+	// Merge state, only touched by the worker that holds the source busy.
+	std::wstring last;
+	std::wstring previous;
+	RepeatIndex repeats;
+	// Read by other threads: under lock.
+	mutable std::mutex lock;
+	std::wstring history;
+	uint64_t polls = 0, misses = 0, changes = 0;
+	uint64_t captureUs = 0, slowestUs = 0;
+	// Sequence numbers of this source's live timeline segments, by offset;
+	// under m_timelineLock.
+	std::deque<uint64_t> segments;
+};
+
+CaptureMux::CaptureMux() {
+}
+
+CaptureMux::~CaptureMux() {
+	Stop();
+}
+
+size_t CaptureMux::AddSource(const CaptureSourceSpec& spec) {
+	if (Running()) return m_sources.size();
+	m_sources.push_back(std::make_unique<Source>());
+	Source& src = *m_sources.back();
+	src.spec = spec;
+	src.spec.pollMs = (std::max)(spec.pollMs, (uint32_t)CAPTURE_MIN_POLL_MS);
+	return m_sources.size() - 1;
+}
+
+bool CaptureMux::Start(const CaptureFn& capture, unsigned threads, bool timeline, const ThreadFn& threadStart, const ThreadFn& threadEnd) {
+	if (Running()) return true;
+	if (m_sources.empty() || !capture) return false;
+	m_capture = capture;
+	m_threadStart = threadStart;
+	m_threadEnd = threadEnd;
+	m_timeline = timeline;
+	if (threads == 0) threads = (unsigned)(std::min)(m_sources.size(), (size_t)CAPTURE_MAX_THREADS);
+	uint64_t now = NowMs();
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_stopping = false;
+		for (auto& src : m_sources) src->dueMs = now;
+	}
+	for (unsigned i = 0; i < threads; i++) m_workers.emplace_back(&CaptureMux::WorkerLoop, this);
+	return true;
+}
+
+void CaptureMux::Stop() {
+	if (!Running()) return;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_stopping = true;
+	}
+	m_wake.notify_all();
+	for (std::thread& worker : m_workers) worker.join();
+	m_workers.clear();
+}
+
+void CaptureMux::WorkerLoop() {
+	if (m_threadStart) m_threadStart();
+	std::unique_lock<std::mutex> lock(m_lock);
+	while (!m_stopping) {
+		// The idle source that is due first; a handful of sources, so a scan.
+		size_t next = m_sources.size();
+		for (size_t i = 0; i < m_sources.size(); i++) {
+			const Source& src = *m_sources[i];
+			if (!src.busy && (next == m_sources.size() || src.dueMs < m_sources[next]->dueMs)) next = i;
+		}
+		if (next == m_sources.size()) {
+			m_wake.wait(lock);
+			continue;
+		}
+		Source& src = *m_sources[next];
+		uint64_t now = NowMs();
+		if (src.dueMs > now) {
+			// Re-evaluated on wake: another worker may have freed an earlier source.
+			m_wake.wait_for(lock, std::chrono::milliseconds(src.dueMs - now));
+			continue;
+		}
+		src.busy = true;
+		lock.unlock();
+		Poll(next);
+		lock.lock();
+		src.busy = false;
+		// Keep the cadence, but skip polls that were missed rather than bunch up.
+		src.dueMs = (std::max)(src.dueMs + src.spec.pollMs, NowMs());
+		m_wake.notify_one();
+	}
+	lock.unlock();
+	if (m_threadEnd) m_threadEnd();
+}
+
+void CaptureMux::Poll(size_t source) {
+	Source& src = *m_sources[source];
+	auto started = std::chrono::steady_clock::now();
+	std::wstring text;
+	bool captured = m_capture(source, src.spec, text);
+	uint64_t us = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - started).count();
+
+	std::lock_guard<std::mutex> lock(src.lock);
+	src.polls++;
+	src.captureUs += us;
+	src.slowestUs = (std::max)(src.slowestUs, us);
+	if (!captured) {
+		src.misses++;
+		return;
+	}
+	// Same gating as the main poll: unchanged and empty snapshots merge nothing.
+	if (text == src.last) return;
+	src.changes++;
+	if (!text.empty()) {
+		HistoryEdit edit = MergeCaptionSnapshot(src.history, src.previous, text, &src.repeats);
+		if (m_timeline && !edit.Empty()) Record(source, src, edit, NowMs());
+	}
+	src.last = std::move(text);
+}
+
+void CaptureMux::Record(size_t source, Source& src, const HistoryEdit& edit, uint64_t nowMs) {
+	std::lock_guard<std::mutex> lock(m_timelineLock);
+	// Cut this source's segments back to the edit; a rewrite's new text is
+	// placed at the time it arrived.
+	while (!src.segments.empty()) {
+		Segment& segment = m_segments[(size_t)(src.segments.back() - m_segmentBase)];
+		if (segment.start < edit.offset) {
+			segment.end = (std::min)(segment.end, edit.offset);
+			break;
+		}
+		segment.end = segment.start;
+		src.segments.pop_back();
+	}
+	if (edit.inserted) {
+		if (!src.segments.empty() && src.segments.back() == m_segmentBase + m_segments.size() - 1 &&
+			m_segments.back().end == edit.offset) {
+			m_segments.back().end += edit.inserted;  // still the latest arrival: extend it
+		}
+		else {
+			m_segments.push_back(Segment{ nowMs, source, edit.offset, edit.offset + edit.inserted });
+			src.segments.push_back(m_segmentBase + m_segments.size() - 1);
+		}
+	}
+	if (m_segments.size() <= CAPTURE_TIMELINE_SEGMENTS) return;
+	while (m_segments.size() > CAPTURE_TIMELINE_SEGMENTS) {
+		m_segments.pop_front();
+		m_segmentBase++;
+	}
+	// Every source's list starts at its oldest live segment, so a source that
+	// only appends does not keep the numbers of dropped ones.
+	for (auto& other : m_sources) {
+		while (!other->segments.empty() && other->segments.front() < m_segmentBase) other->segments.pop_front();
+	}
+}
+
+const CaptureSourceSpec& CaptureMux::Spec(size_t source) const {
+	return m_sources[source]->spec;
+}
+
+std::wstring CaptureMux::History(size_t source) const {
+	const Source& src = *m_sources[source];
+	std::lock_guard<std::mutex> lock(src.lock);
+	return src.history;
+}
+
+std::wstring CaptureMux::Timeline() const {
+	if (!m_timeline) return std::wstring();
+	// Copies first, so no source lock is taken inside the timeline lock; a
+	// merge in between only makes a segment end past its copy, which is clamped.
+	std::vector<std::wstring> histories;
+	for (size_t i = 0; i < m_sources.size(); i++) histories.push_back(History(i));
+	std::wstring out;
+	size_t current = m_sources.size();
+	std::lock_guard<std::mutex> lock(m_timelineLock);
+	for (const Segment& segment : m_segments) {
+		const std::wstring& history = histories[segment.source];
+		size_t end = (std::min)(segment.end, history.size());
+		if (segment.start >= end) continue;
+		if (segment.source != current) {
+			if (!out.empty()) out += L"\r\n";
+			out += L"[" + m_sources[segment.source]->spec.name + L"] ";
+			current = segment.source;
+		}
+		out.append(history, segment.start, end - segment.start);
+	}
+	return out;
+}
+
+std::wstring CaptureMux::Describe() const {
+	std::wstring out;
+	wchar_t line[256];
+	swprintf(line, 256, L"capture sources: %zu on %zu threads%ls\r\n", m_sources.size(), m_workers.size(),
+		m_timeline ? L", with timeline" : L"");
+	out += line;
+	for (const auto& src : m_sources) {
+		std::lock_guard<std::mutex> lock(src->lock);
+		swprintf(line, 256, L"  %ls: every %u ms, %llu polls (%llu unavailable), %llu changed, %zu chars, capture mean %.1f ms, max %.1f ms",
+			src->spec.name.c_str(), src->spec.pollMs, (unsigned long long)src->polls, (unsigned long long)src->misses,
+			(unsigned long long)src->changes, src->history.size(),
+			src->polls ? src->captureUs / 1000.0 / src->polls : 0.0, src->slowestUs / 1000.0);
+		out += line;
+		if (m_timeline) {
+			std::lock_guard<std::mutex> timelineLock(m_timelineLock);
+			swprintf(line, 256, L", %zu timeline runs", src->segments.size());
+			out += line;
+		}
+		out += L"\r\n";
+	}
+	return out;
+}
@@ -0,0 +1,90 @@
+#pragma once
+// Portable capture multiplexer: polls extra caption sources (a translated
+// caption window, a meeting app's CC pane, ...) next to the main Live Caption
+// poll. Each source has its own cadence and merge state and is captured and
+// merged on a small worker pool, so the UI thread does no work per source;
+// readers take copies of the per-source histories or of the interleaved
+// timeline when they need them.
+//
+// The capture itself is supplied by the caller (UI Automation in the app),
+// together with optional per-thread setup and teardown such as COM init.
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "CaptionMerge.h"
+
+#define CAPTURE_POLL_MS           400
+#define CAPTURE_MIN_POLL_MS       50
+#define CAPTURE_MAX_THREADS       4
+#ifndef CAPTURE_TIMELINE_SEGMENTS
+#define CAPTURE_TIMELINE_SEGMENTS 65536  // oldest segments are dropped beyond this (benches build with less)
+#endif
+
+struct CaptureSourceSpec {
+	std::wstring name;    // label in the timeline and diagnostics
+	std::wstring match;   // what the capture function looks for (window title text in the app)
+	uint32_t pollMs = CAPTURE_POLL_MS;
+};
+
+class CaptureMux {
+public:
+	// Called on a worker thread; false when the source is not available now.
+	// One source is never captured by two workers at once, so per-source state
+	// indexed by source (as returned by AddSource) needs no lock of its own.
+	typedef std::function<bool(size_t source, const CaptureSourceSpec& spec, std::wstring& text)> CaptureFn;
+	typedef std::function<void()> ThreadFn;
+
+	CaptureMux();
+	~CaptureMux();
+
+	// Sources are fixed once started.
+	size_t AddSource(const CaptureSourceSpec& spec);
+	// threads 0: one per source, at most CAPTURE_MAX_THREADS. With timeline,
+	// every merge is also recorded in arrival order across sources.
+	bool Start(const CaptureFn& capture, unsigned threads = 0, bool timeline = false,
+		const ThreadFn& threadStart = nullptr, const ThreadFn& threadEnd = nullptr);
+	void Stop();
+	bool Running() const { return !m_workers.empty(); }
+
+	size_t SourceCount() const { return m_sources.size(); }
+	const CaptureSourceSpec& Spec(size_t source) const;
+	std::wstring History(size_t source) const;
+	// Histories interleaved by when their text arrived, one "[name] ..." line
+	// per run of a source. Empty without a timeline.
+	std::wstring Timeline() const;
+	std::wstring Describe() const;
+
+private:
+	struct Source;
+	struct Segment {
+		uint64_t ms;
+		size_t source;
+		size_t start;   // range in that source's history; start == end once rewritten away
+		size_t end;
+	};
+
+	void WorkerLoop();
+	void Poll(size_t source);
+	void Record(size_t source, Source& src, const HistoryEdit& edit, uint64_t nowMs);
+
+	std::vector<std::unique_ptr<Source>> m_sources;
+	CaptureFn m_capture;
+	ThreadFn m_threadStart, m_threadEnd;
+	std::vector<std::thread> m_workers;
+
+	mutable std::mutex m_lock;  // schedule: due times, busy flags, m_stopping
+	std::condition_variable m_wake;
+	bool m_stopping = false;
+
+	bool m_timeline = false;
+	mutable std::mutex m_timelineLock;  // taken inside a source's lock, never around one
+	std::deque<Segment> m_segments;
+	uint64_t m_segmentBase = 0;         // sequence number of m_segments.front()
+};
@@ -0,0 +1,41 @@
+#include "ClipboardPayload.h"
+#include <cstring>
+
+static bool IsHighSurrogate(wchar_t ch) { return ch >= 0xD800 && ch <= 0xDBFF; }
+
+// Units taken from the history itself, without the leading break.
+static size_t RangeLength(const ClipboardPayload& payload, std::wstring_view history) {
+	if (payload.start >= history.size()) return 0;
+	size_t len = history.size() - payload.start;
+	if (payload.length < len) len = payload.length;
+	if (len > 0 && IsHighSurrogate(history[payload.start + len - 1])) len--;
+	return len;
+}
+
+size_t PayloadLength(const ClipboardPayload& payload, std::wstring_view history) {
+	size_t len = RangeLength(payload, history);
+	if (len > 0 && payload.leadingBreak) len += 2;
+	return len;
+}
+
+std::wstring_view PayloadRange(const ClipboardPayload& payload, std::wstring_view history) {
+	return history.substr(payload.start < history.size() ? payload.start : history.size(), RangeLength(payload, history));
+}
+
+size_t RenderPayload(const ClipboardPayload& payload, std::wstring_view history, wchar_t* dst, size_t dstChars) {
+	if (!dst || dstChars == 0) return 0;
+	size_t len = RangeLength(payload, history);
+	size_t written = 0;
+	if (len > 0 && payload.leadingBreak && dstChars > 2) {
+		dst[written++] = L'\r';
+		dst[written++] = L'\n';
+	}
+	if (len > dstChars - 1 - written) {
+		len = dstChars - 1 - written;
+		if (len > 0 && IsHighSurrogate(history[payload.start + len - 1])) len--;
+	}
+	if (len) std::memcpy(dst + written, history.data() + payload.start, len * sizeof(wchar_t));
+	written += len;
+	dst[written] = L'\0';
+	return written;
+}
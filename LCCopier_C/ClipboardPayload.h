@@ -0,0 +1,26 @@
+#pragma once
+// Portable part of the delayed-rendering clipboard provider.
+#include <cstddef>
+#include <string_view>
+
+// A range of the caption history to paste. Only the offsets are captured when
+// the paste starts; the text is produced from the history when (and only if)
+// the target application asks for it via WM_RENDERFORMAT.
+struct ClipboardPayload {
+	size_t start = 0;
+	size_t length = 0;
+	bool leadingBreak = false;  // emit "\r\n" before the range
+};
+
+// Number of UTF-16 units (without terminator) the payload resolves to against
+// the history as it is now. The range is clamped if the history shrank, and a
+// trailing lone high surrogate is dropped rather than emitted half a pair.
+// A leading break counts when there is history text to follow it.
+size_t PayloadLength(const ClipboardPayload& payload, std::wstring_view history);
+
+// The history units the payload resolves to now, without the leading break.
+std::wstring_view PayloadRange(const ClipboardPayload& payload, std::wstring_view history);
+
+// Copy the payload out of the history into dst, always NUL-terminated.
+// dstChars includes room for the terminator. Returns units written without it.
+size_t RenderPayload(const ClipboardPayload& payload, std::wstring_view history, wchar_t* dst, size_t dstChars);
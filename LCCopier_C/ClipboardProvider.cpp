@@ -0,0 +1,208 @@
+#include "ClipboardProvider.h"
+
+// Formats worth saving: plain HGLOBAL blocks that the system will not re-synthesize
+// from something else we already keep. GDI handle formats are skipped; an image
+// put on the clipboard as CF_BITMAP is still preserved through its synthesized CF_DIB.
+static bool IsSnapshotFormat(UINT format, bool hasUnicodeText, bool hasDib) {
+	switch (format) {
+	case CF_BITMAP:
+	case CF_METAFILEPICT:
+	case CF_ENHMETAFILE:
+	case CF_PALETTE:
+	case CF_OWNERDISPLAY:
+	case CF_DSPBITMAP:
+	case CF_DSPMETAFILEPICT:
+	case CF_DSPENHMETAFILE:
+		return false;
+	case CF_TEXT:
+	case CF_OEMTEXT:
+		return !hasUnicodeText;
+	case CF_DIBV5:
+		return !hasDib;
+	}
+	if (format >= CF_PRIVATEFIRST && format <= CF_PRIVATELAST) return false;
+	if (format >= CF_GDIOBJFIRST && format <= CF_GDIOBJLAST) return false;
+	return true;
+}
+
+bool ClipboardProvider::NeedsSnapshot(HWND hOwner) const {
+	return !(m_offeringSaved && GetClipboardOwner() == hOwner);
+}
+
+void ClipboardProvider::SetSnapshot(ClipboardSnapshot snapshot) {
+	m_snapshot = std::move(snapshot);
+}
+
+bool ClipboardProvider::Offer(HWND hOwner, const std::wstring* source, const ClipboardPayload& payload) {
+	if (!source) return false;
+	if (!OpenClipboard(hOwner)) return false;
+	// The snapshot from the previous paste is still valid if nobody replaced
+	// the formats we handed back since then. One taken ahead (off the UI
+	// thread) is used if nothing was copied since; only otherwise is it taken
+	// here, with the clipboard already open.
+	if (!(m_offeringSaved && GetClipboardOwner() == hOwner)) {
+		if (!m_snapshot.taken || m_snapshot.sequence != GetClipboardSequenceNumber()) {
+			CloseClipboard();
+			m_snapshot = TakeSnapshot();
+			if (!OpenClipboard(hOwner)) return false;
+		}
+		m_saved = std::move(m_snapshot.formats);
+	}
+	m_snapshot = ClipboardSnapshot();
+	EmptyOwnedClipboard();
+	m_source = source;
+	m_payload = payload;
+	m_detached.clear();
+	m_payloadDetached = false;
+	SetClipboardData(CF_UNICODETEXT, nullptr);
+	m_offeringPayload = true;
+	CloseClipboard();
+	return true;
+}
+
+void ClipboardProvider::OnSourceChanging() {
+	if (!m_offeringPayload || m_payloadDetached || !m_source) return;
+	m_detached.resize(PayloadLength(m_payload, *m_source) + 1);
+	m_detached.resize(RenderPayload(m_payload, *m_source, m_detached.data(), m_detached.size()));
+	m_payloadDetached = true;
+}
+
+void ClipboardProvider::Restore(HWND hOwner) {
+	if (!OpenClipboard(hOwner)) return;
+	if (GetClipboardOwner() != hOwner) {
+		// Someone else already replaced our payload; leave their data alone.
+		CloseClipboard();
+		return;
+	}
+	if (m_saved.empty()) {
+		if (m_offeringPayload) {
+			HGLOBAL hMem = RenderPayloadGlobal();
+			if (hMem && !SetClipboardData(CF_UNICODETEXT, hMem)) GlobalFree(hMem);
+			m_offeringPayload = false;
+		}
+		CloseClipboard();
+		return;
+	}
+	EmptyOwnedClipboard();
+	for (const SavedFormat& saved : m_saved) {
+		SetClipboardData(saved.format, nullptr);
+	}
+	m_offeringSaved = true;
+	CloseClipboard();
+}
+
+void ClipboardProvider::OnRenderFormat(UINT format) {
+	// The requesting application has the clipboard open; just hand over the data.
+	HGLOBAL hMem = nullptr;
+	if (m_offeringPayload && format == CF_UNICODETEXT) hMem = RenderPayloadGlobal();
+	else if (m_offeringSaved) hMem = RenderSavedGlobal(format);
+	if (hMem && !SetClipboardData(format, hMem)) GlobalFree(hMem);
+}
+
+void ClipboardProvider::OnRenderAllFormats(HWND hOwner) {
+	if (!m_offeringPayload && !m_offeringSaved) return;
+	if (!OpenClipboard(hOwner)) return;
+	if (GetClipboardOwner() == hOwner) {
+		if (m_offeringPayload) {
+			OnRenderFormat(CF_UNICODETEXT);
+		}
+		else {
+			for (const SavedFormat& saved : m_saved) {
+				OnRenderFormat(saved.format);
+			}
+		}
+	}
+	CloseClipboard();
+	m_offeringPayload = false;
+	m_offeringSaved = false;
+}
+
+void ClipboardProvider::OnDestroyClipboard() {
+	m_offeringPayload = false;
+	m_offeringSaved = false;
+	if (!m_emptying) {
+		// Another application took the clipboard: the user's old data is gone for good.
+		std::vector<SavedFormat>().swap(m_saved);
+	}
+}
+
+ClipboardSnapshot ClipboardProvider::TakeSnapshot() {
+	ClipboardSnapshot snapshot;
+	// Another thread (or application) may hold it for a moment.
+	bool opened = false;
+	for (int attempt = 0; attempt < CLIPBOARD_OPEN_ATTEMPTS && !(opened = OpenClipboard(nullptr) != FALSE); attempt++) {
+		Sleep(CLIPBOARD_OPEN_RETRY_MS);
+	}
+	if (!opened) return snapshot;
+	snapshot.taken = true;
+	snapshot.sequence = GetClipboardSequenceNumber();
+	bool hasUnicodeText = IsClipboardFormatAvailable(CF_UNICODETEXT) != FALSE;
+	bool hasDib = IsClipboardFormatAvailable(CF_DIB) != FALSE;
+	UINT format = 0;
+	while ((format = EnumClipboardFormats(format)) != 0) {
+		if (!IsSnapshotFormat(format, hasUnicodeText, hasDib)) continue;
+		HANDLE hData = GetClipboardData(format);
+		if (!hData) continue;
+		SIZE_T size = GlobalSize(hData);
+		if (!size) continue;
+		const BYTE* pData = (const BYTE*)GlobalLock(hData);
+		if (!pData) continue;
+		SavedFormat saved;
+		saved.format = format;
+		saved.data.assign(pData, pData + size);
+		GlobalUnlock(hData);
+		snapshot.formats.push_back(std::move(saved));
+	}
+	CloseClipboard();
+	return snapshot;
+}
+
+void ClipboardProvider::EmptyOwnedClipboard() {
+	m_emptying = true;
+	EmptyClipboard();  // sends WM_DESTROYCLIPBOARD to the previous owner (possibly us)
+	m_emptying = false;
+}
+
+HGLOBAL ClipboardProvider::RenderPayloadGlobal() const {
+	if (m_payloadDetached) {
+		HGLOBAL hMem = GlobalAlloc(GMEM_MOVEABLE, (m_detached.size() + 1) * sizeof(wchar_t));
+		if (!hMem) return nullptr;
+		wchar_t* pMem = (wchar_t*)GlobalLock(hMem);
+		if (!pMem) {
+			GlobalFree(hMem);
+			return nullptr;
+		}
+		memcpy(pMem, m_detached.c_str(), (m_detached.size() + 1) * sizeof(wchar_t));
+		GlobalUnlock(hMem);
+		return hMem;
+	}
+	if (!m_source) return nullptr;
+	size_t len = PayloadLength(m_payload, *m_source);
+	HGLOBAL hMem = GlobalAlloc(GMEM_MOVEABLE, (len + 1) * sizeof(wchar_t));
+	if (!hMem) return nullptr;
+	wchar_t* pMem = (wchar_t*)GlobalLock(hMem);
+	if (!pMem) {
+		GlobalFree(hMem);
+		return nullptr;
+	}
+	RenderPayload(m_payload, *m_source, pMem, len + 1);
+	GlobalUnlock(hMem);
+	return hMem;
+}
+
+HGLOBAL ClipboardProvider::RenderSavedGlobal(UINT format) const {
+	for (const SavedFormat& saved : m_saved) {
+		if (saved.format != format) continue;
+		HGLOBAL hMem = GlobalAlloc(GMEM_MOVEABLE, saved.data.size());
+		if (!hMem) return nullptr;
+		void* pMem = GlobalLock(hMem);
+		if (!pMem) {
+			GlobalFree(hMem);
+			return nullptr;
+		}
+		memcpy(pMem, saved.data.data(), saved.data.size());
+		GlobalUnlock(hMem);
+		return hMem;
+	}
+	return nullptr;
+}
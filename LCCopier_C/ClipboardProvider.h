@@ -0,0 +1,68 @@
+#pragma once
+#include "framework.h"
+#include "ClipboardPayload.h"
+
+#define CLIPBOARD_OPEN_ATTEMPTS  5  // TakeSnapshot, while another thread holds the clipboard
+#define CLIPBOARD_OPEN_RETRY_MS  5
+
+// Clipboard owner used by the paste pipeline.
+//
+// The pasted text is offered with delayed rendering: SetClipboardData(CF_UNICODETEXT, nullptr)
+// and the bytes are produced from the caption history in WM_RENDERFORMAT, only if
+// the target actually reads them. Whatever the user had on the clipboard (all
+// HGLOBAL formats, not just text) is snapshotted before we take ownership and
+// given back the same way, so restoring costs nothing until someone pastes it.
+//
+// Reading a format another application rendered lazily makes it render there
+// and then, while we wait; TakeSnapshot can run on any thread so the app does
+// that off the UI thread, which also runs the input hooks.
+struct SavedFormat {
+	UINT format;
+	std::vector<BYTE> data;
+};
+
+struct ClipboardSnapshot {
+	bool taken = false;
+	DWORD sequence = 0;  // GetClipboardSequenceNumber when it was taken
+	std::vector<SavedFormat> formats;
+};
+
+class ClipboardProvider {
+public:
+	// Any thread: copy the user's formats. Not taken if the clipboard stayed locked.
+	static ClipboardSnapshot TakeSnapshot();
+	// False while the formats we gave back are still ours to offer again.
+	bool NeedsSnapshot(HWND hOwner) const;
+	// Owner thread: the snapshot the next Offer gives back, if the clipboard
+	// has not changed since it was taken. Otherwise Offer takes one itself.
+	void SetSnapshot(ClipboardSnapshot snapshot);
+
+	// Take ownership of the clipboard and offer payload (a range of *source).
+	bool Offer(HWND hOwner, const std::wstring* source, const ClipboardPayload& payload);
+	// *source is about to change (merge, clear, undo): a payload still on offer
+	// is rendered now, so a later paste gets the range as it was offered.
+	void OnSourceChanging();
+	// Give the user's formats back. If there was nothing to give back, the
+	// pasted text stays on the clipboard, rendered now so it stops following the history.
+	void Restore(HWND hOwner);
+
+	// WndProc handlers
+	void OnRenderFormat(UINT format);
+	void OnRenderAllFormats(HWND hOwner);
+	void OnDestroyClipboard();
+
+private:
+	void EmptyOwnedClipboard();
+	HGLOBAL RenderPayloadGlobal() const;
+	HGLOBAL RenderSavedGlobal(UINT format) const;
+
+	std::vector<SavedFormat> m_saved;
+	ClipboardSnapshot m_snapshot;  // from SetSnapshot, not yet used
+	const std::wstring* m_source = nullptr;
+	ClipboardPayload m_payload;
+	std::wstring m_detached;  // the payload, rendered before the source changed
+	bool m_payloadDetached = false;
+	bool m_offeringPayload = false;
+	bool m_offeringSaved = false;
+	bool m_emptying = false;  // our own EmptyClipboard() call is in progress
+};
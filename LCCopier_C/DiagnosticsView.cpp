@@ -0,0 +1,125 @@
+#include "DiagnosticsView.h"
+#include "Resource.h"
+
+#define DIAGNOSTICS_REFRESH_MS 1000
+
+HWND DiagnosticsView::s_hDlg = nullptr;
+HFONT DiagnosticsView::s_hFont = nullptr;
+DiagnosticsView::ReportFn DiagnosticsView::s_report = nullptr;
+DiagnosticsView::ResetFn DiagnosticsView::s_reset = nullptr;
+
+void DiagnosticsView::Show(HWND hParent, ReportFn report, ResetFn reset) {
+	if (s_hDlg && IsWindow(s_hDlg)) {
+		SetForegroundWindow(s_hDlg);
+		return;
+	}
+	s_report = report;
+	s_reset = reset;
+	DialogBoxParamW(GetModuleHandle(nullptr), MAKEINTRESOURCEW(IDD_DIAGNOSTICS), hParent, DialogProc, 0);
+	s_hDlg = nullptr;
+}
+
+std::wstring DiagnosticsView::AppDirectory() {
+	wchar_t path[MAX_PATH];
+	DWORD len = GetModuleFileNameW(nullptr, path, MAX_PATH);
+	if (len == 0 || len >= MAX_PATH) return L"";
+	std::wstring dir(path, len);
+	size_t slash = dir.find_last_of(L"\\/");
+	dir.erase(slash == std::wstring::npos ? 0 : slash + 1);
+	return dir;
+}
+
+std::wstring DiagnosticsView::TimestampedAppFile(const wchar_t* prefix, const wchar_t* extension) {
+	std::wstring file = AppDirectory();
+	if (file.empty()) return L"";
+	SYSTEMTIME st;
+	GetLocalTime(&st);
+	wchar_t stamp[32];
+	swprintf_s(stamp, L"_%04u%02u%02u_%02u%02u%02u",
+		st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond);
+	return file + prefix + stamp + extension;
+}
+
+std::wstring DiagnosticsView::DumpToFile(const std::wstring& report) {
+	std::wstring file = TimestampedAppFile(L"LCCopier_diagnostics", L".txt");
+	if (file.empty()) return L"";
+
+	int bytes = WideCharToMultiByte(CP_UTF8, 0, report.c_str(), (int)report.length(), nullptr, 0, nullptr, nullptr);
+	std::string utf8(bytes > 0 ? bytes : 0, '\0');
+	if (bytes > 0) WideCharToMultiByte(CP_UTF8, 0, report.c_str(), (int)report.length(), &utf8[0], bytes, nullptr, nullptr);
+
+	HANDLE h = CreateFileW(file.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (h == INVALID_HANDLE_VALUE) return L"";
+	DWORD written = 0;
+	BOOL ok = WriteFile(h, utf8.data(), (DWORD)utf8.size(), &written, nullptr) && written == utf8.size();
+	CloseHandle(h);
+	return ok ? file : L"";
+}
+
+void DiagnosticsView::Refresh(HWND hDlg) {
+	if (!s_report) return;
+	HWND hText = GetDlgItem(hDlg, IDC_DIAG_TEXT);
+	// Keep the scroll position across refreshes.
+	int firstLine = (int)SendMessageW(hText, EM_GETFIRSTVISIBLELINE, 0, 0);
+	SendMessageW(hText, WM_SETREDRAW, FALSE, 0);
+	SetWindowTextW(hText, s_report().c_str());
+	SendMessageW(hText, EM_LINESCROLL, 0, firstLine);
+	SendMessageW(hText, WM_SETREDRAW, TRUE, 0);
+	InvalidateRect(hText, nullptr, TRUE);
+}
+
+INT_PTR CALLBACK DiagnosticsView::DialogProc(HWND hDlg, UINT message, WPARAM wParam, LPARAM lParam) {
+	switch (message) {
+	case WM_INITDIALOG:
+	{
+		s_hDlg = hDlg;
+		// The report is a fixed-width table.
+		HDC hdc = GetDC(hDlg);
+		int logPixels = hdc ? GetDeviceCaps(hdc, LOGPIXELSY) : 96;
+		if (hdc) ReleaseDC(hDlg, hdc);
+		s_hFont = CreateFontW(-MulDiv(9, logPixels, 72), 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
+			DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY,
+			FIXED_PITCH | FF_MODERN, L"Consolas");
+		if (s_hFont) SendDlgItemMessageW(hDlg, IDC_DIAG_TEXT, WM_SETFONT, (WPARAM)s_hFont, FALSE);
+		Refresh(hDlg);
+		SetTimer(hDlg, IDT_DIAG_REFRESH, DIAGNOSTICS_REFRESH_MS, nullptr);
+		return TRUE;
+	}
+
+	case WM_TIMER:
+		if (wParam == IDT_DIAG_REFRESH) {
+			Refresh(hDlg);
+			return TRUE;
+		}
+		break;
+
+	case WM_COMMAND:
+		switch (LOWORD(wParam)) {
+		case IDC_DIAG_RESET:
+			if (s_reset) s_reset();
+			Refresh(hDlg);
+			return TRUE;
+		case IDC_DIAG_SAVE:
+		{
+			std::wstring path = s_report ? DumpToFile(s_report()) : L"";
+			if (path.empty()) {
+				MessageBoxW(hDlg, L"Could not write the diagnostics file.", L"Diagnostics", MB_OK | MB_ICONWARNING);
+			}
+			else {
+				MessageBoxW(hDlg, (L"Saved to\n" + path).c_str(), L"Diagnostics", MB_OK | MB_ICONINFORMATION);
+			}
+			return TRUE;
+		}
+		case IDCANCEL:
+			EndDialog(hDlg, 0);
+			return TRUE;
+		}
+		break;
+
+	case WM_DESTROY:
+		KillTimer(hDlg, IDT_DIAG_REFRESH);
+		if (s_hFont) { DeleteObject(s_hFont); s_hFont = nullptr; }
+		return TRUE;
+	}
+	return FALSE;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <Windows.h>
+#include <string>
+
+// Hidden diagnostics dialog (Ctrl+Shift+Alt+F12): shows a live text report and
+// can reset it or save it to a file next to the executable.
+class DiagnosticsView {
+public:
+	typedef std::wstring (*ReportFn)();
+	typedef void (*ResetFn)();
+
+	static void Show(HWND hParent, ReportFn report, ResetFn reset);
+	// Write report as UTF-8 to a timestamped file next to the executable.
+	// Returns the path, or an empty string on failure.
+	static std::wstring DumpToFile(const std::wstring& report);
+	// Directory of the executable with a trailing backslash, or empty on failure.
+	static std::wstring AppDirectory();
+	// <exe dir>\<prefix>_<yyyymmdd_hhmmss><extension>, or empty on failure.
+	static std::wstring TimestampedAppFile(const wchar_t* prefix, const wchar_t* extension);
+
+private:
+	static HWND s_hDlg;
+	static HFONT s_hFont;
+	static ReportFn s_report;
+	static ResetFn s_reset;
+
+	static INT_PTR CALLBACK DialogProc(HWND hDlg, UINT message, WPARAM wParam, LPARAM lParam);
+	static void Refresh(HWND hDlg);
+};
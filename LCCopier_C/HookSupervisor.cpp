@@ -0,0 +1,104 @@
+#include "HookSupervisor.h"
+#include <cwchar>
+
+static const wchar_t* const kHookNames[(size_t)HookKind::Count] = { L"Keyboard", L"Mouse" };
+
+static size_t LatencyBucket(uint32_t latencyMs) {
+	size_t bucket = 0;
+	for (uint32_t limit = 8; bucket + 1 < HOOK_LATENCY_BUCKETS && latencyMs >= limit; limit <<= 1) bucket++;
+	return bucket;
+}
+
+HookSupervisor::TickResult HookSupervisor::OnTick(uint64_t nowMs, uint32_t idleMs) {
+	TickResult result;
+	if (m_lastTickMs && nowMs > m_lastTickMs + HOOK_KEEPALIVE_INTERVAL_MS) {
+		uint64_t late = nowMs - m_lastTickMs - HOOK_KEEPALIVE_INTERVAL_MS;
+		if (late > m_timerLateMaxMs) m_timerLateMaxMs = late > UINT32_MAX ? UINT32_MAX : (uint32_t)late;
+		if (late >= HOOK_STALL_MS) m_timerStalls++;
+	}
+	m_lastTickMs = nowMs;
+
+	uint64_t lastInputMs = idleMs < nowMs ? nowMs - idleMs : 0;
+	// Input neither hook saw: at least one of them is gone (or the input came
+	// from a device that bypasses both, which a probe sorts out).
+	bool suspect = true;
+	for (const HookState& hook : m_hooks) {
+		if (hook.lastSeenMs + HOOK_SUSPECT_SLACK_MS >= lastInputMs) suspect = false;
+	}
+
+	for (size_t i = 0; i < (size_t)HookKind::Count; i++) {
+		HookState& hook = m_hooks[i];
+		if (hook.heartbeatPending) {
+			// Injected input is delivered before WM_TIMER, so a live hook has seen
+			// the heartbeat by the time a later tick runs, however late that tick is.
+			if (nowMs - hook.heartbeatSentMs >= HOOK_HEARTBEAT_TIMEOUT_MS) {
+				hook.heartbeatPending = false;
+				hook.stats.heartbeatsLost++;
+				result.reinstall[i] = true;
+			}
+			continue;
+		}
+		bool stale = idleMs < HOOK_PROBE_IDLE_MS && lastInputMs > hook.lastSeenMs
+			&& nowMs - hook.lastSeenMs >= HOOK_PROBE_IDLE_MS;
+		result.probe[i] = suspect || stale;
+	}
+	return result;
+}
+
+void HookSupervisor::OnHeartbeatSent(HookKind kind, uint64_t nowMs) {
+	HookState& hook = m_hooks[(size_t)kind];
+	hook.heartbeatPending = true;
+	hook.heartbeatSentMs = nowMs;
+	hook.stats.heartbeatsSent++;
+}
+
+void HookSupervisor::OnReinstalled(HookKind kind, uint64_t nowMs) {
+	HookState& hook = m_hooks[(size_t)kind];
+	if (hook.lastSeenMs) hook.stats.reinstalls++;  // not the first install
+	hook.lastSeenMs = nowMs;
+	hook.heartbeatPending = false;
+}
+
+void HookSupervisor::OnCallback(HookKind kind, uint64_t nowMs, uint32_t latencyMs) {
+	HookState& hook = m_hooks[(size_t)kind];
+	hook.lastSeenMs = nowMs;
+	HookStats& stats = hook.stats;
+	stats.callbacks++;
+	stats.latencyTotalMs += latencyMs;
+	if (latencyMs > stats.latencyMaxMs) stats.latencyMaxMs = latencyMs;
+	stats.latencyBuckets[LatencyBucket(latencyMs)]++;
+	if (latencyMs >= HOOK_STALL_MS) stats.stalls++;
+}
+
+void HookSupervisor::OnHeartbeat(HookKind kind, uint64_t nowMs) {
+	HookState& hook = m_hooks[(size_t)kind];
+	hook.lastSeenMs = nowMs;
+	if (!hook.heartbeatPending) return;
+	hook.heartbeatPending = false;
+	uint64_t roundTrip = nowMs - hook.heartbeatSentMs;
+	if (roundTrip > hook.stats.heartbeatMaxMs) hook.stats.heartbeatMaxMs = roundTrip > UINT32_MAX ? UINT32_MAX : (uint32_t)roundTrip;
+}
+
+std::wstring HookSupervisor::Describe() const {
+	std::wstring out;
+	wchar_t line[256];
+	for (size_t i = 0; i < (size_t)HookKind::Count; i++) {
+		const HookStats& s = m_hooks[i].stats;
+		double avg = s.callbacks ? (double)s.latencyTotalMs / (double)s.callbacks : 0.0;
+		swprintf(line, 256, L"%ls hook: %llu callbacks, avg %.1f ms, max %u ms, %llu stalls; heartbeats %u sent, %u lost (max %u ms); %u reinstalls\r\n",
+			kHookNames[i], (unsigned long long)s.callbacks, avg, s.latencyMaxMs, (unsigned long long)s.stalls,
+			s.heartbeatsSent, s.heartbeatsLost, s.heartbeatMaxMs, s.reinstalls);
+		out += line;
+		out += L"  latency";
+		uint32_t limit = 8;
+		for (size_t b = 0; b < HOOK_LATENCY_BUCKETS; b++, limit <<= 1) {
+			if (b + 1 < HOOK_LATENCY_BUCKETS) swprintf(line, 256, L" <%u:%llu", limit, (unsigned long long)s.latencyBuckets[b]);
+			else swprintf(line, 256, L" >=%u:%llu", limit >> 1, (unsigned long long)s.latencyBuckets[b]);
+			out += line;
+		}
+		out += L"\r\n";
+	}
+	swprintf(line, 256, L"Keepalive timer: %llu stalls, max %u ms late\r\n", (unsigned long long)m_timerStalls, m_timerLateMaxMs);
+	out += line;
+	return out;
+}
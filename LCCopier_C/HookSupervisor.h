@@ -0,0 +1,81 @@
+#pragma once
+// Portable health tracking for the low-level keyboard and mouse hooks.
+//
+// Windows silently removes a WH_*_LL hook whose callback does not return
+// within LowLevelHooksTimeout, e.g. after the UI thread stalled. Nothing tells
+// the owner, so hotkeys just stop working. The supervisor is ticked from
+// IDT_HOOK_KEEPALIVE and decides when to probe a hook with a tagged heartbeat
+// event and when a hook has to be reinstalled. The Win32 side does the
+// injecting and (re)hooking.
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#define HOOK_KEEPALIVE_INTERVAL_MS  1000
+// A probe is sent to a hook that has not seen anything for this long while the
+// user is active, i.e. only when injecting cannot keep an idle machine awake.
+#define HOOK_PROBE_IDLE_MS          5000
+// System input this much newer than anything either hook saw is suspicious.
+#define HOOK_SUSPECT_SLACK_MS       250
+#define HOOK_HEARTBEAT_TIMEOUT_MS   1000
+// Callback latency / timer lateness counted as a stall (Windows' default
+// LowLevelHooksTimeout is a few hundred ms).
+#define HOOK_STALL_MS               200
+#define HOOK_LATENCY_BUCKETS        8     // <8, <16, <32 ... <512, >=512 ms
+
+enum class HookKind : uint8_t {
+	Keyboard = 0,
+	Mouse,
+	Count
+};
+
+struct HookStats {
+	uint64_t callbacks = 0;
+	uint64_t latencyTotalMs = 0;
+	uint32_t latencyMaxMs = 0;
+	uint64_t latencyBuckets[HOOK_LATENCY_BUCKETS] = {};
+	uint64_t stalls = 0;          // callbacks delivered HOOK_STALL_MS or more after the event
+	uint32_t heartbeatsSent = 0;
+	uint32_t heartbeatsLost = 0;
+	uint32_t heartbeatMaxMs = 0;  // slowest heartbeat round trip
+	uint32_t reinstalls = 0;
+};
+
+class HookSupervisor {
+public:
+	struct TickResult {
+		bool probe[(size_t)HookKind::Count] = {};
+		bool reinstall[(size_t)HookKind::Count] = {};
+	};
+
+	// Keepalive tick. idleMs is the time since the last system-wide input
+	// (GetLastInputInfo). Heartbeats for which a probe is returned must be
+	// reported with OnHeartbeatSent once actually injected.
+	TickResult OnTick(uint64_t nowMs, uint32_t idleMs);
+	void OnHeartbeatSent(HookKind kind, uint64_t nowMs);
+	void OnReinstalled(HookKind kind, uint64_t nowMs);
+
+	// Called from the hook callbacks; constant time, no allocation.
+	// latencyMs is the delay between the event time stamp and the callback.
+	void OnCallback(HookKind kind, uint64_t nowMs, uint32_t latencyMs);
+	void OnHeartbeat(HookKind kind, uint64_t nowMs);
+
+	const HookStats& Stats(HookKind kind) const { return m_hooks[(size_t)kind].stats; }
+	uint64_t TimerStalls() const { return m_timerStalls; }
+	uint32_t TimerLateMaxMs() const { return m_timerLateMaxMs; }
+	// Multi-line human readable summary of the statistics.
+	std::wstring Describe() const;
+
+private:
+	struct HookState {
+		uint64_t lastSeenMs = 0;
+		uint64_t heartbeatSentMs = 0;
+		bool heartbeatPending = false;
+		HookStats stats;
+	};
+
+	HookState m_hooks[(size_t)HookKind::Count];
+	uint64_t m_lastTickMs = 0;
+	uint64_t m_timerStalls = 0;
+	uint32_t m_timerLateMaxMs = 0;
+};
@@ -0,0 +1,88 @@
+#include "HotkeyEngine.h"
+
+// Bit in m_heldKeys for each modifier virtual key (VK_* values; windows.h is
+// not included here). The generic VK_SHIFT/VK_CONTROL/VK_MENU codes come from
+// injected input and count as the left key.
+enum : uint16_t {
+	kLCtrl = 1 << 0, kRCtrl = 1 << 1,
+	kLShift = 1 << 2, kRShift = 1 << 3,
+	kLAlt = 1 << 4, kRAlt = 1 << 5,
+	kLWin = 1 << 6, kRWin = 1 << 7,
+};
+
+// Both keys of the modifier a bit belongs to.
+static uint16_t ModifierPair(uint16_t bit) {
+	return (bit & 0x55) ? (uint16_t)(bit | bit << 1) : (uint16_t)(bit | bit >> 1);
+}
+
+static uint16_t ModifierKeyBit(uint32_t vk) {
+	switch (vk) {
+	case 0x10: case 0xA0: return kLShift;   // VK_SHIFT, VK_LSHIFT
+	case 0xA1: return kRShift;              // VK_RSHIFT
+	case 0x11: case 0xA2: return kLCtrl;    // VK_CONTROL, VK_LCONTROL
+	case 0xA3: return kRCtrl;               // VK_RCONTROL
+	case 0x12: case 0xA4: return kLAlt;     // VK_MENU, VK_LMENU
+	case 0xA5: return kRAlt;                // VK_RMENU
+	case 0x5B: return kLWin;                // VK_LWIN
+	case 0x5C: return kRWin;                // VK_RWIN
+	}
+	return 0;
+}
+
+void HotkeyEngine::Clear() {
+	for (HotkeyAction& slot : m_table) slot = HotkeyAction::None;
+}
+
+bool HotkeyEngine::Bind(uint8_t modifiers, uint32_t vk, HotkeyAction action) {
+	if (vk == 0 || vk >= 256 || ModifierKeyBit(vk)) return false;
+	m_table[vk * HKMOD_COUNT + (modifiers & (HKMOD_COUNT - 1))] = action;
+	return true;
+}
+
+bool HotkeyEngine::IsModifierVk(uint32_t vk) const {
+	return ModifierKeyBit(vk) != 0;
+}
+
+bool HotkeyEngine::TrackModifier(uint32_t vk, bool down) {
+	uint16_t bit = ModifierKeyBit(vk);
+	if (!bit) return false;
+	if (down) m_heldKeys |= bit;
+	else m_heldKeys &= ~bit;
+	return true;
+}
+
+// Injected input may name the generic code for either key, so a release
+// covers both keys of the modifier.
+void HotkeyEngine::OnOwnKey(uint32_t vk, bool down) {
+	uint16_t bit = ModifierKeyBit(vk);
+	if (bit && !down) m_injectedUp |= ModifierPair(bit);
+}
+
+void HotkeyEngine::ResyncModifier(uint32_t vk, bool down) {
+	uint16_t bit = ModifierKeyBit(vk);
+	if (!down && (m_injectedUp & bit)) return;
+	TrackModifier(vk, down);
+}
+
+uint8_t HotkeyEngine::Modifiers() const {
+	uint8_t mods = 0;
+	if (m_heldKeys & (kLCtrl | kRCtrl)) mods |= HKMOD_CTRL;
+	if (m_heldKeys & (kLShift | kRShift)) mods |= HKMOD_SHIFT;
+	if (m_heldKeys & (kLAlt | kRAlt)) mods |= HKMOD_ALT;
+	if (m_heldKeys & (kLWin | kRWin)) mods |= HKMOD_WIN;
+	return mods;
+}
+
+HotkeyAction HotkeyEngine::Lookup(uint32_t vk, uint8_t modifiers) const {
+	if (vk >= 256) return HotkeyAction::None;
+	return m_table[vk * HKMOD_COUNT + (modifiers & (HKMOD_COUNT - 1))];
+}
+
+HotkeyAction HotkeyEngine::OnKey(uint32_t vk, bool down, uint8_t extraModifiers) {
+	if (TrackModifier(vk, down)) {
+		m_injectedUp &= ~ModifierKeyBit(vk);
+		return HotkeyAction::None;
+	}
+	if (!down) return HotkeyAction::None;
+	return Lookup(vk, Modifiers() | extraModifiers);
+}
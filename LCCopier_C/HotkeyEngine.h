@@ -0,0 +1,58 @@
+#pragma once
+// Portable hotkey matcher for the low-level keyboard hook. It keeps its own
+// modifier state from the key events it is fed (no GetAsyncKeyState calls) and
+// resolves bindings with one table lookup, so the hook callback does a fixed,
+// tiny amount of work per key event no matter how many bindings exist.
+#include <cstdint>
+
+#define HKMOD_CTRL   0x01
+#define HKMOD_SHIFT  0x02
+#define HKMOD_ALT    0x04
+#define HKMOD_WIN    0x08
+#define HKMOD_COUNT  16
+
+enum class HotkeyAction : uint8_t {
+	None = 0,
+	FindAndCopy,
+	ClearHistory,
+	ShowDiagnostics,
+	CopySentences,  // CopySentences + n - 1 copies the last n sentences
+	CopySentencesLast = CopySentences + 8,
+	UndoClear,
+	Count
+};
+
+class HotkeyEngine {
+public:
+	HotkeyEngine() { Clear(); }
+
+	void Clear();
+	// Bind vk + modifiers (HKMOD_*) to action. Modifier keys themselves and
+	// vk >= 256 cannot be bound. A later binding for the same combination wins.
+	bool Bind(uint8_t modifiers, uint32_t vk, HotkeyAction action);
+
+	// Feed every key event. Returns the bound action for a key-down of a
+	// non-modifier key, None otherwise. extraModifiers is OR-ed into the tracked
+	// state (the hook passes HKMOD_ALT for LLKHF_ALTDOWN).
+	HotkeyAction OnKey(uint32_t vk, bool down, uint8_t extraModifiers = 0);
+	// Update the tracked state for a modifier key; false if vk is not one.
+	bool TrackModifier(uint32_t vk, bool down);
+	// Feed the app's own injected key events instead of OnKey. They do not
+	// change the tracked state, but an injected modifier release shows in the
+	// real keyboard state while the user may still hold the key.
+	void OnOwnKey(uint32_t vk, bool down);
+	// Resync one modifier from the real keyboard state (GetAsyncKeyState). A
+	// release is not taken from it after an injected release of that modifier,
+	// until the next real event for the key.
+	void ResyncModifier(uint32_t vk, bool down);
+	void ResetModifiers() { m_heldKeys = 0; m_injectedUp = 0; }
+
+	HotkeyAction Lookup(uint32_t vk, uint8_t modifiers) const;
+	uint8_t Modifiers() const;
+	bool IsModifierVk(uint32_t vk) const;
+
+private:
+	HotkeyAction m_table[256 * HKMOD_COUNT];
+	uint16_t m_heldKeys = 0;  // one bit per physical modifier key (left/right apart)
+	uint16_t m_injectedUp = 0;  // keys whose real state shows an injected release
+};
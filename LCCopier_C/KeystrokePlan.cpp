@@ -0,0 +1,71 @@
+#include "KeystrokePlan.h"
+
+// Same values as VK_BACK / VK_TAB / VK_RETURN; kept local so this file builds without windows.h.
+static const uint16_t kVkBack = 0x08;
+static const uint16_t kVkTab = 0x09;
+static const uint16_t kVkReturn = 0x0D;
+
+static bool IsHighSurrogate(wchar_t ch) { return ch >= 0xD800 && ch <= 0xDBFF; }
+static bool IsLowSurrogate(wchar_t ch) { return ch >= 0xDC00 && ch <= 0xDFFF; }
+
+void KeystrokePlan::Clear() {
+	m_strokes.clear();
+	m_batchEnds.clear();
+}
+
+const KeyStroke* KeystrokePlan::BatchData(size_t batch) const {
+	size_t begin = batch == 0 ? 0 : m_batchEnds[batch - 1];
+	return m_strokes.data() + begin;
+}
+
+size_t KeystrokePlan::BatchSize(size_t batch) const {
+	size_t begin = batch == 0 ? 0 : m_batchEnds[batch - 1];
+	return m_batchEnds[batch] - begin;
+}
+
+void KeystrokePlan::CloseBatchIfFull(size_t groupEvents, size_t maxBatchEvents) {
+	size_t batchBegin = m_batchEnds.empty() ? 0 : m_batchEnds.back();
+	size_t inBatch = m_strokes.size() - batchBegin;
+	if (inBatch > 0 && inBatch + groupEvents > maxBatchEvents) {
+		m_batchEnds.push_back(m_strokes.size());
+	}
+}
+
+void KeystrokePlan::Build(std::wstring_view text, size_t maxBatchEvents, size_t leadingBackspaces) {
+	Clear();
+	if (maxBatchEvents < 4) maxBatchEvents = 4;
+	m_strokes.reserve((text.size() + leadingBackspaces) * 2);
+	for (size_t i = 0; i < leadingBackspaces; i++) {
+		CloseBatchIfFull(2, maxBatchEvents);
+		m_strokes.push_back({ kVkBack, 0, false });
+		m_strokes.push_back({ kVkBack, 0, true });
+	}
+	for (size_t i = 0; i < text.size(); i++) {
+		wchar_t ch = text[i];
+		if (ch == L'\r' || ch == L'\n' || ch == L'\t') {
+			if (ch == L'\r' && i + 1 < text.size() && text[i + 1] == L'\n') i++;
+			uint16_t vk = ch == L'\t' ? kVkTab : kVkReturn;
+			CloseBatchIfFull(2, maxBatchEvents);
+			m_strokes.push_back({ vk, 0, false });
+			m_strokes.push_back({ vk, 0, true });
+		}
+		else if (IsHighSurrogate(ch) && i + 1 < text.size() && IsLowSurrogate(text[i + 1])) {
+			// Both halves go out in the same SendInput call so no other input can
+			// land between them and leave the target with half a character.
+			wchar_t low = text[++i];
+			CloseBatchIfFull(4, maxBatchEvents);
+			m_strokes.push_back({ 0, (uint16_t)ch, false });
+			m_strokes.push_back({ 0, (uint16_t)ch, true });
+			m_strokes.push_back({ 0, (uint16_t)low, false });
+			m_strokes.push_back({ 0, (uint16_t)low, true });
+		}
+		else {
+			CloseBatchIfFull(2, maxBatchEvents);
+			m_strokes.push_back({ 0, (uint16_t)ch, false });
+			m_strokes.push_back({ 0, (uint16_t)ch, true });
+		}
+	}
+	if (m_batchEnds.empty() ? !m_strokes.empty() : m_batchEnds.back() != m_strokes.size()) {
+		m_batchEnds.push_back(m_strokes.size());
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+// Portable planner for the "type it" paste path: turns text into key events
+// for SendInput(KEYEVENTF_UNICODE) and cuts them into batches.
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// One keyboard event. vk == 0 means a KEYEVENTF_UNICODE event carrying unit;
+// otherwise it is a plain virtual-key event (used for Enter and Tab, which
+// many controls ignore when they arrive as VK_PACKET characters).
+struct KeyStroke {
+	uint16_t vk;
+	uint16_t unit;
+	bool keyUp;
+};
+
+class KeystrokePlan {
+public:
+	// Plan text as down/up pairs, at most maxBatchEvents per batch. A surrogate
+	// pair (4 events) is never split across batches. "\r\n", "\r" and "\n" all
+	// become a single Enter. leadingBackspaces Backspace taps go first.
+	void Build(std::wstring_view text, size_t maxBatchEvents, size_t leadingBackspaces = 0);
+	void Clear();
+
+	size_t BatchCount() const { return m_batchEnds.size(); }
+	const KeyStroke* BatchData(size_t batch) const;
+	size_t BatchSize(size_t batch) const;
+	size_t EventCount() const { return m_strokes.size(); }
+
+private:
+	void CloseBatchIfFull(size_t groupEvents, size_t maxBatchEvents);
+
+	std::vector<KeyStroke> m_strokes;
+	std::vector<size_t> m_batchEnds;  // exclusive end index of each batch
+};
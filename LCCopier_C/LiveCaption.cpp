@@ -1,5 +1,25 @@
 #include "LiveCaption.h"
 #include "SettingsDialog.h"
+#include "PasteSequencer.h"
+#include "ClipboardProvider.h"
+#include "CaptionMerge.h"
+#include "CaptionText.h"
+#include "PasteCursor.h"
+#include "SentenceIndex.h"
+#include "HotkeyEngine.h"
+#include "HookSupervisor.h"
+#include "Metrics.h"
+#include "DiagnosticsView.h"
+#include "Tracer.h"
+#include "CaptionStream.h"
+#include "StreamServer.h"
+#include "SubtitleExport.h"
+#include "TranscriptLog.h"
+#include "CaptureMux.h"
+#include "PhraseTriggers.h"
+#include "TaskScheduler.h"
+#include "RevisionJournal.h"
+#include "WindowDiscovery.h"
 
 HINSTANCE hInst;
 WCHAR szTitle[MAX_LOADSTRING];
@@ -7,37 +27,96 @@ WCHAR szWindowClass[MAX_LOADSTRING];
 HBRUSH g_hEditBrush = nullptr;
 HFONT g_hCaptionFont = nullptr;
 static std::wstring g_lastCaptionText;
+static std::wstring g_captureText;  // filled by each poll, then swapped with g_lastCaptionText
 static std::wstring g_captionHistory;
 static std::wstring g_previousCaption;
 static int g_anchorCharIndex = 0;
 static int g_anchorHistoryIndex = 0;
 static bool g_anchorSetByUser = false;
-static volatile long g_pasteInProgress = 0;
 static HWND g_hMainWnd = nullptr;
 static HHOOK g_hKbHook = nullptr;
 static HHOOK g_hMouseHook = nullptr;
 static bool g_middleButtonPaste = true;
 static bool g_middleButtonReplaceAll = true;
+static bool g_incrementalPaste = false;
+static PasteCursor g_pasteCursor;
+static SentenceIndex g_sentences;
+static RepeatIndex g_repeats;  // recent history, for snapshots the merge cannot align
+static RevisionJournal g_journal;  // every edit, for auditing rewrites
+static bool g_saveRevisions = false;  // --revisions: write the rewrite report at exit
+static WindowDiscovery g_captionWindow(IsCaptionWindow, ScanForCaptionWindow);
+static HWINEVENTHOOK g_hWindowEventHooks[2] = {};
+static CaptureMux g_captureMux;
+static PhraseTriggers g_triggers;  // from LCCopier_triggers.txt next to the exe
+static std::vector<TriggerHit> g_triggersFired;
+static HANDLE g_triggerLogFile = INVALID_HANDLE_VALUE;  // output task only, created by the first hit logged
+// What a clear took away, for undo. The history string is moved in and out,
+// never copied, so a clear is O(1) and keeping it costs no extra memory.
+struct ClearedHistory {
+	std::wstring history;
+	SentenceIndex sentences;
+	int anchorCharIndex;
+	int anchorHistoryIndex;
+	bool anchorSetByUser;
+};
+static std::vector<ClearedHistory> g_clearedHistories;  // oldest first, at most UNDO_MAX_CLEARS
+static bool g_captureTimeline = false;
 static bool g_userScrolledUp = false;
-static HotkeyConfig g_autoCopyHotkey   = { true, true, false, false, 'A' };
-static HotkeyConfig g_autoDeleteHotkey = { true, true, false, false, 'D' };
+static HotkeyEngine g_hotkeys;
+static HookSupervisor g_hookSupervisor;
+static MetricsRegistry g_metrics;
+static std::chrono::steady_clock::time_point g_pasteStartedAt;
+static bool g_pasteTimed = false; // g_pasteStartedAt belongs to the paste in progress
+// Tracing (--trace): every poll tick is a caption snapshot with its own id.
+static uint64_t g_snapshotSeq = 0;
+static uint64_t g_tickSnapshot = 0;   // snapshot the current poll tick works on
+static uint64_t g_paintSnapshot = 0;  // changed snapshot waiting for the RichEdit to paint
+static HANDLE g_traceFile = INVALID_HANDLE_VALUE;
+// Caption stream (--stream): merged edits go out over a named pipe to local tools.
+static bool g_streamRequested = false;
+static CaptionStream g_captionStream;
+static StreamServer g_streamServer(g_captionStream);
+// Subtitles (--subtitles): SRT and WebVTT files written as the session runs.
+static SubtitleExporter g_subtitles;
+static HANDLE g_srtFile = INVALID_HANDLE_VALUE;
+static HANDLE g_vttFile = INVALID_HANDLE_VALUE;
+// Snapshot recording (--record): every changed snapshot, for replay in bench/.
+static HANDLE g_recordFile = INVALID_HANDLE_VALUE;
+static std::string g_recordBuffer;
+static ULONGLONG g_recordStartMs = 0;
+static TranscriptLog g_transcriptLog;
+// Background work off the UI thread: file output and loading the trigger list.
+static TaskScheduler g_tasks;
+static ULONGLONG g_lastCaptionChangeMs = 0;
+// Trace, subtitle, recording and trigger log output taken from their buffers
+// but not yet written. One Idle task at a time writes it, so the files stay in
+// order.
+struct PendingOutput {
+	std::string trace, srt, vtt, record, triggers;
+	bool Empty() const { return trace.empty() && srt.empty() && vtt.empty() && record.empty() && triggers.empty(); }
+	size_t Bytes() const { return trace.size() + srt.size() + vtt.size() + record.size() + triggers.size(); }
+};
+static PendingOutput g_pendingOutput;
+static ULONGLONG g_pendingOutputSinceMs = 0;  // when g_pendingOutput last went from empty to not
+static bool g_outputTaskQueued = false;
 static bool g_altSuppressed = false; // true when we swallowed a VK_MENU keydown to prevent menu-bar activation
-static bool g_altPhysicallyDown = false; // tracks if Alt key is physically pressed (regardless of suppression)
-static ITaskbarList* g_pTaskbarList    = nullptr;
+static ITaskbarList* g_pTaskbarList    = nullptr;  // created on first use, see TaskbarList()
+static StartupProfile g_startup;
+static bool g_startupCheck = false;  // --startup-check: exit after startup, code 1 if over budget
 ATOM MyRegisterClass(HINSTANCE hInstance);
 BOOL InitInstance(HINSTANCE, int);
 LRESULT CALLBACK WndProc(HWND, UINT, WPARAM, LPARAM);
-std::wstring GetLiveCaptionText();
+void GetLiveCaptionText(std::wstring& text);
 static BOOL CALLBACK FindLiveCaptionWindow(HWND hwnd, LPARAM lParam);
+static bool IsCaptionWindow(WindowDiscovery::Handle window);
+static WindowDiscovery::Handle ScanForCaptionWindow();
 static bool CollectTextFromElement(IUIAutomation* pAutomation, IUIAutomationElement* pElement, std::wstring& out, bool skipRootName);
-static bool IsUiChrome(const wchar_t* name);
 static void ApplyYellowHighlight(HWND hEdit);
 static LRESULT CALLBACK LowLevelKbHook(int nCode, WPARAM wParam, LPARAM lParam);
 static LRESULT CALLBACK LowLevelMouseHook(int nCode, WPARAM wParam, LPARAM lParam);
 static LRESULT CALLBACK EditSubclassProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
-static bool PasteViaClipboard(const std::wstring& text);
 static void DoFindAndCopyWork(bool replaceAll = false);
-static void UpdateCaptionHistory(const std::wstring& currentText);
+static HistoryEdit UpdateCaptionHistory(const std::wstring& currentText);
 // Helper: returns true for any Alt virtual-key code.
 // In a low-level keyboard hook, the physical Alt key reports as VK_LMENU (left)
 // or VK_RMENU (right), NOT as VK_MENU.  We must handle all three.
@@ -45,27 +124,107 @@ static bool IsAltVk(DWORD vk) {
 	return vk == VK_MENU || vk == VK_LMENU || vk == VK_RMENU;
 }
 
+// Alt as tracked by the keyboard hook from its own events (regardless of suppression).
+static bool IsAltHeld() {
+	return (g_hotkeys.Modifiers() & HKMOD_ALT) != 0;
+}
+
+static uint8_t HotkeyModifiers(const HotkeyConfig& hk) {
+	return (hk.ctrl ? HKMOD_CTRL : 0) | (hk.shift ? HKMOD_SHIFT : 0) | (hk.alt ? HKMOD_ALT : 0) | (hk.win ? HKMOD_WIN : 0);
+}
+
+static void ApplyHotkeyBindings(const AppSettings& settings) {
+	g_hotkeys.Clear();
+	// Hidden, not configurable; bound first so a user binding on the same keys wins.
+	g_hotkeys.Bind(HKMOD_CTRL | HKMOD_SHIFT | HKMOD_ALT, VK_F12, HotkeyAction::ShowDiagnostics);
+	for (int n = 1; n <= SENTENCE_COPY_MAX; n++) {
+		g_hotkeys.Bind(HKMOD_CTRL | HKMOD_SHIFT | HKMOD_ALT, '0' + n, (HotkeyAction)((int)HotkeyAction::CopySentences + n - 1));
+	}
+	g_hotkeys.Bind(HKMOD_CTRL | HKMOD_SHIFT | HKMOD_ALT, 'Z', HotkeyAction::UndoClear);
+	g_hotkeys.Bind(HotkeyModifiers(settings.autoCopyHotkey), settings.autoCopyHotkey.vkCode, HotkeyAction::FindAndCopy);
+	g_hotkeys.Bind(HotkeyModifiers(settings.autoDeleteHotkey), settings.autoDeleteHotkey.vkCode, HotkeyAction::ClearHistory);
+}
+
+// Re-read the real modifier state. The hook can miss key-ups (secure desktop,
+// hook timeouts), which would otherwise leave a modifier stuck in g_hotkeys.
+// The real state also shows our own injected releases; g_hotkeys does not take
+// those as the user letting go.
+static void SyncHotkeyModifiers() {
+	static const int modifierVks[] = { VK_LCONTROL, VK_RCONTROL, VK_LSHIFT, VK_RSHIFT, VK_LMENU, VK_RMENU, VK_LWIN, VK_RWIN };
+	for (int vk : modifierVks) {
+		g_hotkeys.ResyncModifier((uint32_t)vk, (GetAsyncKeyState(vk) & 0x8000) != 0);
+	}
+}
+
+static void PostHotkeyAction(HWND hWnd, HotkeyAction action) {
+	switch (action) {
+	case HotkeyAction::FindAndCopy:
+		PostMessageW(hWnd, WM_APP_FIND_AND_COPY, 0, 0);
+		break;
+	case HotkeyAction::ClearHistory:
+		PostMessageW(hWnd, WM_APP_CLEAR_HISTORY, 0, 0);
+		break;
+	case HotkeyAction::ShowDiagnostics:
+		PostMessageW(hWnd, WM_APP_SHOW_DIAGNOSTICS, 0, 0);
+		break;
+	case HotkeyAction::UndoClear:
+		PostMessageW(hWnd, WM_APP_UNDO_CLEAR, 0, 0);
+		break;
+	default:
+		if (action >= HotkeyAction::CopySentences && action <= HotkeyAction::CopySentencesLast) {
+			PostMessageW(hWnd, WM_APP_COPY_SENTENCES, (int)action - (int)HotkeyAction::CopySentences + 1, 0);
+		}
+		break;
+	}
+}
+
 static BOOL CALLBACK FindLiveCaptionWindow(HWND hwnd, LPARAM lParam) {
 	WCHAR title[256] = {};
 	if (!GetWindowTextW(hwnd, title, (int)std::size(title))) return TRUE;
-	std::wstring t(title);
-	std::transform(t.begin(), t.end(), t.begin(), ::towlower);
-	if (t.find(L"live caption") != std::wstring::npos) {
+	if (IsLiveCaptionTitle(title)) {
 		*reinterpret_cast<HWND*>(lParam) = hwnd;
 		return FALSE;
 	}
 	return TRUE;
 }
 
-static bool IsUiChrome(const wchar_t* name) {
-	if (!name || !*name) return true;
-	std::wstring s(name);
-	std::transform(s.begin(), s.end(), s.begin(), ::towlower);
-	if (s.find(L"live caption") != std::wstring::npos) return true;
-	if (s == L"settings" || s == L"position" || s == L"preferences") return true;
-	if (s.find(L"caption style") != std::wstring::npos) return true;
-	if (s.find(L"edit") == 0 && s.length() <= 5) return true;
-	return false;
+// The cache's check, run on every poll: one title fetch instead of one per window.
+static bool IsCaptionWindow(WindowDiscovery::Handle window) {
+	HWND hwnd = reinterpret_cast<HWND>(window);
+	WCHAR title[256] = {};
+	return IsWindow(hwnd) && GetWindowTextW(hwnd, title, (int)std::size(title)) && IsLiveCaptionTitle(title);
+}
+
+static WindowDiscovery::Handle ScanForCaptionWindow() {
+	HWND hwndCaption = nullptr;
+	EnumWindows(FindLiveCaptionWindow, reinterpret_cast<LPARAM>(&hwndCaption));
+	return reinterpret_cast<WindowDiscovery::Handle>(hwndCaption);
+}
+
+// Out of context, so delivered on the UI thread through its message loop.
+static void CALLBACK CaptionWindowEvent(HWINEVENTHOOK, DWORD event, HWND hwnd, LONG idObject, LONG idChild, DWORD, DWORD) {
+	if (!hwnd || idObject != OBJID_WINDOW || idChild != CHILDID_SELF) return;
+	// A destroyed window can no longer be asked for its parent.
+	if (event != EVENT_OBJECT_DESTROY && GetAncestor(hwnd, GA_ROOT) != hwnd) return;
+	WindowEvent kind = event == EVENT_OBJECT_CREATE ? WindowEvent::Created :
+		event == EVENT_OBJECT_DESTROY ? WindowEvent::Destroyed : WindowEvent::NameChanged;
+	g_captionWindow.OnEvent(kind, reinterpret_cast<WindowDiscovery::Handle>(hwnd));
+}
+
+// Two hooks: the range between DESTROY and NAMECHANGE holds focus, selection
+// and location changes, which arrive far too often to route through here.
+static void StartWindowEvents() {
+	const DWORD flags = WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS;
+	g_hWindowEventHooks[0] = SetWinEventHook(EVENT_OBJECT_CREATE, EVENT_OBJECT_DESTROY, nullptr, CaptionWindowEvent, 0, 0, flags);
+	g_hWindowEventHooks[1] = SetWinEventHook(EVENT_OBJECT_NAMECHANGE, EVENT_OBJECT_NAMECHANGE, nullptr, CaptionWindowEvent, 0, 0, flags);
+	g_captionWindow.SetEventsAvailable(g_hWindowEventHooks[0] && g_hWindowEventHooks[1]);
+}
+
+static void StopWindowEvents() {
+	for (HWINEVENTHOOK& hook : g_hWindowEventHooks) {
+		if (hook) { UnhookWinEvent(hook); hook = nullptr; }
+	}
+	g_captionWindow.SetEventsAvailable(false);
 }
 
 static bool CollectTextFromElement(IUIAutomation* pAutomation, IUIAutomationElement* pElement, std::wstring& out, bool skipRootName) {
@@ -76,10 +235,10 @@ static bool CollectTextFromElement(IUIAutomation* pAutomation, IUIAutomationElem
 		if (SUCCEEDED(pTextPattern->get_DocumentRange(&pRange)) && pRange) {
 			BSTR bstr = nullptr;
 			if (SUCCEEDED(pRange->GetText(-1, &bstr)) && bstr) {
-				std::wstring candidate(bstr);
+				bool caption = *bstr && !IsUiChrome(bstr);
+				if (caption) out.assign(bstr, SysStringLen(bstr));
 				SysFreeString(bstr);
-				if (!candidate.empty() && !IsUiChrome(candidate.c_str())) {
-					out = candidate;
+				if (caption) {
 					pRange->Release();
 					pTextPattern->Release();
 					return true;
@@ -140,10 +299,11 @@ static void ScrollEditToBottom(HWND hEdit) {
 
 static void ApplyYellowHighlight(HWND hEdit) {
 	if (!hEdit) return;
+	StageTimer timer(g_metrics, MetricStage::Highlight, g_tickSnapshot);
 	int len = GetWindowTextLengthW(hEdit);
 	if (len <= 0) return;
 	g_anchorCharIndex = (std::min)(g_anchorCharIndex, len);
-	AppSettings settings = SettingsDialog::LoadSettings();
+	const AppSettings& settings = SettingsDialog::Current();
 	POINT ptScroll = {};
 	SendMessageW(hEdit, EM_GETSCROLLPOS, 0, (LPARAM)&ptScroll);
 	SendMessageW(hEdit, WM_SETREDRAW, FALSE, 0);
@@ -153,17 +313,28 @@ static void ApplyYellowHighlight(HWND hEdit) {
 	cr.cpMin = 0;
 	cr.cpMax = g_anchorCharIndex;
 	SendMessageW(hEdit, EM_EXSETSEL, 0, (LPARAM)&cr);
-	cf.dwMask = CFM_BACKCOLOR | CFM_COLOR;
+	cf.dwMask = CFM_BACKCOLOR | CFM_COLOR | CFM_BOLD;  // not bold: clears trigger hits rewritten away
 	cf.crTextColor = settings.textColor;
 	cf.crBackColor = settings.bgColor;
 	SendMessageW(hEdit, EM_SETCHARFORMAT, SCF_SELECTION, (LPARAM)&cf);
 	cr.cpMin = g_anchorCharIndex;
 	cr.cpMax = len;
 	SendMessageW(hEdit, EM_EXSETSEL, 0, (LPARAM)&cr);
-	cf.dwMask = CFM_BACKCOLOR | CFM_COLOR;
+	cf.dwMask = CFM_BACKCOLOR | CFM_COLOR | CFM_BOLD;
 	cf.crTextColor = settings.textColor;
 	cf.crBackColor = settings.selectedBgColor;
 	SendMessageW(hEdit, EM_SETCHARFORMAT, SCF_SELECTION, (LPARAM)&cf);
+	for (const TriggerHit& hit : g_triggers.Hits()) {
+		if (!(g_triggers.Phrase(hit.phrase).actions & TRIGGER_HIGHLIGHT) || hit.end > (size_t)len) continue;
+		cr.cpMin = (LONG)hit.start;
+		cr.cpMax = (LONG)hit.end;
+		SendMessageW(hEdit, EM_EXSETSEL, 0, (LPARAM)&cr);
+		cf.dwMask = CFM_BACKCOLOR | CFM_COLOR | CFM_BOLD;
+		cf.dwEffects = CFE_BOLD;
+		cf.crTextColor = RGB(0, 0, 0);
+		cf.crBackColor = TRIGGER_HIGHLIGHT_COLOR;
+		SendMessageW(hEdit, EM_SETCHARFORMAT, SCF_SELECTION, (LPARAM)&cf);
+	}
 	cr.cpMin = g_anchorCharIndex;
 	cr.cpMax = g_anchorCharIndex;
 	SendMessageW(hEdit, EM_EXSETSEL, 0, (LPARAM)&cr);
@@ -172,165 +343,642 @@ static void ApplyYellowHighlight(HWND hEdit) {
 	InvalidateRect(hEdit, nullptr, TRUE);
 }
 
-static bool PasteViaClipboard(const std::wstring& text) {
-	if (text.empty()) return false;
-	if (!OpenClipboard(g_hMainWnd)) return false;
-	HANDLE hOldData = GetClipboardData(CF_UNICODETEXT);
-	std::wstring oldClipboard;
-	if (hOldData) {
-		wchar_t* pOldText = (wchar_t*)GlobalLock(hOldData);
-		if (pOldText) {
-			oldClipboard = pOldText;
-			GlobalUnlock(hOldData);
-		}
-	}
-	EmptyClipboard();
-	size_t size = (text.length() + 1) * sizeof(wchar_t);
-	HGLOBAL hMem = GlobalAlloc(GMEM_MOVEABLE, size);
-	if (!hMem) {
-		CloseClipboard();
-		return false;
-	}
-	wchar_t* pMem = (wchar_t*)GlobalLock(hMem);
-	if (pMem) {
-		wcscpy_s(pMem, text.length() + 1, text.c_str());
-		GlobalUnlock(hMem);
-	}
-	SetClipboardData(CF_UNICODETEXT, hMem);
-	CloseClipboard();
-
-	// If Alt is held (e.g. from an Alt+key hotkey), we must release it
-	// before sending Ctrl+V.  Simply injecting Alt-up would look like a
-	// "lone Alt tap" to the foreground app, which activates the menu bar
-	// and swallows the subsequent Ctrl+V.
-	//
-	// Workaround: inject a Ctrl tap (down+up) WHILE Alt is still held.
-	// This makes the app think "Alt was used as a modifier with Ctrl",
-	// so releasing Alt afterwards won't activate the menu bar.
-	// Then we release Alt and send the real Ctrl+V — all in one atomic
-	// SendInput call so nothing can slip in between.
-	if (g_altPhysicallyDown || (GetAsyncKeyState(VK_MENU) & 0x8000)) {
-		INPUT inputs[8] = {};
-		int n = 0;
-		// 1) Ctrl down while Alt is held — breaks the "lone Alt" detection
-		inputs[n].type = INPUT_KEYBOARD;
-		inputs[n].ki.wVk = VK_CONTROL;
-		n++;
-		// 2) Ctrl up
-		inputs[n].type = INPUT_KEYBOARD;
-		inputs[n].ki.wVk = VK_CONTROL;
-		inputs[n].ki.dwFlags = KEYEVENTF_KEYUP;
-		n++;
-		// 3) Alt up — no menu activation because Ctrl was pressed with Alt
-		inputs[n].type = INPUT_KEYBOARD;
-		inputs[n].ki.wVk = VK_MENU;
-		inputs[n].ki.dwFlags = KEYEVENTF_KEYUP;
-		n++;
-		// 4-7) Clean Ctrl+V paste
-		inputs[n].type = INPUT_KEYBOARD;
-		inputs[n].ki.wVk = VK_CONTROL;
-		n++;
-		inputs[n].type = INPUT_KEYBOARD;
-		inputs[n].ki.wVk = 'V';
-		n++;
-		inputs[n].type = INPUT_KEYBOARD;
-		inputs[n].ki.wVk = 'V';
-		inputs[n].ki.dwFlags = KEYEVENTF_KEYUP;
-		n++;
-		inputs[n].type = INPUT_KEYBOARD;
-		inputs[n].ki.wVk = VK_CONTROL;
-		inputs[n].ki.dwFlags = KEYEVENTF_KEYUP;
-		n++;
-		SendInput(n, inputs, sizeof(INPUT));
-		g_altSuppressed = true;  // suppress the real physical Alt-keyup later
-	}
-	else {
-		Sleep(10);
-		// No Alt held — just send Ctrl+V
+static ClipboardProvider g_clipboard;
+
+// SendInput for keystrokes of our own, tagged so the keyboard hook lets them
+// through without counting them as the user's.
+static UINT SendOwnInput(UINT count, INPUT* inputs) {
+	for (UINT i = 0; i < count; i++) inputs[i].ki.dwExtraInfo = OWN_INPUT_TAG;
+	return SendInput(count, inputs, sizeof(INPUT));
+}
+
+// Win32 side of the paste pipeline; the step order and delays live in PasteSequencer.
+class Win32PastePlatform : public IPastePlatform {
+public:
+	uint64_t NowMs() override { return GetTickCount64(); }
+
+	void SendSelectAll() override {
+		// Select all in the focused control so the paste replaces its content
 		INPUT inputs[4] = {};
 		inputs[0].type = INPUT_KEYBOARD;
 		inputs[0].ki.wVk = VK_CONTROL;
 		inputs[1].type = INPUT_KEYBOARD;
-		inputs[1].ki.wVk = 'V';
+		inputs[1].ki.wVk = 'A';
 		inputs[2].type = INPUT_KEYBOARD;
-		inputs[2].ki.wVk = 'V';
+		inputs[2].ki.wVk = 'A';
 		inputs[2].ki.dwFlags = KEYEVENTF_KEYUP;
 		inputs[3].type = INPUT_KEYBOARD;
 		inputs[3].ki.wVk = VK_CONTROL;
 		inputs[3].ki.dwFlags = KEYEVENTF_KEYUP;
-		SendInput(4, inputs, sizeof(INPUT));
-	}
-	Sleep(50);
-	if (!oldClipboard.empty()) {
-		if (OpenClipboard(g_hMainWnd)) {
-			EmptyClipboard();
-			size_t oldSize = (oldClipboard.length() + 1) * sizeof(wchar_t);
-			HGLOBAL hOldMem = GlobalAlloc(GMEM_MOVEABLE, oldSize);
-			if (hOldMem) {
-				wchar_t* pOldMem = (wchar_t*)GlobalLock(hOldMem);
-				if (pOldMem) {
-					wcscpy_s(pOldMem, oldClipboard.length() + 1, oldClipboard.c_str());
-					GlobalUnlock(hOldMem);
-					SetClipboardData(CF_UNICODETEXT, hOldMem);
-				}
-			}
-			CloseClipboard();
-		}
+		SendOwnInput(4, inputs);
 	}
-	return true;
-}
-static void DoFindAndCopyWork(bool replaceAll) {
-	if (InterlockedCompareExchange(&g_pasteInProgress, 1, 0) != 0) return;
-	try {
-		if (g_captionHistory.empty()) {
-			InterlockedExchange(&g_pasteInProgress, 0);
+
+	// The snapshot reads every format the user has; one that another
+	// application renders lazily is rendered while we wait, so that happens on
+	// a worker instead of the thread running the input hooks.
+	void PrepareClipboard() override {
+		if (++m_prepareId == 0) m_prepareId = 1;
+		if (!g_clipboard.NeedsSnapshot(g_hMainWnd)) return;
+		if (!g_tasks.Running()) {
+			g_clipboard.SetSnapshot(ClipboardProvider::TakeSnapshot());
 			return;
 		}
+		m_preparing = m_prepareId;
+		auto snapshot = std::make_shared<ClipboardSnapshot>();
+		unsigned id = m_prepareId;
+		g_tasks.Post(TaskPriority::High, [snapshot] { *snapshot = ClipboardProvider::TakeSnapshot(); },
+			[this, snapshot, id] {
+				if (m_preparing != id) return;  // a later paste asked for its own
+				g_clipboard.SetSnapshot(std::move(*snapshot));
+				m_preparing = 0;
+			});
+	}
 
-		// When replaceAll (e.g. middle-button): select all in the focused control so paste replaces content
-		if (replaceAll) {
+	bool ClipboardPrepared() override {
+		return m_preparing != m_prepareId;
+	}
+
+	bool PlaceOnClipboard(const ClipboardPayload& payload) override {
+		return g_clipboard.Offer(g_hMainWnd, &g_captionHistory, payload);
+	}
+
+	void SendPasteKeys() override {
+		// If Alt is held (e.g. from an Alt+key hotkey), we must release it
+		// before sending Ctrl+V.  Simply injecting Alt-up would look like a
+		// "lone Alt tap" to the foreground app, which activates the menu bar
+		// and swallows the subsequent Ctrl+V.
+		//
+		// Workaround: inject a Ctrl tap (down+up) WHILE Alt is still held.
+		// This makes the app think "Alt was used as a modifier with Ctrl",
+		// so releasing Alt afterwards won't activate the menu bar.
+		// Then we release Alt and send the real Ctrl+V — all in one atomic
+		// SendInput call so nothing can slip in between.
+		if (IsAltHeld() || (GetAsyncKeyState(VK_MENU) & 0x8000)) {
+			INPUT inputs[8] = {};
+			int n = 0;
+			// 1) Ctrl down while Alt is held — breaks the "lone Alt" detection
+			inputs[n].type = INPUT_KEYBOARD;
+			inputs[n].ki.wVk = VK_CONTROL;
+			n++;
+			// 2) Ctrl up
+			inputs[n].type = INPUT_KEYBOARD;
+			inputs[n].ki.wVk = VK_CONTROL;
+			inputs[n].ki.dwFlags = KEYEVENTF_KEYUP;
+			n++;
+			// 3) Alt up — no menu activation because Ctrl was pressed with Alt
+			inputs[n].type = INPUT_KEYBOARD;
+			inputs[n].ki.wVk = VK_MENU;
+			inputs[n].ki.dwFlags = KEYEVENTF_KEYUP;
+			n++;
+			// 4-7) Clean Ctrl+V paste
+			inputs[n].type = INPUT_KEYBOARD;
+			inputs[n].ki.wVk = VK_CONTROL;
+			n++;
+			inputs[n].type = INPUT_KEYBOARD;
+			inputs[n].ki.wVk = 'V';
+			n++;
+			inputs[n].type = INPUT_KEYBOARD;
+			inputs[n].ki.wVk = 'V';
+			inputs[n].ki.dwFlags = KEYEVENTF_KEYUP;
+			n++;
+			inputs[n].type = INPUT_KEYBOARD;
+			inputs[n].ki.wVk = VK_CONTROL;
+			inputs[n].ki.dwFlags = KEYEVENTF_KEYUP;
+			n++;
+			SendOwnInput(n, inputs);
+			g_altSuppressed = true;  // suppress the real physical Alt-keyup later
+		}
+		else {
+			// No Alt held — just send Ctrl+V
 			INPUT inputs[4] = {};
 			inputs[0].type = INPUT_KEYBOARD;
 			inputs[0].ki.wVk = VK_CONTROL;
 			inputs[1].type = INPUT_KEYBOARD;
-			inputs[1].ki.wVk = 'A';
+			inputs[1].ki.wVk = 'V';
 			inputs[2].type = INPUT_KEYBOARD;
-			inputs[2].ki.wVk = 'A';
+			inputs[2].ki.wVk = 'V';
 			inputs[2].ki.dwFlags = KEYEVENTF_KEYUP;
 			inputs[3].type = INPUT_KEYBOARD;
 			inputs[3].ki.wVk = VK_CONTROL;
 			inputs[3].ki.dwFlags = KEYEVENTF_KEYUP;
-			SendInput(4, inputs, sizeof(INPUT));
-			Sleep(30);
+			SendOwnInput(4, inputs);
 		}
+	}
 
-		// Ensure anchor index is valid - if it's at or beyond the end, copy from the beginning
-		int startIndex = g_anchorHistoryIndex;
-		if (startIndex < 0) startIndex = 0;
-		if (startIndex >= (int)g_captionHistory.length()) startIndex = 0;
+	void RestoreClipboard() override {
+		g_clipboard.Restore(g_hMainWnd);
+	}
+
+	void ReadPayload(const ClipboardPayload& payload, std::wstring& out) override {
+		out.resize(PayloadLength(payload, g_captionHistory) + 1);
+		out.resize(RenderPayload(payload, g_captionHistory, out.data(), out.size()));
+	}
 
-		// Copy from startIndex to end
-		std::wstring textToCopy = g_captionHistory.substr(startIndex);
-		if (!textToCopy.empty()) {
-			PasteViaClipboard(textToCopy);
+	void ReleaseModifiers() override {
+		INPUT inputs[7] = {};
+		int n = 0;
+		bool altHeld = IsAltHeld() || (GetAsyncKeyState(VK_MENU) & 0x8000);
+		bool lwinHeld = (GetAsyncKeyState(VK_LWIN) & 0x8000) != 0;
+		bool rwinHeld = (GetAsyncKeyState(VK_RWIN) & 0x8000) != 0;
+		if (altHeld || lwinHeld || rwinHeld) {
+			// Same trick as SendPasteKeys: a Ctrl tap while Alt is held keeps the
+			// Alt release from activating the target's menu bar, and a Win release
+			// from opening Start.
+			inputs[n].type = INPUT_KEYBOARD;
+			inputs[n].ki.wVk = VK_CONTROL;
+			n++;
+			inputs[n].type = INPUT_KEYBOARD;
+			inputs[n].ki.wVk = VK_CONTROL;
+			inputs[n].ki.dwFlags = KEYEVENTF_KEYUP;
+			n++;
+		}
+		if (altHeld) {
+			inputs[n].type = INPUT_KEYBOARD;
+			inputs[n].ki.wVk = VK_MENU;
+			inputs[n].ki.dwFlags = KEYEVENTF_KEYUP;
+			n++;
+			g_altSuppressed = true;  // suppress the real physical Alt-keyup later
+		}
+		// A held Win key would turn every typed unit into a Win+key shortcut.
+		if (lwinHeld) {
+			inputs[n].type = INPUT_KEYBOARD;
+			inputs[n].ki.wVk = VK_LWIN;
+			inputs[n].ki.dwFlags = KEYEVENTF_KEYUP;
+			n++;
+		}
+		if (rwinHeld) {
+			inputs[n].type = INPUT_KEYBOARD;
+			inputs[n].ki.wVk = VK_RWIN;
+			inputs[n].ki.dwFlags = KEYEVENTF_KEYUP;
+			n++;
+		}
+		if (GetAsyncKeyState(VK_CONTROL) & 0x8000) {
+			inputs[n].type = INPUT_KEYBOARD;
+			inputs[n].ki.wVk = VK_CONTROL;
+			inputs[n].ki.dwFlags = KEYEVENTF_KEYUP;
+			n++;
 		}
+		if (GetAsyncKeyState(VK_SHIFT) & 0x8000) {
+			inputs[n].type = INPUT_KEYBOARD;
+			inputs[n].ki.wVk = VK_SHIFT;
+			inputs[n].ki.dwFlags = KEYEVENTF_KEYUP;
+			n++;
+		}
+		if (n) SendOwnInput(n, inputs);
 	}
-	catch (...) {
+
+	void SendKeyStrokes(const KeyStroke* strokes, size_t count) override {
+		m_inputs.resize(count);
+		for (size_t i = 0; i < count; i++) {
+			INPUT& in = m_inputs[i];
+			in = {};
+			in.type = INPUT_KEYBOARD;
+			if (strokes[i].vk) {
+				in.ki.wVk = strokes[i].vk;
+			}
+			else {
+				in.ki.wScan = strokes[i].unit;
+				in.ki.dwFlags = KEYEVENTF_UNICODE;
+			}
+			if (strokes[i].keyUp) in.ki.dwFlags |= KEYEVENTF_KEYUP;
+		}
+		SendOwnInput((UINT)count, m_inputs.data());
+	}
+
+	void ScheduleWake(uint32_t delayMs) override {
+		SetTimer(g_hMainWnd, IDT_PASTE_STEP, (std::max)(delayMs, (uint32_t)USER_TIMER_MINIMUM), nullptr);
+	}
+
+	void CancelWake() override {
+		KillTimer(g_hMainWnd, IDT_PASTE_STEP);
+	}
+
+private:
+	std::vector<INPUT> m_inputs;  // reused across typed batches
+	unsigned m_prepareId = 0;     // one per PrepareClipboard call
+	unsigned m_preparing = 0;     // the one still running in the background, if any
+};
+
+static Win32PastePlatform g_pastePlatform;
+static PasteSequencer g_pasteSequencer(g_pastePlatform);
+
+static std::wstring DiagnosticsReport() {
+	return g_metrics.Report() + L"\r\n" + g_hookSupervisor.Describe() + L"\r\n" + g_captionStream.Describe() +
+		L"\r\n" + g_transcriptLog.Describe() + L"\r\n" + g_startup.Report(STARTUP_BUDGET_MS) +
+		(g_captureMux.SourceCount() ? L"\r\n" + g_captureMux.Describe() : std::wstring()) + L"\r\n" + g_tasks.Describe() +
+		L"\r\n" + g_journal.Describe() + L"\r\n" + g_captionWindow.Describe();
+}
+
+static void ResetDiagnostics() {
+	g_metrics.Reset();
+}
+
+// Chrome trace event JSON next to the executable; open it in chrome://tracing
+// or Perfetto. The "snapshot" track shows each snapshot from capture to paint.
+static void StartTracing() {
+	std::wstring path = DiagnosticsView::TimestampedAppFile(L"LCCopier_trace", L".json");
+	if (path.empty()) return;
+	g_traceFile = CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (g_traceFile == INVALID_HANDLE_VALUE) return;
+	DWORD written = 0;
+	WriteFile(g_traceFile, "[\n", 2, &written, nullptr);
+	TraceSetThreadName("ui");
+	TraceEnable(true);
+}
+
+// Move buffered events to the pending output. The final flush writes the rest
+// itself and closes the JSON array (trace viewers also accept a file cut off
+// without it).
+static void FlushTrace(bool final) {
+	if (g_traceFile == INVALID_HANDLE_VALUE) return;
+	if (final) TraceEnable(false);
+	std::string& json = g_pendingOutput.trace;
+	TraceDrain(json);
+	if (!final) return;
+	char tail[160];
+	sprintf_s(tail, "{\"name\":\"dropped_events\",\"ph\":\"i\",\"s\":\"g\",\"ts\":%llu,\"pid\":1,\"tid\":1,\"args\":{\"count\":%llu}}\n]\n",
+		(unsigned long long)TraceNowUs(), (unsigned long long)TraceDropped());
+	json += tail;
+	DWORD written = 0;
+	WriteFile(g_traceFile, json.data(), (DWORD)json.size(), &written, nullptr);
+	json.clear();
+	CloseHandle(g_traceFile);
+	g_traceFile = INVALID_HANDLE_VALUE;
+}
+
+static void AppendToFile(HANDLE file, const std::string& data) {
+	DWORD written = 0;
+	if (file != INVALID_HANDLE_VALUE && !data.empty()) WriteFile(file, data.data(), (DWORD)data.size(), &written, nullptr);
+}
+
+static HANDLE CreateAppFile(const wchar_t* prefix, const wchar_t* extension) {
+	std::wstring path = DiagnosticsView::TimestampedAppFile(prefix, extension);
+	if (path.empty()) return INVALID_HANDLE_VALUE;
+	return CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+}
+
+static bool SubtitlesEnabled() {
+	return g_srtFile != INVALID_HANDLE_VALUE || g_vttFile != INVALID_HANDLE_VALUE;
+}
+
+static void StartSubtitles() {
+	g_srtFile = CreateAppFile(L"LCCopier_captions", L".srt");
+	g_vttFile = CreateAppFile(L"LCCopier_captions", L".vtt");
+}
+
+// Move the cues finished so far to the pending output. The final flush turns
+// the rest of the transcript into cues, writes them and closes the files.
+static void FlushSubtitles(bool final) {
+	if (!SubtitlesEnabled()) return;
+	if (final) g_subtitles.Finish(g_captionHistory, GetTickCount64());
+	g_subtitles.TakeSrt(g_pendingOutput.srt);
+	g_subtitles.TakeVtt(g_pendingOutput.vtt);
+	if (!final) return;
+	AppendToFile(g_srtFile, g_pendingOutput.srt);
+	AppendToFile(g_vttFile, g_pendingOutput.vtt);
+	g_pendingOutput.srt.clear();
+	g_pendingOutput.vtt.clear();
+	if (g_srtFile != INVALID_HANDLE_VALUE) CloseHandle(g_srtFile);
+	if (g_vttFile != INVALID_HANDLE_VALUE) CloseHandle(g_vttFile);
+	g_srtFile = g_vttFile = INVALID_HANDLE_VALUE;
+}
+
+// Run by the output task, or once the pool has stopped.
+static void AppendToTriggerLog(const std::string& lines) {
+	if (lines.empty()) return;
+	if (g_triggerLogFile == INVALID_HANDLE_VALUE) g_triggerLogFile = CreateAppFile(L"LCCopier_triggers", L".log");
+	AppendToFile(g_triggerLogFile, lines);
+}
+
+// At exit, after the pool has stopped: write the hits still pending and close.
+static void FlushTriggerLog() {
+	AppendToTriggerLog(g_pendingOutput.triggers);
+	g_pendingOutput.triggers.clear();
+	if (g_triggerLogFile != INVALID_HANDLE_VALUE) CloseHandle(g_triggerLogFile);
+	g_triggerLogFile = INVALID_HANDLE_VALUE;
+}
+
+static void StartRecording() {
+	g_recordFile = CreateAppFile(L"LCCopier_snapshots", L".txt");
+	g_recordStartMs = GetTickCount64();
+}
+
+static void FlushRecording(bool final) {
+	if (g_recordFile == INVALID_HANDLE_VALUE) return;
+	g_pendingOutput.record += g_recordBuffer;
+	g_recordBuffer.clear();
+	if (!final) return;
+	AppendToFile(g_recordFile, g_pendingOutput.record);
+	g_pendingOutput.record.clear();
+	CloseHandle(g_recordFile);
+	g_recordFile = INVALID_HANDLE_VALUE;
+}
+
+// Hand the pending output to a task, so the files are written off the UI
+// thread. The hand-off waits for a pause in the captions, when the pool is
+// otherwise quiet; during continuous speech there may be none, so output that
+// has waited OUTPUT_MAX_PENDING_MS or grown past OUTPUT_MAX_PENDING_BYTES goes
+// anyway. It is posted as Normal: an Idle task queued just before speech
+// resumed would hold the output, and everything after it, until the next
+// pause. The handles stay open until WM_DESTROY, which stops the pool
+// (running what is still queued) first.
+static void WriteOutputInBackground() {
+	if (g_pendingOutput.Empty()) {
+		g_pendingOutputSinceMs = 0;
+		return;
 	}
-	InterlockedExchange(&g_pasteInProgress, 0);
+	ULONGLONG now = GetTickCount64();
+	if (!g_pendingOutputSinceMs) g_pendingOutputSinceMs = now;
+	if (g_outputTaskQueued) return;
+	bool pause = now - g_lastCaptionChangeMs >= TASK_IDLE_AFTER_MS && !g_pasteSequencer.Busy();
+	bool overdue = now - g_pendingOutputSinceMs >= OUTPUT_MAX_PENDING_MS || g_pendingOutput.Bytes() >= OUTPUT_MAX_PENDING_BYTES;
+	if (!pause && !overdue) return;
+	auto output = std::make_shared<PendingOutput>(std::move(g_pendingOutput));
+	g_pendingOutput = PendingOutput();
+	g_pendingOutputSinceMs = 0;
+	HANDLE trace = g_traceFile, srt = g_srtFile, vtt = g_vttFile, record = g_recordFile;
+	g_outputTaskQueued = true;
+	g_tasks.Post(TaskPriority::Normal, [=] {
+		AppendToFile(trace, output->trace);
+		AppendToFile(srt, output->srt);
+		AppendToFile(vtt, output->vtt);
+		AppendToFile(record, output->record);
+		AppendToTriggerLog(output->triggers);
+	}, [] { g_outputTaskQueued = false; });
+}
+
+// Extra caption sources (--source "<window title text>[@<poll ms>]", repeatable),
+// captured on the CaptureMux workers. Each worker has its own MTA and UI
+// Automation object; nothing per source runs on this thread.
+static thread_local IUIAutomation* t_automation = nullptr;
+
+static void CaptureThreadStart() {
+	CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+	CoCreateInstance(__uuidof(CUIAutomation), nullptr, CLSCTX_INPROC_SERVER, __uuidof(IUIAutomation), reinterpret_cast<void**>(&t_automation));
+}
+
+static void CaptureThreadEnd() {
+	if (t_automation) { t_automation->Release(); t_automation = nullptr; }
+	CoUninitialize();
+}
+
+struct TitleSearch {
+	std::wstring match;  // folded
+	HWND hwnd;
+};
+
+// A top-level window of another process whose title contains match (folded).
+static bool TitleContains(HWND hwnd, const std::wstring& match) {
+	WCHAR title[256] = {};
+	if (!GetWindowTextW(hwnd, title, (int)std::size(title))) return false;
+	DWORD pid = 0;
+	GetWindowThreadProcessId(hwnd, &pid);
+	if (pid == GetCurrentProcessId()) return false;
+	std::wstring folded(title);
+	FoldCase(folded);
+	return folded.find(match) != std::wstring::npos;
+}
+
+// First window TitleContains accepts.
+static BOOL CALLBACK FindWindowByTitle(HWND hwnd, LPARAM lParam) {
+	TitleSearch* search = reinterpret_cast<TitleSearch*>(lParam);
+	if (!TitleContains(hwnd, search->match)) return TRUE;
+	search->hwnd = hwnd;
+	return FALSE;
+}
+
+// Each source's window, cached the way the Live Caption window is, indexed
+// like the CaptureMux sources and only used by the worker polling that
+// source. Window events arrive on this thread, so they are not fed in: while
+// a source's window is missing every poll scans, as before; once found, a
+// poll only checks that it still exists and still matches.
+static std::vector<std::unique_ptr<WindowDiscovery>> g_sourceWindows;
+
+static void AddSourceWindow(const CaptureSourceSpec& spec) {
+	std::wstring match = spec.match;
+	FoldCase(match);
+	g_sourceWindows.push_back(std::make_unique<WindowDiscovery>(
+		[match](WindowDiscovery::Handle window) {
+			HWND hwnd = reinterpret_cast<HWND>(window);
+			return IsWindow(hwnd) && TitleContains(hwnd, match);
+		},
+		[match] {
+			TitleSearch search = { match, nullptr };
+			EnumWindows(FindWindowByTitle, reinterpret_cast<LPARAM>(&search));
+			return reinterpret_cast<WindowDiscovery::Handle>(search.hwnd);
+		}));
+}
+
+static bool CaptureSourceText(size_t source, const CaptureSourceSpec&, std::wstring& text) {
+	if (!t_automation || source >= g_sourceWindows.size()) return false;
+	HWND hwnd = reinterpret_cast<HWND>(g_sourceWindows[source]->Find(GetTickCount64()));
+	if (!hwnd) return false;
+	IUIAutomationElement* pRoot = nullptr;
+	if (FAILED(t_automation->ElementFromHandle(hwnd, &pRoot)) || !pRoot) return false;
+	CollectTextFromElement(t_automation, pRoot, text, true);
+	pRoot->Release();
+	while (!text.empty() && (text.back() == L'\r' || text.back() == L'\n')) text.pop_back();
+	return true;
 }
 
-static int FindWordStart(const std::wstring& text, int pos) {
-	if (text.empty() || pos <= 0) return 0;
-	if (pos >= (int)text.length()) pos = (int)text.length() - 1;
-	while (pos > 0) {
-		wchar_t ch = text[pos - 1];
-		if (ch == L' ' || ch == L'\t' || ch == L'\r' || ch == L'\n' || ch == L'.' || ch == L',' || ch == L'!' || ch == L'?') {
-			break;
+static void AddCaptureSources(const wchar_t* commandLine, bool& timeline) {
+	int argc = 0;
+	LPWSTR* argv = CommandLineToArgvW(commandLine, &argc);
+	if (!argv) return;
+	for (int i = 1; i < argc; i++) {
+		if (!_wcsicmp(argv[i], L"--timeline") || !_wcsicmp(argv[i], L"/timeline")) {
+			timeline = true;
+			continue;
+		}
+		if ((_wcsicmp(argv[i], L"--source") && _wcsicmp(argv[i], L"/source")) || i + 1 >= argc) continue;
+		CaptureSourceSpec spec;
+		spec.match = argv[++i];
+		size_t at = spec.match.rfind(L'@');
+		if (at != std::wstring::npos && at + 1 < spec.match.size() && iswdigit(spec.match[at + 1])) {
+			spec.pollMs = (uint32_t)_wtoi(spec.match.c_str() + at + 1);
+			spec.match.resize(at);
 		}
-		pos--;
+		spec.name = spec.match;
+		if (spec.match.empty()) continue;
+		g_captureMux.AddSource(spec);
+		AddSourceWindow(spec);
+	}
+	LocalFree(argv);
+}
+
+// Each source's history and the interleaved timeline, written once at exit.
+static void SaveCaptureSources() {
+	if (!g_captureMux.SourceCount()) return;
+	g_captureMux.Stop();
+	HANDLE file = CreateAppFile(L"LCCopier_sources", L".txt");
+	if (file == INVALID_HANDLE_VALUE) return;
+	std::string out;
+	for (size_t i = 0; i < g_captureMux.SourceCount(); i++) {
+		out += "[";
+		AppendUtf8(out, g_captureMux.Spec(i).name);
+		out += "]\r\n";
+		AppendUtf8(out, g_captureMux.History(i));
+		out += "\r\n\r\n";
+	}
+	std::wstring timeline = g_captureMux.Timeline();
+	if (!timeline.empty()) {
+		out += "[timeline]\r\n";
+		AppendUtf8(out, timeline);
+		out += "\r\n";
+	}
+	AppendToFile(file, out);
+	CloseHandle(file);
+}
+
+// Every rewrite Live Caption made this session, what it showed first and what
+// replaced it, in LCCopier_revisions_<stamp>.txt.
+static void SaveRevisions() {
+	if (!g_saveRevisions) return;
+	HANDLE file = CreateAppFile(L"LCCopier_revisions", L".txt");
+	if (file == INVALID_HANDLE_VALUE) return;
+	std::string out;
+	AppendUtf8(out, g_journal.RewriteReport());
+	AppendToFile(file, out);
+	CloseHandle(file);
+}
+
+// Phrase triggers: one phrase per line in LCCopier_triggers.txt (UTF-8), see
+// ParseTriggerList. Read once at startup; no file, no triggers.
+// The list is read and compiled on the pool and swapped in on the UI thread.
+// Text already in the history then is highlighted but does not fire.
+static void LoadTriggers() {
+	std::wstring directory = DiagnosticsView::AppDirectory();
+	if (directory.empty()) return;
+	std::wstring path = directory + TRIGGER_LIST_FILE;
+	g_tasks.Submit<PhraseTriggers>(TaskPriority::Normal, [path] {
+		PhraseTriggers triggers;
+		HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+			nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) return triggers;
+		std::string bytes;
+		char buffer[4096];
+		DWORD read = 0;
+		while (ReadFile(file, buffer, sizeof(buffer), &read, nullptr) && read) bytes.append(buffer, read);
+		CloseHandle(file);
+		triggers.Compile(ParseTriggerList(DecodeUtf8(bytes)));
+		return triggers;
+	}, [](PhraseTriggers& triggers) {
+		if (triggers.Empty()) return;
+		g_triggers = std::move(triggers);
+		if (g_captionHistory.empty()) return;
+		HistoryEdit existing;
+		existing.inserted = g_captionHistory.size();
+		std::vector<TriggerHit> ignored;
+		g_triggers.OnEdit(existing, g_captionHistory, ignored);
+		ApplyYellowHighlight(GetDlgItem(g_hMainWnd, IDC_CAPTION_EDIT));
+	});
+}
+
+// Runs inside UpdateCaptionHistory, so the line only goes to the pending
+// output; the output task writes it.
+static void LogTrigger(const TriggerHit& hit) {
+	SYSTEMTIME now;
+	GetLocalTime(&now);
+	char stamp[32];
+	snprintf(stamp, sizeof(stamp), "%04u-%02u-%02u %02u:%02u:%02u  ", now.wYear, now.wMonth, now.wDay, now.wHour, now.wMinute, now.wSecond);
+	size_t from = hit.start > TRIGGER_LOG_CONTEXT ? hit.start - TRIGGER_LOG_CONTEXT : 0;
+	size_t to = (std::min)(hit.end + TRIGGER_LOG_CONTEXT, g_captionHistory.size());
+	std::wstring context = g_captionHistory.substr(from, to - from);
+	for (wchar_t& ch : context) if (ch == L'\r' || ch == L'\n') ch = L' ';
+	std::string& log = g_pendingOutput.triggers;
+	log += stamp;
+	AppendUtf8(log, g_triggers.Phrase(hit.phrase).text);
+	log += "  ...";
+	AppendUtf8(log, context);
+	log += "...\r\n";
+}
+
+static void FireTriggers() {
+	bool flash = false;
+	for (const TriggerHit& hit : g_triggersFired) {
+		uint8_t actions = g_triggers.Phrase(hit.phrase).actions;
+		if (actions & TRIGGER_FLASH) flash = true;
+		if (actions & TRIGGER_LOG) LogTrigger(hit);
+	}
+	if (flash && g_hMainWnd) {
+		FLASHWINFO info = { sizeof(info), g_hMainWnd, FLASHW_ALL | FLASHW_TIMERNOFG, 3, 0 };
+		FlashWindowEx(&info);
+	}
+	g_triggersFired.clear();
+}
+
+// Record the end-to-end time of a paste once the sequencer has gone idle.
+static void NotePasteProgress() {
+	if (g_pasteTimed && !g_pasteSequencer.Busy()) {
+		g_pasteTimed = false;
+		auto elapsed = std::chrono::steady_clock::now() - g_pasteStartedAt;
+		g_metrics.Record(MetricStage::PasteTotal, (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+	}
+}
+
+static bool StartPaste(const ClipboardPayload& payload, bool replaceAll, size_t backspaces = 0, PasteDoneFn done = nullptr) {
+	{
+		StageTimer timer(g_metrics, MetricStage::PasteStep);
+		if (!g_pasteTimed) {
+			g_pasteTimed = true;
+			g_pasteStartedAt = std::chrono::steady_clock::now();
+		}
+		if (!g_pasteSequencer.Start(payload, replaceAll, backspaces, std::move(done))) {
+			g_pasteTimed = g_pasteSequencer.Busy();
+			return false;
+		}
+		g_metrics.Counters().pastes++;
+	}
+	NotePasteProgress();
+	return true;
+}
+
+// "Paste only what's new": paste the history the target has not received yet.
+// Text we already pasted that Live Caption has since revised is erased with
+// Backspace and pasted again; a revision too large to erase blindly goes on a
+// new line instead, with a warning beep. The cursor is moved from the
+// sequencer's report, once the text handed over is fixed, not when the paste
+// is asked for.
+static void DoIncrementalPaste() {
+	// The delta is taken when the paste starts, so don't queue behind a running one.
+	if (g_pasteSequencer.Busy()) return;
+	PasteCursor::Delta delta = g_pasteCursor.Pending(g_captionHistory);
+	ClipboardPayload payload;
+	payload.start = delta.start;
+	payload.length = delta.length;
+	payload.leadingBreak = delta.lineBreak;
+	if (delta.lineBreak && delta.rewritten) MessageBeep(MB_ICONWARNING);
+	StartPaste(payload, false, delta.retract, [delta, payload](const PasteResult& result) {
+		if (result.textSent) g_pasteCursor.OnPasted(delta, PayloadRange(payload, g_captionHistory));
+		else if (result.backspacesSent) g_pasteCursor.OnRetracted(delta);
+	});
+}
+
+static void DoFindAndCopyWork(bool replaceAll) {
+	try {
+		if (g_captionHistory.empty()) return;
+		if (g_incrementalPaste && !replaceAll) {
+			DoIncrementalPaste();
+			return;
+		}
+
+		// Ensure anchor index is valid - if it's at or beyond the end, copy from the beginning
+		int startIndex = g_anchorHistoryIndex;
+		if (startIndex < 0) startIndex = 0;
+		if (startIndex >= (int)g_captionHistory.length()) startIndex = 0;
+
+		// Paste from startIndex to end. Only the range is captured here: short
+		// ranges are typed, longer ones are rendered from g_captionHistory when the
+		// target reads the clipboard. The remaining steps run from IDT_PASTE_STEP.
+		ClipboardPayload payload;
+		payload.start = (size_t)startIndex;
+		payload.length = g_captionHistory.length() - payload.start;
+		StartPaste(payload, replaceAll, 0, [payload](const PasteResult& result) {
+			if (result.textSent) g_pasteCursor.MarkPasted(payload.start, PayloadRange(payload, g_captionHistory));
+		});
+	}
+	catch (...) {
 	}
-	return pos;
 }
 
 static void AutoStartLiveCaption() {
@@ -350,17 +998,67 @@ static void AutoStartLiveCaption() {
 	inputs[5].type = INPUT_KEYBOARD;
 	inputs[5].ki.wVk = VK_LWIN;
 	inputs[5].ki.dwFlags = KEYEVENTF_KEYUP;
-	SendInput(6, inputs, sizeof(INPUT));
+	SendOwnInput(6, inputs);
+}
+
+// Only an invisible window needs the taskbar button removed, so most sessions
+// never create the COM object.
+static ITaskbarList* TaskbarList() {
+	if (!g_pTaskbarList) {
+		CoCreateInstance(CLSID_TaskbarList, nullptr, CLSCTX_INPROC_SERVER,
+			IID_ITaskbarList, reinterpret_cast<void**>(&g_pTaskbarList));
+		if (g_pTaskbarList && FAILED(g_pTaskbarList->HrInit())) {
+			g_pTaskbarList->Release();
+			g_pTaskbarList = nullptr;
+		}
+	}
+	return g_pTaskbarList;
+}
+
+// Origin for the startup profile: process creation, so loader time is counted.
+static std::chrono::steady_clock::time_point ProcessStartTime() {
+	auto now = std::chrono::steady_clock::now();
+	FILETIME created, exited, kernel, user, current;
+	if (!GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user)) return now;
+	GetSystemTimePreciseAsFileTime(&current);
+	ULARGE_INTEGER c, n;
+	c.LowPart = created.dwLowDateTime;
+	c.HighPart = created.dwHighDateTime;
+	n.LowPart = current.dwLowDateTime;
+	n.HighPart = current.dwHighDateTime;
+	if (n.QuadPart <= c.QuadPart) return now;
+	return now - std::chrono::microseconds((n.QuadPart - c.QuadPart) / 10);
 }
 
 static void DoClearHistory() {
-	std::wstring currentLiveCaption = GetLiveCaptionText();
+	std::wstring currentLiveCaption;
+	GetLiveCaptionText(currentLiveCaption);
+	g_clipboard.OnSourceChanging();
+	// Text still being revised goes out now: on undo it comes back in front of
+	// what these have exported.
+	if (SubtitlesEnabled()) g_subtitles.Finish(g_captionHistory, GetTickCount64());
+	if (g_transcriptLog.Running()) g_transcriptLog.Finish(g_captionHistory);
+	HistoryEdit cleared;
+	cleared.removed = g_captionHistory.length();
+	if (!g_captionHistory.empty()) {
+		if (g_clearedHistories.size() >= UNDO_MAX_CLEARS) g_clearedHistories.erase(g_clearedHistories.begin());
+		g_clearedHistories.push_back(ClearedHistory{ std::move(g_captionHistory), std::move(g_sentences),
+			g_anchorCharIndex, g_anchorHistoryIndex, g_anchorSetByUser });
+	}
 	g_captionHistory.clear();
+	g_captionStream.Publish(cleared, g_captionHistory);
+	g_journal.OnEdit(cleared, g_captionHistory, GetTickCount64());
+	g_sentences.Clear();
+	g_repeats.Clear();
+	g_triggers.Reset();
+	if (SubtitlesEnabled()) g_subtitles.OnEdit(cleared, g_captionHistory, GetTickCount64());
+	if (g_transcriptLog.Running()) g_transcriptLog.OnEdit(cleared, g_captionHistory, GetTickCount64());
 	g_previousCaption = currentLiveCaption;
 	g_lastCaptionText = currentLiveCaption;
 	g_anchorCharIndex = 0;
 	g_anchorHistoryIndex = 0;
 	g_anchorSetByUser = false;
+	g_pasteCursor.Reset(0);
 	HWND hEdit = GetDlgItem(g_hMainWnd, IDC_CAPTION_EDIT);
 	if (hEdit) {
 		SendMessageW(hEdit, WM_SETREDRAW, FALSE, 0);
@@ -370,128 +1068,204 @@ static void DoClearHistory() {
 	}
 }
 
-static void UpdateCaptionHistory(const std::wstring& currentText) {
-	if (g_previousCaption.empty()) {
-		g_captionHistory = currentText;
-		g_previousCaption = currentText;
-		return;
+// Ctrl+Shift+Alt+1..9: paste the last n sentences, found in the sentence
+// table rather than by scanning the history.
+static void DoCopyLastSentences(size_t n) {
+	size_t end = g_captionHistory.length();
+	while (end > 0 && iswspace(g_captionHistory[end - 1])) end--;
+	size_t start = g_sentences.StartOfLast(n, g_captionHistory.length());
+	if (start >= end) return;
+	ClipboardPayload payload;
+	payload.start = start;
+	payload.length = end - start;
+	// The target got [start, end) only; "paste only what's new" continues after
+	// it and never erases before start.
+	StartPaste(payload, false, 0, [payload](const PasteResult& result) {
+		if (result.textSent) g_pasteCursor.MarkPasted(payload.start, PayloadRange(payload, g_captionHistory));
+	});
+}
+
+// Ctrl+Shift+Alt+Z: put the last cleared history back in front of what has
+// arrived since. Consumers that track positions are shifted rather than
+// rescanned; what they already emitted for the earlier text stays emitted.
+static void DoUndoClear() {
+	if (g_clearedHistories.empty()) return;
+	ClearedHistory entry = std::move(g_clearedHistories.back());
+	g_clearedHistories.pop_back();
+	size_t earlierLength = entry.history.length();
+	size_t prefix = earlierLength;
+	if (!g_captionHistory.empty()) {
+		entry.history += L' ';
+		prefix++;
+		entry.history += g_captionHistory;
 	}
-	size_t prevLen = g_previousCaption.length();
-	size_t currLen = currentText.length();
-	if (currLen < prevLen) {
-		g_previousCaption = currentText;
-		return;
+	HistoryEdit restored;
+	restored.removed = g_captionHistory.length();
+	restored.inserted = entry.history.length();
+	g_clipboard.OnSourceChanging();
+	g_captionHistory.swap(entry.history);
+	g_captionStream.Publish(restored, g_captionHistory);
+	g_journal.OnEdit(restored, g_captionHistory, GetTickCount64());
+	g_repeats.OnEdit(restored, g_captionHistory);
+	g_sentences.Prepend(std::move(entry.sentences), g_captionHistory);
+	if (SubtitlesEnabled()) g_subtitles.OnPrepend(prefix);
+	if (g_transcriptLog.Running()) g_transcriptLog.OnPrepend(prefix);
+	// Pasting continues from where it stands: what went out since the clear
+	// moves with its text.
+	g_pasteCursor.OnPrepend(prefix);
+	if (g_anchorSetByUser) {
+		g_anchorCharIndex += (int)prefix;
+		g_anchorHistoryIndex += (int)prefix;
 	}
-	if (currLen <= prevLen + 1) {
-		g_previousCaption = currentText;
-		return;
+	else {
+		g_anchorCharIndex = entry.anchorCharIndex;
+		g_anchorHistoryIndex = entry.anchorHistoryIndex;
+		g_anchorSetByUser = entry.anchorSetByUser;
 	}
-	const size_t patternLen = 20;
-	bool foundPattern = false;
-	std::wstring newPart;
-	if (prevLen < patternLen) {
-		g_captionHistory = currentText;
-		g_previousCaption = currentText;
-		return;
+	if (!g_triggers.Empty()) {
+		g_triggers.Prepend(prefix, earlierLength, g_captionHistory, g_triggersFired);
+		if (!g_triggersFired.empty()) FireTriggers();
 	}
-	size_t maxShift = (std::min)(prevLen - patternLen, (size_t)200);
-	std::wstring currentLower = currentText;
-	std::transform(currentLower.begin(), currentLower.end(), currentLower.begin(), ::towlower);
-	std::wstring pattern;
-
-	for (size_t shift = 0; shift <= maxShift; shift++) {
-		size_t endPos = prevLen - shift;
-		size_t startPos = endPos - patternLen;
-		pattern = g_previousCaption.substr(startPos, patternLen);
-		std::wstring patternLower = pattern;
-		std::transform(patternLower.begin(), patternLower.end(), patternLower.begin(), ::towlower);
-		size_t pos = currentLower.rfind(patternLower);
-		if (pos != std::wstring::npos) {
-			newPart = currentText.substr(pos);
-			foundPattern = true;
-			break;
-		}
-	}
-	if (foundPattern) {
-		size_t hpos = g_captionHistory.rfind(pattern);
-		if (hpos != std::wstring::npos) {
-			std::wstring historyBeforePattern = g_captionHistory.substr(0, hpos);
-			g_captionHistory = historyBeforePattern + newPart;
-		}
-		else {
-			g_captionHistory += newPart;
-		}
+	HWND hEdit = GetDlgItem(g_hMainWnd, IDC_CAPTION_EDIT);
+	if (hEdit) {
+		SendMessageW(hEdit, WM_SETREDRAW, FALSE, 0);
+		SetWindowTextW(hEdit, g_captionHistory.c_str());
+		ApplyYellowHighlight(hEdit);
+		ScrollEditToBottom(hEdit);
+		SendMessageW(hEdit, WM_SETREDRAW, TRUE, 0);
+		InvalidateRect(hEdit, nullptr, TRUE);
 	}
-	else {
-		g_captionHistory += L" " + currentText;
+}
+
+static HistoryEdit UpdateCaptionHistory(const std::wstring& currentText) {
+	g_clipboard.OnSourceChanging();
+	HistoryEdit edit = MergeCaptionSnapshot(g_captionHistory, g_previousCaption, currentText, &g_repeats);
+	g_pasteCursor.OnEdit(edit);
+	g_sentences.OnEdit(edit, g_captionHistory);
+	g_captionStream.Publish(edit, g_captionHistory);
+	g_journal.OnEdit(edit, g_captionHistory, GetTickCount64());
+	if (SubtitlesEnabled()) g_subtitles.OnEdit(edit, g_captionHistory, GetTickCount64());
+	if (g_transcriptLog.Running()) g_transcriptLog.OnEdit(edit, g_captionHistory, GetTickCount64());
+	if (!g_triggers.Empty()) {
+		g_triggers.OnEdit(edit, g_captionHistory, g_triggersFired);
+		if (!g_triggersFired.empty()) FireTriggers();
 	}
-	g_previousCaption = currentText;
+	return edit;
 }
 
 static LRESULT CALLBACK LowLevelKbHook(int nCode, WPARAM wParam, LPARAM lParam) {
 	if (nCode == HC_ACTION && g_hMainWnd) {
 		auto* p = reinterpret_cast<KBDLLHOOKSTRUCT*>(lParam);
+		ULONGLONG now = GetTickCount64();
+		if (p->dwExtraInfo == HOOK_HEARTBEAT_TAG) {
+			g_hookSupervisor.OnHeartbeat(HookKind::Keyboard, now);
+			return 1;
+		}
+		g_hookSupervisor.OnCallback(HookKind::Keyboard, now, GetTickCount() - p->time);
+		bool down = (wParam == WM_KEYDOWN || wParam == WM_SYSKEYDOWN);
+		// Our own keystrokes pass through untouched: tracked, the modifier releases
+		// sent before a paste would drop modifiers the user still holds, and an
+		// injected Alt-up would use up g_altSuppressed meant for the real one.
+		if (p->dwExtraInfo == OWN_INPUT_TAG) {
+			g_hotkeys.OnOwnKey(p->vkCode, down);
+			return CallNextHookEx(g_hKbHook, nCode, wParam, lParam);
+		}
 
-		// Track Alt physical state
-		if (IsAltVk(p->vkCode)) {
-			if (wParam == WM_KEYDOWN || wParam == WM_SYSKEYDOWN) {
-				g_altPhysicallyDown = true;
-			}
-			else if (wParam == WM_KEYUP || wParam == WM_SYSKEYUP) {
-				g_altPhysicallyDown = false;
-				// If we injected an Alt-up in PasteViaClipboard, suppress the real
-				// physical Alt-up so Windows doesn't activate the menu bar.
-				if (g_altSuppressed) {
-					g_altSuppressed = false;
-					return 1;
-				}
-			}
+		// Modifier state is tracked from the hook's own events and a binding is one
+		// table lookup, so no GetAsyncKeyState calls happen per key event.
+		// LLKHF_ALTDOWN is reliable here because we let Alt through to the system.
+		HotkeyAction action = g_hotkeys.OnKey(p->vkCode, down, (p->flags & LLKHF_ALTDOWN) ? HKMOD_ALT : 0);
+
+		// If we injected an Alt-up in SendPasteKeys, suppress the real
+		// physical Alt-up so Windows doesn't activate the menu bar.
+		if (!down && IsAltVk(p->vkCode) && g_altSuppressed) {
+			g_altSuppressed = false;
+			return 1;
 		}
 
-		// --- Hotkey matching on keydown / syskeydown ---
-		if (wParam == WM_KEYDOWN || wParam == WM_SYSKEYDOWN) {
-			// Skip the Alt key itself — we never consume Alt keydown so that
-			// system shortcuts (Alt+Tab, Alt+F4, …) keep working.
-			if (IsAltVk(p->vkCode))
-				return CallNextHookEx(g_hKbHook, nCode, wParam, lParam);
-
-			bool ctrlDown = (GetAsyncKeyState(VK_CONTROL) & 0x8000) != 0;
-			bool shiftDown = (GetAsyncKeyState(VK_SHIFT) & 0x8000) != 0;
-			bool winDown = ((GetAsyncKeyState(VK_LWIN) | GetAsyncKeyState(VK_RWIN)) & 0x8000) != 0;
-
-			// Alt detection: LLKHF_ALTDOWN is reliable here because we let
-			// Alt through to the system.  Also check our physical tracking as fallback.
-			bool altDown = (p->flags & LLKHF_ALTDOWN) != 0
-				|| g_altPhysicallyDown
-				|| ((GetAsyncKeyState(VK_MENU) & 0x8000) != 0);
-
-			auto matches = [&](const HotkeyConfig& hk) {
-				return hk.vkCode == p->vkCode
-					&& hk.ctrl == ctrlDown && hk.shift == shiftDown
-					&& hk.alt == altDown && hk.win == winDown;
-				};
-			if (matches(g_autoCopyHotkey)) {
-				PostMessageW(g_hMainWnd, WM_APP_FIND_AND_COPY, 0, 0);
-				return 1;
-			}
-			if (matches(g_autoDeleteHotkey)) {
-				PostMessageW(g_hMainWnd, WM_APP_CLEAR_HISTORY, 0, 0);
-				return 1;
-			}
+		// Modifier keys never resolve to an action, so the Alt keydown is never
+		// consumed and system shortcuts (Alt+Tab, Alt+F4, …) keep working.
+		if (action != HotkeyAction::None) {
+			PostHotkeyAction(g_hMainWnd, action);
+			return 1;
 		}
 	}
 	return CallNextHookEx(g_hKbHook, nCode, wParam, lParam);
 }
 
 static LRESULT CALLBACK LowLevelMouseHook(int nCode, WPARAM wParam, LPARAM lParam) {
-	if (nCode == HC_ACTION && g_hMainWnd && g_middleButtonPaste && wParam == WM_MBUTTONDOWN) {
-		// wParam=1: replace all then paste; wParam=0: paste only (no replace)
-		PostMessageW(g_hMainWnd, WM_APP_FIND_AND_COPY, g_middleButtonReplaceAll ? 1 : 0, 0);
-		return 1;
+	if (nCode == HC_ACTION && g_hMainWnd) {
+		auto* p = reinterpret_cast<MSLLHOOKSTRUCT*>(lParam);
+		ULONGLONG now = GetTickCount64();
+		if (p->dwExtraInfo == HOOK_HEARTBEAT_TAG) {
+			g_hookSupervisor.OnHeartbeat(HookKind::Mouse, now);
+			return 1;
+		}
+		g_hookSupervisor.OnCallback(HookKind::Mouse, now, GetTickCount() - p->time);
+		if (g_middleButtonPaste && wParam == WM_MBUTTONDOWN) {
+			// wParam=1: replace all then paste; wParam=0: paste only (no replace)
+			PostMessageW(g_hMainWnd, WM_APP_FIND_AND_COPY, g_middleButtonReplaceAll ? 1 : 0, 0);
+			return 1;
+		}
 	}
 	return CallNextHookEx(g_hMouseHook, nCode, wParam, lParam);
 }
 
+static HHOOK& HookHandle(HookKind kind) {
+	return kind == HookKind::Keyboard ? g_hKbHook : g_hMouseHook;
+}
+
+// (Re)install a hook. Unhooking one that Windows already removed fails harmlessly.
+static void InstallHook(HookKind kind) {
+	HHOOK& hook = HookHandle(kind);
+	if (hook) UnhookWindowsHookEx(hook);
+	hook = kind == HookKind::Keyboard
+		? SetWindowsHookExW(WH_KEYBOARD_LL, LowLevelKbHook, nullptr, 0)
+		: SetWindowsHookExW(WH_MOUSE_LL, LowLevelMouseHook, nullptr, 0);
+	g_hookSupervisor.OnReinstalled(kind, GetTickCount64());
+}
+
+// Inject a tagged no-op event. A live hook swallows it, so no application sees
+// it; if the hook is gone it is a lone key-up of an unassigned key / a zero move.
+static bool SendHookHeartbeat(HookKind kind) {
+	INPUT input = {};
+	if (kind == HookKind::Keyboard) {
+		input.type = INPUT_KEYBOARD;
+		input.ki.wVk = HOOK_HEARTBEAT_VK;
+		input.ki.dwFlags = KEYEVENTF_KEYUP;
+		input.ki.dwExtraInfo = HOOK_HEARTBEAT_TAG;
+	}
+	else {
+		input.type = INPUT_MOUSE;
+		input.mi.dwFlags = MOUSEEVENTF_MOVE;
+		input.mi.dwExtraInfo = HOOK_HEARTBEAT_TAG;
+	}
+	return SendInput(1, &input, sizeof(INPUT)) == 1;
+}
+
+static void SuperviseHooks() {
+	ULONGLONG now = GetTickCount64();
+	LASTINPUTINFO lii = { sizeof(lii) };
+	uint32_t idleMs = GetLastInputInfo(&lii) ? (uint32_t)(GetTickCount() - lii.dwTime) : 0;
+	HookSupervisor::TickResult tick = g_hookSupervisor.OnTick(now, idleMs);
+	bool reinstalled = false;
+	for (size_t i = 0; i < (size_t)HookKind::Count; i++) {
+		HookKind kind = (HookKind)i;
+		if (tick.reinstall[i] || !HookHandle(kind)) {
+			InstallHook(kind);
+			reinstalled = reinstalled || HookHandle(kind) != nullptr;
+		}
+		else if (tick.probe[i] && SendHookHeartbeat(kind)) {
+			g_hookSupervisor.OnHeartbeatSent(kind, now);
+		}
+	}
+	SyncHotkeyModifiers(); // also drops modifiers whose key-up a removed hook missed
+	if (reinstalled) {
+		OutputDebugStringW(L"LCCopier: low-level hook was removed by Windows and has been reinstalled\r\n");
+		OutputDebugStringW(g_hookSupervisor.Describe().c_str());
+	}
+}
+
 static WNDPROC g_origEditProc = nullptr;
 static bool g_suppressNextAnchorClick = false; // true when the next LButtonDown is an app-activation click
 
@@ -508,6 +1282,18 @@ LRESULT CALLBACK EditSubclassProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lP
 		}
 		return r;
 	}
+	if (uMsg == WM_PAINT && g_paintSnapshot) {
+		// First paint after a caption change: the end of the snapshot's journey.
+		uint64_t snapshot = g_paintSnapshot;
+		g_paintSnapshot = 0;
+		LRESULT r;
+		{
+			StageTimer timer(g_metrics, MetricStage::Paint, snapshot);
+			r = CallWindowProcW(g_origEditProc, hWnd, uMsg, wParam, lParam);
+		}
+		TraceAsyncEnd("snapshot", "snapshot", snapshot);
+		return r;
+	}
 	if (uMsg == WM_MOUSEACTIVATE) {
 		// Only suppress the upcoming WM_LBUTTONDOWN if this click is bringing the
 		// application back from another app (main window is not the foreground window).
@@ -531,62 +1317,140 @@ LRESULT CALLBACK EditSubclassProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lP
 		g_anchorCharIndex = wordStart;
 		g_anchorSetByUser = true;
 		g_anchorHistoryIndex = wordStart;
+		g_pasteCursor.Reset((size_t)wordStart); // a new anchor restarts "paste only what's new" there
 		ApplyYellowHighlight(hWnd);
 		return r;
 	}
 	if (uMsg == WM_KEYDOWN) {
-		bool ctrl = (GetKeyState(VK_CONTROL) & 0x8000) != 0;
-		bool shift = (GetKeyState(VK_SHIFT) & 0x8000) != 0;
-		// Use the same Alt detection logic as the low-level hook
-		// GetKeyState may not work when Alt is suppressed, so check physical tracking too
-		bool alt = (GetKeyState(VK_MENU) & 0x8000) != 0 || g_altPhysicallyDown || g_altSuppressed;
-		bool win = ((GetKeyState(VK_LWIN) | GetKeyState(VK_RWIN)) & 0x8000) != 0;
-		auto matches = [&](const HotkeyConfig& hk) {
-			return hk.vkCode == (UINT)wParam
-				&& hk.ctrl == ctrl && hk.shift == shift
-				&& hk.alt == alt && hk.win == win;
-			};
-		if (matches(g_autoCopyHotkey)) {
-			PostMessageW(GetParent(hWnd), WM_APP_FIND_AND_COPY, 0, 0);
-			return 0;
-		}
-		if (matches(g_autoDeleteHotkey)) {
-			PostMessageW(GetParent(hWnd), WM_APP_CLEAR_HISTORY, 0, 0);
+		// Only reached when the low-level hook did not take the key; resolve it
+		// through the same bindings. GetKeyState may not see Alt while it is
+		// suppressed, so use the hook's tracked state too.
+		uint8_t mods = 0;
+		if (GetKeyState(VK_CONTROL) & 0x8000) mods |= HKMOD_CTRL;
+		if (GetKeyState(VK_SHIFT) & 0x8000) mods |= HKMOD_SHIFT;
+		if ((GetKeyState(VK_MENU) & 0x8000) || IsAltHeld() || g_altSuppressed) mods |= HKMOD_ALT;
+		if ((GetKeyState(VK_LWIN) | GetKeyState(VK_RWIN)) & 0x8000) mods |= HKMOD_WIN;
+		HotkeyAction action = g_hotkeys.Lookup((uint32_t)wParam, mods);
+		if (action != HotkeyAction::None) {
+			PostHotkeyAction(GetParent(hWnd), action);
 			return 0;
 		}
 	}
 	return CallWindowProcW(g_origEditProc, hWnd, uMsg, wParam, lParam);
 }
 
-std::wstring GetLiveCaptionText() {
-	HWND hwndCaption = nullptr;
-	EnumWindows(FindLiveCaptionWindow, reinterpret_cast<LPARAM>(&hwndCaption));
-	if (!hwndCaption) return L"";
+// Fills text (empty when Live Caption is not showing). The caller's buffer is
+// reused, so a steady caption does not allocate.
+void GetLiveCaptionText(std::wstring& text) {
+	text.clear();
+	HWND hwndCaption = reinterpret_cast<HWND>(g_captionWindow.Find(GetTickCount64()));
+	if (!hwndCaption) return;
 	IUIAutomation* pAutomation = nullptr;
 	HRESULT hr = CoCreateInstance(__uuidof(CUIAutomation), nullptr, CLSCTX_INPROC_SERVER, __uuidof(IUIAutomation), reinterpret_cast<void**>(&pAutomation));
-	if (FAILED(hr) || !pAutomation) return L"";
+	if (FAILED(hr) || !pAutomation) return;
 	IUIAutomationElement* pRoot = nullptr;
 	hr = pAutomation->ElementFromHandle(hwndCaption, &pRoot);
-	if (FAILED(hr) || !pRoot) { pAutomation->Release(); return L""; }
-	std::wstring text;
+	if (FAILED(hr) || !pRoot) { pAutomation->Release(); return; }
 	CollectTextFromElement(pAutomation, pRoot, text, true);
 	pRoot->Release();
 	pAutomation->Release();
 	while (!text.empty() && (text.back() == L'\r' || text.back() == L'\n')) text.pop_back();
-	return text;
+}
+
+// Second startup phase, run once the window is on screen: the caption view,
+// background services and the Live Caption launch.
+static void DeferredInit(HWND hWnd) {
+	const AppSettings& settings = SettingsDialog::Current();
+	HDC hdc = GetDC(hWnd);
+	int logPixels = hdc ? GetDeviceCaps(hdc, LOGPIXELSY) : 96;
+	if (hdc) ReleaseDC(hWnd, hdc);
+	g_hCaptionFont = CreateFontW(
+		-MulDiv(settings.textSize, logPixels, 72),
+		0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
+		DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY,
+		DEFAULT_PITCH | FF_SWISS, L"Segoe UI");
+	g_hEditBrush = CreateSolidBrush(settings.bgColor);
+
+	LoadLibraryW(L"Msftedit.dll");
+	RECT rc = {};
+	GetClientRect(hWnd, &rc);
+	HWND hEdit = CreateWindowExW(WS_EX_CLIENTEDGE, L"RICHEDIT50W", nullptr,
+		WS_CHILD | WS_VISIBLE | WS_VSCROLL | ES_MULTILINE | ES_READONLY | ES_AUTOVSCROLL,
+		0, 0, rc.right, rc.bottom, hWnd, (HMENU)(INT_PTR)IDC_CAPTION_EDIT, hInst, nullptr);
+	if (hEdit) {
+		SendMessageW(hEdit, EM_SETBKGNDCOLOR, 0, (LPARAM)settings.bgColor);
+		SendMessageW(hEdit, WM_SETFONT, (WPARAM)g_hCaptionFont, TRUE);
+		SendMessageW(hEdit, EM_HIDESELECTION, TRUE, FALSE);
+		g_origEditProc = (WNDPROC)SetWindowLongPtrW(hEdit, GWLP_WNDPROC, (LONG_PTR)EditSubclassProc);
+		SetTimer(hWnd, IDT_POLL_CAPTION, POLL_INTERVAL_MS, nullptr);
+	}
+	g_startup.Mark("caption view");
+
+	if (g_streamRequested && !g_streamServer.Start(STREAM_PIPE_NAME)) {
+		OutputDebugStringW(L"LiveCaption: caption stream pipe is already served by another process\n");
+	}
+	if (settings.transcriptLog) {
+		TranscriptLogOptions options;
+		options.directory = DiagnosticsView::AppDirectory();
+		options.archiveDirectory = options.directory;
+		options.flushIntervalMs = (uint32_t)(std::max)(settings.transcriptFlushMs, (int)USER_TIMER_MINIMUM);
+		options.rotateBytes = (uint64_t)(std::max)(settings.transcriptRotateMB, 0) * 1024 * 1024;
+		if (!options.directory.empty()) g_transcriptLog.Start(options);
+	}
+	g_tasks.Start(TASK_THREADS, [] { PostMessageW(g_hMainWnd, WM_APP_TASKS_DONE, 0, 0); },
+		[] { if (TraceEnabled()) TraceSetThreadName("task"); });
+	LoadTriggers();
+	StartWindowEvents();
+	if (g_captureMux.SourceCount()) {
+		g_captureMux.Start(CaptureSourceText, 0, g_captureTimeline, CaptureThreadStart, CaptureThreadEnd);
+	}
+	g_startup.Mark("services");
+	g_startup.Finish();
+
+	std::wstring report = g_startup.Report(STARTUP_BUDGET_MS);
+	OutputDebugStringW(report.c_str());
+	if (g_startupCheck) {
+		DiagnosticsView::DumpToFile(report);
+		DestroyWindow(hWnd);
+		return;
+	}
+	SetTimer(hWnd, IDT_AUTO_START_LC, AUTO_START_DELAY_MS, nullptr);
 }
 
 int APIENTRY wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPWSTR lpCmdLine, _In_ int nCmdShow) {
 	UNREFERENCED_PARAMETER(hPrevInstance);
-	UNREFERENCED_PARAMETER(lpCmdLine);
+	g_startup.Begin(ProcessStartTime());
+	if (lpCmdLine && (wcsstr(lpCmdLine, L"--trace") || wcsstr(lpCmdLine, L"/trace"))) {
+		StartTracing();
+	}
+	if (lpCmdLine && (wcsstr(lpCmdLine, L"--stream") || wcsstr(lpCmdLine, L"/stream"))) {
+		g_streamRequested = true;
+	}
+	if (lpCmdLine && (wcsstr(lpCmdLine, L"--subtitles") || wcsstr(lpCmdLine, L"/subtitles"))) {
+		StartSubtitles();
+	}
+	if (lpCmdLine && (wcsstr(lpCmdLine, L"--record") || wcsstr(lpCmdLine, L"/record"))) {
+		StartRecording();
+	}
+	if (lpCmdLine && (wcsstr(lpCmdLine, L"--revisions") || wcsstr(lpCmdLine, L"/revisions"))) {
+		g_saveRevisions = true;
+	}
+	if (lpCmdLine && (wcsstr(lpCmdLine, L"--startup-check") || wcsstr(lpCmdLine, L"/startup-check"))) {
+		g_startupCheck = true;
+	}
+	if (lpCmdLine && (wcsstr(lpCmdLine, L"--source") || wcsstr(lpCmdLine, L"/source"))) {
+		AddCaptureSources(GetCommandLineW(), g_captureTimeline);
+	}
 	CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
 	LoadStringW(hInstance, IDS_APP_TITLE, szTitle, MAX_LOADSTRING);
 	LoadStringW(hInstance, IDC_LIVECAPTION, szWindowClass, MAX_LOADSTRING);
 	MyRegisterClass(hInstance);
+	g_startup.Mark("init");
 	if (!InitInstance(hInstance, nCmdShow)) {
 		return FALSE;
 	}
-	AutoStartLiveCaption();
+	g_startup.Mark("show");
+	g_startup.Interactive();
 	HACCEL hAccelTable = LoadAccelerators(hInstance, MAKEINTRESOURCE(IDC_LIVECAPTION));
 	MSG msg;
 	while (GetMessage(&msg, nullptr, 0, 0)) {
@@ -596,6 +1460,7 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance
 		}
 	}
 	CoUninitialize();
+	if (g_startupCheck) return g_startup.WithinBudget(STARTUP_BUDGET_MS) ? 0 : 1;
 	return (int)msg.wParam;
 }
 
@@ -634,31 +1499,20 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 	{
 	case WM_CREATE:
 	{
-		AppSettings settings = SettingsDialog::LoadSettings();
-		HDC hdc = GetDC(hWnd);
-		int logPixels = hdc ? GetDeviceCaps(hdc, LOGPIXELSY) : 96;
-		if (hdc) ReleaseDC(hWnd, hdc);
-		g_hCaptionFont = CreateFontW(
-			-MulDiv(settings.textSize, logPixels, 72),
-			0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
-			DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS, CLEARTYPE_QUALITY,
-			DEFAULT_PITCH | FF_SWISS, L"Segoe UI");
-		g_hEditBrush = CreateSolidBrush(settings.bgColor);
-
-		LoadLibraryW(L"Msftedit.dll");
-		HWND hEdit = CreateWindowExW(WS_EX_CLIENTEDGE, L"RICHEDIT50W", nullptr,
-			WS_CHILD | WS_VISIBLE | WS_VSCROLL | ES_MULTILINE | ES_READONLY | ES_AUTOVSCROLL,
-			0, 0, 0, 0, hWnd, (HMENU)(INT_PTR)IDC_CAPTION_EDIT, hInst, nullptr);
-		if (hEdit) {
-			SendMessageW(hEdit, EM_SETBKGNDCOLOR, 0, (LPARAM)settings.bgColor);
-			SendMessageW(hEdit, WM_SETFONT, (WPARAM)g_hCaptionFont, TRUE);
-			SendMessageW(hEdit, EM_HIDESELECTION, TRUE, FALSE);
-			g_origEditProc = (WNDPROC)SetWindowLongPtrW(hEdit, GWLP_WNDPROC, (LONG_PTR)EditSubclassProc);
-			SetTimer(hWnd, IDT_POLL_CAPTION, POLL_INTERVAL_MS, nullptr);
-		}
+		// Only what the user sees first and the hotkeys; the rest is deferred to
+		// WM_APP_DEFERRED_INIT, after the window has been shown.
+		const AppSettings& settings = SettingsDialog::Current();
+		g_startup.Mark("settings");
 		g_hMainWnd = hWnd;
-		g_hKbHook = SetWindowsHookExW(WH_KEYBOARD_LL, LowLevelKbHook, nullptr, 0);
-		g_hMouseHook = SetWindowsHookExW(WH_MOUSE_LL, LowLevelMouseHook, nullptr, 0);
+		InstallHook(HookKind::Keyboard);
+		InstallHook(HookKind::Mouse);
+		SyncHotkeyModifiers();
+		ApplyHotkeyBindings(settings);
+		g_middleButtonPaste = settings.middleButtonPaste;
+		g_middleButtonReplaceAll = settings.middleButtonReplaceAll;
+		g_incrementalPaste = settings.incrementalPaste;
+		SetTimer(hWnd, IDT_HOOK_KEEPALIVE, HOOK_KEEPALIVE_INTERVAL_MS, nullptr);
+		g_startup.Mark("hooks");
 		HMENU hSysMenu = GetSystemMenu(hWnd, FALSE);
 		if (hSysMenu) {
 			DeleteMenu(hSysMenu, SC_MAXIMIZE, MF_BYCOMMAND);
@@ -679,31 +1533,51 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 			BYTE alpha = (BYTE)((settings.transparency * 255) / 100);
 			SetLayeredWindowAttributes(hWnd, 0, alpha, LWA_ALPHA);
 		}
-		g_autoCopyHotkey = settings.autoCopyHotkey;
-		g_autoDeleteHotkey = settings.autoDeleteHotkey;
-		g_middleButtonPaste = settings.middleButtonPaste;
-		g_middleButtonReplaceAll = settings.middleButtonReplaceAll;
-		// Initialize ITaskbarList for taskbar button control
-		CoCreateInstance(CLSID_TaskbarList, nullptr, CLSCTX_INPROC_SERVER,
-			IID_ITaskbarList, reinterpret_cast<void**>(&g_pTaskbarList));
-		if (g_pTaskbarList) g_pTaskbarList->HrInit();
+		PostMessageW(hWnd, WM_APP_DEFERRED_INIT, 0, 0);
+		g_startup.Mark("window");
 	}
 	break;
+	case WM_APP_DEFERRED_INIT:
+		DeferredInit(hWnd);
+		return 0;
 	case WM_APP_FIND_AND_COPY:
 		DoFindAndCopyWork(wParam != 0);
 		return 0;
 	case WM_APP_CLEAR_HISTORY:
 		DoClearHistory();
 		return 0;
+	case WM_APP_TASKS_DONE:
+		g_tasks.RunCompletions();
+		return 0;
+	case WM_APP_UNDO_CLEAR:
+		DoUndoClear();
+		return 0;
+	case WM_APP_COPY_SENTENCES:
+		DoCopyLastSentences((size_t)wParam);
+		return 0;
+	case WM_APP_SHOW_DIAGNOSTICS:
+		DiagnosticsView::Show(hWnd, DiagnosticsReport, ResetDiagnostics);
+		return 0;
+	case WM_RENDERFORMAT:
+		g_clipboard.OnRenderFormat((UINT)wParam);
+		return 0;
+	case WM_RENDERALLFORMATS:
+		g_clipboard.OnRenderAllFormats(hWnd);
+		return 0;
+	case WM_DESTROYCLIPBOARD:
+		g_clipboard.OnDestroyClipboard();
+		return 0;
 	case WM_APP_HIDE_TASKBAR:
-		if (g_pTaskbarList) {
-			if (wParam) g_pTaskbarList->DeleteTab(hWnd);
-			else        g_pTaskbarList->AddTab(hWnd);
+		if (wParam) {
+			if (ITaskbarList* taskbar = TaskbarList()) taskbar->DeleteTab(hWnd);
+		}
+		else if (g_pTaskbarList) {
+			g_pTaskbarList->AddTab(hWnd);  // only created if the button was removed
 		}
 		return 0;
 	case WM_APP_SETTINGS_CHANGED:
 	{
-		AppSettings settings = SettingsDialog::LoadSettings();
+		const AppSettings& settings = SettingsDialog::Current();
 		if (g_hEditBrush) {
 			DeleteObject(g_hEditBrush);
 		}
@@ -735,7 +1609,7 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 		if (settings.setInvisible) {
 			SetWindowDisplayAffinity(hWnd, WDA_EXCLUDEFROMCAPTURE);
 			SetWindowPos(hWnd, HWND_TOPMOST, 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE); // invisible forces topmost
-			if (g_pTaskbarList) g_pTaskbarList->DeleteTab(hWnd); // hide from taskbar without style change
+			if (ITaskbarList* taskbar = TaskbarList()) taskbar->DeleteTab(hWnd); // hide from taskbar without style change
 			LONG_PTR style = GetWindowLongPtrW(hWnd, GWL_STYLE);
 			SetWindowLongPtrW(hWnd, GWL_STYLE, style & ~WS_MINIMIZEBOX);
 			SetWindowPos(hWnd, nullptr, 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE | SWP_NOZORDER | SWP_FRAMECHANGED);
@@ -755,10 +1629,10 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 			BYTE alpha = (BYTE)((settings.transparency * 255) / 100);
 			SetLayeredWindowAttributes(hWnd, 0, alpha, LWA_ALPHA);
 		}
-		g_autoCopyHotkey = settings.autoCopyHotkey;
-		g_autoDeleteHotkey = settings.autoDeleteHotkey;
+		ApplyHotkeyBindings(settings);
 		g_middleButtonPaste = settings.middleButtonPaste;
 		g_middleButtonReplaceAll = settings.middleButtonReplaceAll;
+		g_incrementalPaste = settings.incrementalPaste;
 		return 0;
 	}
 	case WM_SIZE:
@@ -769,21 +1643,42 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 	break;
 	case WM_CTLCOLOREDIT:
 	{
-		AppSettings settings = SettingsDialog::LoadSettings();
+		const AppSettings& settings = SettingsDialog::Current();
 		SetTextColor((HDC)wParam, settings.textColor);
 		SetBkColor((HDC)wParam, settings.bgColor);
 		return (LRESULT)g_hEditBrush;
 	}
 	case WM_TIMER:
 		if (wParam == IDT_POLL_CAPTION) {
-			std::wstring text = GetLiveCaptionText();
-			if (text != g_lastCaptionText) {
+			uint64_t snapshot = ++g_snapshotSeq;
+			g_tickSnapshot = snapshot;
+			TraceAsyncBegin("snapshot", "snapshot", snapshot);
+			StageTimer tickTimer(g_metrics, MetricStage::Tick, snapshot);
+			uint64_t allocationsBefore = AllocationCount();
+			g_metrics.Counters().ticks++;
+			std::wstring& text = g_captureText;
+			{
+				StageTimer timer(g_metrics, MetricStage::Capture, snapshot);
+				GetLiveCaptionText(text);
+			}
+			bool changed;
+			{
+				StageTimer timer(g_metrics, MetricStage::Delta, snapshot);
+				changed = text != g_lastCaptionText;
+			}
+			bool painting = false;
+			if (changed) {
+				g_metrics.Counters().changedTicks++;
+				if (g_recordFile != INVALID_HANDLE_VALUE) AppendSnapshotLine(g_recordBuffer, GetTickCount64() - g_recordStartMs, text);
 				if (!text.empty()) {
-					UpdateCaptionHistory(text);
+					StageTimer timer(g_metrics, MetricStage::Merge, snapshot);
+					HistoryEdit edit = UpdateCaptionHistory(text);
+					g_metrics.Counters().bytesMerged += edit.inserted * sizeof(wchar_t);
 				}
-				g_lastCaptionText = std::move(text);
+				g_lastCaptionText.swap(text);
 				HWND hEdit = GetDlgItem(hWnd, IDC_CAPTION_EDIT);
 				if (hEdit) {
+					StageTimer timer(g_metrics, MetricStage::Render, snapshot);
 					SendMessageW(hEdit, WM_SETREDRAW, FALSE, 0);
 					POINT ptScroll = {};
 					if (g_userScrolledUp) {
@@ -803,8 +1698,40 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 					}
 					SendMessageW(hEdit, WM_SETREDRAW, TRUE, 0);
 					InvalidateRect(hEdit, nullptr, TRUE);
+					// A snapshot still waiting for paint was superseded by this one.
+					if (g_paintSnapshot) TraceAsyncEnd("snapshot", "snapshot", g_paintSnapshot);
+					g_paintSnapshot = snapshot;
+					painting = true;
 				}
 			}
+			if (!painting) TraceAsyncEnd("snapshot", "snapshot", snapshot);
+			g_captionStream.Service(g_captionHistory);
+			if (SubtitlesEnabled()) g_subtitles.OnTick(g_captionHistory, GetTickCount64());
+			if (g_transcriptLog.Running()) g_transcriptLog.OnTick(g_captionHistory, GetTickCount64());
+			// Idle tasks run in pauses in the captions, never during a paste.
+			if (changed) g_lastCaptionChangeMs = GetTickCount64();
+			g_tasks.SetIdle(GetTickCount64() - g_lastCaptionChangeMs >= TASK_IDLE_AFTER_MS && !g_pasteSequencer.Busy());
+			g_tickSnapshot = 0;
+			g_metrics.RecordTickAllocations(AllocationCount() - allocationsBefore);
+		}
+		else if (wParam == IDT_AUTO_START_LC) {
+			KillTimer(hWnd, IDT_AUTO_START_LC);
+			AutoStartLiveCaption();
+		}
+		else if (wParam == IDT_PASTE_STEP) {
+			KillTimer(hWnd, IDT_PASTE_STEP);
+			{
+				StageTimer timer(g_metrics, MetricStage::PasteStep);
+				g_pasteSequencer.OnWake();
+			}
+			NotePasteProgress();
+		}
+		else if (wParam == IDT_HOOK_KEEPALIVE) {
+			SuperviseHooks();
+			FlushTrace(false);
+			FlushSubtitles(false);
+			FlushRecording(false);
+			WriteOutputInBackground();
 		}
 		break;
 	case WM_SYSCOMMAND:
@@ -823,9 +1750,27 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 	}
 	break;
 	case WM_DESTROY:
+		g_pasteSequencer.Abort();
+		g_clipboard.OnRenderAllFormats(hWnd); // nothing may stay delay-rendered once we are gone
 		if (g_hKbHook) { UnhookWindowsHookEx(g_hKbHook); g_hKbHook = nullptr; }
 		if (g_hMouseHook) { UnhookWindowsHookEx(g_hMouseHook); g_hMouseHook = nullptr; }
+		StopWindowEvents();
 		KillTimer(hWnd, IDT_POLL_CAPTION);
+		KillTimer(hWnd, IDT_HOOK_KEEPALIVE);
+		KillTimer(hWnd, IDT_AUTO_START_LC);
+		g_streamServer.Stop();
+		OutputDebugStringW(g_hookSupervisor.Describe().c_str());
+		g_tasks.Stop();  // writes the output already handed to it before the final flushes
+		FlushTrace(true);
+		FlushSubtitles(true);
+		FlushRecording(true);
+		if (g_transcriptLog.Running()) {
+			g_transcriptLog.Finish(g_captionHistory);
+			g_transcriptLog.Stop();
+		}
+		SaveCaptureSources();
+		SaveRevisions();
+		FlushTriggerLog();
 		if (g_hEditBrush) { DeleteObject(g_hEditBrush); g_hEditBrush = nullptr; }
 		if (g_hCaptionFont) { DeleteObject(g_hCaptionFont); g_hCaptionFont = nullptr; }
 		if (g_pTaskbarList) { g_pTaskbarList->Release(); g_pTaskbarList = nullptr; }
@@ -0,0 +1,192 @@
+#include "Metrics.h"
+#include <cstdlib>
+#include <cwchar>
+#include <new>
+
+// Per thread, with constant initialization, so counting needs no lock, no
+// shared cache line between threads and nothing set up on a new thread.
+static thread_local uint64_t t_allocations = 0;
+
+uint64_t AllocationCount() {
+	return t_allocations;
+}
+
+// Counting replacements for the global allocation functions. Same behaviour as
+// the library defaults (malloc/free, new_handler loop), plus one increment of
+// the calling thread's counter. The aligned overloads are left to the library.
+static void* CountedAlloc(size_t size) {
+	t_allocations++;
+	if (size == 0) size = 1;
+	for (;;) {
+		if (void* p = std::malloc(size)) return p;
+		std::new_handler handler = std::get_new_handler();
+		if (!handler) return nullptr;
+		handler();
+	}
+}
+
+void* operator new(size_t size) {
+	if (void* p = CountedAlloc(size)) return p;
+	throw std::bad_alloc();
+}
+void* operator new[](size_t size) {
+	if (void* p = CountedAlloc(size)) return p;
+	throw std::bad_alloc();
+}
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+	try { return CountedAlloc(size); }
+	catch (...) { return nullptr; }
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+	try { return CountedAlloc(size); }
+	catch (...) { return nullptr; }
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+static unsigned HighestBit(uint64_t value) {
+	unsigned bit = 0;
+	while (value >>= 1) bit++;
+	return bit;
+}
+
+static size_t BucketIndex(uint64_t value) {
+	if (value < METRIC_SUB_BUCKETS) return (size_t)value;
+	unsigned msb = HighestBit(value);
+	if (msb > METRIC_MAX_MSB) return METRIC_BUCKETS - 1;
+	return METRIC_SUB_BUCKETS * (msb - 3) + (size_t)((value >> (msb - 4)) - METRIC_SUB_BUCKETS);
+}
+
+static uint64_t BucketHighestValue(size_t index) {
+	if (index < METRIC_SUB_BUCKETS) return index;
+	unsigned msb = (unsigned)(index / METRIC_SUB_BUCKETS) + 3;
+	uint64_t sub = METRIC_SUB_BUCKETS + index % METRIC_SUB_BUCKETS;
+	return ((sub + 1) << (msb - 4)) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t value) {
+	m_buckets[BucketIndex(value)]++;
+	m_count++;
+	m_total += value;
+	if (value > m_max) m_max = value;
+}
+
+void LatencyHistogram::Reset() {
+	*this = LatencyHistogram();
+}
+
+uint64_t LatencyHistogram::ValueAtPercentile(double percentile) const {
+	if (!m_count) return 0;
+	uint64_t target = (uint64_t)((double)m_count * percentile / 100.0 + 0.5);
+	if (target < 1) target = 1;
+	uint64_t seen = 0;
+	for (size_t i = 0; i < METRIC_BUCKETS; i++) {
+		seen += m_buckets[i];
+		if (seen >= target) {
+			uint64_t value = BucketHighestValue(i);
+			return value < m_max ? value : m_max;
+		}
+	}
+	return m_max;
+}
+
+void MetricsRegistry::RecordTickAllocations(uint64_t allocations) {
+	m_allocationsPerTick.Record(allocations);
+	m_counters.allocations += allocations;
+}
+
+void MetricsRegistry::Reset() {
+	for (LatencyHistogram& stage : m_stages) stage.Reset();
+	m_allocationsPerTick.Reset();
+	m_counters = MetricCounters();
+}
+
+static const wchar_t* const kStageNames[(size_t)MetricStage::Count] = {
+	L"tick", L"capture", L"delta", L"merge", L"render", L"paint", L"highlight", L"paste step", L"paste total"
+};
+
+static const char* const kStageTraceNames[(size_t)MetricStage::Count] = {
+	"tick", "capture", "delta", "merge", "render", "paint", "highlight", "paste_step", "paste_total"
+};
+
+const char* MetricStageName(MetricStage stage) {
+	return stage < MetricStage::Count ? kStageTraceNames[(size_t)stage] : "unknown";
+}
+
+std::wstring MetricsRegistry::Report() const {
+	std::wstring out;
+	wchar_t line[256];
+	swprintf(line, 256, L"%-12ls %10ls %10ls %10ls %10ls %10ls %10ls %10ls\r\n",
+		L"stage (us)", L"count", L"mean", L"p50", L"p90", L"p99", L"p99.9", L"max");
+	out += line;
+	for (size_t i = 0; i < (size_t)MetricStage::Count; i++) {
+		const LatencyHistogram& h = m_stages[i];
+		swprintf(line, 256, L"%-12ls %10llu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\r\n",
+			kStageNames[i], (unsigned long long)h.Count(), h.Mean() / 1000.0,
+			h.ValueAtPercentile(50) / 1000.0, h.ValueAtPercentile(90) / 1000.0,
+			h.ValueAtPercentile(99) / 1000.0, h.ValueAtPercentile(99.9) / 1000.0, h.Max() / 1000.0);
+		out += line;
+	}
+	swprintf(line, 256, L"\r\nticks %llu (%llu changed), bytes merged %llu, pastes %llu\r\n",
+		(unsigned long long)m_counters.ticks, (unsigned long long)m_counters.changedTicks,
+		(unsigned long long)m_counters.bytesMerged, (unsigned long long)m_counters.pastes);
+	out += line;
+	const LatencyHistogram& a = m_allocationsPerTick;
+	swprintf(line, 256, L"allocations per tick: mean %.1f, p50 %llu, p99 %llu, max %llu (total %llu)\r\n",
+		a.Mean(), (unsigned long long)a.ValueAtPercentile(50), (unsigned long long)a.ValueAtPercentile(99),
+		(unsigned long long)a.Max(), (unsigned long long)m_counters.allocations);
+	out += line;
+	return out;
+}
+
+void StartupProfile::Begin(std::chrono::steady_clock::time_point origin) {
+	m_origin = origin;
+	m_last = origin;
+	m_count = 0;
+	m_interactiveUs = 0;
+	m_done = false;
+	Mark("loader");
+}
+
+uint64_t StartupProfile::SinceOriginUs(std::chrono::steady_clock::time_point t) const {
+	return t > m_origin ? (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(t - m_origin).count() : 0;
+}
+
+void StartupProfile::Mark(const char* phase) {
+	if (m_done || m_count >= STARTUP_MAX_PHASES) return;
+	auto now = std::chrono::steady_clock::now();
+	Phase& p = m_phases[m_count++];
+	p.name = phase;
+	p.startUs = SinceOriginUs(m_last);
+	p.durationUs = SinceOriginUs(now) - p.startUs;
+	if (TraceEnabled() && m_count > 1) TraceComplete(phase, "startup", TraceTimestampUs(m_last), p.durationUs, 0);
+	m_last = now;
+}
+
+void StartupProfile::Interactive() {
+	if (!m_interactiveUs) m_interactiveUs = SinceOriginUs(std::chrono::steady_clock::now());
+}
+
+std::wstring StartupProfile::Report(uint64_t budgetMs) const {
+	std::wstring out;
+	wchar_t line[128];
+	swprintf(line, 128, L"%-14ls %10ls %10ls\r\n", L"startup (ms)", L"start", L"duration");
+	out += line;
+	for (size_t i = 0; i < m_count; i++) {
+		wchar_t name[32] = {};
+		for (size_t k = 0; k + 1 < 32 && m_phases[i].name[k]; k++) name[k] = (wchar_t)(unsigned char)m_phases[i].name[k];
+		swprintf(line, 128, L"%-14ls %10.1f %10.1f\r\n", name,
+			m_phases[i].startUs / 1000.0, m_phases[i].durationUs / 1000.0);
+		out += line;
+	}
+	if (m_interactiveUs) {
+		swprintf(line, 128, L"interactive at %.1f ms, budget %llu ms: %ls\r\n", m_interactiveUs / 1000.0,
+			(unsigned long long)budgetMs, WithinBudget(budgetMs) ? L"ok" : L"OVER");
+		out += line;
+	}
+	return out;
+}
@@ -0,0 +1,142 @@
+#pragma once
+// Portable, always-on instrumentation: per-stage latency histograms and a few
+// counters for the caption pipeline. Recording is a handful of integer
+// operations with no allocation and no locking; all recording happens on the
+// UI thread (hook callbacks, timers and message handlers all run there).
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "Tracer.h"
+
+// Log-linear ("HDR") buckets: exact below 16, then 16 sub-buckets per power of
+// two, i.e. every recorded value is within 1/16 (6.25%) of its bucket. Values
+// of 2^41 and above (ns: about 36 minutes) land in the last bucket.
+#define METRIC_SUB_BUCKETS  16
+#define METRIC_MAX_MSB      40
+#define METRIC_BUCKETS      (METRIC_SUB_BUCKETS * (METRIC_MAX_MSB - 2))
+
+class LatencyHistogram {
+public:
+	void Record(uint64_t value);
+	void Reset();
+
+	uint64_t Count() const { return m_count; }
+	uint64_t Max() const { return m_max; }
+	double Mean() const { return m_count ? (double)m_total / (double)m_count : 0.0; }
+	// Highest value equivalent to the bucket holding the given percentile (0-100].
+	uint64_t ValueAtPercentile(double percentile) const;
+
+private:
+	uint32_t m_buckets[METRIC_BUCKETS] = {};
+	uint64_t m_count = 0;
+	uint64_t m_total = 0;
+	uint64_t m_max = 0;
+};
+
+enum class MetricStage : uint8_t {
+	Tick = 0,    // the whole IDT_POLL_CAPTION handler
+	Capture,     // UIA fetch (GetLiveCaptionText)
+	Delta,       // deciding whether the snapshot changed
+	Merge,       // UpdateCaptionHistory
+	Render,      // RichEdit text update and scrolling
+	Paint,       // RichEdit WM_PAINT after a change
+	Highlight,   // ApplyYellowHighlight
+	PasteStep,   // one PasteSequencer step (Start or OnWake)
+	PasteTotal,  // paste request to sequencer idle, wall time
+	Count
+};
+
+struct MetricCounters {
+	uint64_t ticks = 0;
+	uint64_t changedTicks = 0;    // ticks where the caption text changed
+	uint64_t bytesMerged = 0;     // bytes inserted into the history by merges
+	uint64_t pastes = 0;
+	uint64_t allocations = 0;     // operator new calls on the UI thread during ticks
+};
+
+class MetricsRegistry {
+public:
+	void Record(MetricStage stage, uint64_t nanoseconds) { m_stages[(size_t)stage].Record(nanoseconds); }
+	void RecordTickAllocations(uint64_t allocations);
+	MetricCounters& Counters() { return m_counters; }
+	const LatencyHistogram& Stage(MetricStage stage) const { return m_stages[(size_t)stage]; }
+	void Reset();
+	// Plain-text table (microseconds), suitable for the diagnostics view and dumps.
+	std::wstring Report() const;
+
+private:
+	LatencyHistogram m_stages[(size_t)MetricStage::Count];
+	LatencyHistogram m_allocationsPerTick;
+	MetricCounters m_counters;
+};
+
+// Short ASCII name of a stage, as used in traces.
+const char* MetricStageName(MetricStage stage);
+
+// Records the lifetime of the scope into a stage and, while tracing is on,
+// as a trace event tagged with the caption snapshot it worked on.
+class StageTimer {
+public:
+	StageTimer(MetricsRegistry& metrics, MetricStage stage, uint64_t snapshotId = 0)
+		: m_metrics(metrics), m_stage(stage), m_snapshotId(snapshotId), m_start(std::chrono::steady_clock::now()) {}
+	~StageTimer() {
+		auto end = std::chrono::steady_clock::now();
+		uint64_t ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(end - m_start).count();
+		m_metrics.Record(m_stage, ns);
+		if (TraceEnabled()) {
+			TraceComplete(MetricStageName(m_stage), "caption", TraceTimestampUs(m_start), ns / 1000, m_snapshotId);
+		}
+	}
+	StageTimer(const StageTimer&) = delete;
+	StageTimer& operator=(const StageTimer&) = delete;
+
+private:
+	MetricsRegistry& m_metrics;
+	MetricStage m_stage;
+	uint64_t m_snapshotId;
+	std::chrono::steady_clock::time_point m_start;
+};
+
+// Cold start, split into phases. Each Mark ends the running phase; Interactive
+// notes the moment the window is up and the hotkeys work, which is what the
+// budget applies to. Later phases (deferred initialization) are reported but
+// do not count against it.
+#define STARTUP_MAX_PHASES  12
+#define STARTUP_BUDGET_MS   150
+
+class StartupProfile {
+public:
+	// origin: process creation when known, otherwise now; the time before the
+	// first Mark is reported as the "loader" phase.
+	void Begin(std::chrono::steady_clock::time_point origin);
+	void Mark(const char* phase);
+	void Interactive();
+	bool Done() const { return m_done; }
+	void Finish() { m_done = true; }
+
+	uint64_t InteractiveUs() const { return m_interactiveUs; }
+	bool WithinBudget(uint64_t budgetMs) const { return m_interactiveUs && m_interactiveUs <= budgetMs * 1000; }
+	std::wstring Report(uint64_t budgetMs) const;
+
+private:
+	struct Phase {
+		const char* name;
+		uint64_t startUs;     // since origin
+		uint64_t durationUs;
+	};
+
+	uint64_t SinceOriginUs(std::chrono::steady_clock::time_point t) const;
+
+	std::chrono::steady_clock::time_point m_origin;
+	std::chrono::steady_clock::time_point m_last;
+	Phase m_phases[STARTUP_MAX_PHASES] = {};
+	size_t m_count = 0;
+	uint64_t m_interactiveUs = 0;
+	bool m_done = false;
+};
+
+// Number of global operator new calls so far on the calling thread. Counted
+// by the replacement operator new in Metrics.cpp; the UI thread reads its own
+// count around a tick, so allocations on the workers are not charged to it.
+uint64_t AllocationCount();
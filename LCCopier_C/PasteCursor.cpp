@@ -0,0 +1,125 @@
+#include "PasteCursor.h"
+
+static bool IsHighSurrogate(wchar_t ch) { return ch >= 0xD800 && ch <= 0xDBFF; }
+static bool IsLowSurrogate(wchar_t ch) { return ch >= 0xDC00 && ch <= 0xDFFF; }
+
+// True when text[at - 1] and text[at] go out as one keystroke.
+static bool SplitsKeystroke(std::wstring_view text, size_t at) {
+	if (at == 0 || at >= text.size()) return false;
+	return (IsHighSurrogate(text[at - 1]) && IsLowSurrogate(text[at])) || (text[at - 1] == L'\r' && text[at] == L'\n');
+}
+
+void PasteCursor::Reset(size_t start) {
+	m_pasted = false;
+	m_pastedStart = start;
+	m_pastedEnd = start;
+	m_stableEnd = start;
+	m_tailStart = start;
+	m_tail.clear();
+}
+
+void PasteCursor::OnEdit(const HistoryEdit& edit) {
+	if (edit.Empty()) return;
+	if (edit.offset < m_stableEnd) m_stableEnd = edit.offset;
+}
+
+void PasteCursor::OnPrepend(size_t units) {
+	m_pastedStart += units;
+	m_pastedEnd += units;
+	m_stableEnd += units;
+	m_tailStart += units;
+}
+
+// Backspaces that erase what the target holds after history[..from).
+size_t PasteCursor::Keystrokes(size_t from) const {
+	size_t keys = 0;
+	for (size_t i = from - m_tailStart; i < m_tail.size(); i++) {
+		if (SplitsKeystroke(m_tail, i + 1)) i++;
+		keys++;
+	}
+	return keys;
+}
+
+PasteCursor::Delta PasteCursor::Pending(std::wstring_view history) const {
+	Delta delta;
+	size_t start = m_pastedStart;
+	if (!m_pasted) {
+		if (SplitsKeystroke(history, start)) start--;
+	}
+	else {
+		if (m_stableEnd < m_pastedStart) {
+			// Rewritten from before the range: none of it is left to keep.
+			delta.rewritten = true;
+			delta.lineBreak = true;
+			if (SplitsKeystroke(history, start)) start--;
+		}
+		else if (m_stableEnd >= m_pastedEnd) {
+			start = m_pastedEnd;
+		}
+		else {
+			start = m_stableEnd;
+			delta.rewritten = true;
+			if (start < m_tailStart) {
+				delta.lineBreak = true;
+			}
+			else {
+				if (SplitsKeystroke(m_tail, start - m_tailStart)) start--;
+				delta.retract = Keystrokes(start);
+				if (delta.retract > PASTE_MAX_RETRACT_CHARS) {
+					delta.retract = 0;
+					delta.lineBreak = true;
+				}
+			}
+		}
+	}
+	delta.start = start < history.size() ? start : history.size();
+	delta.length = history.size() - delta.start;
+	return delta;
+}
+
+void PasteCursor::MarkPasted(size_t start, std::wstring_view pasted) {
+	m_pasted = true;
+	m_pastedStart = start;
+	m_pastedEnd = start + pasted.size();
+	m_stableEnd = m_pastedEnd;
+	m_tailStart = start;
+	m_tail.assign(pasted);
+	TrimTail();
+}
+
+void PasteCursor::OnPasted(const Delta& delta, std::wstring_view pasted) {
+	// An empty payload types no line break either: it is still owed.
+	if (pasted.empty()) {
+		OnRetracted(delta);
+		return;
+	}
+	if (!m_pasted || delta.lineBreak || delta.start < m_tailStart) {
+		MarkPasted(delta.start, pasted);
+		return;
+	}
+	OnRetracted(delta);
+	m_tail.append(pasted);
+	m_pastedEnd = delta.start + pasted.size();
+	// An edit since the delta was taken may already have reached back past its
+	// start; the text kept there is stale then, and stays counted as such.
+	if (m_stableEnd >= delta.start) m_stableEnd = m_pastedEnd;
+	TrimTail();
+}
+
+void PasteCursor::OnRetracted(const Delta& delta) {
+	if (!m_pasted || delta.lineBreak || delta.start < m_tailStart) return;
+	if (delta.start - m_tailStart < m_tail.size()) m_tail.resize(delta.start - m_tailStart);
+	m_pastedEnd = delta.start;
+	if (m_stableEnd > m_pastedEnd) m_stableEnd = m_pastedEnd;
+}
+
+// Only the part still matching the history can be dropped from the front:
+// beyond m_stableEnd the tail's positions no longer line up with it.
+void PasteCursor::TrimTail() {
+	if (m_tail.size() <= PASTE_TAIL_UNITS || m_stableEnd <= m_tailStart) return;
+	size_t cut = m_tail.size() - PASTE_TAIL_UNITS;
+	if (cut > m_stableEnd - m_tailStart) cut = m_stableEnd - m_tailStart;
+	if (SplitsKeystroke(m_tail, cut)) cut--;
+	m_tail.erase(0, cut);
+	m_tailStart += cut;
+}
@@ -0,0 +1,58 @@
+#pragma once
+// Portable bookkeeping for the "paste only what's new" mode.
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include "CaptionMerge.h"
+
+// Rewrites of already-pasted text up to this many Backspaces are corrected in
+// the target; larger ones start a fresh line with the new version.
+#define PASTE_MAX_RETRACT_CHARS 80
+// Units kept from the end of what was pasted, to count those Backspaces: one
+// erases a surrogate pair or a line break, two units each.
+#define PASTE_TAIL_UNITS (2 * PASTE_MAX_RETRACT_CHARS)
+
+// Remembers which part of the history has already been pasted into the target.
+// Merges report their HistoryEdit here, so the position survives tail rewrites:
+// if Live Caption revises text we already pasted, the next paste knows exactly
+// how much in the target is stale instead of pasting it again. Nothing before
+// the start of the pasted range (the anchor) is ever erased.
+class PasteCursor {
+public:
+	struct Delta {
+		size_t start = 0;         // first history unit to paste
+		size_t length = 0;        // units to paste
+		size_t retract = 0;       // Backspaces to type at the end of the target first
+		bool rewritten = false;   // pasted text changed since the last paste
+		bool lineBreak = false;   // too much to erase: paste from start on a new line instead
+	};
+
+	// Forget what was pasted and start the next delta at start (clear, new anchor).
+	void Reset(size_t start);
+	void OnEdit(const HistoryEdit& edit);
+	// units of earlier text were put in front of the history (a clear was
+	// undone): what was pasted since moves with the text it came from.
+	void OnPrepend(size_t units);
+	Delta Pending(std::wstring_view history) const;
+	// delta's Backspaces were typed and then pasted, the text of
+	// history[delta.start, delta.start + pasted.size()) as it was handed over
+	// (without the line break, if there was one).
+	void OnPasted(const Delta& delta, std::wstring_view pasted);
+	// Only delta's Backspaces went out; the text could not be placed.
+	void OnRetracted(const Delta& delta);
+	// The target got pasted, history[start, start + pasted.size()), as a range
+	// of its own (a full paste from the anchor): later deltas continue after it
+	// and never erase before start.
+	void MarkPasted(size_t start, std::wstring_view pasted);
+
+private:
+	size_t Keystrokes(size_t from) const;
+	void TrimTail();
+
+	bool m_pasted = false;    // the target holds something from the current range
+	size_t m_pastedStart = 0; // the current range starts here
+	size_t m_pastedEnd = 0;   // and the target's text ends here, as of the last paste
+	size_t m_stableEnd = 0;   // history[m_pastedStart, m_stableEnd) is still what was pasted
+	size_t m_tailStart = 0;   // m_tail is what the target holds after history[..m_tailStart)
+	std::wstring m_tail;
+};
@@ -0,0 +1,162 @@
+#include "PasteSequencer.h"
+
+bool PasteSequencer::Start(const ClipboardPayload& payload, bool replaceAll, size_t backspaces, PasteDoneFn done) {
+	if (payload.length == 0 && backspaces == 0) return false;
+	if (Busy()) {
+		// Latest wins: the one it replaces never sends anything.
+		if (m_pendingDone) {
+			PasteDoneFn dropped = std::move(m_pendingDone);
+			dropped(PasteResult());
+		}
+		m_pendingPayload = payload;
+		m_pendingReplaceAll = replaceAll;
+		m_pendingBackspaces = backspaces;
+		m_pendingDone = std::move(done);
+		m_hasPending = true;
+		return true;
+	}
+	m_payload = payload;
+	m_replaceAll = replaceAll;
+	m_backspaces = backspaces;
+	m_done = std::move(done);
+	Begin();
+	Run();
+	return true;
+}
+
+void PasteSequencer::OnWake() {
+	if (!Busy()) return;
+	Run();
+}
+
+void PasteSequencer::Abort() {
+	if (m_hasPending && m_pendingDone) {
+		PasteDoneFn dropped = std::move(m_pendingDone);
+		dropped(PasteResult());
+	}
+	m_pendingDone = nullptr;
+	m_hasPending = false;
+	if (!Busy()) return;
+	Report(false);
+	m_platform.CancelWake();
+	if (m_clipboardReplaced) {
+		m_platform.RestoreClipboard();
+		m_clipboardReplaced = false;
+	}
+	m_step = PasteStep::Idle;
+}
+
+void PasteSequencer::Report(bool textSent) {
+	if (!m_done) return;
+	PasteResult result;
+	result.backspacesSent = m_backspacesSent;
+	result.textSent = textSent;
+	PasteDoneFn done = std::move(m_done);
+	m_done = nullptr;
+	done(result);
+}
+
+void PasteSequencer::Begin() {
+	m_typing = false;
+	m_backspacesSent = false;
+	m_typeText.clear();
+	if (m_payload.length > 0 && m_payload.length <= m_typeThreshold) {
+		m_platform.ReadPayload(m_payload, m_typeText);
+		m_typing = !m_typeText.empty();
+	}
+	m_plan.Build(m_typeText, PASTE_TYPE_BATCH_EVENTS, m_backspaces);
+	m_nextBatch = 0;
+	m_step = m_replaceAll ? PasteStep::SelectAll : FirstStep();
+	m_wakeAt = m_platform.NowMs();
+	if (!m_typing && m_payload.length > 0) {
+		m_platform.PrepareClipboard();
+		m_preparedBy = m_wakeAt + PASTE_PREPARE_TIMEOUT_MS;
+	}
+	else {
+		// Everything goes out as keystrokes, already planned from the text read above.
+		m_backspacesSent = m_backspaces > 0;
+		Report(true);
+	}
+}
+
+PasteStep PasteSequencer::FirstStep() const {
+	if (m_plan.BatchCount() > 0) return PasteStep::ReleaseModifiers;
+	if (m_payload.length > 0) return PasteStep::PlaceClipboard;
+	return PasteStep::Idle;
+}
+
+void PasteSequencer::WaitThen(PasteStep next, uint32_t delayMs) {
+	m_step = next;
+	m_wakeAt = m_platform.NowMs() + delayMs;
+}
+
+void PasteSequencer::Run() {
+	while (m_step != PasteStep::Idle) {
+		uint64_t now = m_platform.NowMs();
+		if (now < m_wakeAt) {
+			m_platform.ScheduleWake((uint32_t)(m_wakeAt - now));
+			return;
+		}
+		switch (m_step) {
+		case PasteStep::SelectAll:
+			m_platform.SendSelectAll();
+			WaitThen(FirstStep(), PASTE_SELECT_ALL_SETTLE_MS);
+			break;
+		case PasteStep::PlaceClipboard:
+			if (!m_platform.ClipboardPrepared()) {
+				if (now < m_preparedBy) {
+					WaitThen(PasteStep::PlaceClipboard, PASTE_PREPARE_POLL_MS);
+				}
+				else {
+					m_step = PasteStep::Idle;
+					Report(false);
+				}
+				break;
+			}
+			if (!m_platform.PlaceOnClipboard(m_payload)) {
+				m_step = PasteStep::Idle;
+				Report(false);
+				break;
+			}
+			m_clipboardReplaced = true;
+			Report(true);
+			WaitThen(PasteStep::InjectPaste, PASTE_CLIPBOARD_SETTLE_MS);
+			break;
+		case PasteStep::InjectPaste:
+			m_platform.SendPasteKeys();
+			WaitThen(PasteStep::RestoreClipboard, PASTE_RESTORE_DELAY_MS);
+			break;
+		case PasteStep::RestoreClipboard:
+			m_platform.RestoreClipboard();
+			m_clipboardReplaced = false;
+			m_step = PasteStep::Idle;
+			break;
+		case PasteStep::ReleaseModifiers:
+			m_platform.ReleaseModifiers();
+			m_step = PasteStep::TypeBatch;
+			break;
+		case PasteStep::TypeBatch:
+			if (m_nextBatch < m_plan.BatchCount()) {
+				m_platform.SendKeyStrokes(m_plan.BatchData(m_nextBatch), m_plan.BatchSize(m_nextBatch));
+				m_nextBatch++;
+				m_backspacesSent = m_backspaces > 0;  // they lead the plan
+			}
+			if (m_nextBatch < m_plan.BatchCount()) WaitThen(PasteStep::TypeBatch, PASTE_TYPE_BATCH_GAP_MS);
+			else if (!m_typing && m_payload.length > 0) m_step = PasteStep::PlaceClipboard;
+			else m_step = PasteStep::Idle;
+			break;
+		default:
+			m_step = PasteStep::Idle;
+			break;
+		}
+		if (m_step == PasteStep::Idle && m_hasPending) {
+			m_hasPending = false;
+			m_payload = m_pendingPayload;
+			m_replaceAll = m_pendingReplaceAll;
+			m_backspaces = m_pendingBackspaces;
+			m_done = std::move(m_pendingDone);
+			m_pendingDone = nullptr;
+			Begin();
+		}
+	}
+}
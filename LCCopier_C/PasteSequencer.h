@@ -0,0 +1,122 @@
+#pragma once
+// Portable paste pipeline: no Windows headers here so the sequencing can be
+// driven by a fake platform (and a fake clock) outside of the Win32 build.
+#include <cstdint>
+#include <functional>
+#include <string>
+#include "ClipboardPayload.h"
+#include "KeystrokePlan.h"
+
+// Delays between the steps of a paste. These used to be Sleep() calls on the
+// UI thread; now they are timer waits, so hooks and captions keep running.
+#define PASTE_SELECT_ALL_SETTLE_MS   30   // after Ctrl+A before touching the clipboard
+#define PASTE_CLIPBOARD_SETTLE_MS    10   // after SetClipboardData before Ctrl+V
+#define PASTE_RESTORE_DELAY_MS       50   // after Ctrl+V before restoring the old clipboard
+#define PASTE_PREPARE_POLL_MS        10   // while the user's clipboard is still being saved
+#define PASTE_PREPARE_TIMEOUT_MS     2000 // give up on a clipboard that stays locked this long
+
+// Short payloads are typed with KEYEVENTF_UNICODE instead: no clipboard swap,
+// no restore wait, and no race with clipboard managers.
+#define PASTE_TYPE_MAX_CHARS         256  // payloads up to this length are typed
+#define PASTE_TYPE_BATCH_EVENTS      512  // INPUT events per SendInput call
+#define PASTE_TYPE_BATCH_GAP_MS      1    // yield between batches so the hooks keep running
+
+// Everything the sequencer needs from the OS. LiveCaption.cpp implements it
+// with SendInput / the clipboard / SetTimer.
+class IPastePlatform {
+public:
+	virtual ~IPastePlatform() = default;
+	virtual uint64_t NowMs() = 0;
+	virtual void SendSelectAll() = 0;
+	// Start saving whatever the user has on the clipboard, in the background;
+	// PlaceOnClipboard waits until ClipboardPrepared says it is done.
+	virtual void PrepareClipboard() = 0;
+	virtual bool ClipboardPrepared() = 0;
+	// Save whatever the user had on the clipboard and offer the payload instead.
+	virtual bool PlaceOnClipboard(const ClipboardPayload& payload) = 0;
+	virtual void SendPasteKeys() = 0;
+	virtual void RestoreClipboard() = 0;
+	// Text of the payload; the typing path needs it up front.
+	virtual void ReadPayload(const ClipboardPayload& payload, std::wstring& out) = 0;
+	// Release modifiers still held from the hotkey so typed characters are not shortcuts.
+	virtual void ReleaseModifiers() = 0;
+	virtual void SendKeyStrokes(const KeyStroke* strokes, size_t count) = 0;
+	// Ask for OnWake() to be called after delayMs; replaces any pending wake.
+	virtual void ScheduleWake(uint32_t delayMs) = 0;
+	virtual void CancelWake() = 0;
+};
+
+// What a request got into the target, for callers that track it. Reported
+// once per request, as soon as it is known: when the text is fixed (typing
+// starts, or the payload is placed on the clipboard before Ctrl+V), when
+// placing it fails, or when the request is dropped or aborted.
+struct PasteResult {
+	bool backspacesSent = false;
+	bool textSent = false;
+};
+typedef std::function<void(const PasteResult&)> PasteDoneFn;
+
+enum class PasteStep {
+	Idle,
+	SelectAll,
+	PlaceClipboard,
+	InjectPaste,
+	RestoreClipboard,
+	ReleaseModifiers,
+	TypeBatch,
+};
+
+// select-all -> set clipboard -> Ctrl+V -> delayed clipboard restore, one step
+// per wake. Saving the user's clipboard starts with the paste and overlaps the
+// steps before setting it. Payloads of at most the type threshold skip the clipboard and go
+// select-all -> release modifiers -> typed batches. Requested backspaces are
+// typed first on either path. A request made while a paste is running is kept
+// (latest wins) and started as soon as the running one has finished.
+class PasteSequencer {
+public:
+	explicit PasteSequencer(IPastePlatform& platform) : m_platform(platform) {}
+
+	// Payloads up to chars long are typed; 0 always uses the clipboard.
+	void SetTypeThreshold(size_t chars) { m_typeThreshold = chars; }
+
+	// backspaces: keystrokes to erase in the target before pasting (used to
+	// correct text that was rewritten after an incremental paste). done, if
+	// given, gets the outcome. Returns false when there is nothing to do.
+	bool Start(const ClipboardPayload& payload, bool replaceAll, size_t backspaces = 0, PasteDoneFn done = nullptr);
+	// Timer callback. Early or spurious wakes are harmless.
+	void OnWake();
+	// Drop the pending request and finish the running one right away
+	// (restores the clipboard if it was replaced). Used on shutdown.
+	void Abort();
+
+	bool Busy() const { return m_step != PasteStep::Idle; }
+	PasteStep Step() const { return m_step; }
+
+private:
+	void Begin();
+	void Run();
+	void WaitThen(PasteStep next, uint32_t delayMs);
+	PasteStep FirstStep() const;
+	void Report(bool textSent);
+
+	IPastePlatform& m_platform;
+	PasteStep m_step = PasteStep::Idle;
+	uint64_t m_wakeAt = 0;
+	uint64_t m_preparedBy = 0;  // PlaceClipboard gives up waiting for the platform after this
+	ClipboardPayload m_payload;
+	bool m_replaceAll = false;
+	size_t m_backspaces = 0;
+	bool m_backspacesSent = false;
+	PasteDoneFn m_done;
+	bool m_typing = false;  // payload text goes out as keystrokes, not via the clipboard
+	bool m_clipboardReplaced = false;
+	size_t m_typeThreshold = PASTE_TYPE_MAX_CHARS;
+	std::wstring m_typeText;
+	KeystrokePlan m_plan;
+	size_t m_nextBatch = 0;
+	bool m_hasPending = false;
+	ClipboardPayload m_pendingPayload;
+	bool m_pendingReplaceAll = false;
+	size_t m_pendingBackspaces = 0;
+	PasteDoneFn m_pendingDone;
+};
@@ -0,0 +1,250 @@
+#include "PhraseTriggers.h"
+#include <cwctype>
+
+static bool IsSpace(wchar_t ch) {
+	return std::iswspace(ch) != 0;
+}
+
+static bool IsWordUnit(wchar_t ch) {
+	return std::iswalnum(ch) != 0;
+}
+
+// The second and later units of a whitespace run do not move the automaton.
+static bool IsSkipped(const std::wstring& history, size_t i) {
+	return i > 0 && IsSpace(history[i]) && IsSpace(history[i - 1]);
+}
+
+static std::wstring Trimmed(const std::wstring& text, size_t start, size_t end) {
+	while (start < end && IsSpace(text[start])) start++;
+	while (end > start && IsSpace(text[end - 1])) end--;
+	return text.substr(start, end - start);
+}
+
+// Folded, trimmed, whitespace runs as one space: the form the scan sees.
+static std::wstring Normalized(const std::wstring& phrase) {
+	std::wstring out;
+	for (wchar_t ch : phrase) {
+		if (IsSpace(ch)) {
+			if (!out.empty() && out.back() != L' ') out += L' ';
+		}
+		else {
+			out += (wchar_t)std::towlower(ch);
+		}
+	}
+	if (!out.empty() && out.back() == L' ') out.pop_back();
+	return out;
+}
+
+std::vector<TriggerPhrase> ParseTriggerList(const std::wstring& text) {
+	std::vector<TriggerPhrase> phrases;
+	size_t lineStart = 0;
+	while (lineStart < text.size()) {
+		size_t lineEnd = text.find(L'\n', lineStart);
+		if (lineEnd == std::wstring::npos) lineEnd = text.size();
+		std::wstring line = Trimmed(text, lineStart, lineEnd);
+		lineStart = lineEnd + 1;
+		if (line.empty() || line[0] == L'#') continue;
+		TriggerPhrase phrase;
+		size_t arrow = line.find(L"=>");
+		if (arrow != std::wstring::npos) {
+			std::wstring actions = Normalized(line.substr(arrow + 2));
+			phrase.actions = 0;
+			if (actions.find(L"highlight") != std::wstring::npos) phrase.actions |= TRIGGER_HIGHLIGHT;
+			if (actions.find(L"flash") != std::wstring::npos) phrase.actions |= TRIGGER_FLASH;
+			if (actions.find(L"log") != std::wstring::npos) phrase.actions |= TRIGGER_LOG;
+			if (!phrase.actions) phrase.actions = TRIGGER_DEFAULT;
+			line = Trimmed(line, 0, arrow);
+		}
+		phrase.text = line;
+		if (!phrase.text.empty()) phrases.push_back(phrase);
+	}
+	return phrases;
+}
+
+uint32_t PhraseTriggers::Symbol(wchar_t unit) const {
+	if ((uint32_t)unit < 128) return m_asciiSymbols[unit];
+	auto it = m_otherSymbols.find(unit);
+	return it == m_otherSymbols.end() ? 0 : it->second;
+}
+
+void PhraseTriggers::Compile(const std::vector<TriggerPhrase>& phrases) {
+	m_phrases.clear();
+	m_lengths.clear();
+	m_symbols = 1;
+	for (uint32_t& symbol : m_asciiSymbols) symbol = 0;
+	m_otherSymbols.clear();
+
+	// Alphabet first, so the table width is known before the trie is built.
+	std::vector<std::wstring> keys;
+	for (const TriggerPhrase& phrase : phrases) {
+		std::wstring key = Normalized(phrase.text);
+		if (key.empty()) continue;
+		bool duplicate = false;
+		for (size_t i = 0; i < keys.size(); i++) {
+			if (keys[i] == key) {
+				m_phrases[i].actions |= phrase.actions;
+				duplicate = true;
+				break;
+			}
+		}
+		if (duplicate) continue;
+		for (wchar_t ch : key) {
+			if (Symbol(ch)) continue;
+			if ((uint32_t)ch < 128) m_asciiSymbols[ch] = m_symbols++;
+			else m_otherSymbols[ch] = m_symbols++;
+		}
+		keys.push_back(key);
+		m_phrases.push_back(phrase);
+		m_lengths.push_back(key.size());
+	}
+
+	// Trie; 0 (the root) doubles as "no child", since no edge leads back to it.
+	m_next.assign(m_symbols, 0);
+	m_output.assign(1, -1);
+	for (size_t p = 0; p < keys.size(); p++) {
+		uint32_t state = 0;
+		for (wchar_t ch : keys[p]) {
+			uint32_t& slot = m_next[(size_t)state * m_symbols + Symbol(ch)];
+			if (!slot) {
+				slot = (uint32_t)m_output.size();
+				m_output.push_back(-1);
+				m_next.resize(m_next.size() + m_symbols, 0);
+			}
+			state = m_next[(size_t)state * m_symbols + Symbol(ch)];
+		}
+		m_output[state] = (int32_t)p;
+	}
+
+	// Failure links breadth-first, folded into the table so a step is one lookup.
+	size_t states = m_output.size();
+	std::vector<uint32_t> fail(states, 0);
+	m_outputLink.assign(states, 0);
+	std::vector<uint32_t> queue;
+	queue.reserve(states);
+	for (uint32_t a = 0; a < m_symbols; a++) {
+		if (m_next[a]) queue.push_back(m_next[a]);
+	}
+	for (size_t head = 0; head < queue.size(); head++) {
+		uint32_t u = queue[head];
+		for (uint32_t a = 0; a < m_symbols; a++) {
+			uint32_t& v = m_next[(size_t)u * m_symbols + a];
+			uint32_t viaFail = m_next[(size_t)fail[u] * m_symbols + a];
+			if (!v) {
+				v = viaFail;
+				continue;
+			}
+			fail[v] = viaFail;
+			m_outputLink[v] = m_output[viaFail] >= 0 ? viaFail : m_outputLink[viaFail];
+			queue.push_back(v);
+		}
+	}
+	Reset();
+}
+
+void PhraseTriggers::Reset() {
+	m_states.clear();
+	m_statesBase = 0;
+	m_baseState = 0;
+	m_pending.clear();
+	m_hits.clear();
+}
+
+uint32_t PhraseTriggers::Step(uint32_t state, const std::wstring& history, size_t i) const {
+	wchar_t ch = history[i];
+	if (IsSkipped(history, i)) return state;
+	ch = IsSpace(ch) ? L' ' : (wchar_t)std::towlower(ch);
+	return m_next[(size_t)state * m_symbols + Symbol(ch)];
+}
+
+void PhraseTriggers::Found(uint32_t state, const std::wstring& history, size_t end) {
+	for (uint32_t s = m_output[state] >= 0 ? state : m_outputLink[state]; s; s = m_outputLink[s]) {
+		size_t phrase = (size_t)m_output[s];
+		// Walk back over the phrase's normalized units to its first unit.
+		size_t start = end;
+		for (size_t units = 0; units < m_lengths[phrase] && start > 0;) {
+			start--;
+			if (!IsSkipped(history, start)) units++;
+		}
+		if (start > 0 && IsWordUnit(history[start - 1])) continue;
+		m_pending.push_back(TriggerHit{ phrase, start, end });
+	}
+}
+
+// A hit ending before quietEnd fired before the clear that was undone.
+void PhraseTriggers::Confirm(const TriggerHit& hit, size_t quietEnd, std::vector<TriggerHit>& fired) {
+	bool seen = hit.end < quietEnd;
+	for (const TriggerHit& old : m_revoked) {
+		if (old.phrase == hit.phrase && old.start == hit.start && old.end == hit.end) {
+			seen = true;
+			break;
+		}
+	}
+	if (!seen) fired.push_back(hit);
+	m_hits.push_back(hit);
+	if (m_hits.size() > TRIGGER_KEEP_HITS) m_hits.pop_front();
+}
+
+void PhraseTriggers::Prepend(size_t units, size_t earlierLength, const std::wstring& history, std::vector<TriggerHit>& fired) {
+	if (Empty()) return;
+	// Every earlier hit with a unit after it was confirmed, and fired, before
+	// the clear; the ones found since have fired too.
+	m_revoked.clear();
+	for (const TriggerHit& hit : m_hits) m_revoked.push_back(TriggerHit{ hit.phrase, hit.start + units, hit.end + units });
+	Reset();
+	Scan(0, history, 0, earlierLength, fired);
+}
+
+void PhraseTriggers::OnEdit(const HistoryEdit& edit, const std::wstring& history, std::vector<TriggerHit>& fired) {
+	if (Empty() || edit.Empty()) return;
+	size_t offset = edit.offset;
+	// Hits reaching the edit may be gone; the rescan restores the ones still
+	// there, without firing them again.
+	m_revoked.clear();
+	while (!m_hits.empty() && m_hits.back().end >= offset) {
+		m_revoked.push_back(m_hits.back());
+		m_hits.pop_back();
+	}
+	size_t scannedEnd = m_statesBase + m_states.size();
+	if (offset < scannedEnd) m_pending.clear();  // their next unit is the one that changed otherwise
+
+	uint32_t state;
+	if (offset < m_statesBase || offset > scannedEnd) {
+		m_states.clear();
+		m_statesBase = offset;
+		m_baseState = 0;
+		state = 0;
+	}
+	else {
+		m_states.truncate(offset - m_statesBase);
+		state = m_states.empty() ? m_baseState : m_states.back();
+		// Hits ending right before the edit wait on the unit that changed.
+		if (offset < scannedEnd && offset > 0 && !IsSkipped(history, offset - 1) &&
+			(m_output[state] >= 0 || m_outputLink[state])) {
+			Found(state, history, offset);
+		}
+	}
+
+	Scan(state, history, offset, 0, fired);
+}
+
+void PhraseTriggers::Scan(uint32_t state, const std::wstring& history, size_t from, size_t quietEnd, std::vector<TriggerHit>& fired) {
+	for (size_t i = from; i < history.size(); i++) {
+		if (!m_pending.empty()) {
+			// The unit after a hit decides whether it ended on a word boundary.
+			if (!IsWordUnit(history[i])) {
+				for (const TriggerHit& hit : m_pending) Confirm(hit, quietEnd, fired);
+			}
+			m_pending.clear();
+		}
+		state = Step(state, history, i);
+		m_states.push_back(state);
+		// Only the last TRIGGER_REWIND_UNITS states are kept, however long the edit.
+		if (m_states.size() > TRIGGER_REWIND_UNITS) {
+			m_baseState = m_states.front();
+			m_states.pop_front();
+			m_statesBase++;
+		}
+		if (!IsSkipped(history, i) && (m_output[state] >= 0 || m_outputLink[state])) Found(state, history, i + 1);
+	}
+	m_unitsScanned += history.size() - from;
+}
@@ -0,0 +1,89 @@
+#pragma once
+// Portable phrase triggers: a user list of phrases ("action item", a name, a
+// project code) compiled into one Aho-Corasick automaton with a dense
+// transition table, so each unit of caption text costs one table step no
+// matter how many phrases there are. Only the text a HistoryEdit touched is
+// scanned; the automaton state is kept per recent unit, so a phrase split
+// across ticks is found and a tail rewrite resumes from the state before it.
+//
+// Matching folds case, treats any run of whitespace as one space and only
+// accepts whole words: the units before and after a hit must not be letters
+// or digits. A hit at the very end of the history waits for the next unit.
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "CaptionMerge.h"
+#include "RingQueue.h"
+
+#define TRIGGER_HIGHLIGHT    0x01
+#define TRIGGER_FLASH        0x02
+#define TRIGGER_LOG          0x04
+#define TRIGGER_DEFAULT      (TRIGGER_HIGHLIGHT | TRIGGER_LOG)
+#define TRIGGER_REWIND_UNITS 2048  // a rewrite further back rescans from the root state
+#define TRIGGER_KEEP_HITS    256   // hits remembered for highlighting and refire checks
+#define TRIGGER_LIST_FILE    L"LCCopier_triggers.txt"
+
+struct TriggerPhrase {
+	std::wstring text;
+	uint8_t actions = TRIGGER_DEFAULT;
+};
+
+struct TriggerHit {
+	size_t phrase;
+	size_t start;  // history range of the hit
+	size_t end;
+};
+
+// One phrase per line, optionally followed by "=>" and actions (highlight,
+// flash, log); lines starting with '#' are comments. Returns the phrases kept.
+std::vector<TriggerPhrase> ParseTriggerList(const std::wstring& text);
+
+class PhraseTriggers {
+public:
+	void Compile(const std::vector<TriggerPhrase>& phrases);
+	bool Empty() const { return m_phrases.empty(); }
+	const TriggerPhrase& Phrase(size_t index) const { return m_phrases[index]; }
+
+	// The history was cleared.
+	void Reset();
+	// Scan from the edit to the end of history. Hits found for the first time
+	// are appended to fired; a hit that a rewrite removed and restored fires once.
+	void OnEdit(const HistoryEdit& edit, const std::wstring& history, std::vector<TriggerHit>& fired);
+	// Undo of a clear: units of earlier text were put in front of the history,
+	// the first earlierLength of them the cleared history. The history is
+	// scanned again, so the earlier hits are kept again and one across the join
+	// is found; hits that fired before the clear or since do not fire again.
+	void Prepend(size_t units, size_t earlierLength, const std::wstring& history, std::vector<TriggerHit>& fired);
+	// Recent hits still in the history, by end offset.
+	const RingQueue<TriggerHit>& Hits() const { return m_hits; }
+	uint64_t UnitsScanned() const { return m_unitsScanned; }
+
+private:
+	uint32_t Symbol(wchar_t unit) const;
+	uint32_t Step(uint32_t state, const std::wstring& history, size_t i) const;
+	void Found(uint32_t state, const std::wstring& history, size_t end);
+	void Scan(uint32_t state, const std::wstring& history, size_t from, size_t quietEnd, std::vector<TriggerHit>& fired);
+	void Confirm(const TriggerHit& hit, size_t quietEnd, std::vector<TriggerHit>& fired);
+
+	std::vector<TriggerPhrase> m_phrases;
+	std::vector<size_t> m_lengths;        // normalized units per phrase
+	// Automaton: m_next[state * m_symbols + symbol]; symbol 0 is any unit that
+	// occurs in no phrase.
+	uint32_t m_symbols = 1;
+	uint32_t m_asciiSymbols[128] = {};
+	std::unordered_map<wchar_t, uint32_t> m_otherSymbols;
+	std::vector<uint32_t> m_next;
+	std::vector<int32_t> m_output;        // phrase ending at the state, or -1
+	std::vector<uint32_t> m_outputLink;   // next state on the failure chain with an output, 0 if none
+
+	// Scan state: m_states[i] is the state after unit m_statesBase + i.
+	RingQueue<uint32_t> m_states;
+	size_t m_statesBase = 0;
+	uint32_t m_baseState = 0;             // state before unit m_statesBase
+	std::vector<TriggerHit> m_pending;    // hits ending at the end of history
+	RingQueue<TriggerHit> m_hits;
+	std::vector<TriggerHit> m_revoked;    // hits the current edit may have removed
+	uint64_t m_unitsScanned = 0;
+};
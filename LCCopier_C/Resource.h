@@ -14,6 +14,8 @@
 #define IDT_POLL_CAPTION        1
 #define IDT_HOOK_KEEPALIVE      2    // timer: periodically verify hooks are still installed
 #define IDT_AUTO_START_LC       3    // one-shot timer: delay AutoStartLiveCaption() so hotkey modifiers are released
+#define IDT_PASTE_STEP          4    // one-shot timer: advance the paste sequence (PasteSequencer)
+#define IDT_DIAG_REFRESH        5    // diagnostics dialog: refresh the report
 
 
 #define IDD_SETTINGS_DIALOG     200
@@ -42,14 +44,36 @@
 #define IDC_SELECTED_BG_COLOR_PICKER 226
 #define IDC_MIDDLE_BUTTON_PASTE      227
 #define IDC_MIDDLE_BUTTON_REPLACE_ALL 228
+#define IDC_INCREMENTAL_PASTE        229
+
+#define IDD_DIAGNOSTICS         300
+#define IDC_DIAG_TEXT           301
+#define IDC_DIAG_SAVE           302
+#define IDC_DIAG_RESET          303
 
 #define MAX_LOADSTRING              100
 #define POLL_INTERVAL_MS            400
+#define AUTO_START_DELAY_MS         300  // after deferred init: Win+Ctrl+L is sent once modifiers are released
 #define WM_APP_FIND_AND_COPY (WM_APP + 3)
 #define WM_APP_CLEAR_HISTORY (WM_APP + 4)
 #define WM_APP_SETTINGS_CHANGED (WM_APP + 6)
 #define WM_APP_HIDE_TASKBAR     (WM_APP + 7)  // wParam=1 hide, wParam=0 show
+#define WM_APP_SHOW_DIAGNOSTICS (WM_APP + 8)
+#define WM_APP_DEFERRED_INIT    (WM_APP + 9)  // second startup phase, posted from WM_CREATE
+#define WM_APP_COPY_SENTENCES   (WM_APP + 10) // wParam = number of sentences
+#define WM_APP_UNDO_CLEAR       (WM_APP + 11)
+#define UNDO_MAX_CLEARS         8             // cleared histories kept for Ctrl+Shift+Alt+Z
+#define WM_APP_TASKS_DONE       (WM_APP + 12) // background task completions are waiting
+#define TASK_THREADS            2
+#define TASK_IDLE_AFTER_MS      1500          // no caption change (and no paste) for this long lets Idle tasks run
+#define OUTPUT_MAX_PENDING_MS   10000         // buffered trace/subtitle/snapshot output is written after this long...
+#define OUTPUT_MAX_PENDING_BYTES (256 * 1024) // ...or past this size, even while captions keep changing
 #define IDM_SETTINGS 9001
+#define HOOK_HEARTBEAT_TAG  ((ULONG_PTR)0x4C434842)  // dwExtraInfo of injected hook heartbeats ("LCHB")
+#define HOOK_HEARTBEAT_VK   0x97                     // unassigned virtual key used for the keyboard heartbeat
+#define OWN_INPUT_TAG       ((ULONG_PTR)0x4C434B49)  // dwExtraInfo of the keystrokes we send ("LCKI")
+#define TRIGGER_HIGHLIGHT_COLOR RGB(255, 192, 0)      // background of phrase trigger hits
+#define TRIGGER_LOG_CONTEXT     60                    // units of history on each side of a logged hit
 
 #ifndef IDC_STATIC
 #define IDC_STATIC				-1
@@ -0,0 +1,147 @@
+#include "RevisionJournal.h"
+#include <algorithm>
+#include <cwchar>
+
+void RevisionJournal::OnEdit(const HistoryEdit& edit, const std::wstring& history, uint64_t nowMs) {
+	if (edit.Empty()) return;
+	if (!m_started) {
+		m_startMs = nowMs;
+		m_started = true;
+		Reserve();
+	}
+	Entry entry;
+	entry.ms = (uint32_t)(std::min)(nowMs - m_startMs, (uint64_t)UINT32_MAX);
+	entry.offset = (uint32_t)edit.offset;
+	entry.removed = (uint32_t)edit.removed;
+	entry.inserted = (uint32_t)edit.inserted;
+	entry.kept = (uint32_t)(std::min)(edit.inserted, (size_t)JOURNAL_BASE_CHARS);
+	// The evicted front is compacted away only when an append would not fit,
+	// so the storage reserved never grows; the slack left once the limits are
+	// reached means each entry and unit is moved O(1) times.
+	if (m_first && m_entries.size() == m_entries.capacity()) {
+		m_entries.erase(m_entries.begin(), m_entries.begin() + m_first);
+		m_first = 0;
+	}
+	if (m_textFirst && m_text.size() + entry.kept > m_text.capacity()) {
+		m_text.erase(0, m_textFirst);
+		m_textBase += m_textFirst;
+		m_textFirst = 0;
+	}
+	entry.textStart = m_textBase + m_text.size();
+	m_text.append(history, edit.offset + edit.inserted - entry.kept, entry.kept);
+	m_entries.push_back(entry);
+	m_edits++;
+	if (edit.removed) {
+		m_rewrites++;
+		m_rewrittenUnits += edit.removed;
+	}
+	Evict();
+}
+
+const wchar_t* RevisionJournal::Inserted(const Entry& entry) const {
+	return m_text.data() + (size_t)(entry.textStart - m_textBase);
+}
+
+// text is the history from start on. An edit inside it replaces its end; one
+// reaching back before it, or keeping only part of what it inserted, leaves
+// only the kept text.
+void RevisionJournal::Apply(std::wstring& text, size_t& start, const Entry& entry, const wchar_t* kept) {
+	if (entry.offset >= start && entry.kept == entry.inserted) {
+		size_t offset = (std::min)((size_t)entry.offset - start, text.size());
+		text.replace(offset, std::wstring::npos, kept, entry.kept);
+	}
+	else {
+		text.assign(kept, entry.kept);
+		start = (size_t)entry.offset + entry.inserted - entry.kept;
+	}
+}
+
+// Live entries stay within JOURNAL_MAX_EDITS and live text within
+// JOURNAL_MAX_CHARS, plus the one edit being added; the base reaches at most
+// 2 * JOURNAL_BASE_CHARS before an edit is applied to it.
+void RevisionJournal::Reserve() {
+	m_entries.reserve(JOURNAL_MAX_EDITS + JOURNAL_SLACK_EDITS);
+	m_text.reserve(JOURNAL_MAX_CHARS + 2 * JOURNAL_BASE_CHARS);
+	m_base.reserve(3 * JOURNAL_BASE_CHARS);
+}
+
+void RevisionJournal::Evict() {
+	while (EditCount() && (EditCount() > JOURNAL_MAX_EDITS || m_text.size() - m_textFirst > JOURNAL_MAX_CHARS)) {
+		const Entry& oldest = m_entries[m_first];
+		Apply(m_base, m_baseStart, oldest, Inserted(oldest));
+		m_textFirst += oldest.kept;
+		m_first++;
+		m_evicted++;
+		// Cut back to JOURNAL_BASE_CHARS once twice that, so each unit moves O(1) times.
+		if (m_base.size() > 2 * JOURNAL_BASE_CHARS) {
+			size_t cut = m_base.size() - JOURNAL_BASE_CHARS;
+			m_base.erase(0, cut);
+			m_baseStart += cut;
+		}
+	}
+}
+
+std::wstring RevisionJournal::TextAt(uint64_t atMs, size_t* start) const {
+	std::wstring text = m_base;
+	size_t textStart = m_baseStart;
+	if (m_started && atMs >= m_startMs) {
+		uint64_t ms = atMs - m_startMs;
+		for (size_t i = m_first; i < m_entries.size() && m_entries[i].ms <= ms; i++) {
+			Apply(text, textStart, m_entries[i], Inserted(m_entries[i]));
+		}
+	}
+	if (start) *start = textStart;
+	return text;
+}
+
+// Quoted, on one line, cut to JOURNAL_REPORT_CHARS. cutFront: the text begins
+// with units no longer kept.
+static void AppendQuoted(std::wstring& out, const wchar_t* text, size_t length, bool cutFront) {
+	out += L'"';
+	if (cutFront) out += L"...";
+	for (size_t i = 0; i < length && i < JOURNAL_REPORT_CHARS; i++) {
+		out += text[i] == L'\r' || text[i] == L'\n' ? L' ' : text[i];
+	}
+	if (length > JOURNAL_REPORT_CHARS) out += L"...";
+	out += L'"';
+}
+
+std::wstring RevisionJournal::RewriteReport() const {
+	std::wstring out;
+	wchar_t line[96];
+	size_t rewrites = 0;
+	std::wstring text = m_base;
+	size_t textStart = m_baseStart;
+	for (size_t i = m_first; i < m_entries.size(); i++) {
+		const Entry& entry = m_entries[i];
+		const wchar_t* kept = Inserted(entry);
+		if (entry.removed) {
+			rewrites++;
+			unsigned seconds = entry.ms / 1000;
+			swprintf(line, 96, L"%u:%02u:%02u.%03u  at %u  ", seconds / 3600, seconds / 60 % 60, seconds % 60, entry.ms % 1000, entry.offset);
+			out += line;
+			if (entry.offset == 0 && !entry.inserted) {
+				swprintf(line, 96, L"cleared %u units", entry.removed);
+				out += line;
+			}
+			else {
+				size_t offset = (std::min)((size_t)(std::max)((size_t)entry.offset, textStart) - textStart, text.size());
+				AppendQuoted(out, text.data() + offset, text.size() - offset, entry.offset < textStart);
+				out += L" -> ";
+				AppendQuoted(out, kept, entry.kept, entry.kept < entry.inserted);
+			}
+			out += L"\r\n";
+		}
+		Apply(text, textStart, entry, kept);
+	}
+	swprintf(line, 96, L"%zu rewrites in the last %zu edits\r\n", rewrites, EditCount());
+	return line + out;
+}
+
+std::wstring RevisionJournal::Describe() const {
+	wchar_t line[256];
+	swprintf(line, 256, L"revision journal: %llu edits, %llu rewrites (%llu units replaced); %zu edits and %zu KB of text kept, %llu folded into a %zu KB base\r\n",
+		(unsigned long long)m_edits, (unsigned long long)m_rewrites, (unsigned long long)m_rewrittenUnits, EditCount(),
+		(m_text.size() - m_textFirst) * sizeof(wchar_t) / 1024, (unsigned long long)m_evicted, m_base.size() * sizeof(wchar_t) / 1024);
+	return line;
+}
@@ -0,0 +1,76 @@
+#pragma once
+// Portable revision journal: every HistoryEdit the merge (or a clear) makes,
+// as a compact delta of offset, units removed, units inserted and time, plus
+// the inserted text. Replaying the deltas over the oldest state kept gives the
+// history as it looked at any moment, and the text a rewrite replaced, so what
+// Live Caption first showed can be audited after it was corrected.
+//
+// Every edit replaces the history from its offset to the end, so the journal
+// only needs the end of it: the base is a checkpoint of the history from
+// m_baseStart on, and an edit reaching back before what is kept replaces all
+// of it. Memory is bounded by the limits below:
+//   - at most JOURNAL_MAX_EDITS deltas;
+//   - at most JOURNAL_MAX_CHARS units of inserted text, of which each edit
+//     keeps its last JOURNAL_BASE_CHARS (undoing a clear inserts the whole
+//     restored history);
+//   - a base of at most 2 * JOURNAL_BASE_CHARS units; past JOURNAL_BASE_CHARS
+//     the front is dropped, lazily.
+// The oldest deltas are folded into the base, and can no longer be told apart.
+// Storage for these bounds, with room for lazy compaction, is reserved by the
+// first edit, so recording an edit does not allocate.
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "CaptionMerge.h"
+
+#define JOURNAL_MAX_EDITS    65536
+#define JOURNAL_MAX_CHARS    (1u << 20)  // inserted text kept, in units
+#define JOURNAL_BASE_CHARS   (1u << 18)  // end of the history the base keeps; also the most one edit keeps
+#define JOURNAL_REPORT_CHARS 160         // longer texts are cut in the rewrite report
+#define JOURNAL_SLACK_EDITS  (JOURNAL_MAX_EDITS / 4)  // evicted edits are compacted away once this many would not fit
+
+class RevisionJournal {
+public:
+	// nowMs: any monotonic clock; times are reported relative to the first edit.
+	void OnEdit(const HistoryEdit& edit, const std::wstring& history, uint64_t nowMs);
+
+	size_t EditCount() const { return m_entries.size() - m_first; }
+	uint64_t RewriteCount() const { return m_rewrites; }
+	// The history as it was at atMs, after every edit made at or before it,
+	// from *start on; the units before it are no longer kept. Before the
+	// oldest edit kept, the oldest state kept.
+	std::wstring TextAt(uint64_t atMs, size_t* start = nullptr) const;
+	// Every rewrite kept, oldest first: when, where, and what replaced what.
+	// Appends are left out; they are visible in TextAt.
+	std::wstring RewriteReport() const;
+	std::wstring Describe() const;
+	// Units of text held: the base and the inserted text of the kept edits.
+	size_t KeptUnits() const { return m_base.size() + m_text.size() - m_textFirst; }
+
+private:
+	struct Entry {
+		uint32_t ms;        // since m_startMs
+		uint32_t offset;
+		uint32_t removed;
+		uint32_t inserted;
+		uint32_t kept;      // the last units of the inserted text, at most JOURNAL_BASE_CHARS
+		uint64_t textStart; // of the kept text, counted over everything ever appended to m_text
+	};
+
+	const wchar_t* Inserted(const Entry& entry) const;
+	static void Apply(std::wstring& text, size_t& start, const Entry& entry, const wchar_t* kept);
+	void Reserve();
+	void Evict();
+
+	std::wstring m_base;           // the history before the oldest kept edit, from m_baseStart on
+	size_t m_baseStart = 0;
+	std::vector<Entry> m_entries;  // kept edits from m_first on; the front is compacted lazily
+	size_t m_first = 0;
+	std::wstring m_text;           // inserted text of the kept edits, front compacted lazily
+	uint64_t m_textBase = 0;       // textStart of m_text[0]
+	size_t m_textFirst = 0;        // m_text before this belongs to evicted edits
+	uint64_t m_startMs = 0;
+	bool m_started = false;
+	uint64_t m_edits = 0, m_rewrites = 0, m_rewrittenUnits = 0, m_evicted = 0;
+};
@@ -0,0 +1,80 @@
+#pragma once
+// Portable double-ended queue over one vector used as a ring, for the recent
+// state the caption consumers keep per edit or per unit. Unlike std::deque it
+// keeps its storage through pops and clear(), so once it has grown to its
+// working size pushing does not allocate; when full it doubles. Named like
+// the std::deque members it stands in for.
+#include <cstddef>
+#include <vector>
+
+template <typename T>
+class RingQueue {
+public:
+	class Iterator {
+	public:
+		Iterator(RingQueue* queue, size_t index) : m_queue(queue), m_index(index) {}
+		T& operator*() const { return (*m_queue)[m_index]; }
+		T* operator->() const { return &(*m_queue)[m_index]; }
+		Iterator& operator++() { m_index++; return *this; }
+		bool operator!=(const Iterator& other) const { return m_index != other.m_index; }
+	private:
+		RingQueue* m_queue;
+		size_t m_index;
+	};
+	class ConstIterator {
+	public:
+		ConstIterator(const RingQueue* queue, size_t index) : m_queue(queue), m_index(index) {}
+		const T& operator*() const { return (*m_queue)[m_index]; }
+		const T* operator->() const { return &(*m_queue)[m_index]; }
+		ConstIterator& operator++() { m_index++; return *this; }
+		bool operator!=(const ConstIterator& other) const { return m_index != other.m_index; }
+	private:
+		const RingQueue* m_queue;
+		size_t m_index;
+	};
+
+	size_t size() const { return m_count; }
+	bool empty() const { return m_count == 0; }
+	void clear() { m_first = 0; m_count = 0; }
+
+	T& operator[](size_t i) { return m_items[Slot(i)]; }
+	const T& operator[](size_t i) const { return m_items[Slot(i)]; }
+	T& front() { return m_items[m_first]; }
+	const T& front() const { return m_items[m_first]; }
+	T& back() { return m_items[Slot(m_count - 1)]; }
+	const T& back() const { return m_items[Slot(m_count - 1)]; }
+
+	void push_back(const T& item) {
+		if (m_count == m_items.size()) Grow();
+		m_items[Slot(m_count)] = item;
+		m_count++;
+	}
+	void pop_front() {
+		m_first = Slot(1);
+		m_count--;
+	}
+	void pop_back() { m_count--; }
+	// Keep the first count items (count <= size()).
+	void truncate(size_t count) { m_count = count; }
+
+	Iterator begin() { return Iterator(this, 0); }
+	Iterator end() { return Iterator(this, m_count); }
+	ConstIterator begin() const { return ConstIterator(this, 0); }
+	ConstIterator end() const { return ConstIterator(this, m_count); }
+
+private:
+	size_t Slot(size_t i) const {
+		size_t slot = m_first + i;
+		return slot < m_items.size() ? slot : slot - m_items.size();
+	}
+	void Grow() {
+		std::vector<T> items(m_items.empty() ? 16 : m_items.size() * 2);
+		for (size_t i = 0; i < m_count; i++) items[i] = (*this)[i];
+		m_items.swap(items);
+		m_first = 0;
+	}
+
+	std::vector<T> m_items;
+	size_t m_first = 0;
+	size_t m_count = 0;
+};
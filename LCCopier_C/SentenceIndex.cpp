@@ -0,0 +1,100 @@
+#include "SentenceIndex.h"
+#include <cwctype>
+
+static bool IsTerminator(wchar_t ch) {
+	return ch == L'.' || ch == L'?' || ch == L'!' || ch == 0x2026 /* … */;
+}
+
+// Full-width terminators are not followed by a space.
+static bool IsFullWidthTerminator(wchar_t ch) {
+	return ch == 0x3002 /* 。 */ || ch == 0xFF1F /* ？ */ || ch == 0xFF01 /* ！ */;
+}
+
+// May follow a terminator without ending the sentence early: "Why?" he said.
+static bool IsCloser(wchar_t ch) {
+	return ch == L'"' || ch == L'\'' || ch == L')' || ch == L']' || ch == 0x2019 || ch == 0x201D || ch == 0x00BB;
+}
+
+void SentenceIndex::Clear() {
+	m_starts.clear();
+}
+
+void SentenceIndex::OnEdit(const HistoryEdit& edit, const std::wstring& history) {
+	if (edit.Empty()) return;
+	// A start depends only on the text up to and including it, so the ones
+	// before the edit stand; the rest are found again from the last of those.
+	while (!m_starts.empty() && m_starts.back() >= edit.offset) m_starts.pop_back();
+	if (m_starts.empty()) Scan(history, 0);
+	else Scan(history, m_starts.back());
+}
+
+void SentenceIndex::Prepend(SentenceIndex&& earlier, const std::wstring& history) {
+	m_starts.swap(earlier.m_starts);
+	earlier.m_starts.clear();
+	if (m_starts.empty()) Scan(history, 0);
+	else Scan(history, m_starts.back());
+}
+
+void SentenceIndex::Scan(const std::wstring& history, size_t from) {
+	enum { Seeking, InSentence, Closing, Ended } state = Seeking;
+	size_t start = 0;
+	wchar_t terminator = 0;
+	auto begin = [&](size_t i) {
+		wchar_t ch = history[i];
+		start = i;
+		if (IsFullWidthTerminator(ch)) {
+			terminator = ch;
+			state = Ended;
+		}
+		else {
+			terminator = IsTerminator(ch) ? ch : 0;
+			state = terminator ? Closing : InSentence;
+		}
+	};
+	// Resuming at a known start: the state there is the same as on a full scan.
+	if (!m_starts.empty() && m_starts.back() == from) begin(from++);
+	for (size_t i = from; i < history.size(); i++) {
+		wchar_t ch = history[i];
+		bool space = std::iswspace(ch) != 0;
+		switch (state) {
+		case InSentence:
+			if (ch == L'\n') {
+				terminator = 0;
+				state = Ended;
+			}
+			else if (IsTerminator(ch) || IsFullWidthTerminator(ch)) {
+				terminator = ch;
+				state = IsFullWidthTerminator(ch) ? Ended : Closing;
+			}
+			else if (space && i - start >= SENTENCE_MAX_CHARS) {
+				terminator = 0;
+				state = Ended;
+			}
+			continue;
+		case Closing:
+			if (space) state = Ended;
+			else if (!IsTerminator(ch) && !IsCloser(ch)) state = InSentence;  // 3.5, U.S.
+			continue;
+		case Ended:
+			if (space) continue;
+			if (IsFullWidthTerminator(ch)) continue;
+			// "e.g. the", "Why?" he asked: Live Caption capitalizes sentence starts,
+			// so a lower-case word after a terminator continues the sentence.
+			if (IsTerminator(terminator) && std::iswlower(ch)) {
+				state = InSentence;
+				continue;
+			}
+			break;
+		case Seeking:
+			if (space) continue;
+			break;
+		}
+		m_starts.push_back(i);
+		begin(i);
+	}
+}
+
+size_t SentenceIndex::StartOfLast(size_t n, size_t historyLength) const {
+	if (n == 0 || m_starts.empty()) return historyLength;
+	return n >= m_starts.size() ? m_starts.front() : m_starts[m_starts.size() - n];
+}
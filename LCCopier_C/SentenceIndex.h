@@ -0,0 +1,37 @@
+#pragma once
+// Portable sentence offset table over the caption history, kept up to date
+// from the merge's HistoryEdits. Each edit rescans only from the last sentence
+// start before it, so a retroactive "." or "?" that Live Caption adds to the
+// tail splits the open sentence, and a rewrite that removes one joins them
+// again. Looking up the last N sentences is an index into the table.
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "CaptionMerge.h"
+
+// A sentence with no terminator is split at the next space after this many
+// units, which also bounds the rescan an edit can cause.
+#define SENTENCE_MAX_CHARS 400
+// Ctrl+Shift+Alt+1..9 copy the last 1..9 sentences.
+#define SENTENCE_COPY_MAX  9
+
+class SentenceIndex {
+public:
+	void Clear();
+	void OnEdit(const HistoryEdit& edit, const std::wstring& history);
+	// Undo of a clear: earlier (the index as it was) covers the start of the
+	// history. The text after it is scanned again from earlier's last start,
+	// since joined to the earlier text its first sentence may continue one.
+	void Prepend(SentenceIndex&& earlier, const std::wstring& history);
+
+	// Sentences in the history, counting an unfinished last one.
+	size_t Count() const { return m_starts.size(); }
+	// First unit of the last n sentences (of all of them when there are fewer);
+	// historyLength when there are none.
+	size_t StartOfLast(size_t n, size_t historyLength) const;
+
+private:
+	void Scan(const std::wstring& history, size_t from);
+
+	std::vector<size_t> m_starts;  // first non-space unit of each sentence, ascending
+};
@@ -3,12 +3,18 @@
 #include <CommCtrl.h>
 #include <RichEdit.h>
 #include <string>
+#include <vector>
+
+#define SETTINGS_KEY   L"Software\\LiveCaption"
+#define SETTINGS_VALUE L"Settings"
 
 #pragma comment(lib, "Comctl32.lib")
 
 HWND SettingsDialog::s_hDlg = nullptr;
 HWND SettingsDialog::s_hParent = nullptr;
 AppSettings SettingsDialog::s_settings = {};
+AppSettings SettingsDialog::s_current = {};
+bool SettingsDialog::s_currentLoaded = false;
 int SettingsDialog::s_originalTransparency = 100;
 
 void SettingsDialog::Show(HWND hParent) {
@@ -32,13 +38,25 @@ void SettingsDialog::Close() {
 
 AppSettings SettingsDialog::LoadSettings() {
     AppSettings settings = GetDefaultSettings();
-    LoadFromRegistry(settings);
+    bool present = false;
+    if (!LoadFromRegistry(settings, present) && LoadLegacyValues(settings) && !present) {
+        SaveToRegistry(settings);  // migrate; the old values are left for older builds
+    }
+    s_current = settings;
+    s_currentLoaded = true;
     return settings;
 }
 
+const AppSettings& SettingsDialog::Current() {
+    if (!s_currentLoaded) LoadSettings();
+    return s_current;
+}
+
 void SettingsDialog::SaveSettings(const AppSettings& settings) {
     SaveToRegistry(settings);
     s_settings = settings;
+    s_current = settings;
+    s_currentLoaded = true;
 }
 
 AppSettings SettingsDialog::GetDefaultSettings() {
@@ -48,6 +66,7 @@ AppSettings SettingsDialog::GetDefaultSettings() {
     settings.setInvisible = false;
     settings.middleButtonPaste = true;
     settings.middleButtonReplaceAll = true;
+    settings.incrementalPaste = false;
     settings.transparency = 100;
     settings.autoCopyHotkey = { true, true, false, false, 'A' };
     settings.autoDeleteHotkey = { true, true, false, false, 'D' };
@@ -55,12 +74,26 @@ AppSettings SettingsDialog::GetDefaultSettings() {
     settings.textColor = RGB(0, 0, 0);
     settings.bgColor = RGB(255, 255, 255);
     settings.selectedBgColor = RGB(168, 223, 142);
+    settings.transcriptLog = true;
+    settings.transcriptFlushMs = 2000;
+    settings.transcriptRotateMB = 16;
     return settings;
 }
 
-void SettingsDialog::LoadFromRegistry(AppSettings& settings) {
+// present is false only when there is no blob at all; a blob this build cannot
+// read (damaged, or from a newer version) must not be overwritten by migration.
+bool SettingsDialog::LoadFromRegistry(AppSettings& settings, bool& present) {
+    uint8_t blob[SETTINGS_BLOB_MAX_BYTES];
+    DWORD size = sizeof(blob);
+    LSTATUS status = RegGetValueW(HKEY_CURRENT_USER, SETTINGS_KEY, SETTINGS_VALUE, RRF_RT_REG_BINARY, nullptr, blob, &size);
+    present = status != ERROR_FILE_NOT_FOUND;
+    return status == ERROR_SUCCESS && DeserializeSettings(blob, size, settings);
+}
+
+// Settings as written before the blob: one DWORD value each.
+bool SettingsDialog::LoadLegacyValues(AppSettings& settings) {
     HKEY hKey;
-    if (RegOpenKeyExW(HKEY_CURRENT_USER, L"Software\\LiveCaption", 0, KEY_READ, &hKey) == ERROR_SUCCESS) {
+    if (RegOpenKeyExW(HKEY_CURRENT_USER, SETTINGS_KEY, 0, KEY_READ, &hKey) == ERROR_SUCCESS) {
         DWORD dwValue, dwSize = sizeof(DWORD);
         if (RegQueryValueExW(hKey, L"DarkMode", nullptr, nullptr, (LPBYTE)&dwValue, &dwSize) == ERROR_SUCCESS)
             settings.darkMode = (dwValue != 0);
@@ -72,6 +105,8 @@ void SettingsDialog::LoadFromRegistry(AppSettings& settings) {
             settings.middleButtonPaste = (dwValue != 0);
         if (RegQueryValueExW(hKey, L"MiddleButtonReplaceAll", nullptr, nullptr, (LPBYTE)&dwValue, &dwSize) == ERROR_SUCCESS)
             settings.middleButtonReplaceAll = (dwValue != 0);
+        if (RegQueryValueExW(hKey, L"IncrementalPaste", nullptr, nullptr, (LPBYTE)&dwValue, &dwSize) == ERROR_SUCCESS)
+            settings.incrementalPaste = (dwValue != 0);
         if (RegQueryValueExW(hKey, L"Transparency", nullptr, nullptr, (LPBYTE)&dwValue, &dwSize) == ERROR_SUCCESS)
             settings.transparency = (int)dwValue;
         if (RegQueryValueExW(hKey, L"AutoCopyCtrl", nullptr, nullptr, (LPBYTE)&dwValue, &dwSize) == ERROR_SUCCESS)
@@ -102,56 +137,22 @@ void SettingsDialog::LoadFromRegistry(AppSettings& settings) {
             settings.bgColor = (COLORREF)dwValue;
         if (RegQueryValueExW(hKey, L"SelectedBgColor", nullptr, nullptr, (LPBYTE)&dwValue, &dwSize) == ERROR_SUCCESS)
             settings.selectedBgColor = (COLORREF)dwValue;
+        if (RegQueryValueExW(hKey, L"TranscriptLog", nullptr, nullptr, (LPBYTE)&dwValue, &dwSize) == ERROR_SUCCESS)
+            settings.transcriptLog = dwValue != 0;
+        if (RegQueryValueExW(hKey, L"TranscriptFlushMs", nullptr, nullptr, (LPBYTE)&dwValue, &dwSize) == ERROR_SUCCESS)
+            settings.transcriptFlushMs = (int)dwValue;
+        if (RegQueryValueExW(hKey, L"TranscriptRotateMB", nullptr, nullptr, (LPBYTE)&dwValue, &dwSize) == ERROR_SUCCESS)
+            settings.transcriptRotateMB = (int)dwValue;
         RegCloseKey(hKey);
+        return true;
     }
+    return false;
 }
 
+// One value, so a save is never seen half done.
 void SettingsDialog::SaveToRegistry(const AppSettings& settings) {
-    HKEY hKey;
-    if (RegCreateKeyExW(HKEY_CURRENT_USER, L"Software\\LiveCaption", 0, nullptr, 0, KEY_WRITE, nullptr, &hKey, nullptr) == ERROR_SUCCESS) {
-        DWORD dwValue;
-        dwValue = settings.darkMode ? 1 : 0;
-        RegSetValueExW(hKey, L"DarkMode", 0, REG_DWORD, (LPBYTE)&dwValue, sizeof(DWORD));
-        dwValue = settings.setTop ? 1 : 0;
-        RegSetValueExW(hKey, L"SetTop", 0, REG_DWORD, (LPBYTE)&dwValue, sizeof(DWORD));
-        dwValue = settings.setInvisible ? 1 : 0;
-        RegSetValueExW(hKey, L"SetInvisible", 0, REG_DWORD, (LPBYTE)&dwValue, sizeof(DWORD));
-        dwValue = settings.middleButtonPaste ? 1 : 0;
-        RegSetValueExW(hKey, L"MiddleButtonPaste", 0, REG_DWORD, (LPBYTE)&dwValue, sizeof(DWORD));
-        dwValue = settings.middleButtonReplaceAll ? 1 : 0;
-        RegSetValueExW(hKey, L"MiddleButtonReplaceAll", 0, REG_DWORD, (LPBYTE)&dwValue, sizeof(DWORD));
-        dwValue = settings.transparency;
-        RegSetValueExW(hKey, L"Transparency", 0, REG_DWORD, (LPBYTE)&dwValue, sizeof(DWORD));
-        dwValue = settings.autoCopyHotkey.ctrl ? 1 : 0;
-        RegSetValueExW(hKey, L"AutoCopyCtrl", 0, REG_DWORD, (LPBYTE)&dwValue, sizeof(DWORD));
-        dwValue = settings.autoCopyHotkey.shift ? 1 : 0;
-        RegSetValueExW(hKey, L"AutoCopyShift", 0, REG_DWORD, (LPBYTE)&dwValue, sizeof(DWORD));
-        dwValue = settings.autoCopyHotkey.alt ? 1 : 0;
-        RegSetValueExW(hKey, L"AutoCopyAlt", 0, REG_DWORD, (LPBYTE)&dwValue, sizeof(DWORD));
-        dwValue = settings.autoCopyHotkey.win ? 1 : 0;
-        RegSetValueExW(hKey, L"AutoCopyWin", 0, REG_DWORD, (LPBYTE)&dwValue, sizeof(DWORD));
-        dwValue = settings.autoCopyHotkey.vkCode;
-        RegSetValueExW(hKey, L"AutoCopyKey", 0, REG_DWORD, (LPBYTE)&dwValue, sizeof(DWORD));
-        dwValue = settings.autoDeleteHotkey.ctrl ? 1 : 0;
-        RegSetValueExW(hKey, L"AutoDeleteCtrl", 0, REG_DWORD, (LPBYTE)&dwValue, sizeof(DWORD));
-        dwValue = settings.autoDeleteHotkey.shift ? 1 : 0;
-        RegSetValueExW(hKey, L"AutoDeleteShift", 0, REG_DWORD, (LPBYTE)&dwValue, sizeof(DWORD));
-        dwValue = settings.autoDeleteHotkey.alt ? 1 : 0;
-        RegSetValueExW(hKey, L"AutoDeleteAlt", 0, REG_DWORD, (LPBYTE)&dwValue, sizeof(DWORD));
-        dwValue = settings.autoDeleteHotkey.win ? 1 : 0;
-        RegSetValueExW(hKey, L"AutoDeleteWin", 0, REG_DWORD, (LPBYTE)&dwValue, sizeof(DWORD));
-        dwValue = settings.autoDeleteHotkey.vkCode;
-        RegSetValueExW(hKey, L"AutoDeleteKey", 0, REG_DWORD, (LPBYTE)&dwValue, sizeof(DWORD));
-        dwValue = settings.textSize;
-        RegSetValueExW(hKey, L"TextSize", 0, REG_DWORD, (LPBYTE)&dwValue, sizeof(DWORD));
-        dwValue = settings.textColor;
-        RegSetValueExW(hKey, L"TextColor", 0, REG_DWORD, (LPBYTE)&dwValue, sizeof(DWORD));
-        dwValue = settings.bgColor;
-        RegSetValueExW(hKey, L"BgColor", 0, REG_DWORD, (LPBYTE)&dwValue, sizeof(DWORD));
-        dwValue = settings.selectedBgColor;
-        RegSetValueExW(hKey, L"SelectedBgColor", 0, REG_DWORD, (LPBYTE)&dwValue, sizeof(DWORD));
-        RegCloseKey(hKey);
-    }
+    std::vector<uint8_t> blob = SerializeSettings(settings);
+    RegSetKeyValueW(HKEY_CURRENT_USER, SETTINGS_KEY, SETTINGS_VALUE, REG_BINARY, blob.data(), (DWORD)blob.size());
 }
 
 INT_PTR CALLBACK SettingsDialog::DialogProc(HWND hDlg, UINT message, WPARAM wParam, LPARAM lParam) {
@@ -342,6 +343,7 @@ void SettingsDialog::LoadSettingsToControls(HWND hDlg) {
     CheckDlgButton(hDlg, IDC_MIDDLE_BUTTON_PASTE, s_settings.middleButtonPaste ? BST_CHECKED : BST_UNCHECKED);
     CheckDlgButton(hDlg, IDC_MIDDLE_BUTTON_REPLACE_ALL, s_settings.middleButtonReplaceAll ? BST_CHECKED : BST_UNCHECKED);
     EnableWindow(GetDlgItem(hDlg, IDC_MIDDLE_BUTTON_REPLACE_ALL), IsDlgButtonChecked(hDlg, IDC_MIDDLE_BUTTON_PASTE) == BST_CHECKED);
+    CheckDlgButton(hDlg, IDC_INCREMENTAL_PASTE, s_settings.incrementalPaste ? BST_CHECKED : BST_UNCHECKED);
     SendDlgItemMessageW(hDlg, IDC_TEXTSIZE_SLIDER, TBM_SETPOS, TRUE, s_settings.textSize);
     SetDlgItemInt(hDlg, IDC_TEXTSIZE_VALUE, s_settings.textSize, FALSE);
     InvalidateRect(GetDlgItem(hDlg, IDC_TEXT_COLOR_PICKER), nullptr, TRUE);
@@ -368,6 +370,7 @@ void SettingsDialog::SaveControlsToSettings(HWND hDlg) {
     if (keyText[0]) s_settings.autoDeleteHotkey.vkCode = (UINT)towupper(keyText[0]);
     s_settings.middleButtonPaste = (IsDlgButtonChecked(hDlg, IDC_MIDDLE_BUTTON_PASTE) == BST_CHECKED);
     s_settings.middleButtonReplaceAll = (IsDlgButtonChecked(hDlg, IDC_MIDDLE_BUTTON_REPLACE_ALL) == BST_CHECKED);
+    s_settings.incrementalPaste = (IsDlgButtonChecked(hDlg, IDC_INCREMENTAL_PASTE) == BST_CHECKED);
     s_settings.textSize = (int)SendDlgItemMessageW(hDlg, IDC_TEXTSIZE_SLIDER, TBM_GETPOS, 0, 0);
 }
 
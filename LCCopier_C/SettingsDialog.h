@@ -1,28 +1,6 @@
 #pragma once
 #include <Windows.h>
-
-struct HotkeyConfig {
-    bool ctrl;
-    bool shift;
-    bool alt;
-    bool win;
-    UINT vkCode;
-};
-
-struct AppSettings {
-    bool darkMode;
-    bool setTop;
-    bool setInvisible;
-    bool middleButtonPaste;
-    bool middleButtonReplaceAll;
-    int transparency;
-    HotkeyConfig autoCopyHotkey;
-    HotkeyConfig autoDeleteHotkey;
-    int textSize;
-    COLORREF textColor;
-    COLORREF bgColor;
-    COLORREF selectedBgColor;
-};
+#include "AppSettings.h"
 
 struct ToggleButtonStyle {
     const wchar_t* textOff;
@@ -37,13 +15,18 @@ class SettingsDialog {
 public:
     static void Show(HWND hParent);
     static void Close();
+    // Reads the registry and refreshes the cached copy.
     static AppSettings LoadSettings();
+    // Cached settings for hot paths (painting, highlighting): no registry access.
+    static const AppSettings& Current();
     static void SaveSettings(const AppSettings& settings);
 
 private:
     static HWND s_hDlg;
     static HWND s_hParent;
     static AppSettings s_settings;
+    static AppSettings s_current;
+    static bool s_currentLoaded;
     static int s_originalTransparency;
 
     static INT_PTR CALLBACK DialogProc(HWND hDlg, UINT message, WPARAM wParam, LPARAM lParam);
@@ -58,7 +41,8 @@ private:
     static ToggleButtonStyle GetToggleButtonStyle(int controlId);
 
     static AppSettings GetDefaultSettings();
-    static void LoadFromRegistry(AppSettings& settings);
+    static bool LoadFromRegistry(AppSettings& settings, bool& present);
+    static bool LoadLegacyValues(AppSettings& settings);
     static void SaveToRegistry(const AppSettings& settings);
 };
 
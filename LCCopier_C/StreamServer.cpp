@@ -0,0 +1,407 @@
+#include "StreamServer.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#ifdef _WIN32
+#include <Windows.h>
+#include <sddl.h>
+#pragma comment(lib, "Advapi32.lib")
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+#endif
+
+namespace {
+
+#ifdef _WIN32
+typedef HANDLE StopSignal;  // manual-reset event
+struct Connection {
+	HANDLE pipe = INVALID_HANDLE_VALUE;
+	HANDLE ioEvent = nullptr;
+};
+#else
+typedef int StopSignal;     // read end of a pipe that becomes readable on stop
+struct Connection {
+	int fd = -1;
+};
+#endif
+
+#ifdef _WIN32
+// One overlapped transfer that gives up on stop or after timeoutMs.
+bool Transfer(Connection& c, StopSignal stop, bool write, void* data, DWORD size, DWORD timeoutMs, DWORD& done) {
+	done = 0;
+	OVERLAPPED ov = {};
+	ov.hEvent = c.ioEvent;
+	BOOL ok = write ? WriteFile(c.pipe, data, size, nullptr, &ov) : ReadFile(c.pipe, data, size, nullptr, &ov);
+	if (!ok && GetLastError() != ERROR_IO_PENDING) return false;
+	HANDLE handles[2] = { c.ioEvent, stop };
+	if (WaitForMultipleObjects(2, handles, FALSE, timeoutMs) != WAIT_OBJECT_0) {
+		CancelIoEx(c.pipe, &ov);
+		GetOverlappedResult(c.pipe, &ov, &done, TRUE);
+		done = 0;
+		return false;
+	}
+	return GetOverlappedResult(c.pipe, &ov, &done, FALSE) != FALSE;
+}
+
+bool ReadSome(Connection& c, StopSignal stop, char* data, size_t size, uint32_t timeoutMs, size_t& got) {
+	DWORD done = 0;
+	bool ok = Transfer(c, stop, false, data, (DWORD)size, timeoutMs, done);
+	got = done;
+	return ok && done > 0;
+}
+
+bool WriteAll(Connection& c, StopSignal stop, const std::string& data) {
+	size_t sent = 0;
+	while (sent < data.size()) {
+		DWORD done = 0;
+		if (!Transfer(c, stop, true, (void*)(data.data() + sent), (DWORD)(data.size() - sent), INFINITE, done) || !done) return false;
+		sent += done;
+	}
+	return true;
+}
+
+void CloseConnection(Connection& c) {
+	if (c.pipe != INVALID_HANDLE_VALUE) CloseHandle(c.pipe);
+	if (c.ioEvent) CloseHandle(c.ioEvent);
+	c.pipe = INVALID_HANDLE_VALUE;
+	c.ioEvent = nullptr;
+}
+
+// A DACL for the current user and SYSTEM only: the default one also lets
+// other local accounts read the transcript. LocalFree when done.
+PSECURITY_DESCRIPTOR CreateOwnerOnlyDescriptor() {
+	HANDLE token = nullptr;
+	if (!OpenProcessToken(GetCurrentProcess(), TOKEN_QUERY, &token)) return nullptr;
+	DWORD size = 0;
+	GetTokenInformation(token, TokenUser, nullptr, 0, &size);
+	std::vector<BYTE> user(size);
+	LPWSTR sid = nullptr;
+	if (size && GetTokenInformation(token, TokenUser, user.data(), size, &size)) {
+		ConvertSidToStringSidW(reinterpret_cast<TOKEN_USER*>(user.data())->User.Sid, &sid);
+	}
+	CloseHandle(token);
+	if (!sid) return nullptr;
+	std::wstring sddl = L"D:P(A;;GA;;;SY)(A;;GA;;;" + std::wstring(sid) + L")";
+	LocalFree(sid);
+	PSECURITY_DESCRIPTOR descriptor = nullptr;
+	if (!ConvertStringSecurityDescriptorToSecurityDescriptorW(sddl.c_str(), SDDL_REVISION_1, &descriptor, nullptr)) return nullptr;
+	return descriptor;
+}
+
+HANDLE CreatePipeInstance(const std::wstring& name, bool first, PSECURITY_DESCRIPTOR security) {
+	SECURITY_ATTRIBUTES attributes = { sizeof(attributes), security, FALSE };
+	return CreateNamedPipeW(name.c_str(),
+		PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED | (first ? FILE_FLAG_FIRST_PIPE_INSTANCE : 0),
+		PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+		PIPE_UNLIMITED_INSTANCES, 64 * 1024, STREAM_HELLO_MAX, 0, &attributes);
+}
+#else
+// Wait until fd is ready for events; false on stop, timeout or error.
+bool WaitReady(int fd, StopSignal stop, short events, int timeoutMs) {
+	for (;;) {
+		pollfd fds[2] = { { fd, events, 0 }, { stop, POLLIN, 0 } };
+		int n = poll(fds, 2, timeoutMs);
+		if (n < 0 && errno == EINTR) continue;
+		return n > 0 && !fds[1].revents && (fds[0].revents & events);
+	}
+}
+
+bool ReadSome(Connection& c, StopSignal stop, char* data, size_t size, uint32_t timeoutMs, size_t& got) {
+	got = 0;
+	if (!WaitReady(c.fd, stop, POLLIN, (int)timeoutMs)) return false;
+	ssize_t n = recv(c.fd, data, size, 0);
+	if (n <= 0) return false;
+	got = (size_t)n;
+	return true;
+}
+
+bool WriteAll(Connection& c, StopSignal stop, const std::string& data) {
+	size_t sent = 0;
+	while (sent < data.size()) {
+		ssize_t n = send(c.fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+		if (n > 0) {
+			sent += (size_t)n;
+			continue;
+		}
+		if (n < 0 && errno == EINTR) continue;
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && WaitReady(c.fd, stop, POLLOUT, -1)) continue;
+		return false;
+	}
+	return true;
+}
+
+void CloseConnection(Connection& c) {
+	if (c.fd >= 0) close(c.fd);
+	c.fd = -1;
+}
+#endif
+
+// "resume <session> <seq> <offset>" within the hello timeout; anything else
+// means start from scratch.
+void ReadHello(Connection& c, StopSignal stop, uint64_t& session, uint64_t& seq, size_t& offset) {
+	char line[STREAM_HELLO_MAX + 1];
+	size_t length = 0;
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(STREAM_HELLO_TIMEOUT_MS);
+	while (length < STREAM_HELLO_MAX && !memchr(line, '\n', length)) {
+		auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+		size_t got = 0;
+		if (left <= 0 || !ReadSome(c, stop, line + length, STREAM_HELLO_MAX - length, (uint32_t)left, got)) break;
+		length += got;
+	}
+	line[length] = '\0';
+	unsigned long long s = 0, q = 0, o = 0;
+	if (sscanf(line, "resume %llu %llu %llu", &s, &q, &o) == 3) {
+		session = s;
+		seq = q;
+		offset = (size_t)o;
+	}
+}
+
+}  // namespace
+
+struct StreamServer::Platform {
+#ifdef _WIN32
+	std::wstring pipeName;
+	HANDLE stopEvent = nullptr;
+	HANDLE firstPipe = INVALID_HANDLE_VALUE;  // created by Start so a second server fails there
+	PSECURITY_DESCRIPTOR security = nullptr;  // every pipe instance gets it
+	StopSignal Stop() const { return stopEvent; }
+#else
+	std::string path;
+	int listenFd = -1;
+	int stopPipe[2] = { -1, -1 };
+	StopSignal Stop() const { return stopPipe[0]; }
+#endif
+};
+
+struct StreamServer::Client {
+	Connection connection;
+	std::thread thread;
+	std::atomic<bool> done{ false };
+	std::shared_ptr<StreamSubscription> subscription;  // guarded by m_clientsLock
+};
+
+StreamServer::StreamServer(CaptionStream& stream) : m_stream(stream) {
+}
+
+StreamServer::~StreamServer() {
+	Stop();
+}
+
+bool StreamServer::Start(const std::string& endpoint) {
+	if (Running()) return true;
+	auto platform = std::make_unique<Platform>();
+#ifdef _WIN32
+	int chars = MultiByteToWideChar(CP_UTF8, 0, endpoint.c_str(), (int)endpoint.size(), nullptr, 0);
+	platform->pipeName.resize(chars > 0 ? chars : 0);
+	if (chars > 0) MultiByteToWideChar(CP_UTF8, 0, endpoint.c_str(), (int)endpoint.size(), &platform->pipeName[0], chars);
+	platform->security = CreateOwnerOnlyDescriptor();
+	if (!platform->security) return false;
+	platform->firstPipe = CreatePipeInstance(platform->pipeName, true, platform->security);
+	if (platform->firstPipe == INVALID_HANDLE_VALUE) {
+		LocalFree(platform->security);
+		return false;
+	}
+	platform->stopEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+	if (!platform->stopEvent) {
+		CloseHandle(platform->firstPipe);
+		LocalFree(platform->security);
+		return false;
+	}
+#else
+	sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+	if (endpoint.empty() || endpoint.size() >= sizeof(addr.sun_path)) return false;
+	memcpy(addr.sun_path, endpoint.c_str(), endpoint.size());
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) return false;
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+	// A socket file left behind by a crashed server is replaced; a live one is
+	// not, and neither is anything else at the path (a mistyped --serve).
+	struct stat existing;
+	if (lstat(endpoint.c_str(), &existing) == 0) {
+		if (!S_ISSOCK(existing.st_mode) || connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0) {
+			close(fd);
+			return false;
+		}
+		unlink(endpoint.c_str());
+	}
+	bool bound = bind(fd, (sockaddr*)&addr, sizeof(addr)) == 0;
+	if (!bound || chmod(endpoint.c_str(), 0600) != 0 || listen(fd, STREAM_MAX_SUBSCRIBERS) != 0 || pipe(platform->stopPipe) != 0) {
+		close(fd);
+		if (bound) unlink(endpoint.c_str());
+		return false;
+	}
+	platform->path = endpoint;
+	platform->listenFd = fd;
+#endif
+	m_platform = std::move(platform);
+	m_stopping = false;
+	m_acceptThread = std::thread(&StreamServer::AcceptLoop, this);
+	return true;
+}
+
+void StreamServer::Stop() {
+	if (!Running()) return;
+	{
+		std::lock_guard<std::mutex> lock(m_clientsLock);
+		m_stopping = true;
+		for (auto& client : m_clients) {
+			if (client->subscription) client->subscription->Close();
+		}
+	}
+#ifdef _WIN32
+	SetEvent(m_platform->stopEvent);
+#else
+	char wake = 1;
+	while (write(m_platform->stopPipe[1], &wake, 1) < 0 && errno == EINTR) {}
+#endif
+	m_acceptThread.join();
+	// Every blocking call in a client thread also waits on the stop signal.
+	for (auto& client : m_clients) {
+		if (client->thread.joinable()) client->thread.join();
+	}
+	m_clients.clear();
+#ifdef _WIN32
+	if (m_platform->firstPipe != INVALID_HANDLE_VALUE) CloseHandle(m_platform->firstPipe);
+	CloseHandle(m_platform->stopEvent);
+	LocalFree(m_platform->security);
+#else
+	close(m_platform->listenFd);
+	close(m_platform->stopPipe[0]);
+	close(m_platform->stopPipe[1]);
+	unlink(m_platform->path.c_str());
+#endif
+	m_platform.reset();
+}
+
+void StreamServer::ReapFinished() {
+	std::lock_guard<std::mutex> lock(m_clientsLock);
+	for (auto it = m_clients.begin(); it != m_clients.end();) {
+		if ((*it)->done.load()) {
+			(*it)->thread.join();
+			it = m_clients.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+}
+
+void StreamServer::AcceptLoop() {
+	auto launch = [this](Connection& connection) {
+		ReapFinished();
+		std::lock_guard<std::mutex> lock(m_clientsLock);
+		if (m_stopping) {
+			CloseConnection(connection);
+			return;
+		}
+		m_clients.push_back(std::make_unique<Client>());
+		Client* client = m_clients.back().get();
+		client->connection = connection;
+		client->thread = std::thread(&StreamServer::Serve, this, client);
+	};
+#ifdef _WIN32
+	HANDLE pipe = m_platform->firstPipe;
+	m_platform->firstPipe = INVALID_HANDLE_VALUE;
+	HANDLE connectEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+	while (connectEvent) {
+		if (pipe == INVALID_HANDLE_VALUE) pipe = CreatePipeInstance(m_platform->pipeName, false, m_platform->security);
+		if (pipe == INVALID_HANDLE_VALUE) {
+			// Out of resources; try again later unless we are stopping.
+			if (WaitForSingleObject(m_platform->stopEvent, 1000) == WAIT_OBJECT_0) break;
+			continue;
+		}
+		OVERLAPPED ov = {};
+		ov.hEvent = connectEvent;
+		bool connected = ConnectNamedPipe(pipe, &ov) != FALSE;
+		DWORD error = GetLastError();
+		DWORD unused = 0;
+		if (!connected && error == ERROR_PIPE_CONNECTED) {
+			connected = true;
+		}
+		else if (!connected && error == ERROR_IO_PENDING) {
+			HANDLE handles[2] = { connectEvent, m_platform->stopEvent };
+			if (WaitForMultipleObjects(2, handles, FALSE, INFINITE) != WAIT_OBJECT_0) {
+				CancelIoEx(pipe, &ov);
+				GetOverlappedResult(pipe, &ov, &unused, TRUE);
+				break;
+			}
+			connected = GetOverlappedResult(pipe, &ov, &unused, FALSE) != FALSE;
+		}
+		if (connected) {
+			Connection connection;
+			connection.pipe = pipe;
+			connection.ioEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+			if (connection.ioEvent) launch(connection);
+			else CloseConnection(connection);
+		}
+		else {
+			CloseHandle(pipe);
+		}
+		pipe = INVALID_HANDLE_VALUE;
+	}
+	if (pipe != INVALID_HANDLE_VALUE) CloseHandle(pipe);
+	if (connectEvent) CloseHandle(connectEvent);
+#else
+	for (;;) {
+		pollfd fds[2] = { { m_platform->listenFd, POLLIN, 0 }, { m_platform->stopPipe[0], POLLIN, 0 } };
+		if (poll(fds, 2, -1) < 0) {
+			if (errno == EINTR) continue;
+			break;
+		}
+		if (fds[1].revents) break;
+		if (!(fds[0].revents & POLLIN)) continue;
+		Connection connection;
+		connection.fd = accept(m_platform->listenFd, nullptr, nullptr);
+		if (connection.fd < 0) continue;
+		fcntl(connection.fd, F_SETFD, FD_CLOEXEC);
+		fcntl(connection.fd, F_SETFL, fcntl(connection.fd, F_GETFL) | O_NONBLOCK);
+		launch(connection);
+	}
+#endif
+}
+
+void StreamServer::Serve(Client* client) {
+	Connection& connection = client->connection;
+	StopSignal stop = m_platform->Stop();
+	uint64_t session = 0, seq = 0;
+	size_t offset = 0;
+	ReadHello(connection, stop, session, seq, offset);
+
+	std::shared_ptr<StreamSubscription> subscription;
+	{
+		std::lock_guard<std::mutex> lock(m_clientsLock);
+		if (!m_stopping) {
+			subscription = m_stream.Subscribe(session, seq, offset);
+			client->subscription = subscription;
+		}
+	}
+	if (subscription) {
+		std::vector<StreamFrame> frames;
+		std::string out;
+		while (subscription->Wait(frames, STREAM_KEEPALIVE_MS)) {
+			out.clear();
+			if (frames.empty()) out = "\n";
+			for (const StreamFrame& frame : frames) CaptionStream::EncodeFrame(frame, m_stream.Session(), out);
+			frames.clear();
+			if (!WriteAll(connection, stop, out)) break;
+		}
+		m_stream.Unsubscribe(subscription);
+	}
+	else {
+		WriteAll(connection, stop, "{\"error\":\"busy\"}\n");
+	}
+	CloseConnection(connection);
+	client->done.store(true);
+}
@@ -0,0 +1,50 @@
+#pragma once
+// Local IPC endpoint for CaptionStream: a named pipe on Windows, a Unix domain
+// socket elsewhere. One thread accepts connections and one thread per client
+// writes to it, so every blocking call stays off the caption thread.
+//
+// Protocol: right after connecting a client may send one line,
+//   resume <session> <seq> <offset>\n
+// taken from the last frame it processed, to continue a transcript it
+// already has; without it (or after STREAM_HELLO_TIMEOUT_MS) the client gets
+// the whole transcript. The server then writes JSON lines as described in
+// CaptionStream::EncodeFrame. An empty line is a keepalive.
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "CaptionStream.h"
+
+#define STREAM_PIPE_NAME          "\\\\.\\pipe\\LCCopier.Captions"
+#define STREAM_HELLO_TIMEOUT_MS   500
+#define STREAM_KEEPALIVE_MS       15000
+#define STREAM_HELLO_MAX          128   // bytes of the resume line
+
+class StreamServer {
+public:
+	explicit StreamServer(CaptionStream& stream);
+	~StreamServer();
+
+	// endpoint: pipe name on Windows, socket path elsewhere (UTF-8).
+	// Fails if the endpoint is already served, e.g. by another instance.
+	bool Start(const std::string& endpoint);
+	void Stop();
+	bool Running() const { return m_acceptThread.joinable(); }
+
+private:
+	struct Platform;
+	struct Client;
+
+	void AcceptLoop();
+	void Serve(Client* client);
+	void ReapFinished();
+
+	CaptionStream& m_stream;
+	std::unique_ptr<Platform> m_platform;
+	std::thread m_acceptThread;
+	std::mutex m_clientsLock;
+	bool m_stopping = false;  // guarded by m_clientsLock
+	std::list<std::unique_ptr<Client>> m_clients;
+};
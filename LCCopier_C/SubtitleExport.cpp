@@ -0,0 +1,206 @@
+#include "SubtitleExport.h"
+#include "CaptionText.h"
+#include <algorithm>
+#include <cstdio>
+#include <cwctype>
+
+static const uint64_t kNoNextCue = UINT64_MAX;
+
+static bool IsSentenceEnd(wchar_t ch) {
+	return ch == L'.' || ch == L'?' || ch == L'!';
+}
+
+static void AppendTimestamp(std::string& out, uint64_t ms, char fractionSeparator) {
+	char text[32];
+	snprintf(text, sizeof(text), "%02llu:%02llu:%02llu%c%03llu",
+		(unsigned long long)(ms / 3600000), (unsigned long long)(ms / 60000 % 60),
+		(unsigned long long)(ms / 1000 % 60), fractionSeparator, (unsigned long long)(ms % 1000));
+	out += text;
+}
+
+// Cue text in WebVTT is markup: &, < and > must be escaped.
+static void AppendEscapedVtt(std::string& out, const std::string& text) {
+	for (char ch : text) {
+		if (ch == '&') out += "&amp;";
+		else if (ch == '<') out += "&lt;";
+		else if (ch == '>') out += "&gt;";
+		else out += ch;
+	}
+}
+
+SubtitleExporter::SubtitleExporter() : m_vtt("WEBVTT\n\n") {
+}
+
+void SubtitleExporter::OnEdit(const HistoryEdit& edit, const std::wstring& history, uint64_t nowMs) {
+	if (edit.Empty()) return;
+	if (!m_started) {
+		m_started = true;
+		m_baseMs = nowMs;
+	}
+	size_t offset = edit.offset;
+	if (offset < m_committed) {
+		// Exported text was rewritten (history cleared or re-anchored). Cues
+		// cannot be taken back, so only what lies beyond them is exported.
+		m_committed = (std::min)(m_committed, history.size());
+		m_regions.clear();
+		if (m_committed < history.size()) m_regions.push_back(Region{ m_committed, nowMs, nowMs });
+		return;
+	}
+	// A rewrite keeps the time of the text it replaces: the words were spoken
+	// then, the recognizer only changed its mind about them later.
+	uint64_t seen = nowMs;
+	bool replacedRegionStart = false;
+	while (!m_regions.empty() && m_regions.back().offset >= offset) {
+		seen = m_regions.back().seenMs;
+		replacedRegionStart = m_regions.back().offset == offset;
+		m_regions.pop_back();
+	}
+	if (!edit.removed) seen = nowMs;
+	else if (!replacedRegionStart && !m_regions.empty()) seen = m_regions.back().seenMs;
+	if (offset < history.size()) m_regions.push_back(Region{ offset, seen, nowMs });
+}
+
+void SubtitleExporter::OnPrepend(size_t units) {
+	m_committed += units;
+	for (Region& region : m_regions) region.offset += units;
+}
+
+void SubtitleExporter::OnTick(const std::wstring& history, uint64_t nowMs) {
+	if (!m_started) return;
+	size_t frontier = history.size();
+	for (const Region& region : m_regions) {
+		if (nowMs - region.touchedMs < SUBTITLE_STABLE_MS) {
+			frontier = region.offset;
+			break;
+		}
+	}
+	// Never cut a word that is still being revised.
+	if (frontier < history.size()) {
+		while (frontier > m_committed && !std::iswspace(history[frontier - 1])) frontier--;
+	}
+	if (frontier > m_committed) Commit(history, frontier, nowMs);
+	// Anything still to come is newer than now, so a long enough pause ends the cue.
+	if (!m_cueText.empty() && m_regions.empty() && nowMs - m_baseMs >= m_lastWordMs + SUBTITLE_GAP_MS) {
+		CloseCue(kNoNextCue);
+	}
+}
+
+void SubtitleExporter::Finish(const std::wstring& history, uint64_t nowMs) {
+	if (!m_started) return;
+	if (history.size() > m_committed) Commit(history, history.size(), nowMs);
+	if (!m_cueText.empty()) CloseCue(kNoNextCue);
+}
+
+void SubtitleExporter::Commit(const std::wstring& history, size_t end, uint64_t nowMs) {
+	size_t r = 0;
+	auto timeAt = [&](size_t pos) -> uint64_t {
+		if (m_regions.empty()) return nowMs - m_baseMs;
+		while (r + 1 < m_regions.size() && m_regions[r + 1].offset <= pos) r++;
+		const Region& region = m_regions[r];
+		uint64_t t = region.seenMs;
+		// Spread the words of one region over the time until the next one.
+		if (r + 1 < m_regions.size()) {
+			const Region& next = m_regions[r + 1];
+			if (next.seenMs > t && pos > region.offset) {
+				t += (next.seenMs - t) * (pos - region.offset) / (next.offset - region.offset);
+			}
+		}
+		return t - m_baseMs;
+	};
+	size_t pos = m_committed;
+	while (pos < end) {
+		while (pos < end && std::iswspace(history[pos])) pos++;
+		size_t start = pos;
+		while (pos < end && !std::iswspace(history[pos])) pos++;
+		if (pos > start) AddWord(history, start, pos - start, timeAt(start));
+	}
+	m_committed = end;
+	while (m_regions.size() > 1 && m_regions[1].offset <= end) m_regions.pop_front();
+	if (!m_regions.empty() && m_regions.front().offset < end) m_regions.front().offset = end;
+	if (!m_regions.empty() && m_regions.front().offset >= history.size()) m_regions.pop_front();
+}
+
+void SubtitleExporter::AddWord(const std::wstring& history, size_t start, size_t length, uint64_t timeMs) {
+	if (timeMs < m_lastWordMs) timeMs = m_lastWordMs;
+	if (!m_cueText.empty()) {
+		bool sentenceDone = IsSentenceEnd(m_cueText.back()) && m_cueText.size() >= SUBTITLE_SENTENCE_MIN_CHARS;
+		// The cue may start later than its first word when the previous one was held up.
+		uint64_t cueMs = timeMs > m_cueStartMs ? timeMs - m_cueStartMs : 0;
+		if (sentenceDone || timeMs - m_lastWordMs >= SUBTITLE_GAP_MS || cueMs >= SUBTITLE_MAX_MS ||
+			m_cueText.size() + 1 + length > SUBTITLE_MAX_CHARS) {
+			CloseCue(timeMs);
+		}
+	}
+	if (m_cueText.empty()) {
+		m_cueStartMs = (std::max)(timeMs, m_lastEndMs);
+	}
+	else {
+		m_cueText += L' ';
+	}
+	m_cueText.append(history, start, length);
+	m_lastWordMs = timeMs;
+}
+
+void SubtitleExporter::CloseCue(uint64_t nextStartMs) {
+	uint64_t end = m_lastWordMs + SUBTITLE_LINGER_MS;
+	if (nextStartMs < end) end = nextStartMs;
+	if (end > m_cueStartMs + SUBTITLE_MAX_MS) end = m_cueStartMs + SUBTITLE_MAX_MS;
+	if (end < m_cueStartMs + SUBTITLE_MIN_MS) end = m_cueStartMs + SUBTITLE_MIN_MS;
+	m_lastEndMs = end;
+
+	// Two lines, broken at the space closest to the middle.
+	size_t lineBreak = std::wstring::npos;
+	if (m_cueText.size() > SUBTITLE_LINE_CHARS) {
+		size_t middle = m_cueText.size() / 2;
+		for (size_t d = 0; d <= middle && lineBreak == std::wstring::npos; d++) {
+			if (middle + d < m_cueText.size() && m_cueText[middle + d] == L' ') lineBreak = middle + d;
+			else if (m_cueText[middle - d] == L' ') lineBreak = middle - d;
+		}
+	}
+	std::string& first = m_lines[0];
+	std::string& second = m_lines[1];
+	first.clear();
+	second.clear();
+	AppendUtf8(first, m_cueText, 0, lineBreak);
+	if (lineBreak != std::wstring::npos) AppendUtf8(second, m_cueText, lineBreak + 1);
+
+	m_cueCount++;
+	char index[24];
+	snprintf(index, sizeof(index), "%llu\r\n", (unsigned long long)m_cueCount);
+	m_srt += index;
+	AppendTimestamp(m_srt, m_cueStartMs, ',');
+	m_srt += " --> ";
+	AppendTimestamp(m_srt, end, ',');
+	m_srt += "\r\n";
+	m_srt += first;
+	m_srt += "\r\n";
+	if (!second.empty()) {
+		m_srt += second;
+		m_srt += "\r\n";
+	}
+	m_srt += "\r\n";
+
+	AppendTimestamp(m_vtt, m_cueStartMs, '.');
+	m_vtt += " --> ";
+	AppendTimestamp(m_vtt, end, '.');
+	m_vtt += "\n";
+	AppendEscapedVtt(m_vtt, first);
+	m_vtt += "\n";
+	if (!second.empty()) {
+		AppendEscapedVtt(m_vtt, second);
+		m_vtt += "\n";
+	}
+	m_vtt += "\n";
+
+	m_cueText.clear();
+}
+
+void SubtitleExporter::TakeSrt(std::string& out) {
+	out += m_srt;
+	m_srt.clear();
+}
+
+void SubtitleExporter::TakeVtt(std::string& out) {
+	out += m_vtt;
+	m_vtt.clear();
+}
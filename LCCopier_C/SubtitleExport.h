@@ -0,0 +1,69 @@
+#pragma once
+// Portable subtitle export: turns the merged transcript into timed SRT and
+// WebVTT cues while the session runs. Fed with every HistoryEdit and a poll
+// tick; text that has not been rewritten for SUBTITLE_STABLE_MS is final and
+// is cut into cues. Memory is bounded by the not-yet-final tail and one open
+// cue, whatever the session length. Output is UTF-8, taken by the caller.
+// Once its buffers have grown to their working size, feeding it does not
+// allocate.
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "CaptionMerge.h"
+#include "RingQueue.h"
+
+#define SUBTITLE_STABLE_MS            3000  // unchanged this long: no more revisions expected
+#define SUBTITLE_MAX_CHARS            84    // per cue (two lines)
+#define SUBTITLE_LINE_CHARS           42    // longer cues are broken into two lines
+#define SUBTITLE_MAX_MS               6000  // per cue
+#define SUBTITLE_MIN_MS               1000  // a cue stays up at least this long
+#define SUBTITLE_GAP_MS               1500  // a pause this long ends the cue
+#define SUBTITLE_LINGER_MS            1500  // last cue before a pause stays up this long
+#define SUBTITLE_SENTENCE_MIN_CHARS   16    // a sentence end closes cues at least this long
+
+class SubtitleExporter {
+public:
+	SubtitleExporter();
+
+	// nowMs: any monotonic clock; cue times are relative to the first edit.
+	void OnEdit(const HistoryEdit& edit, const std::wstring& history, uint64_t nowMs);
+	// Once per poll tick: finalizes stable text and closes cues after a pause.
+	void OnTick(const std::wstring& history, uint64_t nowMs);
+	// units of earlier text were put in front of the history (a clear was
+	// undone); its cues were exported before the clear.
+	void OnPrepend(size_t units);
+	// End of session: everything left becomes cues.
+	void Finish(const std::wstring& history, uint64_t nowMs);
+
+	// Formatted output produced since the last call (appended to out).
+	void TakeSrt(std::string& out);
+	void TakeVtt(std::string& out);
+
+	uint64_t CueCount() const { return m_cueCount; }
+
+private:
+	// A run of uncommitted history that arrived in one edit.
+	struct Region {
+		size_t offset;
+		uint64_t seenMs;     // when this text (or the text it replaced) first appeared
+		uint64_t touchedMs;  // last time it was rewritten
+	};
+
+	void Commit(const std::wstring& history, size_t end, uint64_t nowMs);
+	void AddWord(const std::wstring& history, size_t start, size_t length, uint64_t timeMs);
+	void CloseCue(uint64_t nextStartMs);
+
+	bool m_started = false;
+	uint64_t m_baseMs = 0;
+	size_t m_committed = 0;          // history before this offset has been exported
+	RingQueue<Region> m_regions;     // cover [m_committed, history end)
+
+	std::wstring m_cueText;
+	uint64_t m_cueStartMs = 0;
+	uint64_t m_lastWordMs = 0;
+	uint64_t m_lastEndMs = 0;
+	uint64_t m_cueCount = 0;
+	std::string m_srt;
+	std::string m_vtt;
+	std::string m_lines[2];          // the closing cue's lines, UTF-8
+};
@@ -0,0 +1,167 @@
+#include "TaskScheduler.h"
+#include <algorithm>
+#include <cwchar>
+
+// Lane of the worker running on this thread, for tasks posted from inside the
+// pool; such tasks stay on that worker unless another one steals them.
+static thread_local const TaskScheduler* t_scheduler = nullptr;
+static thread_local size_t t_lane = 0;
+
+TaskScheduler::TaskScheduler() {
+}
+
+TaskScheduler::~TaskScheduler() {
+	Stop();
+}
+
+bool TaskScheduler::Start(unsigned threads, const TaskFn& wake, const TaskFn& threadStart, const TaskFn& threadEnd) {
+	if (Running()) return true;
+	if (threads == 0) threads = (std::max)(1u, std::thread::hardware_concurrency());
+	threads = (std::min)(threads, (unsigned)TASK_MAX_THREADS);
+	m_wakeFn = wake;
+	m_threadStart = threadStart;
+	m_threadEnd = threadEnd;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_stopping = false;
+	}
+	m_lanes.clear();
+	for (unsigned i = 0; i < threads; i++) m_lanes.push_back(std::make_unique<Lane>());
+	for (unsigned i = 0; i < threads; i++) m_workers.emplace_back(&TaskScheduler::WorkerLoop, this, (size_t)i);
+	return true;
+}
+
+void TaskScheduler::Stop() {
+	if (!Running()) return;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_stopping = true;
+	}
+	m_wake.notify_all();
+	for (std::thread& worker : m_workers) worker.join();
+	m_workers.clear();
+}
+
+void TaskScheduler::Post(TaskPriority priority, TaskFn work, TaskFn done, const CancelToken& cancel) {
+	size_t p = (size_t)priority;
+	if (!Running()) {
+		// No pool (not started, or shutting down): run it here rather than lose it.
+		if (cancel.Cancelled()) {
+			m_cancelled++;
+			return;
+		}
+		work();
+		m_run[p]++;
+		if (done) Complete([done, cancel] { if (!cancel.Cancelled()) done(); });
+		return;
+	}
+	size_t lane = t_scheduler == this ? t_lane : m_nextLane++ % m_lanes.size();
+	{
+		std::lock_guard<std::mutex> lock(m_lanes[lane]->lock);
+		m_lanes[lane]->queues[p].push_back(Task{ std::move(work), std::move(done), cancel });
+		m_queued[p]++;
+	}
+	// Taking m_lock orders the count above before a sleeping worker's check.
+	{ std::lock_guard<std::mutex> lock(m_lock); }
+	m_wake.notify_one();
+}
+
+void TaskScheduler::SetIdle(bool idle) {
+	if (m_idle.exchange(idle) == idle || !idle) return;
+	{ std::lock_guard<std::mutex> lock(m_lock); }
+	m_wake.notify_all();
+}
+
+bool TaskScheduler::Runnable() const {
+	if (m_queued[(size_t)TaskPriority::High] || m_queued[(size_t)TaskPriority::Normal]) return true;
+	return m_queued[(size_t)TaskPriority::Idle] && (m_idle || m_stopping);
+}
+
+// Highest priority first: own lane (newest task), then the others' (oldest).
+bool TaskScheduler::Take(size_t lane, Task& task) {
+	for (size_t p = 0; p < TASK_PRIORITIES; p++) {
+		if (!m_queued[p]) continue;
+		if (p == (size_t)TaskPriority::Idle && !m_idle) {
+			std::lock_guard<std::mutex> lock(m_lock);
+			if (!m_stopping) continue;
+		}
+		for (size_t i = 0; i < m_lanes.size(); i++) {
+			Lane& from = *m_lanes[(lane + i) % m_lanes.size()];
+			std::lock_guard<std::mutex> lock(from.lock);
+			std::deque<Task>& queue = from.queues[p];
+			if (queue.empty()) continue;
+			if (i == 0) {
+				task = std::move(queue.back());
+				queue.pop_back();
+			}
+			else {
+				task = std::move(queue.front());
+				queue.pop_front();
+				m_stolen++;
+			}
+			m_queued[p]--;
+			m_run[p]++;
+			return true;
+		}
+	}
+	return false;
+}
+
+void TaskScheduler::WorkerLoop(size_t lane) {
+	t_scheduler = this;
+	t_lane = lane;
+	if (m_threadStart) m_threadStart();
+	for (;;) {
+		Task task;
+		if (Take(lane, task)) {
+			if (task.cancel.Cancelled()) {
+				m_cancelled++;
+				continue;
+			}
+			task.work();
+			if (task.done) {
+				TaskFn done = std::move(task.done);
+				CancelToken cancel = task.cancel;
+				Complete([done, cancel] { if (!cancel.Cancelled()) done(); });
+			}
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(m_lock);
+		if (Runnable()) continue;
+		if (m_stopping) break;
+		m_wake.wait(lock);
+	}
+	if (m_threadEnd) m_threadEnd();
+	t_scheduler = nullptr;
+}
+
+void TaskScheduler::Complete(TaskFn done) {
+	{
+		std::lock_guard<std::mutex> lock(m_completionLock);
+		m_completions.push_back(std::move(done));
+	}
+	if (!m_woken.exchange(true) && m_wakeFn) m_wakeFn();
+}
+
+size_t TaskScheduler::RunCompletions() {
+	// Cleared first: completions queued from here on wake the owner again.
+	m_woken = false;
+	std::vector<TaskFn> ready;
+	{
+		std::lock_guard<std::mutex> lock(m_completionLock);
+		ready.swap(m_completions);
+	}
+	for (TaskFn& done : ready) done();
+	return ready.size();
+}
+
+std::wstring TaskScheduler::Describe() const {
+	wchar_t line[256];
+	swprintf(line, 256, L"background tasks: %zu threads%ls, run %llu/%llu/%llu (high/normal/idle), %llu stolen, %llu cancelled, "
+		L"queued %zu/%zu/%zu\r\n",
+		m_workers.size(), m_idle ? L" (idle)" : L"",
+		(unsigned long long)m_run[0], (unsigned long long)m_run[1], (unsigned long long)m_run[2],
+		(unsigned long long)m_stolen, (unsigned long long)m_cancelled,
+		(size_t)m_queued[0], (size_t)m_queued[1], (size_t)m_queued[2]);
+	return line;
+}
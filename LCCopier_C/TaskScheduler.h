@@ -0,0 +1,157 @@
+#pragma once
+// Portable background task scheduler: a small worker pool for work that should
+// not run inside a WndProc handler (file writes, parsing, indexing, export).
+// Each worker has its own queues and steals from the others when it runs dry,
+// so bursts posted from one place spread over the pool. Three priority
+// classes; Idle tasks only run while the owner says it is idle.
+//
+// Results come back on the owner thread (the UI thread in the app): a task's
+// completion is queued and the wake function is called once per batch, which
+// in the app posts WM_APP_TASKS_DONE; the owner then calls RunCompletions.
+// With C++20 coroutines, a coroutine can hop between the pool and the owner
+// thread with co_await.
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#include <exception>
+#define TASK_COROUTINES 1
+#endif
+
+#define TASK_MAX_THREADS 8
+#define TASK_PRIORITIES  3
+
+enum class TaskPriority {
+	High,    // the owner is waiting for the result
+	Normal,
+	Idle,    // only while SetIdle(true); e.g. flushing buffered output
+};
+
+// Shared between the poster and the task. A task that has not started when
+// cancelled is dropped; a running one can poll Cancelled(). Either way its
+// completion does not run if the token is cancelled by then.
+class CancelToken {
+public:
+	CancelToken() : m_flag(std::make_shared<std::atomic<bool>>(false)) {}
+	void Cancel() { m_flag->store(true, std::memory_order_relaxed); }
+	bool Cancelled() const { return m_flag->load(std::memory_order_relaxed); }
+
+private:
+	std::shared_ptr<std::atomic<bool>> m_flag;
+};
+
+class TaskScheduler {
+public:
+	typedef std::function<void()> TaskFn;
+
+	TaskScheduler();
+	~TaskScheduler();
+
+	// threads 0: one per core, at most TASK_MAX_THREADS. wake is called on a
+	// worker when completions are waiting and the owner has not been woken yet.
+	bool Start(unsigned threads, const TaskFn& wake, const TaskFn& threadStart = nullptr, const TaskFn& threadEnd = nullptr);
+	// Runs everything still queued (Idle tasks too, cancelled ones excepted),
+	// then joins the workers. Completions are left for RunCompletions.
+	void Stop();
+	bool Running() const { return !m_workers.empty(); }
+
+	// work runs on a worker; done, if given, on the owner thread afterwards.
+	void Post(TaskPriority priority, TaskFn work, TaskFn done = nullptr, const CancelToken& cancel = CancelToken());
+	// work's result is handed to done on the owner thread.
+	template <class T>
+	void Submit(TaskPriority priority, std::function<T()> work, std::function<void(T&)> done, const CancelToken& cancel = CancelToken()) {
+		auto result = std::make_shared<std::optional<T>>();
+		Post(priority, [result, work] { result->emplace(work()); },
+			[result, done] { if (result->has_value()) done(**result); }, cancel);
+	}
+
+	// Idle tasks wait until the owner sets this.
+	void SetIdle(bool idle);
+	// On the owner thread: run the completions that are ready. Returns how many.
+	size_t RunCompletions();
+	std::wstring Describe() const;
+
+#ifdef TASK_COROUTINES
+	// co_await scheduler.Resume(priority): continue on a worker. Evaluates to
+	// false if cancel was cancelled by the time it resumes.
+	struct ResumeAwaiter {
+		TaskScheduler& scheduler;
+		TaskPriority priority;
+		CancelToken cancel;
+		bool await_ready() const noexcept { return false; }
+		void await_suspend(std::coroutine_handle<> handle) { scheduler.Post(priority, [handle] { handle.resume(); }); }
+		bool await_resume() const noexcept { return !cancel.Cancelled(); }
+	};
+	ResumeAwaiter Resume(TaskPriority priority, const CancelToken& cancel = CancelToken()) { return ResumeAwaiter{ *this, priority, cancel }; }
+
+	// co_await scheduler.ResumeOnOwner(): continue in RunCompletions.
+	struct OwnerAwaiter {
+		TaskScheduler& scheduler;
+		CancelToken cancel;
+		bool await_ready() const noexcept { return false; }
+		void await_suspend(std::coroutine_handle<> handle) { scheduler.Complete([handle] { handle.resume(); }); }
+		bool await_resume() const noexcept { return !cancel.Cancelled(); }
+	};
+	OwnerAwaiter ResumeOnOwner(const CancelToken& cancel = CancelToken()) { return OwnerAwaiter{ *this, cancel }; }
+#endif
+
+private:
+	struct Task {
+		TaskFn work;
+		TaskFn done;
+		CancelToken cancel;
+	};
+	// One per worker; the owner pops the back, thieves take the front.
+	struct Lane {
+		std::mutex lock;
+		std::deque<Task> queues[TASK_PRIORITIES];
+	};
+
+	void WorkerLoop(size_t lane);
+	bool Take(size_t lane, Task& task);
+	bool Runnable() const;
+	void Complete(TaskFn done);
+
+	std::vector<std::unique_ptr<Lane>> m_lanes;
+	std::vector<std::thread> m_workers;
+	TaskFn m_wakeFn, m_threadStart, m_threadEnd;
+	std::atomic<size_t> m_nextLane{ 0 };  // lane for tasks posted from outside the pool
+
+	std::atomic<size_t> m_queued[TASK_PRIORITIES] = {};
+	std::atomic<bool> m_idle{ false };
+	mutable std::mutex m_lock;  // sleeping workers and m_stopping
+	std::condition_variable m_wake;
+	bool m_stopping = false;
+
+	std::mutex m_completionLock;
+	std::vector<TaskFn> m_completions;
+	std::atomic<bool> m_woken{ false };  // wake called, RunCompletions not yet
+
+	std::atomic<uint64_t> m_run[TASK_PRIORITIES] = {};
+	std::atomic<uint64_t> m_stolen{ 0 };
+	std::atomic<uint64_t> m_cancelled{ 0 };
+};
+
+#ifdef TASK_COROUTINES
+// Return type for a fire-and-forget coroutine that moves between the pool and
+// the owner thread. It starts running on the caller's thread.
+struct BackgroundJob {
+	struct promise_type {
+		BackgroundJob get_return_object() noexcept { return {}; }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() noexcept {}
+		void unhandled_exception() noexcept { std::terminate(); }
+	};
+};
+#endif
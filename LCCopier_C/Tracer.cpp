@@ -0,0 +1,154 @@
+#include "Tracer.h"
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+struct TraceEvent {
+	const char* name;
+	const char* category;
+	char phase;        // 'X' complete, 'b'/'e' async begin/end
+	uint64_t ts;
+	uint64_t dur;
+	uint64_t id;
+};
+
+// Single producer (the owning thread), single consumer (TraceDrain).
+class TraceBuffer {
+public:
+	explicit TraceBuffer(uint32_t tid) : m_tid(tid) {}
+
+	void Push(const TraceEvent& e) {
+		uint64_t head = m_head.load(std::memory_order_relaxed);
+		if (head - m_tail.load(std::memory_order_acquire) >= TRACE_BUFFER_EVENTS) {
+			m_dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		m_events[head % TRACE_BUFFER_EVENTS] = e;
+		m_head.store(head + 1, std::memory_order_release);
+	}
+
+	template <class Fn>
+	size_t Drain(Fn&& fn) {
+		uint64_t tail = m_tail.load(std::memory_order_relaxed);
+		uint64_t head = m_head.load(std::memory_order_acquire);
+		for (uint64_t i = tail; i < head; i++) fn(m_events[i % TRACE_BUFFER_EVENTS]);
+		m_tail.store(head, std::memory_order_release);
+		return (size_t)(head - tail);
+	}
+
+	uint32_t Tid() const { return m_tid; }
+	uint64_t Dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+	std::atomic<const char*> threadName{ nullptr };
+	bool nameWritten = false;  // consumer side
+
+private:
+	TraceEvent m_events[TRACE_BUFFER_EVENTS];
+	std::atomic<uint64_t> m_head{ 0 };
+	std::atomic<uint64_t> m_tail{ 0 };
+	std::atomic<uint64_t> m_dropped{ 0 };
+	uint32_t m_tid;
+};
+
+std::atomic<bool> s_enabled{ false };
+const std::chrono::steady_clock::time_point s_epoch = std::chrono::steady_clock::now();
+
+// Buffers live until process exit, so a thread that ended can still be drained.
+std::mutex s_registryLock;
+std::vector<std::unique_ptr<TraceBuffer>> s_buffers;
+
+TraceBuffer& ThreadBuffer() {
+	thread_local TraceBuffer* buffer = nullptr;
+	if (!buffer) {
+		std::lock_guard<std::mutex> lock(s_registryLock);
+		s_buffers.push_back(std::make_unique<TraceBuffer>((uint32_t)s_buffers.size() + 1));
+		buffer = s_buffers.back().get();
+	}
+	return *buffer;
+}
+
+void Push(const char* name, const char* category, char phase, uint64_t ts, uint64_t dur, uint64_t id) {
+	ThreadBuffer().Push(TraceEvent{ name, category, phase, ts, dur, id });
+}
+
+}  // namespace
+
+void TraceEnable(bool enabled) {
+	s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool TraceEnabled() {
+	return s_enabled.load(std::memory_order_relaxed);
+}
+
+uint64_t TraceTimestampUs(std::chrono::steady_clock::time_point t) {
+	if (t < s_epoch) return 0;
+	return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(t - s_epoch).count();
+}
+
+uint64_t TraceNowUs() {
+	return TraceTimestampUs(std::chrono::steady_clock::now());
+}
+
+void TraceSetThreadName(const char* name) {
+	ThreadBuffer().threadName.store(name, std::memory_order_release);
+}
+
+void TraceComplete(const char* name, const char* category, uint64_t startUs, uint64_t durationUs, uint64_t id) {
+	if (!TraceEnabled()) return;
+	Push(name, category, 'X', startUs, durationUs, id);
+}
+
+void TraceAsyncBegin(const char* name, const char* category, uint64_t id) {
+	if (!TraceEnabled()) return;
+	Push(name, category, 'b', TraceNowUs(), 0, id);
+}
+
+void TraceAsyncEnd(const char* name, const char* category, uint64_t id) {
+	if (!TraceEnabled()) return;
+	Push(name, category, 'e', TraceNowUs(), 0, id);
+}
+
+size_t TraceDrain(std::string& out) {
+	std::vector<TraceBuffer*> buffers;
+	{
+		std::lock_guard<std::mutex> lock(s_registryLock);
+		for (auto& b : s_buffers) buffers.push_back(b.get());
+	}
+	char line[320];
+	size_t count = 0;
+	for (TraceBuffer* b : buffers) {
+		const char* threadName = b->threadName.load(std::memory_order_acquire);
+		if (threadName && !b->nameWritten) {
+			snprintf(line, sizeof(line), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}},\n",
+				b->Tid(), threadName);
+			out += line;
+			b->nameWritten = true;
+		}
+		count += b->Drain([&](const TraceEvent& e) {
+			if (e.phase == 'X') {
+				snprintf(line, sizeof(line),
+					"{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%" PRIu64 ",\"dur\":%" PRIu64 ",\"pid\":1,\"tid\":%u,\"args\":{\"snapshot\":%" PRIu64 "}},\n",
+					e.name, e.category, e.ts, e.dur, b->Tid(), e.id);
+			}
+			else {
+				snprintf(line, sizeof(line),
+					"{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",\"id\":%" PRIu64 ",\"ts\":%" PRIu64 ",\"pid\":1,\"tid\":%u},\n",
+					e.name, e.category, e.phase, e.id, e.ts, b->Tid());
+			}
+			out += line;
+		});
+	}
+	return count;
+}
+
+uint64_t TraceDropped() {
+	std::lock_guard<std::mutex> lock(s_registryLock);
+	uint64_t dropped = 0;
+	for (auto& b : s_buffers) dropped += b->Dropped();
+	return dropped;
+}
@@ -0,0 +1,35 @@
+#pragma once
+// Portable, optional event tracing in Chrome trace event format (open the
+// output in chrome://tracing or Perfetto). Each thread records into its own
+// fixed-size ring buffer without locks; one consumer drains all buffers into
+// JSON text. While tracing is off, recording costs one relaxed atomic load.
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#define TRACE_BUFFER_EVENTS  16384   // per thread; events beyond this are dropped until drained
+
+void TraceEnable(bool enabled);
+bool TraceEnabled();
+
+// Microseconds since the trace clock started.
+uint64_t TraceNowUs();
+uint64_t TraceTimestampUs(std::chrono::steady_clock::time_point t);
+
+// Name the calling thread in the trace (a literal; the pointer is kept).
+void TraceSetThreadName(const char* name);
+
+// name/category must be string literals without JSON special characters.
+// id ties events of one caption snapshot together (0: none).
+void TraceComplete(const char* name, const char* category, uint64_t startUs, uint64_t durationUs, uint64_t id);
+// An async span per id, shown as its own track (e.g. snapshot to pixels).
+void TraceAsyncBegin(const char* name, const char* category, uint64_t id);
+void TraceAsyncEnd(const char* name, const char* category, uint64_t id);
+
+// Drain every thread's buffer and append the events as JSON objects, each
+// followed by ",\n", so the result can be streamed into a "[" ... "]" file.
+// Call from one thread at a time. Returns the number of events appended.
+size_t TraceDrain(std::string& out);
+// Events dropped because a buffer was full.
+uint64_t TraceDropped();
@@ -0,0 +1,349 @@
+#include "TranscriptArchive.h"
+#include "CaptionText.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+size_t AlignUp(size_t value, size_t alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+void Pad(std::string& out, size_t alignment) {
+	out.resize(AlignUp(out.size(), alignment), '\0');
+}
+
+template <class T>
+void AppendRecord(std::string& out, const T& record) {
+	out.append(reinterpret_cast<const char*>(&record), sizeof(record));
+}
+
+bool InFile(uint64_t offset, uint64_t bytes, uint64_t fileBytes) {
+	return offset <= fileBytes && bytes <= fileBytes - offset;
+}
+
+std::vector<std::string> QueryTerms(const std::wstring& query) {
+	std::string utf8;
+	AppendUtf8(utf8, query);
+	std::vector<std::string> terms;
+	std::string term;
+	size_t i = 0, start = 0;
+	while (NextUtf8Term(utf8.data(), utf8.size(), i, term, start)) terms.push_back(term);
+	return terms;
+}
+
+}  // namespace
+
+void ArchiveWriter::Add(uint64_t unixMs, const char* utf8, size_t bytes) {
+	// Text offsets are 32-bit; a session never gets near 4 GB of captions.
+	if (!bytes || m_text.size() + bytes > UINT32_MAX) return;
+	m_chunks.push_back(ArchiveChunk{ unixMs, (uint32_t)m_text.size(), 0 });
+	m_text.append(utf8, bytes);
+}
+
+void ArchiveWriter::Clear() {
+	m_text.clear();
+	m_chunks.clear();
+}
+
+bool ArchiveWriter::Write(const std::wstring& path) const {
+	if (m_text.empty()) return false;
+	std::unordered_map<std::string, std::vector<uint32_t>> postings;
+	std::string term;
+	size_t i = 0, start = 0;
+	while (NextUtf8Term(m_text.data(), m_text.size(), i, term, start)) postings[term].push_back((uint32_t)start);
+	std::vector<const std::pair<const std::string, std::vector<uint32_t>>*> sorted;
+	sorted.reserve(postings.size());
+	for (const auto& entry : postings) sorted.push_back(&entry);
+	std::sort(sorted.begin(), sorted.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+
+	ArchiveHeader header = {};
+	header.magic = ARCHIVE_MAGIC;
+	header.version = ARCHIVE_VERSION;
+	header.startMs = m_chunks.front().ms;
+	header.endMs = m_chunks.back().ms;
+	header.chunkCount = (uint32_t)m_chunks.size();
+	header.termCount = (uint32_t)sorted.size();
+
+	std::string out(sizeof(ArchiveHeader), '\0');
+	header.textOffset = out.size();
+	header.textBytes = m_text.size();
+	out += m_text;
+	Pad(out, 8);
+	header.chunksOffset = out.size();
+	for (const ArchiveChunk& chunk : m_chunks) AppendRecord(out, chunk);
+	header.termsOffset = out.size();
+	uint32_t termBytes = 0, posting = 0;
+	for (const auto* entry : sorted) {
+		ArchiveTerm record = { termBytes, (uint32_t)entry->first.size(), posting, (uint32_t)entry->second.size() };
+		AppendRecord(out, record);
+		termBytes += record.bytesLength;
+		posting += record.postingCount;
+	}
+	header.termBytesOffset = out.size();
+	for (const auto* entry : sorted) out += entry->first;
+	Pad(out, 4);
+	header.postingsOffset = out.size();
+	header.postingCount = posting;
+	for (const auto* entry : sorted) {
+		out.append(reinterpret_cast<const char*>(entry->second.data()), entry->second.size() * sizeof(uint32_t));
+	}
+	header.fileBytes = out.size();
+	memcpy(&out[0], &header, sizeof(header));
+
+	// Written under a temporary name so a reader never maps half a file.
+	std::filesystem::path target(path);
+	std::filesystem::path temporary = target;
+	temporary += L".tmp";
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		if (!file.write(out.data(), (std::streamsize)out.size()) || !file.flush()) return false;
+	}
+	std::error_code error;
+	std::filesystem::rename(temporary, target, error);
+	return !error;
+}
+
+struct TranscriptArchive::Session {
+	std::wstring path;
+	ArchiveHeader header = {};
+	std::mutex lock;
+	bool mapped = false;
+	bool damaged = false;
+	const char* base = nullptr;
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = nullptr;
+#endif
+
+	~Session() {
+#ifdef _WIN32
+		if (base) UnmapViewOfFile(base);
+		if (mapping) CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+		if (base) munmap(const_cast<char*>(base), (size_t)header.fileBytes);
+#endif
+	}
+
+	bool MapFile() {
+#ifdef _WIN32
+		file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) return false;
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || (uint64_t)size.QuadPart != header.fileBytes) return false;
+		mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping) return false;
+		base = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		return base != nullptr;
+#else
+		std::string utf8;
+		AppendUtf8(utf8, path);
+		int fd = open(utf8.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0) return false;
+		struct stat st;
+		bool ok = fstat(fd, &st) == 0 && (uint64_t)st.st_size == header.fileBytes;
+		if (ok) {
+			void* view = mmap(nullptr, (size_t)header.fileBytes, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (view != MAP_FAILED) base = (const char*)view;
+		}
+		close(fd);
+		return base != nullptr;
+#endif
+	}
+
+	const ArchiveChunk* Chunks() const { return reinterpret_cast<const ArchiveChunk*>(base + header.chunksOffset); }
+	const ArchiveTerm* Terms() const { return reinterpret_cast<const ArchiveTerm*>(base + header.termsOffset); }
+	const uint32_t* Postings() const { return reinterpret_cast<const uint32_t*>(base + header.postingsOffset); }
+
+	// The term record, with its bytes and postings inside the file, or nullptr.
+	const ArchiveTerm* Lookup(const std::string& term) const {
+		const ArchiveTerm* terms = Terms();
+		uint64_t termBytes = header.postingsOffset - header.termBytesOffset;
+		size_t low = 0, high = header.termCount;
+		while (low < high) {
+			size_t mid = (low + high) / 2;
+			const ArchiveTerm& t = terms[mid];
+			if (!InFile(t.bytesOffset, t.bytesLength, termBytes)) return nullptr;
+			int order = std::string_view(base + header.termBytesOffset + t.bytesOffset, t.bytesLength).compare(term);
+			if (order == 0) {
+				return InFile(t.firstPosting, t.postingCount, header.postingCount) ? &t : nullptr;
+			}
+			if (order < 0) low = mid + 1;
+			else high = mid;
+		}
+		return nullptr;
+	}
+};
+
+TranscriptArchive::TranscriptArchive() {
+}
+
+TranscriptArchive::~TranscriptArchive() {
+}
+
+size_t TranscriptArchive::Load(const std::wstring& directory) {
+	m_sessions.clear();
+	std::error_code error;
+	for (std::filesystem::directory_iterator it(std::filesystem::path(directory), error), end; !error && it != end; it.increment(error)) {
+		const std::filesystem::path& path = it->path();
+		if (path.extension() != ARCHIVE_EXTENSION) continue;
+		auto session = std::make_unique<Session>();
+		std::ifstream file(path, std::ios::binary);
+		if (!file.read(reinterpret_cast<char*>(&session->header), sizeof(ArchiveHeader))) continue;
+		if (session->header.magic != ARCHIVE_MAGIC || session->header.version != ARCHIVE_VERSION) continue;
+		session->path = path.wstring();
+		m_sessions.push_back(std::move(session));
+	}
+	std::sort(m_sessions.begin(), m_sessions.end(), [](const auto& a, const auto& b) {
+		return a->header.startMs != b->header.startMs ? a->header.startMs < b->header.startMs : a->path < b->path;
+	});
+	return m_sessions.size();
+}
+
+const ArchiveHeader& TranscriptArchive::Header(size_t session) const {
+	return m_sessions[session]->header;
+}
+
+const std::wstring& TranscriptArchive::Path(size_t session) const {
+	return m_sessions[session]->path;
+}
+
+TranscriptArchive::Session* TranscriptArchive::Map(size_t session) {
+	Session& s = *m_sessions[session];
+	std::lock_guard<std::mutex> lock(s.lock);
+	if (!s.mapped) {
+		s.mapped = true;
+		const ArchiveHeader& h = s.header;
+		uint64_t size = h.fileBytes;
+		bool sane = h.fileBytes >= sizeof(ArchiveHeader) && h.textBytes <= UINT32_MAX &&
+			InFile(h.textOffset, h.textBytes, size) &&
+			h.chunkCount > 0 && InFile(h.chunksOffset, (uint64_t)h.chunkCount * sizeof(ArchiveChunk), size) &&
+			InFile(h.termsOffset, (uint64_t)h.termCount * sizeof(ArchiveTerm), size) &&
+			h.termBytesOffset <= h.postingsOffset &&
+			InFile(h.postingsOffset, (uint64_t)h.postingCount * sizeof(uint32_t), size) &&
+			h.chunksOffset % alignof(uint64_t) == 0 && h.postingsOffset % alignof(uint32_t) == 0;
+		s.damaged = !sane || !s.MapFile();
+	}
+	return s.damaged ? nullptr : &s;
+}
+
+const char* TranscriptArchive::Text(size_t session, size_t& bytes) {
+	Session* s = Map(session);
+	bytes = s ? (size_t)s->header.textBytes : 0;
+	return s ? s->base + s->header.textOffset : nullptr;
+}
+
+uint64_t TranscriptArchive::TimeAt(size_t session, uint32_t textOffset) {
+	Session* s = Map(session);
+	if (!s) return m_sessions[session]->header.startMs;
+	const ArchiveChunk* chunks = s->Chunks();
+	const ArchiveChunk* end = chunks + s->header.chunkCount;
+	const ArchiveChunk* chunk = std::upper_bound(chunks, end, textOffset,
+		[](uint32_t offset, const ArchiveChunk& c) { return offset < c.textOffset; });
+	return chunk == chunks ? chunks->ms : (chunk - 1)->ms;
+}
+
+void TranscriptArchive::FindInSession(size_t session, const std::vector<std::string>& terms, std::vector<ArchiveHit>& hits) {
+	Session* s = Map(session);
+	if (!s) return;
+	// Every term has to occur; the first one anchors the phrase.
+	const ArchiveTerm* anchor = nullptr;
+	for (size_t k = 0; k < terms.size(); k++) {
+		const ArchiveTerm* t = s->Lookup(terms[k]);
+		if (!t) return;
+		if (k == 0) anchor = t;
+	}
+	const char* text = s->base + s->header.textOffset;
+	size_t textBytes = (size_t)s->header.textBytes;
+	const uint32_t* postings = s->Postings() + anchor->firstPosting;
+	std::string term;
+	for (uint32_t p = 0; p < anchor->postingCount; p++) {
+		uint32_t offset = postings[p];
+		if (offset >= textBytes) continue;
+		size_t i = offset, start = 0;
+		bool match = NextUtf8Term(text, textBytes, i, term, start) && start == offset;
+		for (size_t k = 1; match && k < terms.size(); k++) {
+			match = NextUtf8Term(text, textBytes, i, term, start) && term == terms[k];
+		}
+		if (!match) continue;
+
+		// Snippet on whole code points: skip continuation bytes at both cuts.
+		size_t from = offset > ARCHIVE_SNIPPET_BYTES ? offset - ARCHIVE_SNIPPET_BYTES : 0;
+		size_t to = (std::min)(textBytes, i + ARCHIVE_SNIPPET_BYTES);
+		while (from < offset && ((unsigned char)text[from] & 0xC0) == 0x80) from++;
+		while (to > i && to < textBytes && ((unsigned char)text[to] & 0xC0) == 0x80) to--;
+		ArchiveHit hit;
+		hit.session = session;
+		hit.ms = TimeAt(session, offset);
+		hit.textOffset = offset;
+		hit.snippet.assign(text + from, to - from);
+		hits.push_back(std::move(hit));
+	}
+}
+
+void TranscriptArchive::Search(const std::wstring& query, const HitFn& onHit, unsigned threads) {
+	std::vector<std::string> terms = QueryTerms(query);
+	size_t count = m_sessions.size();
+	if (terms.empty() || !count) return;
+	if (!threads) threads = (std::max)(1u, std::thread::hardware_concurrency());
+	threads = (unsigned)(std::min)((size_t)threads, count);
+
+	// Workers take sessions in time order; the caller reports each session
+	// once it and every earlier one are done.
+	struct Slot {
+		bool done = false;
+		std::vector<ArchiveHit> hits;
+	};
+	std::vector<Slot> slots(count);
+	std::atomic<size_t> next(0);
+	std::atomic<bool> cancelled(false);
+	std::mutex lock;
+	std::condition_variable finished;
+	auto work = [&] {
+		for (size_t s; !cancelled && (s = next++) < count;) {
+			std::vector<ArchiveHit> hits;
+			FindInSession(s, terms, hits);
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				slots[s].hits = std::move(hits);
+				slots[s].done = true;
+			}
+			finished.notify_all();
+		}
+	};
+	std::vector<std::thread> pool;
+	for (unsigned t = 0; t < threads; t++) pool.emplace_back(work);
+
+	for (size_t s = 0; s < count && !cancelled; s++) {
+		std::vector<ArchiveHit> hits;
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			finished.wait(guard, [&] { return slots[s].done; });
+			hits.swap(slots[s].hits);
+		}
+		for (const ArchiveHit& hit : hits) {
+			if (!onHit(hit)) {
+				cancelled = true;
+				break;
+			}
+		}
+	}
+	for (std::thread& t : pool) t.join();
+}
@@ -0,0 +1,108 @@
+#pragma once
+// Transcript archive: one file per session (LCCopier_session_<stamp>.lca) with
+// a fixed header (time range, sizes, section offsets), the session text as
+// UTF-8, a chunk table from text offset to wall-clock time and a sorted term
+// dictionary with postings. Readers memory-map a session the first time its
+// text or index is needed, so listing a month of sessions reads one header
+// each. Search fans out across sessions on all cores and reports hits in
+// time order as the sessions finish.
+//
+// All integers are little-endian; the header and tables are fixed-size
+// records so a mapped file is read in place. Section bounds are checked when
+// a session is mapped and each term as it is read; a damaged file is skipped.
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define ARCHIVE_MAGIC         0x5241434Cu  // "LCAR"
+#define ARCHIVE_VERSION       1
+#define ARCHIVE_EXTENSION     L".lca"
+#define ARCHIVE_SNIPPET_BYTES 80           // context on each side of a hit
+
+#pragma pack(push, 1)
+struct ArchiveHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t startMs;         // Unix time of the first and last chunk
+	uint64_t endMs;
+	uint64_t fileBytes;
+	uint64_t textOffset;
+	uint64_t textBytes;
+	uint64_t chunksOffset;    // ArchiveChunk[chunkCount], by text offset
+	uint64_t termsOffset;     // ArchiveTerm[termCount], by term bytes
+	uint64_t termBytesOffset;
+	uint64_t postingsOffset;  // uint32_t text offsets, grouped per term
+	uint32_t chunkCount;
+	uint32_t termCount;
+	uint32_t postingCount;
+	uint32_t reserved;
+};
+
+struct ArchiveChunk {
+	uint64_t ms;
+	uint32_t textOffset;
+	uint32_t reserved;
+};
+
+struct ArchiveTerm {
+	uint32_t bytesOffset;     // into the term bytes section
+	uint32_t bytesLength;
+	uint32_t firstPosting;
+	uint32_t postingCount;
+};
+#pragma pack(pop)
+
+// Collects one session on the transcript writer thread and writes it out at
+// the end. Memory is the session text plus its postings.
+class ArchiveWriter {
+public:
+	void Add(uint64_t unixMs, const char* utf8, size_t bytes);
+	bool Empty() const { return m_text.empty(); }
+	bool Write(const std::wstring& path) const;
+	void Clear();
+
+private:
+	std::string m_text;
+	std::vector<ArchiveChunk> m_chunks;
+};
+
+struct ArchiveHit {
+	size_t session;
+	uint64_t ms;              // Unix time of the chunk holding the hit
+	uint32_t textOffset;
+	std::string snippet;      // UTF-8, whole code points
+};
+
+class TranscriptArchive {
+public:
+	TranscriptArchive();
+	~TranscriptArchive();
+
+	// Reads the headers of every session file in directory (which ends with a
+	// path separator); sessions are kept in start-time order.
+	size_t Load(const std::wstring& directory);
+	size_t SessionCount() const { return m_sessions.size(); }
+	const ArchiveHeader& Header(size_t session) const;
+	const std::wstring& Path(size_t session) const;
+
+	// Maps the session if needed. Returns nullptr for a damaged file.
+	const char* Text(size_t session, size_t& bytes);
+	uint64_t TimeAt(size_t session, uint32_t textOffset);
+
+	// Phrase search (terms as NextUtf8Term splits them, consecutive). onHit is
+	// called on the calling thread, sessions in time order and hits in text
+	// order; returning false stops the search. threads 0: all cores.
+	typedef std::function<bool(const ArchiveHit&)> HitFn;
+	void Search(const std::wstring& query, const HitFn& onHit, unsigned threads = 0);
+
+private:
+	struct Session;
+
+	Session* Map(size_t session);
+	void FindInSession(size_t session, const std::vector<std::string>& terms, std::vector<ArchiveHit>& hits);
+
+	std::vector<std::unique_ptr<Session>> m_sessions;
+};
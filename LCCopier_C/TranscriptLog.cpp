@@ -0,0 +1,273 @@
+#include "TranscriptLog.h"
+#include "CaptionText.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <cwctype>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#define TRANSCRIPT_MAX_PARTS 1000  // per day; beyond this the last part keeps growing
+
+static void LocalTime(struct tm& local) {
+	time_t now = time(nullptr);
+#ifdef _WIN32
+	localtime_s(&local, &now);
+#else
+	localtime_r(&now, &local);
+#endif
+}
+
+static unsigned LocalDay() {
+	struct tm local;
+	LocalTime(local);
+	return (unsigned)((local.tm_year + 1900) * 10000 + (local.tm_mon + 1) * 100 + local.tm_mday);
+}
+
+static FILE* OpenForAppend(const std::wstring& path) {
+#ifdef _WIN32
+	return _wfopen(path.c_str(), L"ab");
+#else
+	std::string utf8;
+	AppendUtf8(utf8, path);
+	return fopen(utf8.c_str(), "ab");
+#endif
+}
+
+static uint64_t FileSize(FILE* file) {
+#ifdef _WIN32
+	if (_fseeki64(file, 0, SEEK_END) != 0) return 0;
+	long long size = _ftelli64(file);
+#else
+	if (fseeko(file, 0, SEEK_END) != 0) return 0;
+	long long size = (long long)ftello(file);
+#endif
+	return size > 0 ? (uint64_t)size : 0;
+}
+
+// Push the batch past the OS cache as well: a group commit per flush interval.
+static bool CommitToDisk(FILE* file) {
+	if (fflush(file) != 0) return false;
+#ifdef _WIN32
+	return _commit(_fileno(file)) == 0;
+#else
+	return fsync(fileno(file)) == 0;
+#endif
+}
+
+TranscriptLog::~TranscriptLog() {
+	Stop();
+}
+
+bool TranscriptLog::Start(const TranscriptLogOptions& options) {
+	if (Running()) return true;
+	m_options = options;
+	if (m_options.flushIntervalMs == 0) m_options.flushIntervalMs = TRANSCRIPT_FLUSH_MS;
+	m_logged = 0;
+	m_touches.clear();
+	struct tm local;
+	LocalTime(local);
+	m_archive.Clear();
+	m_archivePath.clear();
+	if (!m_options.archiveDirectory.empty()) {
+		wchar_t stamp[32];
+		swprintf(stamp, 32, L"_%04d%02d%02d_%02d%02d%02d", local.tm_year + 1900, local.tm_mon + 1, local.tm_mday,
+			local.tm_hour, local.tm_min, local.tm_sec);
+		m_archivePath = m_options.archiveDirectory + L"LCCopier_session" + stamp + ARCHIVE_EXTENSION;
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_stopping = false;
+		char header[64];
+		snprintf(header, sizeof(header), "\n[session %04d-%02d-%02d %02d:%02d:%02d]\n",
+			local.tm_year + 1900, local.tm_mon + 1, local.tm_mday, local.tm_hour, local.tm_min, local.tm_sec);
+		m_pending.reserve(m_options.bufferBytes + sizeof(header));
+		m_batch.reserve(m_options.bufferBytes + sizeof(header));
+		m_archiveSkip = m_pending.size() + strlen(header);
+		m_pending += header;
+	}
+	m_writer = std::thread(&TranscriptLog::WriterLoop, this);
+	return true;
+}
+
+void TranscriptLog::Stop() {
+	if (!Running()) return;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_stopping = true;
+	}
+	m_wake.notify_all();
+	m_writer.join();
+}
+
+void TranscriptLog::OnEdit(const HistoryEdit& edit, const std::wstring& history, uint64_t nowMs) {
+	if (edit.Empty()) return;
+	if (edit.offset < m_logged) {
+		// Logged text was cleared or re-anchored; what is in the file stays, and
+		// the text after it starts on a new line.
+		m_logged = (std::min)(m_logged, history.size());
+		m_lineBreak = true;
+	}
+	m_touches.push_back(Touch{ edit.offset, nowMs });
+}
+
+void TranscriptLog::OnPrepend(size_t units) {
+	m_logged += units;
+	for (Touch& touch : m_touches) touch.offset += units;
+}
+
+void TranscriptLog::OnTick(const std::wstring& history, uint64_t nowMs) {
+	while (!m_touches.empty() && nowMs - m_touches.front().ms >= TRANSCRIPT_STABLE_MS) m_touches.pop_front();
+	size_t frontier = history.size();
+	for (const Touch& touch : m_touches) frontier = (std::min)(frontier, touch.offset);
+	// Never cut a word that is still being revised.
+	if (frontier < history.size()) {
+		while (frontier > m_logged && !std::iswspace(history[frontier - 1])) frontier--;
+	}
+	if (frontier > m_logged) {
+		Queue(history, m_logged, frontier - m_logged);
+		m_logged = frontier;
+	}
+}
+
+void TranscriptLog::Finish(const std::wstring& history) {
+	if (history.size() > m_logged) Queue(history, m_logged, history.size() - m_logged);
+	m_logged = history.size();
+	m_touches.clear();
+}
+
+void TranscriptLog::Queue(const std::wstring& history, size_t start, size_t length) {
+	m_utf8.clear();
+	AppendUtf8(m_utf8, history, start, length);
+	std::lock_guard<std::mutex> lock(m_lock);
+	char prefix[64] = "";
+	if (m_droppedBytes) snprintf(prefix, sizeof(prefix), "\n[%llu bytes dropped]\n", (unsigned long long)m_droppedBytes);
+	else if (m_lineBreak) snprintf(prefix, sizeof(prefix), "\n");
+	size_t bytes = strlen(prefix) + m_utf8.size();
+	if (m_pending.size() + bytes > m_options.bufferBytes) {
+		// The writer is behind: keep what is buffered, drop the new text.
+		m_droppedBytes += bytes;
+		m_droppedTotal += bytes;
+		return;
+	}
+	m_pending += prefix;
+	m_pending += m_utf8;
+	m_droppedBytes = 0;
+	m_lineBreak = false;
+	m_queuedBytes += bytes;
+}
+
+void TranscriptLog::WriterLoop() {
+	std::unique_lock<std::mutex> lock(m_lock);
+	while (!m_stopping) {
+		m_wake.wait_for(lock, std::chrono::milliseconds(m_options.flushIntervalMs), [this] { return m_stopping; });
+		WriteBatch(lock);
+	}
+	WriteBatch(lock);  // Stop may come before the first wait
+	lock.unlock();
+	CloseFile();
+	if (!m_archivePath.empty() && !m_archive.Empty()) m_archive.Write(m_archivePath);
+	m_archive.Clear();
+}
+
+void TranscriptLog::WriteBatch(std::unique_lock<std::mutex>& lock) {
+	if (m_pending.empty()) return;
+	// Swap rather than copy, so both buffers keep their capacity.
+	m_batch.swap(m_pending);
+	lock.unlock();
+
+	auto started = std::chrono::steady_clock::now();
+	unsigned day = LocalDay();
+	bool ok = true;
+	bool full = m_options.rotateBytes && m_fileBytes && m_fileBytes + m_batch.size() > m_options.rotateBytes;
+	if (!m_file || day != m_fileDay || full) {
+		CloseFile();
+		ok = OpenFile(day, full);
+	}
+	if (ok) ok = fwrite(m_batch.data(), 1, m_batch.size(), m_file) == m_batch.size() && CommitToDisk(m_file);
+	if (ok) {
+		m_fileBytes += m_batch.size();
+		if (!m_archivePath.empty() && m_batch.size() > m_archiveSkip) {
+			uint64_t unixMs = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+				std::chrono::system_clock::now().time_since_epoch()).count();
+			m_archive.Add(unixMs, m_batch.data() + m_archiveSkip, m_batch.size() - m_archiveSkip);
+		}
+		m_archiveSkip = m_archiveSkip > m_batch.size() ? m_archiveSkip - m_batch.size() : 0;
+	}
+	else {
+		CloseFile();  // reopened on the next batch
+	}
+	uint64_t elapsedMs = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now() - started).count();
+
+	lock.lock();
+	m_batches++;
+	m_slowestCommitMs = (std::max)(m_slowestCommitMs, elapsedMs);
+	m_largestBatch = (std::max)(m_largestBatch, m_batch.size());
+	if (ok) {
+		m_writtenBytes += m_batch.size();
+	}
+	else {
+		m_writeErrors++;
+		// Retry with the next batch if the buffer has room, like any other text.
+		if (m_batch.size() + m_pending.size() <= m_options.bufferBytes) {
+			m_pending.insert(0, m_batch);
+		}
+		else {
+			m_droppedBytes += m_batch.size();
+			m_droppedTotal += m_batch.size();
+		}
+	}
+	m_batch.clear();
+}
+
+bool TranscriptLog::OpenFile(unsigned day, bool nextPart) {
+	if (day != m_fileDay) {
+		m_fileDay = day;
+		m_filePart = 1;
+	}
+	else if (nextPart && m_filePart < TRANSCRIPT_MAX_PARTS) {
+		m_filePart++;
+	}
+	for (;;) {
+		wchar_t suffix[32];
+		if (m_filePart > 1) swprintf(suffix, 32, L"_%u_%u.txt", m_fileDay, m_filePart);
+		else swprintf(suffix, 32, L"_%u.txt", m_fileDay);
+		std::wstring name = m_options.directory + m_options.prefix + suffix;
+		m_file = OpenForAppend(name);
+		if (!m_file) return false;
+		m_fileBytes = FileSize(m_file);
+		// An earlier session may have filled today's file already.
+		if (!m_options.rotateBytes || m_fileBytes < m_options.rotateBytes || m_filePart >= TRANSCRIPT_MAX_PARTS) {
+			std::lock_guard<std::mutex> lock(m_lock);
+			m_fileName = name;
+			return true;
+		}
+		fclose(m_file);
+		m_file = nullptr;
+		m_filePart++;
+	}
+}
+
+void TranscriptLog::CloseFile() {
+	if (!m_file) return;
+	fclose(m_file);
+	m_file = nullptr;
+}
+
+std::wstring TranscriptLog::Describe() {
+	std::lock_guard<std::mutex> lock(m_lock);
+	wchar_t line[256];
+	swprintf(line, 256, L"transcript log: %llu bytes queued, %llu written in %llu batches (largest %zu), %zu pending, "
+		L"%llu dropped, %llu write errors, slowest commit %llu ms\r\n",
+		(unsigned long long)m_queuedBytes, (unsigned long long)m_writtenBytes, (unsigned long long)m_batches,
+		m_largestBatch, m_pending.size(), (unsigned long long)m_droppedTotal, (unsigned long long)m_writeErrors,
+		(unsigned long long)m_slowestCommitMs);
+	std::wstring out = line;
+	if (!m_fileName.empty()) out += L"  " + m_fileName + L"\r\n";
+	return out;
+}
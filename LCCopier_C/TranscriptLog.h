@@ -0,0 +1,105 @@
+#pragma once
+// Always-on transcript log: committed caption text is appended to daily files
+// (<prefix>_<yyyymmdd>.txt, then _2, _3, ... once a file reaches the rotate
+// size). The caption thread only copies text into a memory buffer; a writer
+// thread takes the whole buffer every flush interval, writes it and commits it
+// to disk in one go. When the disk cannot keep up the buffer grows up to its
+// limit, after which new text is dropped, counted and marked in the log.
+// Both buffers are reserved to the limit at Start, so queuing text does not
+// allocate.
+//
+// Text counts as committed once it has not been rewritten for
+// TRANSCRIPT_STABLE_MS, so the log does not fill up with recognizer revisions.
+// With an archive directory the writer also indexes the session and writes
+// it as one TranscriptArchive file when the log stops.
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "CaptionMerge.h"
+#include "RingQueue.h"
+#include "TranscriptArchive.h"
+
+#define TRANSCRIPT_STABLE_MS          3000
+#define TRANSCRIPT_FLUSH_MS           2000              // default group-commit interval
+#define TRANSCRIPT_ROTATE_BYTES       (16 * 1024 * 1024)
+#define TRANSCRIPT_BUFFER_BYTES       (1024 * 1024)     // pending text beyond this is dropped
+
+struct TranscriptLogOptions {
+	std::wstring directory;                    // ends with a path separator
+	std::wstring prefix = L"LCCopier_transcript";
+	uint32_t flushIntervalMs = TRANSCRIPT_FLUSH_MS;
+	uint64_t rotateBytes = TRANSCRIPT_ROTATE_BYTES;  // 0: one file per day
+	size_t bufferBytes = TRANSCRIPT_BUFFER_BYTES;
+	std::wstring archiveDirectory;             // empty: no archive
+};
+
+class TranscriptLog {
+public:
+	~TranscriptLog();
+
+	bool Start(const TranscriptLogOptions& options);
+	// Writes out everything still buffered, then joins the writer.
+	void Stop();
+	bool Running() const { return m_writer.joinable(); }
+
+	// Caption thread. Same contract as SubtitleExporter: every HistoryEdit,
+	// then one OnTick per poll; OnTick queues text that has become stable.
+	void OnEdit(const HistoryEdit& edit, const std::wstring& history, uint64_t nowMs);
+	void OnTick(const std::wstring& history, uint64_t nowMs);
+	// units of earlier text were put in front of the history (a clear was
+	// undone); that text was logged before the clear.
+	void OnPrepend(size_t units);
+	// Queue the rest of the history regardless of stability (end of session).
+	void Finish(const std::wstring& history);
+
+	std::wstring Describe();
+
+private:
+	struct Touch {
+		size_t offset;
+		uint64_t ms;
+	};
+
+	void Queue(const std::wstring& history, size_t start, size_t length);
+	void WriterLoop();
+	void WriteBatch(std::unique_lock<std::mutex>& lock);
+	bool OpenFile(unsigned day, bool nextPart);
+	void CloseFile();
+
+	TranscriptLogOptions m_options;
+
+	// Caption thread only.
+	size_t m_logged = 0;          // history before this offset has been queued
+	RingQueue<Touch> m_touches;   // edits within the stable window
+	std::string m_utf8;           // text being queued, converted outside the lock
+	bool m_lineBreak = false;     // logged text was rewritten; start a new line
+
+	std::mutex m_lock;
+	std::condition_variable m_wake;
+	bool m_stopping = false;
+	std::string m_pending;        // UTF-8, guarded by m_lock
+	uint64_t m_droppedBytes = 0;  // since the last marker, guarded by m_lock
+	uint64_t m_droppedTotal = 0;
+	uint64_t m_queuedBytes = 0;
+	uint64_t m_writtenBytes = 0;
+	uint64_t m_batches = 0;
+	uint64_t m_writeErrors = 0;
+	uint64_t m_slowestCommitMs = 0;
+	size_t m_largestBatch = 0;
+	std::wstring m_fileName;
+
+	// Writer thread only.
+	std::thread m_writer;
+	std::string m_batch;
+	FILE* m_file = nullptr;
+	uint64_t m_fileBytes = 0;
+	unsigned m_fileDay = 0;       // yyyymmdd of the open file
+	unsigned m_filePart = 1;
+	ArchiveWriter m_archive;
+	std::wstring m_archivePath;
+	size_t m_archiveSkip = 0;     // session header bytes, kept out of the archive
+};
@@ -0,0 +1,89 @@
+#include "WindowDiscovery.h"
+#include <algorithm>
+#include <cwchar>
+
+WindowDiscovery::WindowDiscovery(MatchFn match, ScanFn scan) : m_match(std::move(match)), m_scan(std::move(scan)) {
+}
+
+void WindowDiscovery::OnEvent(WindowEvent event, Handle window) {
+	if (!window) return;
+	m_events++;
+	switch (event) {
+	case WindowEvent::Destroyed:
+		// Windows created while ours was cached were not tracked, so one scan
+		// settles whether another caption window is left.
+		if (window == m_window) {
+			m_window = 0;
+			m_candidates.clear();
+			m_scanNeeded = true;
+		}
+		m_candidates.erase(std::remove(m_candidates.begin(), m_candidates.end(), window), m_candidates.end());
+		break;
+	case WindowEvent::Created:
+	case WindowEvent::NameChanged:
+		// The cached window is checked on every Find anyway; others only matter
+		// while there is none. A window is often created untitled and named after.
+		if (!m_window) AddCandidate(window);
+		break;
+	}
+}
+
+void WindowDiscovery::AddCandidate(Handle window) {
+	if (m_scanNeeded) return;
+	if (std::find(m_candidates.begin(), m_candidates.end(), window) != m_candidates.end()) return;
+	if (m_candidates.size() >= DISCOVERY_MAX_CANDIDATES) {
+		m_candidates.clear();
+		m_scanNeeded = true;
+		return;
+	}
+	m_candidates.push_back(window);
+}
+
+void WindowDiscovery::SetEventsAvailable(bool available) {
+	m_eventsAvailable = available;
+	// Events from before the hook was installed were never seen.
+	if (available) m_scanNeeded = true;
+}
+
+WindowDiscovery::Handle WindowDiscovery::Find(uint64_t nowMs) {
+	m_finds++;
+	if (m_window) {
+		if (m_match(m_window)) {
+			m_hits++;
+			return m_window;
+		}
+		// Renamed, or gone without an event: no telling where it went.
+		m_window = 0;
+		m_lost++;
+		m_scanNeeded = true;
+	}
+	if (!m_scanNeeded) {
+		for (Handle candidate : m_candidates) {
+			m_candidateChecks++;
+			if (m_match(candidate)) {
+				m_window = candidate;
+				break;
+			}
+		}
+		m_candidates.clear();
+		if (m_window) return m_window;
+	}
+	if (m_scanNeeded || !m_eventsAvailable || !m_scanned || nowMs - m_lastScanMs >= DISCOVERY_RESCAN_MS) {
+		m_candidates.clear();
+		m_scanNeeded = false;
+		m_scanned = true;
+		m_lastScanMs = nowMs;
+		m_scans++;
+		m_window = m_scan();
+	}
+	return m_window;
+}
+
+std::wstring WindowDiscovery::Describe() const {
+	wchar_t line[256];
+	swprintf(line, 256, L"caption window: %ls; %llu lookups, %llu from the cache, %llu lost, %llu full scans, %llu events (%llu windows checked)%ls\r\n",
+		m_window ? L"found" : L"not found", (unsigned long long)m_finds, (unsigned long long)m_hits, (unsigned long long)m_lost,
+		(unsigned long long)m_scans, (unsigned long long)m_events, (unsigned long long)m_candidateChecks,
+		m_eventsAvailable ? L"" : L", no window events");
+	return line;
+}
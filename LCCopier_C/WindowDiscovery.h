@@ -0,0 +1,61 @@
+#pragma once
+// Portable discovery cache for the Live Caption window. Enumerating every
+// top-level window and fetching its title on each poll costs time in
+// proportion to the windows open on the desktop; this keeps the window found
+// last and only checks that it still matches. Window events (in the app, from
+// SetWinEventHook) name the windows worth looking at when nothing is cached:
+// one created, or one whose title changed. A full scan runs only when the
+// cached window is destroyed or stops matching, when too many events piled up
+// to check one by one, or every DISCOVERY_RESCAN_MS while nothing is found, in
+// case an event was missed.
+//
+// Not thread-safe: events and Find come from the same thread (the UI thread,
+// which is where out-of-context WinEvent callbacks are delivered).
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#define DISCOVERY_MAX_CANDIDATES 16     // more windows named by events than this: scan instead
+#define DISCOVERY_RESCAN_MS      10000  // full scan this often while nothing is found
+
+enum class WindowEvent {
+	Created,
+	Destroyed,
+	NameChanged,
+};
+
+class WindowDiscovery {
+public:
+	typedef uintptr_t Handle;  // an HWND in the app; 0 is none
+	typedef std::function<bool(Handle)> MatchFn;  // the window exists and is the one we want
+	typedef std::function<Handle()> ScanFn;       // full search; 0 if there is none
+
+	WindowDiscovery(MatchFn match, ScanFn scan);
+
+	// Top-level windows only. Destroyed may name a window that is already gone.
+	void OnEvent(WindowEvent event, Handle window);
+	// Without events (the hook could not be installed) every Find that has
+	// nothing cached scans, as polling did before.
+	void SetEventsAvailable(bool available);
+
+	// The window, or 0. nowMs: any monotonic clock.
+	Handle Find(uint64_t nowMs);
+	Handle Cached() const { return m_window; }
+	uint64_t ScanCount() const { return m_scans; }
+	std::wstring Describe() const;
+
+private:
+	void AddCandidate(Handle window);
+
+	MatchFn m_match;
+	ScanFn m_scan;
+	Handle m_window = 0;
+	std::vector<Handle> m_candidates;  // named by events since the last Find, oldest first
+	bool m_scanNeeded = true;          // nothing is known about the windows that exist
+	bool m_eventsAvailable = false;
+	bool m_scanned = false;
+	uint64_t m_lastScanMs = 0;
+	uint64_t m_finds = 0, m_hits = 0, m_lost = 0, m_candidateChecks = 0, m_scans = 0, m_events = 0;
+};
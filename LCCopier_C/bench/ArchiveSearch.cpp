@@ -0,0 +1,122 @@
+// Searches a directory of transcript archive sessions (LCCopier_session_*.lca,
+// written by the app next to its transcript logs), or fills one with
+// synthetic sessions (made-up words from CaptionSynth) to measure load and
+// search times.
+//
+// Build and run on Linux (from LCCopier_C/bench):
+//   g++ -std=c++17 -O2 -I.. ArchiveSearch.cpp CaptionSynth.cpp ../CaptionText.cpp ../TranscriptArchive.cpp -pthread -o archive_search
+//   ./archive_search --dir /tmp/archive/ --generate 200 --minutes 60
+//   ./archive_search --dir /tmp/archive/ --query "stou" --limit 20
+//   ./archive_search --dir /tmp/archive/ --query "stou" --threads 1 --count
+//
+// Hits print in time order: local time, session file, snippet. --count only
+// counts them, which times the search itself.
+#include "CaptionSynth.h"
+#include "CaptionText.h"
+#include "TranscriptArchive.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+static double MsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::wstring Widen(const char* text) {
+	return DecodeUtf8(text);
+}
+
+// One synthetic session: the synth's ground truth, chunked every 2 s the way
+// the transcript writer hands batches to the archive.
+static bool GenerateSession(const std::wstring& directory, uint32_t seed, double minutes, uint64_t startMs) {
+	SynthOptions options;
+	options.seed = seed;
+	CaptionSynth synth({}, options);
+	ArchiveWriter writer;
+	size_t written = 0;
+	std::string utf8;
+	while (synth.ElapsedMs() < (uint64_t)(minutes * 60000)) {
+		synth.Next();
+		if (synth.ElapsedMs() % 2000 != 0) continue;
+		const std::wstring& truth = synth.GroundTruth();
+		utf8.clear();
+		AppendUtf8(utf8, truth, written);
+		written = truth.size();
+		writer.Add(startMs + synth.ElapsedMs(), utf8.data(), utf8.size());
+	}
+	wchar_t name[64];
+	swprintf(name, 64, L"LCCopier_session_synth%05u%ls", seed, ARCHIVE_EXTENSION);
+	return writer.Write(directory + name);
+}
+
+int main(int argc, char** argv) {
+	std::wstring directory;
+	const char* query = nullptr;
+	unsigned generate = 0, threads = 0;
+	double minutes = 60;
+	long limit = 50;
+	bool countOnly = false;
+	for (int i = 1; i < argc; i++) {
+		bool hasValue = i + 1 < argc;
+		if (!strcmp(argv[i], "--dir") && hasValue) directory = Widen(argv[++i]);
+		else if (!strcmp(argv[i], "--query") && hasValue) query = argv[++i];
+		else if (!strcmp(argv[i], "--generate") && hasValue) generate = (unsigned)atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--minutes") && hasValue) minutes = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--threads") && hasValue) threads = (unsigned)atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--limit") && hasValue) limit = atol(argv[++i]);
+		else if (!strcmp(argv[i], "--count")) countOnly = true;
+		else {
+			fprintf(stderr, "usage: %s --dir DIR [--generate N --minutes M] [--query TEXT [--limit N] [--threads N] [--count]]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (directory.empty()) {
+		fprintf(stderr, "--dir is required\n");
+		return 2;
+	}
+	if (directory.back() != L'/' && directory.back() != L'\\') directory += L'/';
+
+	if (generate) {
+		auto start = std::chrono::steady_clock::now();
+		uint64_t base = 1700000000000ull;
+		for (unsigned s = 0; s < generate; s++) {
+			if (!GenerateSession(directory, s + 1, minutes, base + s * 86400000ull)) {
+				fprintf(stderr, "cannot write session %u\n", s + 1);
+				return 1;
+			}
+		}
+		printf("generated %u sessions of %.0f minutes in %.0f ms\n", generate, minutes, MsSince(start));
+	}
+
+	TranscriptArchive archive;
+	auto start = std::chrono::steady_clock::now();
+	size_t sessions = archive.Load(directory);
+	uint64_t textBytes = 0;
+	for (size_t s = 0; s < sessions; s++) textBytes += archive.Header(s).textBytes;
+	printf("%zu sessions, %.1f MB of text, headers read in %.1f ms\n", sessions, textBytes / 1048576.0, MsSince(start));
+	if (!query) return 0;
+
+	long hits = 0;
+	start = std::chrono::steady_clock::now();
+	archive.Search(Widen(query), [&](const ArchiveHit& hit) {
+		hits++;
+		if (!countOnly) {
+			time_t seconds = (time_t)(hit.ms / 1000);
+			struct tm local;
+			localtime_r(&seconds, &local);
+			char when[32];
+			strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &local);
+			std::string path;
+			AppendUtf8(path, archive.Path(hit.session));
+			std::string snippet = hit.snippet;
+			for (char& ch : snippet) if (ch == '\n' || ch == '\r') ch = ' ';
+			printf("%s  %s\n    ...%s...\n", when, path.c_str() + path.find_last_of('/') + 1, snippet.c_str());
+		}
+		return countOnly || limit <= 0 || hits < limit;
+	}, threads);
+	printf("%ld hits in %.1f ms\n", hits, MsSince(start));
+	return 0;
+}
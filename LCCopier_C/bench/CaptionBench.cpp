@@ -0,0 +1,303 @@
+// Microbenchmarks for the portable caption text core.
+//
+// Build and run on Linux (from LCCopier_C/bench):
+//   g++ -std=c++17 -O2 -I.. CaptionBench.cpp ../CaptionMerge.cpp ../CaptionText.cpp ../ClipboardPayload.cpp -o caption_bench
+//   ./caption_bench                 human readable table
+//   ./caption_bench --json          one JSON object per benchmark, for diffing in review
+//   ./caption_bench --filter merge  only benchmarks whose name contains "merge"
+//   ./caption_bench --samples 31 --min-ms 20
+//
+// Every benchmark is calibrated to run at least --min-ms per sample, then
+// sampled --samples times; the median is the headline number and the median
+// absolute deviation (MAD) tells whether a run was noisy. wchar_t is 4 bytes on
+// Linux and 2 on Windows, so compare numbers from the same platform only.
+#include "CaptionMerge.h"
+#include "CaptionText.h"
+#include "ClipboardPayload.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+template <class T>
+static void DoNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "r,m"(value) : "memory");
+#else
+	static volatile const void* sink;
+	sink = &value;
+#endif
+}
+
+// Deterministic word source, so every run measures the same text.
+class WordSource {
+public:
+	explicit WordSource(uint32_t seed) : m_state(seed) {}
+	const wchar_t* Next() {
+		static const wchar_t* const kWords[] = {
+			L"the", L"caption", L"of", L"and", L"meeting", L"we", L"should", L"probably", L"look", L"at",
+			L"numbers", L"quarter", L"I", L"think", L"that's", L"right", L"so", L"next", L"slide", L"please",
+			L"customers", L"really", L"want", L"it", L"to", L"be", L"faster", L"yeah,", L"okay.", L"thanks!",
+		};
+		m_state = m_state * 1664525u + 1013904223u;
+		return kWords[(m_state >> 16) % (sizeof(kWords) / sizeof(kWords[0]))];
+	}
+private:
+	uint32_t m_state;
+};
+
+// Imitates Live Caption: a window of the last ~windowChars of a transcript
+// that grows by a word or two per poll.
+class CaptionStream {
+public:
+	CaptionStream(uint32_t seed, size_t windowChars) : m_words(seed), m_windowChars(windowChars) {}
+	const std::wstring& Tick() {
+		int words = 1 + (int)(m_ticks++ % 3);
+		for (int i = 0; i < words; i++) {
+			if (!m_window.empty()) m_window += L' ';
+			m_window += m_words.Next();
+		}
+		if (m_window.length() > m_windowChars) {
+			size_t cut = m_window.find(L' ', m_window.length() - m_windowChars);
+			if (cut != std::wstring::npos) m_window.erase(0, cut + 1);
+		}
+		return m_window;
+	}
+private:
+	WordSource m_words;
+	size_t m_windowChars;
+	size_t m_ticks = 0;
+	std::wstring m_window;
+};
+
+static std::wstring MakeText(size_t chars, uint32_t seed) {
+	WordSource words(seed);
+	std::wstring text;
+	text.reserve(chars + 16);
+	while (text.length() < chars) {
+		if (!text.empty()) text += L' ';
+		text += words.Next();
+	}
+	text.resize(chars);
+	return text;
+}
+
+struct BenchOptions {
+	int samples = 21;
+	double minMs = 10.0;
+	const char* filter = nullptr;
+	bool json = false;
+};
+
+struct BenchResult {
+	std::string name;
+	size_t size = 0;
+	uint64_t iterations = 0;  // per sample
+	double medianNs = 0, minNs = 0, madNs = 0;  // per operation
+};
+
+// prepare() runs untimed before every sample; body(iterations) is timed.
+// maxIterations bounds calibration for bodies that consume prepared input.
+static BenchResult Measure(const BenchOptions& opt, const std::string& name, size_t size,
+	const std::function<void()>& prepare, const std::function<void(uint64_t)>& body,
+	uint64_t maxIterations = 1ull << 30) {
+	using Clock = std::chrono::steady_clock;
+	auto timeOnce = [&](uint64_t iterations) {
+		prepare();
+		auto start = Clock::now();
+		body(iterations);
+		return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+	};
+	uint64_t iterations = 1;
+	while (iterations < maxIterations && timeOnce(iterations) < opt.minMs * 1e6) iterations *= 2;
+	if (iterations > maxIterations) iterations = maxIterations;
+
+	std::vector<double> perOp;
+	timeOnce(iterations);  // warm-up
+	for (int i = 0; i < opt.samples; i++) perOp.push_back(timeOnce(iterations) / (double)iterations);
+	std::sort(perOp.begin(), perOp.end());
+	BenchResult r;
+	r.name = name;
+	r.size = size;
+	r.iterations = iterations;
+	r.medianNs = perOp[perOp.size() / 2];
+	r.minNs = perOp.front();
+	std::vector<double> deviations;
+	for (double v : perOp) deviations.push_back(v > r.medianNs ? v - r.medianNs : r.medianNs - v);
+	std::sort(deviations.begin(), deviations.end());
+	r.madNs = deviations[deviations.size() / 2];
+	return r;
+}
+
+static void Report(const BenchOptions& opt, const BenchResult& r) {
+	if (opt.json) {
+		printf("{\"name\":\"%s\",\"size\":%zu,\"iterations\":%llu,\"median_ns\":%.2f,\"min_ns\":%.2f,\"mad_ns\":%.2f}\n",
+			r.name.c_str(), r.size, (unsigned long long)r.iterations, r.medianNs, r.minNs, r.madNs);
+	}
+	else {
+		printf("%-28s %9zu %12.1f %12.1f %8.1f%%\n", r.name.c_str(), r.size, r.medianNs, r.minNs,
+			r.medianNs > 0 ? 100.0 * r.madNs / r.medianNs : 0.0);
+	}
+	fflush(stdout);
+}
+
+static bool Selected(const BenchOptions& opt, const char* name) {
+	return !opt.filter || std::strstr(name, opt.filter);
+}
+
+static const size_t kHistorySizes[] = { 1000, 10000, 100000, 1000000 };
+
+static void BenchMerge(const BenchOptions& opt) {
+	if (!Selected(opt, "merge_tick")) return;
+	for (size_t historyChars : kHistorySizes) {
+		// Warm up through real merges, pad the front of the history to the wanted
+		// size (older captions), then measure further ticks of the same stream.
+		CaptionStream stream(7, 400);
+		std::wstring history, previous;
+		for (int i = 0; i < 200; i++) MergeCaptionSnapshot(history, previous, stream.Tick());
+		if (history.length() < historyChars) history = MakeText(historyChars - history.length() - 1, 29) + L" " + history;
+		std::vector<std::wstring> snapshots;
+		CaptionStream ahead = stream;
+		for (int i = 0; i < 8192; i++) snapshots.push_back(ahead.Tick());
+
+		std::wstring h, p;
+		Report(opt, Measure(opt, "merge_tick", historyChars,
+			[&] { h = history; p = previous; },
+			[&](uint64_t n) {
+				for (uint64_t i = 0; i < n; i++) DoNotOptimize(MergeCaptionSnapshot(h, p, snapshots[i]));
+			}, snapshots.size()));
+	}
+}
+
+static void BenchMergeFallback(const BenchOptions& opt) {
+	if (!Selected(opt, "merge_unmatched")) return;
+	// A snapshot with no overlap with the previous one: every shift is tried and
+	// the text is appended (the worst case of the pattern search).
+	std::wstring previous = MakeText(400, 11), current = MakeText(420, 12);
+	std::wstring history = MakeText(10000, 13);
+	std::wstring h, p;
+	Report(opt, Measure(opt, "merge_unmatched", current.length(),
+		[&] {},
+		[&](uint64_t n) {
+			for (uint64_t i = 0; i < n; i++) {
+				h.assign(history, 0, 1000);
+				p = previous;
+				DoNotOptimize(MergeCaptionSnapshot(h, p, current));
+			}
+		}));
+}
+
+static void BenchFindWordStart(const BenchOptions& opt) {
+	if (!Selected(opt, "find_word_start")) return;
+	for (size_t chars : kHistorySizes) {
+		std::wstring text = MakeText(chars, 3);
+		std::vector<int> positions;
+		uint32_t state = 5;
+		for (int i = 0; i < 1024; i++) {
+			state = state * 1664525u + 1013904223u;
+			positions.push_back((int)(state % chars));
+		}
+		Report(opt, Measure(opt, "find_word_start", chars, [] {},
+			[&](uint64_t n) {
+				for (uint64_t i = 0; i < n; i++) DoNotOptimize(FindWordStart(text, positions[i & 1023]));
+			}));
+	}
+}
+
+static void BenchIsUiChrome(const BenchOptions& opt) {
+	if (!Selected(opt, "is_ui_chrome")) return;
+	// Element names seen while walking the Live Caption UIA tree, plus a caption.
+	std::wstring caption = MakeText(400, 17);
+	struct { const char* label; const wchar_t* name; } cases[] = {
+		{ "title", L"Live Captions" }, { "settings", L"Settings" }, { "edit", L"Edit" },
+		{ "caption_style", L"Caption style" }, { "caption", caption.c_str() },
+	};
+	for (const auto& c : cases) {
+		const wchar_t* name = c.name;
+		Report(opt, Measure(opt, std::string("is_ui_chrome:") + c.label, std::wcslen(name), [] {},
+			[&](uint64_t n) {
+				for (uint64_t i = 0; i < n; i++) DoNotOptimize(IsUiChrome(name));
+			}));
+	}
+}
+
+static void BenchFoldCase(const BenchOptions& opt) {
+	if (!Selected(opt, "fold_case")) return;
+	for (size_t chars : { (size_t)20, (size_t)400, (size_t)10000 }) {
+		std::wstring text = MakeText(chars, 19), work;
+		Report(opt, Measure(opt, "fold_case", chars, [] {},
+			[&](uint64_t n) {
+				for (uint64_t i = 0; i < n; i++) {
+					work = text;
+					FoldCase(work);
+					DoNotOptimize(work);
+				}
+			}));
+	}
+}
+
+static void BenchExtraction(const BenchOptions& opt) {
+	for (size_t chars : kHistorySizes) {
+		std::wstring history = MakeText(chars, 23);
+		size_t start = chars / 4;  // paste from an anchor a quarter into the history
+		if (Selected(opt, "history_copy")) {
+			Report(opt, Measure(opt, "history_copy", chars, [] {},
+				[&](uint64_t n) {
+					for (uint64_t i = 0; i < n; i++) {
+						std::wstring copy = history;
+						DoNotOptimize(copy);
+					}
+				}));
+		}
+		if (Selected(opt, "history_substr")) {
+			Report(opt, Measure(opt, "history_substr", chars - start, [] {},
+				[&](uint64_t n) {
+					for (uint64_t i = 0; i < n; i++) {
+						std::wstring part = history.substr(start);
+						DoNotOptimize(part);
+					}
+				}));
+		}
+		if (Selected(opt, "render_payload")) {
+			// What WM_RENDERFORMAT does for a delayed-rendered paste.
+			ClipboardPayload payload;
+			payload.start = start;
+			payload.length = chars - start;
+			std::vector<wchar_t> buffer(chars + 3);
+			Report(opt, Measure(opt, "render_payload", chars - start, [] {},
+				[&](uint64_t n) {
+					for (uint64_t i = 0; i < n; i++) {
+						size_t len = PayloadLength(payload, history);
+						DoNotOptimize(RenderPayload(payload, history, buffer.data(), len + 1));
+					}
+				}));
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	BenchOptions opt;
+	for (int i = 1; i < argc; i++) {
+		if (!std::strcmp(argv[i], "--json")) opt.json = true;
+		else if (!std::strcmp(argv[i], "--filter") && i + 1 < argc) opt.filter = argv[++i];
+		else if (!std::strcmp(argv[i], "--samples") && i + 1 < argc) opt.samples = (std::max)(1, std::atoi(argv[++i]));
+		else if (!std::strcmp(argv[i], "--min-ms") && i + 1 < argc) opt.minMs = std::atof(argv[++i]);
+		else {
+			fprintf(stderr, "usage: %s [--json] [--filter NAME] [--samples N] [--min-ms MS]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (!opt.json) printf("%-28s %9s %12s %12s %9s\n", "benchmark", "size", "median ns", "min ns", "MAD");
+	BenchMerge(opt);
+	BenchMergeFallback(opt);
+	BenchFindWordStart(opt);
+	BenchIsUiChrome(opt);
+	BenchFoldCase(opt);
+	BenchExtraction(opt);
+	return 0;
+}
@@ -0,0 +1,252 @@
+// Soak test for the caption merge path, driven by the synthetic Live Caption
+// stream in CaptionSynth. Feeds snapshots through MergeCaptionSnapshot the way
+// the poll timer does and reports throughput, memory growth and how far the
+// merged history is from the ground-truth transcript.
+//
+// Build and run on Linux (from LCCopier_C/bench):
+//   g++ -std=c++17 -O2 -pthread -I.. CaptionSoak.cpp CaptionSynth.cpp ../CaptionMerge.cpp ../CaptionText.cpp ../CaptionStream.cpp ../StreamServer.cpp -o caption_soak
+//   ./caption_soak --minutes 600                     ten simulated hours, as fast as possible
+//   ./caption_soak --minutes 60 --speed 100          one hour at 100x real time
+//   ./caption_soak --seed 7 --corpus talk.txt --json
+//   ./caption_soak --max-wer 0.15                    exit code 1 if the final word error rate is higher
+//   ./caption_soak --no-repeats                      merge without the RepeatIndex, for comparison
+//   ./caption_soak --speed 10 --serve /tmp/lc.sock   stream the merged transcript like the app's pipe
+//
+// The word error rate comes from a greedy, resynchronizing word alignment
+// rather than a full edit distance, so it is an approximation meant for
+// comparing runs. Insertions are mostly text the merge duplicated, deletions
+// text it lost. On the default generated corpus the merge scores about 0.12
+// (text revised where a snapshot could not be aligned, kept twice); a merge
+// that loses the history when the caption restarts after a pause scores close
+// to 1.
+#include "CaptionMerge.h"
+#include "CaptionStream.h"
+#include "CaptionSynth.h"
+#include "CaptionText.h"
+#include "StreamServer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwctype>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct SoakOptions {
+	SynthOptions synth;
+	double minutes = 60;
+	double speed = 0;          // x real time; 0 = unthrottled
+	double reportEvery = 10;   // simulated minutes
+	const char* corpusPath = nullptr;
+	const char* servePath = nullptr;
+	bool json = false;
+	bool repeats = true;       // RepeatIndex on the fallback path, as in the app
+	double maxWer = -1;
+};
+
+struct Alignment {
+	size_t matched = 0, substituted = 0, inserted = 0, deleted = 0;
+	size_t truthWords = 0;
+	double Wer() const { return truthWords ? (double)(substituted + inserted + deleted) / (double)truthWords : 0.0; }
+};
+
+// Lower-case words with surrounding punctuation removed.
+static std::vector<std::wstring> NormalizedWords(const std::wstring& text) {
+	std::vector<std::wstring> words = CaptionSynth::SplitWords(text);
+	for (std::wstring& w : words) {
+		FoldCase(w);
+		while (!w.empty() && std::iswpunct(w.back())) w.pop_back();
+		size_t lead = 0;
+		while (lead < w.size() && std::iswpunct(w[lead])) lead++;
+		w.erase(0, lead);
+	}
+	words.erase(std::remove(words.begin(), words.end(), std::wstring()), words.end());
+	return words;
+}
+
+// Greedy alignment: walk both word lists, and on a mismatch resynchronize at
+// the nearest point where two consecutive history words occur in the truth
+// (found through a bigram index, so whole lost passages are skipped in one
+// step). History words that never resynchronize count as insertions.
+static Alignment Align(const std::wstring& history, const std::wstring& truth) {
+	const size_t window = 32;
+	std::vector<std::wstring> h = NormalizedWords(history), t = NormalizedWords(truth);
+	std::unordered_map<std::wstring, std::vector<size_t>> bigrams;
+	for (size_t k = 0; k + 1 < t.size(); k++) bigrams[t[k] + L'\x1f' + t[k + 1]].push_back(k);
+
+	Alignment a;
+	a.truthWords = t.size();
+	size_t i = 0, j = 0;
+	while (i < h.size() && j < t.size()) {
+		if (h[i] == t[j]) {
+			a.matched++;
+			i++;
+			j++;
+			continue;
+		}
+		size_t bestX = 0, bestY = 0, bestCost = SIZE_MAX;
+		for (size_t x = 0; x < window && i + x + 1 < h.size() && x < bestCost; x++) {
+			auto it = bigrams.find(h[i + x] + L'\x1f' + h[i + x + 1]);
+			if (it == bigrams.end()) continue;
+			auto pos = std::lower_bound(it->second.begin(), it->second.end(), j);
+			if (pos == it->second.end()) continue;
+			size_t y = *pos - j;
+			if (x + y < bestCost) {
+				bestCost = x + y;
+				bestX = x;
+				bestY = y;
+			}
+		}
+		if (bestCost == SIZE_MAX) {
+			a.inserted++;
+			i++;
+			continue;
+		}
+		size_t common = (std::min)(bestX, bestY);
+		a.substituted += common;
+		a.inserted += bestX - common;
+		a.deleted += bestY - common;
+		i += bestX;
+		j += bestY;
+	}
+	a.inserted += h.size() - i;
+	a.deleted += t.size() - j;
+	return a;
+}
+
+static bool LoadCorpus(const char* path, std::vector<std::wstring>& words) {
+	FILE* f = fopen(path, "rb");
+	if (!f) return false;
+	std::string bytes;
+	char buffer[65536];
+	size_t n;
+	while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) bytes.append(buffer, n);
+	fclose(f);
+	words = CaptionSynth::SplitWords(DecodeUtf8(bytes));
+	return !words.empty();
+}
+
+static double ResidentMegabytes() {
+	FILE* f = fopen("/proc/self/statm", "r");
+	if (!f) return 0;
+	unsigned long size = 0, resident = 0;
+	int fields = fscanf(f, "%lu %lu", &size, &resident);
+	fclose(f);
+	return fields == 2 ? resident * 4096.0 / (1024.0 * 1024.0) : 0;
+}
+
+int main(int argc, char** argv) {
+	SoakOptions opt;
+	for (int i = 1; i < argc; i++) {
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (!std::strcmp(arg, "--json")) { opt.json = true; continue; }
+		if (!std::strcmp(arg, "--no-repeats")) { opt.repeats = false; continue; }
+		if (!value) { fprintf(stderr, "missing value for %s\n", arg); return 2; }
+		i++;
+		if (!std::strcmp(arg, "--seed")) opt.synth.seed = (uint32_t)std::strtoul(value, nullptr, 10);
+		else if (!std::strcmp(arg, "--minutes")) opt.minutes = std::atof(value);
+		else if (!std::strcmp(arg, "--speed")) opt.speed = std::atof(value);
+		else if (!std::strcmp(arg, "--report-every")) opt.reportEvery = std::atof(value);
+		else if (!std::strcmp(arg, "--corpus")) opt.corpusPath = value;
+		else if (!std::strcmp(arg, "--serve")) opt.servePath = value;
+		else if (!std::strcmp(arg, "--lines")) opt.synth.visibleLines = (size_t)std::atoi(value);
+		else if (!std::strcmp(arg, "--line-chars")) opt.synth.lineChars = (size_t)std::atoi(value);
+		else if (!std::strcmp(arg, "--revise")) opt.synth.reviseProbability = std::atof(value);
+		else if (!std::strcmp(arg, "--silence")) opt.synth.silenceProbability = std::atof(value);
+		else if (!std::strcmp(arg, "--max-wer")) opt.maxWer = std::atof(value);
+		else {
+			fprintf(stderr, "usage: %s [--seed N] [--minutes M] [--speed X] [--report-every M] [--corpus FILE] [--serve SOCKET]\n"
+				"       [--lines N] [--line-chars N] [--revise P] [--silence P] [--max-wer W] [--no-repeats] [--json]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	std::vector<std::wstring> corpus;
+	if (opt.corpusPath && !LoadCorpus(opt.corpusPath, corpus)) {
+		fprintf(stderr, "cannot read corpus %s\n", opt.corpusPath);
+		return 2;
+	}
+	CaptionSynth synth(std::move(corpus), opt.synth);
+	CaptionStream stream;
+	StreamServer server(stream);
+	if (opt.servePath && !server.Start(opt.servePath)) {
+		fprintf(stderr, "cannot serve on %s\n", opt.servePath);
+		return 2;
+	}
+
+	using Clock = std::chrono::steady_clock;
+	const uint64_t totalMs = (uint64_t)(opt.minutes * 60000.0);
+	const uint64_t reportMs = (uint64_t)(opt.reportEvery * 60000.0);
+	std::wstring history, previous, lastText;
+	RepeatIndex repeats;
+	uint64_t snapshots = 0, merges = 0, nextReportMs = reportMs;
+	uint64_t rewrites = 0, removedChars = 0, largestRemoval = 0;  // merges that took text back out of history
+	double mergeSeconds = 0, mergeMaxUs = 0;
+	Clock::time_point wallStart = Clock::now();
+
+	if (!opt.json) printf("%8s %10s %12s %12s %12s %8s %7s\n", "sim min", "snapshots", "merges/s", "history", "capacity", "RSS MB", "WER");
+	auto report = [&](bool final) {
+		double wall = std::chrono::duration<double>(Clock::now() - wallStart).count();
+		Alignment a = Align(history, synth.GroundTruth());
+		if (opt.json) {
+			printf("{\"final\":%s,\"sim_minutes\":%.1f,\"snapshots\":%llu,\"merges\":%llu,\"wall_s\":%.3f,"
+				"\"merge_us_mean\":%.2f,\"merge_us_max\":%.1f,\"rewrites\":%llu,\"removed_chars\":%llu,\"largest_removal\":%llu,\"history_chars\":%zu,\"history_capacity\":%zu,"
+				"\"rss_mb\":%.1f,\"truth_words\":%zu,\"matched\":%zu,\"substituted\":%zu,\"inserted\":%zu,\"deleted\":%zu,\"wer\":%.4f}\n",
+				final ? "true" : "false", synth.ElapsedMs() / 60000.0, (unsigned long long)snapshots, (unsigned long long)merges, wall,
+				merges ? mergeSeconds * 1e6 / merges : 0.0, mergeMaxUs,
+				(unsigned long long)rewrites, (unsigned long long)removedChars, (unsigned long long)largestRemoval,
+				history.size(), history.capacity(), ResidentMegabytes(), a.truthWords, a.matched, a.substituted, a.inserted, a.deleted, a.Wer());
+		}
+		else {
+			printf("%8.1f %10llu %12.0f %12zu %12zu %8.1f %7.3f\n", synth.ElapsedMs() / 60000.0, (unsigned long long)snapshots,
+				mergeSeconds > 0 ? merges / mergeSeconds : 0.0, history.size(), history.capacity(), ResidentMegabytes(), a.Wer());
+			if (final) {
+				printf("truth words %zu: matched %zu, substituted %zu, inserted %zu, deleted %zu; merge mean %.2f us, max %.1f us; wall %.2f s\n",
+					a.truthWords, a.matched, a.substituted, a.inserted, a.deleted,
+					merges ? mergeSeconds * 1e6 / merges : 0.0, mergeMaxUs, wall);
+				printf("rewrites %llu, %llu chars removed, largest %llu\n",
+					(unsigned long long)rewrites, (unsigned long long)removedChars, (unsigned long long)largestRemoval);
+			}
+		}
+		fflush(stdout);
+		return a;
+	};
+
+	while (synth.ElapsedMs() < totalMs) {
+		const std::wstring& text = synth.Next();
+		snapshots++;
+		// Same gating as the IDT_POLL_CAPTION handler.
+		if (text != lastText) {
+			if (!text.empty()) {
+				Clock::time_point start = Clock::now();
+				HistoryEdit edit = MergeCaptionSnapshot(history, previous, text, opt.repeats ? &repeats : nullptr);
+				double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+				mergeSeconds += us / 1e6;
+				if (us > mergeMaxUs) mergeMaxUs = us;
+				merges++;
+				if (edit.removed) {
+					rewrites++;
+					removedChars += edit.removed;
+					if (edit.removed > largestRemoval) largestRemoval = edit.removed;
+				}
+				if (opt.servePath) stream.Publish(edit, history);
+			}
+			lastText = text;
+		}
+		if (opt.servePath) stream.Service(history);
+		if (opt.speed > 0) {
+			std::this_thread::sleep_until(wallStart + std::chrono::microseconds((int64_t)(synth.ElapsedMs() * 1000.0 / opt.speed)));
+		}
+		if (reportMs && synth.ElapsedMs() >= nextReportMs && synth.ElapsedMs() < totalMs) {
+			report(false);
+			nextReportMs += reportMs;
+		}
+	}
+	Alignment final = report(true);
+	return opt.maxWer >= 0 && final.Wer() > opt.maxWer ? 1 : 0;
+}
@@ -0,0 +1,213 @@
+#include "CaptionSynth.h"
+#include <cwctype>
+#include <utility>
+
+static bool IsSentenceEnd(wchar_t ch) {
+	return ch == L'.' || ch == L'?' || ch == L'!';
+}
+
+// xorshift32: fast, and identical on every platform.
+static uint32_t XorShift(uint32_t& state) {
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+// One made-up sentence of 6 to 19 words, appended to words.
+static void AppendSentence(std::vector<std::wstring>& words, uint32_t& state) {
+	static const wchar_t* const onsets[] = { L"b", L"d", L"f", L"g", L"k", L"l", L"m", L"n", L"p", L"r", L"s", L"t", L"v", L"br", L"st", L"tr" };
+	static const wchar_t* const vowels[] = { L"a", L"e", L"i", L"o", L"u", L"ai", L"ou" };
+	for (uint32_t n = 6 + XorShift(state) % 14, i = 0; i < n; i++) {
+		std::wstring word;
+		for (uint32_t syllables = 1 + XorShift(state) % 3; syllables > 0; syllables--) {
+			word += onsets[XorShift(state) % 16];
+			word += vowels[XorShift(state) % 7];
+		}
+		if (i == 0) word[0] = (wchar_t)std::towupper(word[0]);
+		if (i + 1 == n) word += XorShift(state) % 5 ? L'.' : L'?';
+		else if (XorShift(state) % 12 == 0) word += L',';
+		words.push_back(std::move(word));
+	}
+}
+
+// Seeds 0 and 1 would otherwise start the same (and xorshift cannot start at 0).
+static uint32_t WordSeed(uint32_t seed) {
+	return (seed * 2654435761u + 0x9E3779B9u) | 1;
+}
+
+std::vector<std::wstring> CaptionSynth::GenerateWords(uint32_t seed, size_t count) {
+	uint32_t state = WordSeed(seed);
+	std::vector<std::wstring> words;
+	words.reserve(count + 20);
+	while (words.size() < count) AppendSentence(words, state);
+	words.resize(count);
+	return words;
+}
+
+std::vector<std::wstring> CaptionSynth::SplitWords(const std::wstring& text) {
+	std::vector<std::wstring> words;
+	std::wstring word;
+	for (wchar_t ch : text) {
+		if (std::iswspace(ch)) {
+			if (!word.empty()) words.push_back(std::move(word));
+			word.clear();
+		}
+		else {
+			word += ch;
+		}
+	}
+	if (!word.empty()) words.push_back(std::move(word));
+	return words;
+}
+
+CaptionSynth::CaptionSynth(std::vector<std::wstring> corpus, const SynthOptions& options)
+	: m_corpus(std::move(corpus)), m_options(options), m_state(options.seed ? options.seed : 1), m_wordState(WordSeed(options.seed)) {
+	if (m_corpus.empty()) {
+		m_generated = true;
+		m_corpusPos = GenerateSentence();
+		return;
+	}
+	// Sentences are dealt from a reshuffled deck, so a short corpus does not
+	// turn into an exactly repeating transcript, and no sentence comes back
+	// before all the others have been used.
+	m_sentenceStarts.push_back(0);
+	for (size_t i = 0; i + 1 < m_corpus.size(); i++) {
+		if (!m_corpus[i].empty() && IsSentenceEnd(m_corpus[i].back())) m_sentenceStarts.push_back(i + 1);
+	}
+	m_deckPos = m_sentenceStarts.size();
+	m_corpusPos = NextSentence();
+}
+
+size_t CaptionSynth::NextSentence() {
+	if (m_deckPos >= m_sentenceStarts.size()) {
+		for (size_t i = m_sentenceStarts.size(); i > 1; i--) std::swap(m_sentenceStarts[i - 1], m_sentenceStarts[Random() % i]);
+		m_deckPos = 0;
+	}
+	return m_sentenceStarts[m_deckPos++];
+}
+
+// Replaces m_corpus with the next made-up sentence.
+size_t CaptionSynth::GenerateSentence() {
+	m_corpus.clear();
+	AppendSentence(m_corpus, m_wordState);
+	return 0;
+}
+
+uint32_t CaptionSynth::Random() {
+	return XorShift(m_state);
+}
+
+double CaptionSynth::Uniform() {
+	return (Random() >> 8) / 16777216.0;
+}
+
+std::wstring CaptionSynth::Capitalized(const std::wstring& word, bool capital) {
+	if (!capital || word.empty()) return word;
+	std::wstring out = word;
+	out[0] = (wchar_t)std::towupper(out[0]);
+	return out;
+}
+
+void CaptionSynth::SpeakWord() {
+	Token t;
+	t.word = m_corpus[m_corpusPos];
+	if (!t.word.empty() && IsSentenceEnd(t.word.back())) {
+		t.punctuation = t.word.back();
+		t.word.pop_back();
+	}
+	if (t.word.empty()) t.word = L"uh";
+	// Capitals at sentence starts are the generator's job (they appear late).
+	if (m_sentenceStart && t.word != L"I") t.word[0] = (wchar_t)std::towlower(t.word[0]);
+	t.capital = m_sentenceStart;
+
+	if (Uniform() < m_options.reviseProbability) {
+		t.reviseTicks = 1 + Random() % (m_options.reviseMaxTicks ? m_options.reviseMaxTicks : 1);
+		if (t.word.size() > 3 && (Random() & 1)) {
+			t.shown = t.word.substr(0, 2 + Random() % (t.word.size() - 2));  // heard only partly so far
+		}
+		else {
+			t.shown = m_corpus[Random() % m_corpus.size()];
+			while (!t.shown.empty() && (IsSentenceEnd(t.shown.back()) || t.shown.back() == L',')) t.shown.pop_back();
+			if (t.shown.empty() || t.shown == t.word) t.shown = t.word + L"s";
+		}
+	}
+	if (t.punctuation) t.punctuationTicks = m_options.punctuationDelayTicks;
+
+	if (!m_truth.empty()) m_truth += L' ';
+	m_truth += Capitalized(t.word, t.capital);
+	if (t.punctuation) m_truth += t.punctuation;
+
+	m_sentenceStart = t.punctuation != 0;
+	m_utterance.push_back(std::move(t));
+	m_wordsSpoken++;
+
+	if (++m_corpusPos >= m_corpus.size() || m_sentenceStart) {
+		if (m_sentenceStart && Uniform() < m_options.silenceProbability) {
+			m_silenceUntilMs = m_elapsedMs + m_options.silenceMs;
+			m_clearAfterSilence = true;
+		}
+		m_corpusPos = m_generated ? GenerateSentence() : NextSentence();
+		m_sentenceStart = true;
+	}
+}
+
+void CaptionSynth::Render() {
+	// Word-wrap into lines and drop whole lines from the top until the rest
+	// fits, the way the caption window scrolls.
+	size_t lines = 0, lineLen = 0, firstLineEnd = 0;
+	for (size_t i = 0; i < m_utterance.size(); i++) {
+		const Token& t = m_utterance[i];
+		size_t len = t.reviseTicks ? t.shown.size() : t.word.size() + (t.punctuation ? 1 : 0);
+		if (lines == 0 || lineLen + 1 + len > m_options.lineChars) {
+			if (lines == 1) firstLineEnd = i;
+			lines++;
+			lineLen = len;
+		}
+		else {
+			lineLen += 1 + len;
+		}
+	}
+	if (lines > m_options.visibleLines && firstLineEnd) {
+		m_utterance.erase(m_utterance.begin(), m_utterance.begin() + firstLineEnd);
+		Render();
+		return;
+	}
+
+	m_visible.clear();
+	for (size_t i = 0; i < m_utterance.size(); i++) {
+		const Token& t = m_utterance[i];
+		if (i) m_visible += L' ';
+		if (t.reviseTicks) {
+			m_visible += t.shown;
+			continue;
+		}
+		// The capital after a sentence end appears together with its punctuation.
+		bool capital = t.capital && (i == 0 || m_utterance[i - 1].punctuationTicks == 0);
+		m_visible += Capitalized(t.word, capital);
+		if (t.punctuation && t.punctuationTicks == 0) m_visible += t.punctuation;
+	}
+}
+
+const std::wstring& CaptionSynth::Next() {
+	m_elapsedMs += m_options.tickMs;
+	for (Token& t : m_utterance) {
+		if (t.reviseTicks && --t.reviseTicks == 0) t.shown.clear();
+		if (t.punctuationTicks) t.punctuationTicks--;
+	}
+	if (m_elapsedMs >= m_silenceUntilMs) {
+		if (m_clearAfterSilence) {
+			m_utterance.clear();
+			m_clearAfterSilence = false;
+			m_wordCredit = 0;
+		}
+		// Speech comes in bursts: vary the rate per tick around the average.
+		m_wordCredit += m_options.wordsPerSecond * m_options.tickMs / 1000.0 * (0.5 + Uniform());
+		while (m_wordCredit >= 1.0 && !m_clearAfterSilence) {
+			SpeakWord();
+			m_wordCredit -= 1.0;
+		}
+	}
+	Render();
+	return m_visible;
+}
@@ -0,0 +1,91 @@
+#pragma once
+// Deterministic imitation of the Live Caption window, for load and soak tests
+// of the merge path on Linux. Given a seed and a corpus it produces the same
+// snapshot sequence every time, together with the ground-truth transcript.
+//
+// Modelled behaviour:
+// - the visible text is the last few word-wrapped lines of the current
+//   utterance; when a line is added the top one scrolls away;
+// - new words may first appear misrecognized (a prefix or a different word)
+//   and are corrected a few ticks later;
+// - sentence punctuation, and the capital letter after it, show up late, so
+//   text already seen is edited retroactively;
+// - after a silence the window is cleared and a new utterance starts.
+//
+// Without a corpus the words are made up from random syllables, a sentence at
+// a time, so the transcript never repeats and a merge that realigns onto
+// earlier text shows up in the ground-truth comparison.
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct SynthOptions {
+	uint32_t seed = 1;
+	uint32_t tickMs = 400;            // poll interval being simulated
+	double wordsPerSecond = 2.6;      // about 155 words per minute
+	size_t lineChars = 80;            // Live Caption wraps words into lines...
+	size_t visibleLines = 3;          // ...and scrolls whole lines off the top
+	double reviseProbability = 0.15;  // new word first shown wrong
+	uint32_t reviseMaxTicks = 3;      // ...and corrected within this many ticks
+	uint32_t punctuationDelayTicks = 2;
+	double silenceProbability = 0.08; // per sentence end
+	uint32_t silenceMs = 5000;
+};
+
+class CaptionSynth {
+public:
+	// corpus: words in reading order; sentence ends carry their punctuation.
+	// Sentences are dealt from it in shuffled rounds. An empty corpus makes up
+	// new sentences from options.seed for as long as the synth runs.
+	CaptionSynth(std::vector<std::wstring> corpus, const SynthOptions& options);
+
+	// Advance simulated time by one tick and return the visible caption text.
+	const std::wstring& Next();
+
+	uint64_t ElapsedMs() const { return m_elapsedMs; }
+	uint64_t WordsSpoken() const { return m_wordsSpoken; }
+	// Everything spoken so far, final form, words separated by single spaces.
+	const std::wstring& GroundTruth() const { return m_truth; }
+
+	static std::vector<std::wstring> SplitWords(const std::wstring& text);
+	// count made-up words in sentences, the same from the same seed: text in
+	// which a 20-unit pattern practically never occurs twice.
+	static std::vector<std::wstring> GenerateWords(uint32_t seed, size_t count);
+
+private:
+	struct Token {
+		std::wstring word;       // true word, without sentence punctuation
+		wchar_t punctuation = 0; // '.', '?', '!' at a sentence end
+		bool capital = false;    // first word of a sentence
+		std::wstring shown;      // misrecognized form while reviseTicks > 0
+		uint32_t reviseTicks = 0;
+		uint32_t punctuationTicks = 0; // punctuation still hidden for this many ticks
+	};
+
+	uint32_t Random();
+	double Uniform();
+	void SpeakWord();
+	void Render();
+	size_t NextSentence();
+	size_t GenerateSentence();
+	static std::wstring Capitalized(const std::wstring& word, bool capital);
+
+	std::vector<std::wstring> m_corpus;
+	std::vector<size_t> m_sentenceStarts;  // corpus index of each sentence's first word
+	size_t m_deckPos = 0;                   // next entry of the shuffled m_sentenceStarts
+	bool m_generated = false;               // m_corpus is the current made-up sentence
+	SynthOptions m_options;
+	uint32_t m_state;
+	uint32_t m_wordState;                   // generator for the made-up words
+	size_t m_corpusPos = 0;
+	uint64_t m_elapsedMs = 0;
+	uint64_t m_wordsSpoken = 0;
+	double m_wordCredit = 0;
+	uint64_t m_silenceUntilMs = 0;
+	bool m_clearAfterSilence = false;
+	bool m_sentenceStart = true;
+	std::vector<Token> m_utterance;  // tokens still in the visible window
+	std::wstring m_visible;
+	std::wstring m_truth;
+};
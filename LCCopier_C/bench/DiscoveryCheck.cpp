@@ -0,0 +1,291 @@
+// Checks for the caption window discovery cache against a simulated desktop:
+// windows come and go and change titles, the events a WinEvent hook would
+// deliver are passed on (or dropped, to play a missed event), and every title
+// fetch is counted, since that is what EnumWindows polling paid per window.
+//
+// Build and run on Linux (from LCCopier_C/bench):
+//   g++ -std=c++17 -O2 -I.. DiscoveryCheck.cpp ../WindowDiscovery.cpp -o discovery_check
+//   ./discovery_check                 checks, then title fetches per poll against polling
+//   ./discovery_check --windows 800 --seed 7 --steps 500000
+//
+// Exit code 1 if a check fails: the window is found without a scan when an
+// event names it, a steady caption costs one title fetch per poll, a destroyed
+// or renamed window is dropped, a reused handle is not mistaken for it, missed
+// events are caught up by the periodic scan, and over a random run every
+// lookup agrees with the desktop.
+#include "WindowDiscovery.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+static const wchar_t* const CAPTION_TITLE = L"Live Captions";
+static const uint64_t POLL_MS = 400;
+
+class Desktop {
+public:
+	Desktop() : discovery([this](WindowDiscovery::Handle h) { return Matches(h); }, [this] { return Scan(); }) {
+		discovery.SetEventsAvailable(true);
+	}
+
+	WindowDiscovery::Handle Create(const std::wstring& title) {
+		WindowDiscovery::Handle h;
+		if (!m_freed.empty() && m_reuse) {
+			h = m_freed.back();
+			m_freed.pop_back();
+		}
+		else {
+			h = m_next++;
+		}
+		windows[h] = title;
+		if (deliver) discovery.OnEvent(WindowEvent::Created, h);
+		return h;
+	}
+	void Destroy(WindowDiscovery::Handle h) {
+		windows.erase(h);
+		m_freed.push_back(h);
+		if (deliver) discovery.OnEvent(WindowEvent::Destroyed, h);
+	}
+	void Rename(WindowDiscovery::Handle h, const std::wstring& title) {
+		windows[h] = title;
+		if (deliver) discovery.OnEvent(WindowEvent::NameChanged, h);
+	}
+	void ReuseHandles(bool reuse) { m_reuse = reuse; }
+
+	WindowDiscovery::Handle Poll() {
+		nowMs += POLL_MS;
+		return discovery.Find(nowMs);
+	}
+	// What a lookup should return: a window titled CAPTION_TITLE, if any.
+	bool Agrees(WindowDiscovery::Handle found) const {
+		if (found) return Matches(found);
+		for (auto& w : windows) {
+			if (w.second == CAPTION_TITLE) return false;
+		}
+		return true;
+	}
+
+	std::map<WindowDiscovery::Handle, std::wstring> windows;
+	WindowDiscovery discovery;
+	bool deliver = true;
+	uint64_t nowMs = 1000000;
+	uint64_t titleFetches = 0;
+
+private:
+	bool Matches(WindowDiscovery::Handle h) const {
+		auto it = windows.find(h);
+		if (it == windows.end()) return false;
+		const_cast<Desktop*>(this)->titleFetches++;
+		return it->second == CAPTION_TITLE;
+	}
+	WindowDiscovery::Handle Scan() {
+		for (auto& w : windows) {
+			titleFetches++;
+			if (w.second == CAPTION_TITLE) return w.first;
+		}
+		return 0;
+	}
+
+	WindowDiscovery::Handle m_next = 0x10000;
+	std::vector<WindowDiscovery::Handle> m_freed;
+	bool m_reuse = false;
+};
+
+static int g_failures = 0;
+
+static void Check(bool ok, const char* what) {
+	printf("%-62s %s\n", what, ok ? "ok" : "FAILED");
+	if (!ok) g_failures++;
+}
+
+static void Populate(Desktop& desktop, int count) {
+	for (int i = 0; i < count; i++) desktop.Create(L"window " + std::to_wstring(i));
+}
+
+static void CheckNotRunning(int windowCount) {
+	Desktop desktop;
+	Populate(desktop, windowCount);
+	bool none = true;
+	// A minute of polls with a browser retitling its tab and windows coming and going.
+	for (int tick = 0; tick < 150; tick++) {
+		desktop.Rename(desktop.windows.begin()->first, L"tab " + std::to_wstring(tick));
+		if (tick % 10 == 0) desktop.Destroy(desktop.Create(L"popup"));
+		none = none && desktop.Poll() == 0;
+	}
+	uint64_t scans = desktop.discovery.ScanCount();
+	Check(none && scans <= 1 + 60000 / DISCOVERY_RESCAN_MS, "not running: a scan at start and one per rescan interval");
+}
+
+static void CheckFoundFromEvents(int windowCount) {
+	Desktop desktop;
+	Populate(desktop, windowCount);
+	desktop.Poll();
+	uint64_t scans = desktop.discovery.ScanCount();
+	WindowDiscovery::Handle caption = desktop.Create(CAPTION_TITLE);
+	Check(desktop.Poll() == caption && desktop.discovery.ScanCount() == scans, "created with its title: found without a scan");
+
+	Desktop named;
+	Populate(named, windowCount);
+	named.Poll();
+	scans = named.discovery.ScanCount();
+	WindowDiscovery::Handle untitled = named.Create(L"");
+	bool missing = named.Poll() == 0;
+	named.Rename(untitled, CAPTION_TITLE);
+	Check(missing && named.Poll() == untitled && named.discovery.ScanCount() == scans, "created untitled, then named: found without a scan");
+}
+
+static void CheckSteadyState(int windowCount) {
+	Desktop desktop;
+	Populate(desktop, windowCount);
+	WindowDiscovery::Handle caption = desktop.Create(CAPTION_TITLE);
+	desktop.Poll();
+	uint64_t scans = desktop.discovery.ScanCount();
+	uint64_t fetches = desktop.titleFetches;
+	bool same = true;
+	for (int tick = 0; tick < 1000; tick++) {
+		desktop.Rename(desktop.windows.begin()->first, L"tab " + std::to_wstring(tick));
+		if (tick % 10 == 0) desktop.Destroy(desktop.Create(L"popup"));
+		same = same && desktop.Poll() == caption;
+	}
+	Check(same && desktop.discovery.ScanCount() == scans && desktop.titleFetches - fetches == 1000,
+		"steady caption: no scans, one title fetch per poll");
+}
+
+static void CheckLost(int windowCount) {
+	Desktop desktop;
+	Populate(desktop, windowCount);
+	WindowDiscovery::Handle caption = desktop.Create(CAPTION_TITLE);
+	desktop.Poll();
+	uint64_t scans = desktop.discovery.ScanCount();
+	desktop.Destroy(caption);
+	bool gone = desktop.Poll() == 0 && desktop.Poll() == 0;
+	Check(gone && desktop.discovery.ScanCount() == scans + 1, "destroyed: dropped after one scan");
+
+	caption = desktop.Create(CAPTION_TITLE);
+	bool found = desktop.Poll() == caption;
+	desktop.Rename(caption, L"Settings");
+	Check(found && desktop.Poll() == 0, "renamed away: dropped");
+
+	// Two caption windows; closing the one in use falls back to the other.
+	WindowDiscovery::Handle first = desktop.Create(CAPTION_TITLE);
+	desktop.Poll();
+	desktop.Rename(caption, CAPTION_TITLE);
+	desktop.Destroy(first);
+	Check(desktop.Poll() == caption, "the other caption window is found when ours closes");
+}
+
+static void CheckMissedEvents(int windowCount) {
+	Desktop desktop;
+	Populate(desktop, windowCount);
+	desktop.ReuseHandles(true);
+	WindowDiscovery::Handle caption = desktop.Create(CAPTION_TITLE);
+	desktop.Poll();
+	// Destroyed without an event, and its handle handed to another window.
+	desktop.deliver = false;
+	desktop.Destroy(caption);
+	WindowDiscovery::Handle reused = desktop.Create(L"Notepad");
+	Check(reused == caption && desktop.Poll() == 0, "a reused handle is not taken for the caption window");
+
+	WindowDiscovery::Handle late = desktop.Create(CAPTION_TITLE);
+	int polls = 0;
+	while (desktop.Poll() != late && polls < 1000) polls++;
+	Check(polls < (int)(DISCOVERY_RESCAN_MS / POLL_MS) + 1, "a missed Created is caught up by the periodic scan");
+
+	Desktop polling;
+	Populate(polling, windowCount);
+	polling.discovery.SetEventsAvailable(false);
+	polling.deliver = false;
+	for (int tick = 0; tick < 10; tick++) polling.Poll();
+	Check(polling.discovery.ScanCount() == 10, "without window events every empty lookup scans");
+
+	Desktop burst;
+	Populate(burst, windowCount);
+	burst.Poll();
+	uint64_t scans = burst.discovery.ScanCount();
+	for (int i = 0; i < 4 * DISCOVERY_MAX_CANDIDATES; i++) burst.Create(L"burst");
+	WindowDiscovery::Handle named = burst.Create(CAPTION_TITLE);
+	Check(burst.Poll() == named && burst.discovery.ScanCount() == scans + 1, "a burst of events turns into one scan");
+}
+
+static void CheckRandom(int windowCount, unsigned seed, int steps) {
+	std::mt19937 rng(seed);
+	Desktop desktop;
+	desktop.ReuseHandles(true);
+	Populate(desktop, windowCount);
+	std::vector<std::wstring> titles = { L"", L"Notepad", L"tab", CAPTION_TITLE };
+	bool agrees = true;
+	int polls = 0;
+	for (int step = 0; step < steps; step++) {
+		unsigned op = rng() % 10;
+		if (op < 2 || desktop.windows.empty()) {
+			desktop.Create(titles[rng() % titles.size()]);
+		}
+		else if (op < 4 || desktop.windows.size() > (size_t)windowCount * 2) {
+			auto it = desktop.windows.begin();
+			std::advance(it, rng() % desktop.windows.size());
+			desktop.Destroy(it->first);
+		}
+		else if (op < 7) {
+			auto it = desktop.windows.begin();
+			std::advance(it, rng() % desktop.windows.size());
+			desktop.Rename(it->first, titles[rng() % titles.size()]);
+		}
+		else {
+			polls++;
+			agrees = agrees && desktop.Agrees(desktop.Poll());
+		}
+	}
+	printf("random: %d steps, %d lookups, %llu full scans\n", steps, polls, (unsigned long long)desktop.discovery.ScanCount());
+	Check(agrees, "random desktop: every lookup agrees with the windows open");
+}
+
+// Title fetches per poll over an hour: EnumWindows polling against the cache.
+static void BenchFetches(int windowCount) {
+	Desktop desktop;
+	Populate(desktop, windowCount);
+	const int polls = 3600 * 1000 / (int)POLL_MS;
+	WindowDiscovery::Handle caption = 0;
+	for (int tick = 0; tick < polls; tick++) {
+		// Live Caption is started a minute in, and closed and reopened every 20 minutes.
+		if (tick == 150 || (caption == 0 && tick % 3000 == 150)) caption = desktop.Create(CAPTION_TITLE);
+		else if (caption && tick % 3000 == 0) {
+			desktop.Destroy(caption);
+			caption = 0;
+		}
+		if (tick % 5 == 0) desktop.Rename(desktop.windows.begin()->first, L"tab " + std::to_wstring(tick));
+		desktop.Poll();
+	}
+	// Polling fetched titles up to the caption window, or all of them when it was closed.
+	printf("%d windows, %d polls: %.2f title fetches per poll with the cache, up to %d polling; %llu full scans\n",
+		windowCount, polls, (double)desktop.titleFetches / polls, windowCount + 1,
+		(unsigned long long)desktop.discovery.ScanCount());
+	fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+	int windowCount = 300;
+	unsigned seed = 1;
+	int steps = 200000;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (!std::strcmp(argv[i], "--windows")) windowCount = std::atoi(argv[i + 1]);
+		else if (!std::strcmp(argv[i], "--seed")) seed = (unsigned)std::atoi(argv[i + 1]);
+		else if (!std::strcmp(argv[i], "--steps")) steps = std::atoi(argv[i + 1]);
+		else {
+			fprintf(stderr, "usage: %s [--windows N] [--seed N] [--steps N]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (windowCount < 1) windowCount = 1;
+
+	CheckNotRunning(windowCount);
+	CheckFoundFromEvents(windowCount);
+	CheckSteadyState(windowCount);
+	CheckLost(windowCount);
+	CheckMissedEvents(windowCount);
+	CheckRandom(windowCount, seed, steps);
+	BenchFetches(windowCount);
+	return g_failures ? 1 : 0;
+}
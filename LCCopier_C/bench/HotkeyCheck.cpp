@@ -0,0 +1,299 @@
+// Checks for the hotkey matcher the keyboard hook feeds: modifier state kept
+// from key events alone, against a simulated keyboard that knows which keys
+// are really down, the way GetAsyncKeyState does in the app.
+//
+// Build and run on Linux (from LCCopier_C/bench):
+//   g++ -std=c++17 -O2 -I.. HotkeyCheck.cpp ../HotkeyEngine.cpp -o hotkey_check
+//   ./hotkey_check                    exit code 1 if a check fails
+//
+// Covered: bindings (modifier keys and out-of-range keys refused, a later
+// binding wins), modifiers pressed and released in any order, left and right
+// keys held together, the generic codes injected input uses, LLKHF_ALTDOWN
+// passed as an extra modifier, a key-up the hook never saw (a stuck modifier
+// until the resync from the real state), the app's own injected releases
+// (which the real state shows, but the user still holds the keys), and a
+// random run of all of these.
+#include "HotkeyEngine.h"
+#include <cstdio>
+#include <random>
+#include <set>
+
+enum : uint32_t {
+	VK_SHIFT = 0x10, VK_CONTROL = 0x11, VK_MENU = 0x12,
+	VK_LWIN = 0x5B, VK_RWIN = 0x5C,
+	VK_LSHIFT = 0xA0, VK_RSHIFT = 0xA1, VK_LCONTROL = 0xA2, VK_RCONTROL = 0xA3, VK_LMENU = 0xA4, VK_RMENU = 0xA5,
+	VK_F12 = 0x7B,
+};
+static const uint32_t kModifierVks[] = { VK_LCONTROL, VK_RCONTROL, VK_LSHIFT, VK_RSHIFT, VK_LMENU, VK_RMENU, VK_LWIN, VK_RWIN };
+
+// The keys really down, and what the hook is fed.
+class Keyboard {
+public:
+	explicit Keyboard(HotkeyEngine& engine) : m_engine(engine) {}
+
+	HotkeyAction Press(uint32_t vk) { return Key(vk, true); }
+	HotkeyAction Release(uint32_t vk) { return Key(vk, false); }
+	// SendOwnInput: a tagged event the hook passes on. An injected release
+	// shows in the real state until the user presses or releases the key.
+	// A generic code is taken to show on both keys.
+	void Inject(uint32_t vk, bool isDown) {
+		for (uint32_t key : { vk, Specific(vk, 0), Specific(vk, 1) }) {
+			if (!key) continue;
+			if (isDown) injectedUp.erase(key);
+			else injectedUp.insert(key);
+		}
+		m_engine.OnOwnKey(vk, isDown);
+	}
+	// SyncHotkeyModifiers: read every modifier's real state.
+	void Resync() {
+		for (uint32_t vk : kModifierVks) m_engine.ResyncModifier(vk, down.count(vk) != 0 && injectedUp.count(vk) == 0);
+	}
+	uint8_t RealModifiers() const {
+		uint8_t mods = 0;
+		if (down.count(VK_LCONTROL) || down.count(VK_RCONTROL)) mods |= HKMOD_CTRL;
+		if (down.count(VK_LSHIFT) || down.count(VK_RSHIFT)) mods |= HKMOD_SHIFT;
+		if (down.count(VK_LMENU) || down.count(VK_RMENU)) mods |= HKMOD_ALT;
+		if (down.count(VK_LWIN) || down.count(VK_RWIN)) mods |= HKMOD_WIN;
+		return mods;
+	}
+
+	std::set<uint32_t> down;
+	std::set<uint32_t> injectedUp;  // held, but released by injected input as GetAsyncKeyState sees it
+	bool deliver = true;  // false: the hook misses the events (secure desktop, hook timeout)
+
+private:
+	static uint32_t Specific(uint32_t vk, int right) {
+		switch (vk) {
+		case VK_SHIFT: return VK_LSHIFT + right;
+		case VK_CONTROL: return VK_LCONTROL + right;
+		case VK_MENU: return VK_LMENU + right;
+		}
+		return 0;
+	}
+
+	HotkeyAction Key(uint32_t vk, bool isDown) {
+		injectedUp.erase(vk);
+		if (isDown) down.insert(vk);
+		else down.erase(vk);
+		return deliver ? m_engine.OnKey(vk, isDown) : HotkeyAction::None;
+	}
+
+	HotkeyEngine& m_engine;
+};
+
+static int g_failures = 0;
+
+static void Check(bool ok, const char* what) {
+	printf("%-70s %s\n", what, ok ? "ok" : "FAILED");
+	if (!ok) g_failures++;
+}
+
+static const uint8_t kCopyMods = HKMOD_CTRL | HKMOD_SHIFT | HKMOD_ALT;
+
+static void Bind(HotkeyEngine& engine) {
+	engine.Bind(kCopyMods, '1', HotkeyAction::CopySentences);
+	engine.Bind(kCopyMods, 'Z', HotkeyAction::UndoClear);
+	engine.Bind(HKMOD_CTRL, 'Q', HotkeyAction::FindAndCopy);
+	engine.Bind(HKMOD_WIN | HKMOD_SHIFT, 'D', HotkeyAction::ClearHistory);
+}
+
+static void CheckBindings() {
+	HotkeyEngine engine;
+	bool refused = !engine.Bind(HKMOD_CTRL, VK_LSHIFT, HotkeyAction::FindAndCopy) && !engine.Bind(HKMOD_CTRL, VK_MENU, HotkeyAction::FindAndCopy) &&
+		!engine.Bind(HKMOD_CTRL, 256, HotkeyAction::FindAndCopy) && !engine.Bind(HKMOD_CTRL, 0, HotkeyAction::FindAndCopy);
+	Check(refused, "modifier keys, 0 and keys past 255 cannot be bound");
+
+	engine.Bind(kCopyMods, VK_F12, HotkeyAction::ShowDiagnostics);
+	engine.Bind(kCopyMods, VK_F12, HotkeyAction::FindAndCopy);
+	Check(engine.Lookup(VK_F12, kCopyMods) == HotkeyAction::FindAndCopy && engine.Lookup(VK_F12, HKMOD_CTRL) == HotkeyAction::None,
+		"a later binding for the same keys wins; other modifiers do not match");
+	engine.Clear();
+	Check(engine.Lookup(VK_F12, kCopyMods) == HotkeyAction::None, "Clear drops every binding");
+}
+
+static void CheckOrdering() {
+	HotkeyEngine engine;
+	Bind(engine);
+	Keyboard keys(engine);
+	keys.Press(VK_LSHIFT);
+	keys.Press(VK_RMENU);
+	HotkeyAction early = keys.Press('1');  // Ctrl not down yet
+	keys.Release('1');
+	keys.Press(VK_LCONTROL);
+	HotkeyAction first = keys.Press('1');
+	keys.Release('1');
+	HotkeyAction repeat = keys.Press('1');  // modifiers still held: fires again
+	keys.Release('1');
+	Check(early == HotkeyAction::None && first == HotkeyAction::CopySentences && repeat == HotkeyAction::CopySentences,
+		"modifiers pressed in any order; the hotkey repeats while they are held");
+
+	keys.Release(VK_LSHIFT);
+	HotkeyAction lessShift = keys.Press('1');
+	keys.Release('1');
+	keys.Release(VK_RMENU);
+	HotkeyAction ctrlOnly = keys.Press('Q');
+	keys.Release('Q');
+	keys.Release(VK_LCONTROL);
+	HotkeyAction none = keys.Press('Q');
+	keys.Release('Q');
+	Check(lessShift == HotkeyAction::None && ctrlOnly == HotkeyAction::FindAndCopy && none == HotkeyAction::None && engine.Modifiers() == 0,
+		"released in another order: each release drops only its modifier");
+
+	// Both Ctrl keys held: releasing one leaves Ctrl down.
+	keys.Press(VK_LCONTROL);
+	keys.Press(VK_RCONTROL);
+	keys.Release(VK_LCONTROL);
+	HotkeyAction right = keys.Press('Q');
+	keys.Release('Q');
+	keys.Release(VK_RCONTROL);
+	Check(right == HotkeyAction::FindAndCopy && engine.Modifiers() == 0, "left and right held together: one release keeps the modifier");
+
+	// Injected input names the generic codes; they count as the left keys.
+	keys.Press(VK_CONTROL);
+	bool generic = engine.Modifiers() == HKMOD_CTRL;
+	keys.Release(VK_CONTROL);
+	Check(generic && engine.Modifiers() == 0, "the generic Ctrl code counts as left Ctrl");
+
+	// LLKHF_ALTDOWN on an event, with the Alt-down itself not seen.
+	keys.Press(VK_LCONTROL);
+	keys.Press(VK_LSHIFT);
+	HotkeyAction withFlag = engine.OnKey('Z', true, HKMOD_ALT);
+	engine.OnKey('Z', false, HKMOD_ALT);
+	keys.Release(VK_LSHIFT);
+	keys.Release(VK_LCONTROL);
+	Check(withFlag == HotkeyAction::UndoClear && engine.Modifiers() == 0, "the hook's Alt flag counts without being tracked");
+
+	keys.Press(VK_RWIN);
+	keys.Press(VK_RSHIFT);
+	HotkeyAction win = keys.Press('D');
+	Check(win == HotkeyAction::ClearHistory, "the Win keys are modifiers too");
+}
+
+static void CheckLostKeyUps() {
+	HotkeyEngine engine;
+	Bind(engine);
+	Keyboard keys(engine);
+	keys.Press(VK_LCONTROL);
+	keys.deliver = false;  // e.g. Ctrl+Alt+Del: the key-up happens on the secure desktop
+	keys.Release(VK_LCONTROL);
+	keys.deliver = true;
+	HotkeyAction stuck = keys.Press('Q');
+	keys.Release('Q');
+	keys.Resync();
+	HotkeyAction resynced = keys.Press('Q');
+	keys.Release('Q');
+	Check(stuck == HotkeyAction::FindAndCopy && resynced == HotkeyAction::None && engine.Modifiers() == 0,
+		"a lost key-up leaves the modifier stuck until the resync");
+
+	// The opposite: a key-down never seen, held across a reinstalled hook.
+	keys.deliver = false;
+	keys.Press(VK_LCONTROL);
+	keys.deliver = true;
+	HotkeyAction missed = keys.Press('Q');
+	keys.Release('Q');
+	keys.Resync();
+	HotkeyAction found = keys.Press('Q');
+	keys.Release('Q');
+	Check(missed == HotkeyAction::None && found == HotkeyAction::FindAndCopy, "a lost key-down is picked up by the resync");
+
+	keys.Release(VK_LCONTROL);
+	keys.Press(VK_LSHIFT);
+	engine.ResetModifiers();
+	bool forgotten = engine.Modifiers() == 0;
+	keys.Resync();
+	Check(forgotten && engine.Modifiers() == HKMOD_SHIFT, "ResetModifiers forgets everything; a resync brings it back");
+}
+
+// The release-before-paste path: modifiers the user holds are released by
+// injected input, which GetAsyncKeyState reflects, and the keepalive resync
+// runs before the user's next digit.
+static void CheckOwnInput() {
+	HotkeyEngine engine;
+	Bind(engine);
+	Keyboard keys(engine);
+	keys.Press(VK_LCONTROL);
+	keys.Press(VK_LSHIFT);
+	keys.Press(VK_RMENU);
+	HotkeyAction first = keys.Press('1');
+	keys.Release('1');
+	keys.Inject(VK_LCONTROL, false);
+	keys.Inject(VK_LSHIFT, false);
+	keys.Inject(VK_MENU, false);  // the generic code, for the right key held
+	keys.Resync();
+	HotkeyAction again = keys.Press('1');
+	keys.Release('1');
+	keys.Resync();
+	HotkeyAction third = keys.Press('1');
+	keys.Release('1');
+	Check(first == HotkeyAction::CopySentences && again == HotkeyAction::CopySentences && third == HotkeyAction::CopySentences,
+		"injected release, then resync: the user's next digits still fire");
+
+	// A real event for a key makes its real state count again.
+	keys.Release(VK_LSHIFT);
+	keys.Resync();
+	bool shiftGone = engine.Modifiers() == (HKMOD_CTRL | HKMOD_ALT);
+	keys.Press(VK_LSHIFT);
+	keys.Inject(VK_LSHIFT, false);
+	keys.Resync();
+	Check(shiftGone && engine.Modifiers() == kCopyMods, "a real release after it is tracked; a new injected release is not");
+
+	// An injected release of a key the user is not holding changes nothing.
+	keys.Release(VK_LCONTROL);
+	keys.Release(VK_LSHIFT);
+	keys.Release(VK_RMENU);
+	keys.Inject(VK_LCONTROL, false);
+	keys.Resync();
+	Check(engine.Modifiers() == 0 && keys.Press('1') == HotkeyAction::None, "an injected release of a key not held changes nothing");
+	keys.Release('1');
+}
+
+// Random presses and releases with now and then a missed event: the tracked
+// modifiers match the keyboard whenever nothing was missed since the last
+// resync, and a binding fires exactly when its modifiers are really down.
+static void CheckRandom(unsigned seed, int steps) {
+	std::mt19937 rng(seed);
+	HotkeyEngine engine;
+	Bind(engine);
+	Keyboard keys(engine);
+	bool missed = false, tracked = true, fired = true;
+	int misses = 0, resyncs = 0;
+	for (int step = 0; step < steps; step++) {
+		unsigned op = rng() % 100;
+		if (op < 70) {
+			uint32_t vk = kModifierVks[rng() % 8];
+			bool isDown = keys.down.count(vk) == 0;
+			keys.deliver = rng() % 200 != 0;
+			if (!keys.deliver) {
+				missed = true;
+				misses++;
+			}
+			isDown ? keys.Press(vk) : keys.Release(vk);
+			keys.deliver = true;
+		}
+		else if (op < 97) {
+			static const uint32_t vks[] = { '1', 'Z', 'Q', 'D', 'X' };
+			uint32_t vk = vks[rng() % 5];
+			HotkeyAction action = keys.Press(vk);
+			keys.Release(vk);
+			if (!missed) fired = fired && action == engine.Lookup(vk, keys.RealModifiers());
+		}
+		else {
+			keys.Resync();
+			missed = false;
+			resyncs++;
+		}
+		if (!missed) tracked = tracked && engine.Modifiers() == keys.RealModifiers();
+	}
+	printf("random: %d steps, %d missed events, %d resyncs\n", steps, misses, resyncs);
+	Check(tracked, "random: the tracked modifiers match the keyboard");
+	Check(fired, "random: a binding fires exactly when its keys are down");
+}
+
+int main() {
+	CheckBindings();
+	CheckOrdering();
+	CheckLostKeyUps();
+	CheckOwnInput();
+	CheckRandom(1, 200000);
+	return g_failures ? 1 : 0;
+}
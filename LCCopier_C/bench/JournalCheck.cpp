@@ -0,0 +1,172 @@
+// Checks for the revision journal: over a long session of appends, tail
+// rewrites, clears and undone clears (each inserting the whole restored
+// history), the memory held stays within the documented bound, and what is
+// kept is right: TextAt gives the end of the history exactly as it was, from
+// the start it reports on.
+//
+// Build and run on Linux (from LCCopier_C/bench):
+//   g++ -std=c++17 -O2 -I.. JournalCheck.cpp ../RevisionJournal.cpp -o journal_check
+//   ./journal_check                   exit code 1 if a check fails
+//   ./journal_check --seed 7 --edits 400000
+#include "RevisionJournal.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <random>
+
+static int g_failures = 0;
+
+static void Check(bool ok, const char* what) {
+	printf("%-70s %s\n", what, ok ? "ok" : "FAILED");
+	if (!ok) g_failures++;
+}
+
+// The history as one edit left it: its length and its last units.
+struct Snapshot {
+	uint64_t ms;
+	size_t length;
+	std::wstring tail;
+};
+
+#define SNAPSHOT_UNITS 4096
+#define SNAPSHOTS      64
+
+// What TextAt gave for a moment agrees with the history then: it ends where
+// the history ended, and matches it over the units both have.
+static bool Agrees(const RevisionJournal& journal, const Snapshot& snapshot, size_t& coverage) {
+	size_t start = 0;
+	std::wstring text = journal.TextAt(snapshot.ms, &start);
+	if (start + text.size() != snapshot.length) return false;
+	coverage = text.size();
+	size_t n = (std::min)(text.size(), snapshot.tail.size());
+	return text.compare(text.size() - n, n, snapshot.tail, snapshot.tail.size() - n, n) == 0;
+}
+
+static std::wstring Words(std::mt19937& rng, size_t units) {
+	std::wstring text;
+	while (text.size() < units) {
+		text += (wchar_t)(L'a' + rng() % 26);
+		if (rng() % 6 == 0) text += L' ';
+	}
+	text.resize(units);
+	return text;
+}
+
+static void CheckSession(unsigned seed, int edits) {
+	std::mt19937 rng(seed);
+	RevisionJournal journal;
+	std::wstring history;
+	std::vector<std::wstring> cleared;
+	std::deque<Snapshot> snapshots;
+	size_t maxKept = 0, maxEdits = 0, longest = 0, restores = 0;
+	size_t shortNow = 0, checks = 0;
+	bool agrees = true;
+	for (int i = 1; i <= edits; i++) {
+		HistoryEdit edit;
+		unsigned op = rng() % 100000;
+		if (op < 5 && !history.empty()) {
+			// DoClearHistory
+			edit.removed = history.size();
+			cleared.push_back(std::move(history));
+			history.clear();
+		}
+		else if (op < 10 && !cleared.empty()) {
+			// DoUndoClear: the cleared history in front of what arrived since.
+			std::wstring restored = std::move(cleared.back());
+			cleared.pop_back();
+			if (!history.empty()) restored += L' ' + history;
+			edit.removed = history.size();
+			edit.inserted = restored.size();
+			history.swap(restored);
+			restores++;
+		}
+		else {
+			// The merge: rewrite up to the last 60 units, then append.
+			size_t back = op < 30000 ? (std::min)(history.size(), (size_t)(1 + rng() % 60)) : 0;
+			edit.offset = history.size() - back;
+			edit.removed = back;
+			history.resize(edit.offset);
+			history += Words(rng, back + rng() % 80);
+			edit.inserted = history.size() - edit.offset;
+			if (edit.Empty()) continue;
+		}
+		uint64_t ms = (uint64_t)i * 10;
+		journal.OnEdit(edit, history, ms);
+		longest = (std::max)(longest, history.size());
+		maxKept = (std::max)(maxKept, journal.KeptUnits());
+		maxEdits = (std::max)(maxEdits, journal.EditCount());
+
+		Snapshot snapshot{ ms, history.size(), history.substr(history.size() - (std::min)(history.size(), (size_t)SNAPSHOT_UNITS)) };
+		if (snapshots.size() == SNAPSHOTS) snapshots.pop_front();
+		snapshots.push_back(std::move(snapshot));
+		if (i % 997 == 0) {
+			size_t coverage = 0;
+			agrees = agrees && Agrees(journal, snapshots.back(), coverage);
+			if (coverage < (std::min)(history.size(), (size_t)SNAPSHOT_UNITS)) shortNow++;
+			agrees = agrees && Agrees(journal, snapshots[rng() % snapshots.size()], coverage);
+			checks++;
+		}
+	}
+	printf("session: %d edits, %zu undone clears, longest history %zu units, at most %zu units and %zu edits kept\n",
+		edits, restores, longest, maxKept, maxEdits);
+	Check(longest > 3 * (JOURNAL_MAX_CHARS + 2 * JOURNAL_BASE_CHARS), "the session outgrows the journal's bound three times over");
+	Check(maxKept <= JOURNAL_MAX_CHARS + 2 * JOURNAL_BASE_CHARS && maxEdits <= JOURNAL_MAX_EDITS,
+		"memory stays within JOURNAL_MAX_EDITS, JOURNAL_MAX_CHARS and the base");
+	Check(agrees, "TextAt gives the end of the history as it was");
+	Check(shortNow == 0, "the current history is kept back at least SNAPSHOT_UNITS");
+	printf("%zu TextAt checks\n", checks);
+}
+
+// A rewrite reaching back before what the base keeps is still reported, with
+// the part no longer kept marked.
+static void CheckReport() {
+	RevisionJournal journal;
+	std::wstring history(3 * JOURNAL_BASE_CHARS, L'x');
+	HistoryEdit edit;
+	edit.inserted = history.size();
+	journal.OnEdit(edit, history, 0);
+	// Push the first edit out of the journal, and the base past its trim.
+	std::mt19937 rng(5);
+	for (uint64_t ms = 1; ms <= (JOURNAL_MAX_CHARS + 3 * JOURNAL_BASE_CHARS) / 2048; ms++) {
+		edit.offset = history.size();
+		edit.removed = 0;
+		history += Words(rng, 2048);
+		edit.inserted = 2048;
+		journal.OnEdit(edit, history, ms);
+	}
+	size_t start = 0;
+	std::wstring now = journal.TextAt(UINT64_MAX, &start);
+	Check(start > 0 && start + now.size() == history.size() && history.compare(start, std::wstring::npos, now) == 0,
+		"the base keeps the end of the history once the start is dropped");
+
+	edit.offset = start - 10;
+	edit.removed = history.size() - edit.offset;
+	history.resize(edit.offset);
+	history += L"corrected";
+	edit.inserted = 9;
+	journal.OnEdit(edit, history, 200000);
+	std::wstring report = journal.RewriteReport();
+	Check(report.find(L"\"...") != std::wstring::npos && report.find(L"-> \"corrected\"") != std::wstring::npos,
+		"a rewrite from before the kept text is reported with the cut marked");
+	now = journal.TextAt(UINT64_MAX, &start);
+	Check(start == edit.offset && now == L"corrected", "after it, TextAt starts at the rewrite");
+}
+
+int main(int argc, char** argv) {
+	unsigned seed = 1;
+	int edits = 200000;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (!std::strcmp(argv[i], "--seed")) seed = (unsigned)std::atoi(argv[i + 1]);
+		else if (!std::strcmp(argv[i], "--edits")) edits = std::atoi(argv[i + 1]);
+		else {
+			fprintf(stderr, "usage: %s [--seed N] [--edits N]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	CheckSession(seed, edits);
+	CheckReport();
+	return g_failures ? 1 : 0;
+}
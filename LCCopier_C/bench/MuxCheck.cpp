@@ -0,0 +1,130 @@
+// Checks for the CaptureMux timeline: histories of several sources are
+// interleaved by arrival, a rewrite cuts its source's segments back and puts
+// the new text at the time it arrived, and once the oldest segments are
+// dropped every source's list of live segments stays within the bound. The
+// sources are scripted: each shows a text until the check changes it, and a
+// step waits until the source has been polled twice since, so its merge is
+// done.
+//
+// Build and run on Linux (from LCCopier_C/bench), with a small timeline so it
+// fills in a few seconds:
+//   g++ -std=c++17 -O2 -pthread -DCAPTURE_TIMELINE_SEGMENTS=8 -I.. MuxCheck.cpp ../CaptureMux.cpp ../CaptionMerge.cpp ../CaptionText.cpp -o mux_check
+//   ./mux_check                       exit code 1 if a check fails
+#include "CaptureMux.h"
+#include <chrono>
+#include <cstdio>
+#include <cwchar>
+#include <mutex>
+#include <thread>
+
+static int g_failures = 0;
+
+static void Check(bool ok, const char* what) {
+	printf("%-70s %s\n", what, ok ? "ok" : "FAILED");
+	if (!ok) g_failures++;
+}
+
+// What each source's window shows, and how often it was captured since.
+struct Script {
+	std::mutex lock;
+	std::wstring text[2];
+	unsigned polls[2] = {};
+
+	bool Capture(size_t source, std::wstring& out) {
+		std::lock_guard<std::mutex> guard(lock);
+		out = text[source];
+		polls[source]++;
+		return true;
+	}
+	void Show(size_t source, const std::wstring& shown) {
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			text[source] = shown;
+			polls[source] = 0;
+		}
+		for (;;) {
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				if (polls[source] >= 2) return;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+	}
+};
+
+// ", N timeline runs" on the source's Describe line.
+static size_t TimelineRuns(const CaptureMux& mux, const wchar_t* name) {
+	std::wstring text = mux.Describe();
+	size_t line = text.find(std::wstring(L"  ") + name + L":");
+	if (line == std::wstring::npos) return (size_t)-1;
+	size_t at = text.find(L" timeline runs", line);
+	size_t start = text.rfind(L", ", at);
+	return (size_t)std::wcstoul(text.c_str() + start + 2, nullptr, 10);
+}
+
+static bool EndsWith(const std::wstring& text, const std::wstring& end) {
+	return text.size() >= end.size() && text.compare(text.size() - end.size(), end.size(), end) == 0;
+}
+
+static void Print(const char* label, const std::wstring& text) {
+	std::string out;
+	for (wchar_t ch : text) out += ch == L'\r' ? "\\r" : ch == L'\n' ? "\\n" : std::string(1, (char)ch);
+	printf("%s: %s\n", label, out.c_str());
+}
+
+int main() {
+	Script script;
+	CaptureMux mux;
+	mux.AddSource(CaptureSourceSpec{ L"alpha", L"", CAPTURE_MIN_POLL_MS });
+	mux.AddSource(CaptureSourceSpec{ L"beta", L"", CAPTURE_MIN_POLL_MS });
+	mux.Start([&](size_t source, const CaptureSourceSpec&, std::wstring& text) { return script.Capture(source, text); },
+		0, true);
+
+	script.Show(0, L"hello there");
+	script.Show(1, L"bonjour");
+	script.Show(0, L"hello there how are you");
+	script.Show(0, L"hello there how are you today");
+	script.Show(1, L"bonjour ça va");
+	std::wstring timeline = mux.Timeline();
+	Check(timeline == L"[alpha] hello there\r\n[beta] bonjour\r\n[alpha]  how are you today\r\n[beta]  ça va",
+		"sources interleave by arrival; a source's next edit extends its run");
+	if (g_failures) Print("timeline", timeline);
+
+	// Live Caption revises the tail in a snapshot that also grows.
+	script.Show(0, L"hello there how are you now, right");
+	script.Show(1, L"bonjour ça va bien");
+	timeline = mux.Timeline();
+	Check(timeline == L"[alpha] hello there\r\n[beta] bonjour\r\n[alpha]  how are you \r\n[beta]  ça va\r\n[alpha] now, right\r\n[beta]  bien",
+		"a rewrite cuts its run back and the new text goes where it arrived");
+	if (g_failures) Print("timeline", timeline);
+
+	// Far more runs than the timeline keeps, alpha only appending.
+	std::wstring alpha = L"hello there how are you now, right", beta = L"bonjour ça va bien";
+	for (int i = 0; i < 3 * CAPTURE_TIMELINE_SEGMENTS; i++) {
+		alpha += L" a" + std::to_wstring(i);
+		script.Show(0, alpha);
+		beta += L" b" + std::to_wstring(i);
+		script.Show(1, beta);
+	}
+	size_t alphaRuns = TimelineRuns(mux, L"alpha"), betaRuns = TimelineRuns(mux, L"beta");
+	printf("timeline runs after %d steps: alpha %zu, beta %zu\n", 6 * CAPTURE_TIMELINE_SEGMENTS, alphaRuns, betaRuns);
+	Check(alphaRuns + betaRuns == CAPTURE_TIMELINE_SEGMENTS, "dropped segments leave every source's list of live ones");
+	timeline = mux.Timeline();
+	int last = 3 * CAPTURE_TIMELINE_SEGMENTS - 1;
+	int oldest = last - CAPTURE_TIMELINE_SEGMENTS / 2 + 1;
+	Check(EndsWith(timeline, L"[beta]  b" + std::to_wstring(last)) && timeline.find(L"[alpha]  a" + std::to_wstring(oldest)) == 0,
+		"the timeline holds the newest segments");
+
+	// A rewrite of all of alpha's live segments, and of dropped text before them.
+	size_t cut = alpha.rfind(L" a" + std::to_wstring(oldest)) - 1;
+	script.Show(0, alpha.substr(0, cut) + L"X rewritten and then some more");
+	std::wstring expected;
+	for (int i = oldest; i <= last; i++) expected += L" b" + std::to_wstring(i);
+	timeline = mux.Timeline();
+	Check(timeline == L"[beta] " + expected + L"\r\n[alpha] X rewritten and then some more",
+		"a rewrite past the dropped segments leaves only its new text");
+	if (g_failures) Print("timeline", timeline);
+	Check(TimelineRuns(mux, L"alpha") == 1, "and its source's list holds just that");
+	mux.Stop();
+	return g_failures ? 1 : 0;
+}
@@ -0,0 +1,617 @@
+// Checks for the paste pipeline, driven through IPastePlatform by a fake
+// platform with a fake clock: each call is logged with the time it was made,
+// and a scheduled wake moves the clock to it and calls OnWake, the way
+// IDT_PASTE_STEP does in the app.
+//
+// Build and run on Linux (from LCCopier_C/bench):
+//   g++ -std=c++17 -O2 -I.. PasteCheck.cpp ../PasteSequencer.cpp ../KeystrokePlan.cpp ../ClipboardPayload.cpp ../PasteCursor.cpp -o paste_check
+//   ./paste_check                     exit code 1 if a check fails
+//
+// Covered: the step order and the waits between steps, a request made while
+// busy (latest wins), Abort, and the clipboard being given back, or left alone
+// when placing the payload failed or the user's clipboard could not be saved.
+// For the typed path: KeystrokePlan's batches (never over the limit, never
+// splitting a surrogate pair), line breaks and tabs, and the length threshold
+// between typing and the clipboard. The outcome each request reports. For
+// "paste only what's new": PasteCursor
+// fed the way DoIncrementalPaste feeds it, checked against what the target
+// holds; text before the anchor is never erased, and a rewrite is erased with
+// one Backspace per keystroke that typed it.
+#include "PasteCursor.h"
+#include "PasteSequencer.h"
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+class FakePlatform : public IPastePlatform {
+public:
+	uint64_t NowMs() override { return now; }
+	void SendSelectAll() override { Log("select-all"); }
+	void PrepareClipboard() override {
+		Log("snapshot");
+		preparedAt = now + snapshotMs;
+	}
+	bool ClipboardPrepared() override { return now >= preparedAt; }
+	bool PlaceOnClipboard(const ClipboardPayload& payload) override {
+		Log(placeFailures ? "place-failed" : "place");
+		if (placeFailures) {
+			placeFailures--;
+			return false;
+		}
+		clipboard = Render(payload);
+		clipboardOwned = true;
+		return true;
+	}
+	void SendPasteKeys() override {
+		Log("ctrl-v");
+		target += clipboard;
+	}
+	void RestoreClipboard() override {
+		Log("restore");
+		clipboard = L"user's";
+		clipboardOwned = false;
+	}
+	void ReadPayload(const ClipboardPayload& payload, std::wstring& out) override { out = Render(payload); }
+	void ReleaseModifiers() override { Log("release-modifiers"); }
+	void SendKeyStrokes(const KeyStroke* strokes, size_t count) override {
+		Log("keys");
+		batchSizes.push_back(count);
+		for (size_t i = 0; i < count; i++) {
+			if (strokes[i].keyUp) continue;
+			if (strokes[i].vk == 0x08) Backspace();
+			else if (strokes[i].vk == 0x0D) target += L"\r\n";
+			else if (strokes[i].vk == 0x09) target += L'\t';
+			else target += (wchar_t)strokes[i].unit;
+		}
+	}
+	void ScheduleWake(uint32_t delayMs) override {
+		wakeAt = now + delayMs;
+		wakeScheduled = true;
+	}
+	void CancelWake() override { wakeScheduled = false; }
+
+	// Run the sequencer's timer until it stops asking for wakes.
+	void Pump(PasteSequencer& paste) {
+		while (wakeScheduled) {
+			wakeScheduled = false;
+			now = wakeAt;
+			paste.OnWake();
+		}
+	}
+	std::wstring Render(const ClipboardPayload& payload) const {
+		std::wstring out(PayloadLength(payload, history) + 1, L'\0');
+		out.resize(RenderPayload(payload, history, out.data(), out.size()));
+		return out;
+	}
+	std::string Steps() const {
+		std::string out;
+		for (auto& call : calls) out += (out.empty() ? "" : " ") + call.first;
+		return out;
+	}
+	// Time of the first call named step, relative to the start.
+	long long At(const char* step) const {
+		for (auto& call : calls) {
+			if (call.first == step) return (long long)(call.second - start);
+		}
+		return -1;
+	}
+	void Clear() {
+		calls.clear();
+		batchSizes.clear();
+		start = now;
+	}
+
+	std::wstring history;
+	std::wstring target;
+	std::wstring clipboard = L"user's";
+	bool clipboardOwned = false;
+	int placeFailures = 0;  // calls to PlaceOnClipboard that fail
+	uint64_t snapshotMs = 0;  // how long saving the user's clipboard takes
+	uint64_t preparedAt = 0;
+	std::vector<std::pair<std::string, uint64_t>> calls;
+	std::vector<size_t> batchSizes;
+	uint64_t now = 1000, start = 1000, wakeAt = 0;
+	bool wakeScheduled = false;
+
+	size_t backspaces = 0;
+
+private:
+	void Log(const char* step) { calls.emplace_back(step, now); }
+	// Like an edit control: a line break or a surrogate pair goes in one keystroke.
+	void Backspace() {
+		backspaces++;
+		size_t n = target.size();
+		if (n == 0) return;
+		bool pair = n >= 2 && ((target[n - 2] == L'\r' && target[n - 1] == L'\n') ||
+			(target[n - 2] >= 0xD800 && target[n - 2] <= 0xDBFF && target[n - 1] >= 0xDC00 && target[n - 1] <= 0xDFFF));
+		target.resize(n - (pair ? 2 : 1));
+	}
+};
+
+static int g_failures = 0;
+
+static void Check(bool ok, const char* what) {
+	printf("%-70s %s\n", what, ok ? "ok" : "FAILED");
+	if (!ok) g_failures++;
+}
+
+static ClipboardPayload Range(size_t start, size_t length) {
+	ClipboardPayload payload;
+	payload.start = start;
+	payload.length = length;
+	return payload;
+}
+
+static void CheckClipboardOrder() {
+	FakePlatform platform;
+	platform.history = std::wstring(1000, L'x');
+	PasteSequencer paste(platform);
+	paste.Start(Range(0, 1000), true);
+	// Start only runs what is due now; the rest waits for timer wakes.
+	bool returnedEarly = platform.Steps() == "snapshot select-all" && paste.Busy();
+	platform.Pump(paste);
+	Check(returnedEarly && platform.Steps() == "snapshot select-all place ctrl-v restore", "clipboard path: select-all, place, Ctrl+V, restore");
+	Check(platform.At("place") == PASTE_SELECT_ALL_SETTLE_MS &&
+		platform.At("ctrl-v") == PASTE_SELECT_ALL_SETTLE_MS + PASTE_CLIPBOARD_SETTLE_MS &&
+		platform.At("restore") == PASTE_SELECT_ALL_SETTLE_MS + PASTE_CLIPBOARD_SETTLE_MS + PASTE_RESTORE_DELAY_MS,
+		"clipboard path: each step waits for the one before to settle");
+	Check(platform.target == platform.history && !platform.clipboardOwned && platform.clipboard == L"user's" && !paste.Busy(),
+		"clipboard path: payload pasted, user's clipboard given back");
+
+	platform.Clear();
+	paste.Start(Range(0, 1000), false);
+	platform.Pump(paste);
+	Check(platform.Steps() == "snapshot place ctrl-v restore" && platform.At("place") == 0, "append: no select-all, placed at once");
+}
+
+static void CheckTypedOrder() {
+	FakePlatform platform;
+	platform.history = L"hello world";
+	PasteSequencer paste(platform);
+	platform.target = L"old";
+	paste.Start(Range(0, 11), true);
+	platform.Pump(paste);
+	Check(platform.Steps() == "select-all release-modifiers keys" && platform.At("keys") == PASTE_SELECT_ALL_SETTLE_MS,
+		"typed path: select-all, release modifiers, keys");
+	Check(platform.clipboard == L"user's" && platform.target == L"oldhello world", "typed path: clipboard untouched");
+
+	// Backspaces go first, then the long payload through the clipboard.
+	platform.history = std::wstring(PASTE_TYPE_MAX_CHARS + 1, L'y');
+	platform.target = L"abc";
+	platform.Clear();
+	paste.Start(Range(0, PASTE_TYPE_MAX_CHARS + 1), false, 2);
+	platform.Pump(paste);
+	Check(platform.Steps() == "snapshot release-modifiers keys place ctrl-v restore" && platform.target == L"a" + platform.history,
+		"backspaces are typed before a clipboard paste");
+}
+
+static void CheckLatestWins() {
+	FakePlatform platform;
+	platform.history = std::wstring(2000, L'z');
+	PasteSequencer paste(platform);
+	paste.Start(Range(0, 1000), false);
+	paste.Start(Range(0, 1200), false);
+	paste.Start(Range(0, 1500), true);
+	bool busy = paste.Busy() && platform.Steps() == "snapshot place";
+	platform.Pump(paste);
+	Check(busy && platform.Steps() == "snapshot place ctrl-v restore snapshot select-all place ctrl-v restore",
+		"requests made while busy: only the latest runs, after the first");
+	Check(platform.target.size() == 2500 && !platform.clipboardOwned, "requests made while busy: the dropped one is never pasted");
+	Check(!paste.Start(Range(0, 0), false) && !paste.Busy(), "an empty request does nothing");
+}
+
+static void CheckAbort() {
+	FakePlatform platform;
+	platform.history = std::wstring(1000, L'x');
+	PasteSequencer paste(platform);
+	paste.Start(Range(0, 1000), false);
+	paste.Start(Range(0, 500), false);
+	platform.now += PASTE_CLIPBOARD_SETTLE_MS;  // the payload is on the clipboard, Ctrl+V not sent yet
+	paste.Abort();
+	bool restored = !platform.clipboardOwned && platform.clipboard == L"user's" && !platform.wakeScheduled;
+	platform.Pump(paste);
+	Check(restored && !paste.Busy() && platform.Steps() == "snapshot place restore" && platform.target.empty(),
+		"abort after placing: clipboard restored, pending request dropped");
+
+	platform.Clear();
+	paste.Start(Range(0, 1000), true);
+	paste.Abort();
+	platform.Pump(paste);
+	Check(platform.Steps() == "snapshot select-all" && !paste.Busy(), "abort before placing: nothing to restore");
+}
+
+static void CheckPlaceFailure() {
+	FakePlatform platform;
+	platform.history = std::wstring(1000, L'x');
+	PasteSequencer paste(platform);
+	platform.placeFailures = 1;
+	paste.Start(Range(0, 1000), true);
+	paste.Start(Range(0, 600), false);  // queued behind the select-all wait
+	platform.Pump(paste);
+	Check(platform.Steps() == "snapshot select-all place-failed snapshot place ctrl-v restore" && platform.target.size() == 600,
+		"placing fails: no Ctrl+V or restore, the pending request still runs");
+	Check(!platform.clipboardOwned && platform.clipboard == L"user's", "placing fails: the user's clipboard is left alone");
+}
+
+static void CheckSnapshotWait() {
+	FakePlatform platform;
+	platform.history = std::wstring(1000, L'x');
+	PasteSequencer paste(platform);
+	// Saving the user's clipboard overlaps the select-all wait...
+	platform.snapshotMs = PASTE_SELECT_ALL_SETTLE_MS - 5;
+	paste.Start(Range(0, 1000), true);
+	platform.Pump(paste);
+	Check(platform.At("place") == PASTE_SELECT_ALL_SETTLE_MS, "a quick clipboard snapshot does not delay the paste");
+
+	// ...and a slow one holds the clipboard step back without blocking.
+	platform.Clear();
+	platform.snapshotMs = 300;
+	paste.Start(Range(0, 1000), false);
+	platform.Pump(paste);
+	long long placed = platform.At("place");
+	Check(placed >= 300 && placed < 300 + PASTE_PREPARE_POLL_MS + 1 && platform.Steps() == "snapshot place ctrl-v restore",
+		"placing waits for a slow clipboard snapshot");
+
+	platform.Clear();
+	platform.snapshotMs = PASTE_PREPARE_TIMEOUT_MS * 2;
+	platform.target.clear();
+	paste.Start(Range(0, 1000), false);
+	platform.Pump(paste);
+	Check(platform.Steps() == "snapshot" && platform.target.empty() && !paste.Busy() && !platform.clipboardOwned,
+		"a clipboard that cannot be saved in time: the paste is dropped");
+}
+
+// What the target ends up with from a plan: line breaks all arrive as "\n".
+static std::wstring Typed(const KeystrokePlan& plan) {
+	std::wstring out;
+	for (size_t b = 0; b < plan.BatchCount(); b++) {
+		const KeyStroke* strokes = plan.BatchData(b);
+		for (size_t i = 0; i < plan.BatchSize(b); i++) {
+			if (strokes[i].keyUp) continue;
+			if (strokes[i].vk == 0x08) out += L'\b';
+			else if (strokes[i].vk == 0x0D) out += L'\n';
+			else if (strokes[i].vk == 0x09) out += L'\t';
+			else out += (wchar_t)strokes[i].unit;
+		}
+	}
+	return out;
+}
+
+static std::wstring NormalizeBreaks(const std::wstring& text) {
+	std::wstring out;
+	for (size_t i = 0; i < text.size(); i++) {
+		if (text[i] == L'\r') {
+			if (i + 1 < text.size() && text[i + 1] == L'\n') i++;
+			out += L'\n';
+		}
+		else {
+			out += text[i];
+		}
+	}
+	return out;
+}
+
+// Every batch within the limit, made of whole down/up pairs, and no surrogate
+// pair cut between two batches.
+static bool BatchesWellFormed(const KeystrokePlan& plan, size_t maxBatchEvents) {
+	for (size_t b = 0; b < plan.BatchCount(); b++) {
+		size_t size = plan.BatchSize(b);
+		if (size == 0 || size > maxBatchEvents || size % 2) return false;
+		if (b == 0) continue;
+		const KeyStroke& first = plan.BatchData(b)[0];
+		const KeyStroke& last = plan.BatchData(b - 1)[plan.BatchSize(b - 1) - 2];
+		if (!first.vk && first.unit >= 0xDC00 && first.unit <= 0xDFFF && !last.vk && last.unit >= 0xD800 && last.unit <= 0xDBFF) return false;
+	}
+	return true;
+}
+
+// U+1F600 as the two UTF-16 units the history holds (wchar_t is wider on Linux).
+static const wchar_t kPair[] = { (wchar_t)0xD83D, (wchar_t)0xDE00, 0 };
+
+static void CheckPlanBatches() {
+	KeystrokePlan plan;
+	plan.Build(std::wstring(1000, L'a'), PASTE_TYPE_BATCH_EVENTS);
+	bool split = plan.EventCount() == 2000 && plan.BatchCount() == 4 && plan.BatchSize(0) == PASTE_TYPE_BATCH_EVENTS &&
+		plan.BatchSize(3) == 2000 - 3 * PASTE_TYPE_BATCH_EVENTS;
+	Check(split && BatchesWellFormed(plan, PASTE_TYPE_BATCH_EVENTS), "batches are filled up to PASTE_TYPE_BATCH_EVENTS");
+
+	// One BMP character, then pairs: every pair would straddle a 4-event boundary.
+	std::wstring pairs = L"a";
+	for (int i = 0; i < 50; i++) pairs += kPair;
+	plan.Build(pairs, 8);
+	Check(BatchesWellFormed(plan, 8) && Typed(plan) == pairs && plan.BatchSize(0) == 6, "a surrogate pair is never split across batches");
+
+	plan.Build(L"a\r\nb\rc\nd\te", 64);
+	Check(Typed(plan) == L"a\nb\nc\nd\te" && plan.EventCount() == 18 && plan.BatchData(0)[2].vk == 0x0D,
+		"CRLF, CR and LF are one Enter each; Tab is a Tab key");
+
+	std::wstring lone = L"x";
+	lone += (wchar_t)0xD83D;
+	lone += L"y";
+	lone += (wchar_t)0xDE00;
+	plan.Build(lone, 4);
+	Check(Typed(plan) == lone && BatchesWellFormed(plan, 4), "lone surrogates go out as single units");
+
+	plan.Build(L"abc", 4, 3);
+	Check(Typed(plan) == L"\b\b\babc" && plan.BatchCount() == 3, "backspaces come first, batched like text");
+
+	plan.Build(L"abcd", 1);
+	Check(plan.BatchCount() == 2 && BatchesWellFormed(plan, 4), "a batch limit under 4 events is raised to 4");
+
+	plan.Build(L"", PASTE_TYPE_BATCH_EVENTS);
+	Check(plan.BatchCount() == 0 && plan.EventCount() == 0, "empty text, no backspaces: nothing to send");
+
+	std::mt19937 rng(1);
+	const wchar_t* pieces[] = { L"a", L"\u00e9", L"\r\n", L"\n", L"\r", L"\t", kPair };
+	bool agrees = true;
+	for (int round = 0; round < 2000 && agrees; round++) {
+		std::wstring text;
+		size_t length = rng() % 200;
+		while (text.size() < length) text += pieces[rng() % (sizeof(pieces) / sizeof(pieces[0]))];
+		size_t batch = 4 + rng() % 60;
+		size_t backspaces = rng() % 4;
+		plan.Build(text, batch, backspaces);
+		agrees = BatchesWellFormed(plan, batch) && Typed(plan) == std::wstring(backspaces, L'\b') + NormalizeBreaks(text);
+	}
+	Check(agrees, "random text: batches well formed, typed text round-trips");
+}
+
+static void CheckTypeThreshold() {
+	FakePlatform platform;
+	platform.history = std::wstring(PASTE_TYPE_MAX_CHARS + 1, L'q');
+	PasteSequencer paste(platform);
+	paste.Start(Range(0, PASTE_TYPE_MAX_CHARS), false);
+	platform.Pump(paste);
+	bool typed = platform.Steps().find("place") == std::string::npos && platform.target.size() == PASTE_TYPE_MAX_CHARS;
+	size_t batches = platform.batchSizes.size();
+	bool sized = batches == (2 * PASTE_TYPE_MAX_CHARS + PASTE_TYPE_BATCH_EVENTS - 1) / PASTE_TYPE_BATCH_EVENTS;
+	for (size_t size : platform.batchSizes) sized = sized && size <= PASTE_TYPE_BATCH_EVENTS;
+	Check(typed && sized, "up to PASTE_TYPE_MAX_CHARS: typed, in full batches");
+	Check(platform.calls.size() < 2 || platform.calls.back().second - platform.calls[1].second == (batches - 1) * PASTE_TYPE_BATCH_GAP_MS,
+		"typed batches are spaced by PASTE_TYPE_BATCH_GAP_MS");
+
+	platform.Clear();
+	platform.target.clear();
+	paste.Start(Range(0, PASTE_TYPE_MAX_CHARS + 1), false);
+	platform.Pump(paste);
+	Check(platform.Steps() == "snapshot place ctrl-v restore" && platform.batchSizes.empty(), "one unit over: through the clipboard");
+
+	platform.Clear();
+	paste.SetTypeThreshold(0);
+	paste.Start(Range(0, 3), false);
+	platform.Pump(paste);
+	Check(platform.Steps() == "snapshot place ctrl-v restore", "threshold 0: always through the clipboard");
+}
+
+static void CheckReports() {
+	FakePlatform platform;
+	platform.history = std::wstring(1000, L'x');
+	PasteSequencer paste(platform);
+	std::vector<std::string> results;
+	auto record = [&results](const char* name) {
+		return [&results, name](const PasteResult& r) {
+			results.push_back(std::string(name) + (r.backspacesSent ? " erased" : "") + (r.textSent ? " sent" : ""));
+		};
+	};
+	paste.Start(Range(0, 500), false, 0, record("first"));
+	paste.Start(Range(0, 10), false, 3, record("dropped"));
+	paste.Start(Range(0, 10), false, 3, record("typed"));
+	platform.Pump(paste);
+	platform.placeFailures = 1;
+	paste.Start(Range(0, 500), false, 2, record("failed"));
+	platform.Pump(paste);
+	paste.Start(Range(0, 0), false, 2, record("erase-only"));
+	platform.Pump(paste);
+	std::string got;
+	for (auto& r : results) got += (got.empty() ? "" : ", ") + r;
+	Check(got == "first sent, dropped, typed erased sent, failed erased, erase-only erased sent",
+		"each request reports once what reached the target");
+}
+
+// The app side of "paste only what's new", as in LiveCaption.cpp.
+class IncrementalApp {
+public:
+	IncrementalApp() : paste(platform) {}
+
+	// Live Caption replaced history[offset..] with tail.
+	void Edit(size_t offset, const std::wstring& tail) {
+		HistoryEdit edit;
+		edit.offset = offset;
+		edit.removed = platform.history.size() - offset;
+		edit.inserted = tail.size();
+		platform.history.replace(offset, std::wstring::npos, tail);
+		cursor.OnEdit(edit);
+	}
+	void Append(const std::wstring& text) { Edit(platform.history.size(), text); }
+	void Anchor(size_t start) { cursor.Reset(start); }
+
+	// DoIncrementalPaste; the paste runs to the end unless pump is false.
+	PasteCursor::Delta Paste(bool pump = true) {
+		PasteCursor::Delta delta = cursor.Pending(platform.history);
+		ClipboardPayload payload;
+		payload.start = delta.start;
+		payload.length = delta.length;
+		payload.leadingBreak = delta.lineBreak;
+		paste.Start(payload, false, delta.retract, [this, delta, payload](const PasteResult& result) {
+			if (result.textSent) cursor.OnPasted(delta, PayloadRange(payload, platform.history));
+			else if (result.backspacesSent) cursor.OnRetracted(delta);
+		});
+		if (pump) platform.Pump(paste);
+		return delta;
+	}
+
+	FakePlatform platform;
+	PasteSequencer paste;
+	PasteCursor cursor;
+};
+
+static const std::wstring kUserText = L"Notes typed by hand: ";
+
+static void CheckCursorAnchor() {
+	IncrementalApp app;
+	app.platform.target = kUserText;
+	app.Append(L"the first sentence. The second one");
+	app.Anchor(20);  // "The second one"
+	// Live Caption re-punctuates a word before the anchor; nothing was pasted yet.
+	app.Edit(10, L"sentence, the second one");
+	PasteCursor::Delta delta = app.Paste();
+	Check(delta.retract == 0 && !delta.lineBreak && app.platform.backspaces == 0 && app.platform.target == kUserText + L"the second one",
+		"anchor, then a rewrite before it: nothing erased, paste from the anchor");
+
+	// Rewritten from before the pasted range: a fresh line, still nothing erased.
+	app.Edit(10, L"sentences. The second one is long");
+	delta = app.Paste();
+	Check(delta.lineBreak && app.platform.backspaces == 0 &&
+		app.platform.target == kUserText + L"the second one\r\n" + app.platform.history.substr(20),
+		"a rewrite starting before the pasted range: re-pasted on a new line");
+}
+
+static void CheckCursorKeystrokes() {
+	IncrementalApp app;
+	app.platform.target = kUserText;
+	std::wstring smile = kPair;
+	app.Append(L"line one\r\nsee " + smile + smile + L" ok");
+	app.Anchor(0);
+	app.Paste();
+	// "\r\nsee XX ok" becomes "\r\nsaw it": the break, "see", two pairs and " ok"
+	// are 1 + 4 + 2 + 3 Backspaces, though 14 units.
+	app.Edit(8, L"\r\nsaw it");
+	app.platform.backspaces = 0;
+	PasteCursor::Delta delta = app.Paste();
+	Check(delta.retract == 10 && app.platform.backspaces == 10 && app.platform.target == kUserText + app.platform.history,
+		"a retract counts keystrokes, not UTF-16 units");
+
+	// A rewrite starting inside a pair or a line break erases all of it.
+	app.Append(L"\r\n" + smile);
+	app.Paste();
+	app.Edit(app.platform.history.size() - 1, std::wstring(1, (wchar_t)0xDE01));
+	app.platform.backspaces = 0;
+	app.Paste();
+	Check(app.platform.backspaces == 1 && app.platform.target == kUserText + app.platform.history, "a rewrite inside a surrogate pair erases the pair once");
+}
+
+static void CheckCursorInFlight() {
+	IncrementalApp app;
+	app.platform.target = kUserText;
+	app.Append(std::wstring(300, L'a'));  // long enough for the clipboard
+	app.Anchor(0);
+	app.platform.snapshotMs = 100;
+	app.Paste(false);
+	// A merge lands while the paste waits for the clipboard snapshot.
+	app.platform.now += 50;
+	app.Edit(290, L"bbbbbbbbbbbbbbbbbbbb");
+	app.platform.Pump(app.paste);
+	// The payload is placed after the merge: the target got the range asked
+	// for, with the merged text in it, and the merge's overflow comes next.
+	bool got = app.platform.target == kUserText + app.platform.history.substr(0, 300);
+	app.Append(L" more");
+	app.platform.backspaces = 0;
+	app.Paste();
+	Check(got && app.platform.backspaces == 0 && app.platform.target == kUserText + app.platform.history,
+		"a merge before the payload is placed: marked as placed, not as asked");
+
+	// Backspaces typed, then the clipboard fails: they are not counted twice.
+	size_t kept = app.platform.history.size() - 4;
+	app.Edit(kept, L"ore text that is long enough to need the clipboard " + std::wstring(300, L'c'));
+	app.platform.placeFailures = 1;
+	app.platform.snapshotMs = 0;
+	app.platform.backspaces = 0;
+	app.Paste();
+	bool retracted = app.platform.backspaces == 4 && app.platform.target == kUserText + app.platform.history.substr(0, kept);
+	app.platform.backspaces = 0;
+	app.Paste();
+	Check(retracted && app.platform.backspaces == 0 && app.platform.target == kUserText + app.platform.history,
+		"placing fails after the Backspaces: the next paste does not erase again");
+}
+
+// The last sentences, pasted without the whitespace after them (DoCopyLastSentences).
+static void CheckCursorPartialRange() {
+	IncrementalApp app;
+	app.platform.target = kUserText;
+	app.Append(L"One sentence. Two words.  ");
+	ClipboardPayload payload = Range(14, 10);  // "Two words."
+	app.paste.Start(payload, false, 0, [&app, payload](const PasteResult& result) {
+		if (result.textSent) app.cursor.MarkPasted(payload.start, PayloadRange(payload, app.platform.history));
+	});
+	app.platform.Pump(app.paste);
+	app.Edit(24, L" Three");
+	PasteCursor::Delta delta = app.Paste();
+	Check(delta.start == 24 && delta.retract == 0 && app.platform.target == kUserText + app.platform.history.substr(14),
+		"after a partial range: the next delta starts where it ended");
+	app.Edit(18, L"birds. Three");
+	app.platform.backspaces = 0;
+	delta = app.Paste();
+	Check(delta.retract == 12 && app.platform.target == kUserText + app.platform.history.substr(14),
+		"after a partial range: a rewrite inside it is erased, nothing before it");
+	app.Edit(3, L" sentence, two birds. Three");
+	delta = app.Paste();
+	Check(delta.lineBreak && app.platform.target.compare(0, kUserText.size() + 4, kUserText + L"Two ") == 0,
+		"after a partial range: a rewrite before it goes on a new line");
+}
+
+// Random tail rewrites and pastes. After every paste with no merge in between,
+// the target holds the user's text, untouched, then the current pasted line
+// equal to the history it was pasted from.
+static void CheckCursorRandom(unsigned seed, int rounds) {
+	std::mt19937 rng(seed);
+	const std::wstring pieces[] = { L"word ", L"a", L". ", L"\r\n", kPair, std::wstring(40, L'x') };
+	IncrementalApp app;
+	app.platform.target = kUserText;
+	for (int i = 0; i < 20; i++) app.Append(pieces[rng() % 6]);
+	size_t anchor = app.platform.history.size() / 2;
+	while (anchor > 0 && (app.platform.history[anchor] == L'\n' || (app.platform.history[anchor] >= 0xDC00 && app.platform.history[anchor] <= 0xDFFF))) anchor--;
+	app.Anchor(anchor);
+	size_t lineTarget = kUserText.size(), lineHistory = anchor;
+	bool intact = true, matches = true;
+	int breaks = 0, retracts = 0;
+	for (int round = 0; round < rounds && intact && matches; round++) {
+		unsigned op = rng() % 10;
+		std::wstring& history = app.platform.history;
+		if (op < 5) {
+			std::wstring tail;
+			for (unsigned n = rng() % 4; n > 0; n--) tail += pieces[rng() % 6];
+			// Mostly near the end, now and then far back; never inside a pair or a line break.
+			size_t back = rng() % 10 == 0 ? rng() % (history.size() + 1) : rng() % 30;
+			size_t offset = back > history.size() ? 0 : history.size() - back;
+			while (offset > 0 && offset < history.size() && (history[offset] == L'\n' || (history[offset] >= 0xDC00 && history[offset] <= 0xDFFF))) offset--;
+			app.Edit(offset, tail);
+		}
+		else {
+			size_t targetBefore = app.platform.target.size();
+			PasteCursor::Delta delta = app.Paste();
+			if (delta.lineBreak && delta.length) {
+				breaks++;
+				lineTarget = targetBefore + 2;
+				lineHistory = delta.start;
+			}
+			if (delta.retract) retracts++;
+			intact = app.platform.target.compare(0, kUserText.size(), kUserText) == 0;
+			// Cut back to before the pasted line with nothing new yet: the new line waits.
+			if (delta.lineBreak && !delta.length) continue;
+			matches = app.platform.target.size() >= lineTarget && lineHistory <= history.size() &&
+				app.platform.target.substr(lineTarget) == history.substr(lineHistory);
+		}
+	}
+	printf("random cursor: %d rounds, %d retracts, %d new lines\n", rounds, retracts, breaks);
+	Check(intact, "random rewrites: the user's text is never erased");
+	Check(matches, "random rewrites: the pasted line matches the history");
+}
+
+int main() {
+	CheckClipboardOrder();
+	CheckTypedOrder();
+	CheckLatestWins();
+	CheckAbort();
+	CheckPlaceFailure();
+	CheckSnapshotWait();
+	CheckPlanBatches();
+	CheckTypeThreshold();
+	CheckReports();
+	CheckCursorAnchor();
+	CheckCursorKeystrokes();
+	CheckCursorInFlight();
+	CheckCursorPartialRange();
+	CheckCursorRandom(1, 20000);
+	return g_failures ? 1 : 0;
+}
@@ -0,0 +1,228 @@
+// Checks for the RepeatIndex and the merge's fallback for snapshots it cannot
+// align (an ASR reset): recent text the reset re-emits is spliced onto the end
+// of history rather than appended again, a repeat of something older than
+// REPEAT_WINDOW is kept, and a snapshot that only repeats history changes
+// nothing. The index itself is compared with a brute-force search of the
+// history as it grows, is rewritten, ages out and is cleared.
+//
+// Build and run on Linux (from LCCopier_C/bench):
+//   g++ -std=c++17 -O2 -I.. RepeatCheck.cpp ../CaptionMerge.cpp ../CaptionText.cpp -o repeat_check
+//   ./repeat_check                    exit code 1 if a check fails
+//   ./repeat_check --seed 7 --edits 50000
+#include "CaptionMerge.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwctype>
+#include <random>
+
+static int g_failures = 0;
+
+static void Check(bool ok, const char* what) {
+	printf("%-70s %s\n", what, ok ? "ok" : "FAILED");
+	if (!ok) g_failures++;
+}
+
+static std::wstring Words(std::mt19937& rng, size_t units) {
+	static const wchar_t* const kSyllables[] = { L"ka", L"lo", L"mi", L"ne", L"su", L"ta", L"ri", L"vo", L"de", L"pa" };
+	std::wstring text;
+	while (text.size() < units) {
+		if (!text.empty()) text += L' ';
+		for (unsigned n = 1 + rng() % 3; n; n--) text += kSyllables[rng() % 10];
+	}
+	text.resize(units);
+	return text;
+}
+
+// History set up in one edit, and a previous caption no snapshot below aligns
+// with (and shorter than each), so each one goes to the fallback.
+struct Merge {
+	std::wstring history;
+	std::wstring previousCaption = L"[caption not aligned]";
+	RepeatIndex repeats;
+
+	explicit Merge(const std::wstring& text) {
+		history = text;
+		HistoryEdit edit;
+		edit.inserted = text.size();
+		repeats.OnEdit(edit, history);
+	}
+	HistoryEdit Snapshot(const std::wstring& text) {
+		return MergeCaptionSnapshot(history, previousCaption, text, &repeats);
+	}
+};
+
+static void CheckFallback() {
+	std::mt19937 rng(11);
+	const std::wstring tail = L"the meeting will resume after lunch today.";
+	std::wstring before = Words(rng, 3000) + L". " + tail;
+
+	Merge reset(before);
+	HistoryEdit edit = reset.Snapshot(tail + L" and then we continue");
+	Check(reset.history == before + L" and then we continue" && edit.offset == before.size() && !edit.removed,
+		"a reset that re-emits recent text is spliced, not duplicated");
+	Merge cased(before);
+	cased.Snapshot(L"The meeting will resume after lunch today, and then we continue");
+	Check(cased.history == before.substr(0, before.size() - tail.size()) + L"The meeting will resume after lunch today, and then we continue",
+		"the splice takes the re-emitted text's case and punctuation");
+
+	Merge unchanged(before);
+	edit = unchanged.Snapshot(tail);
+	Check(edit.Empty() && unchanged.history == before, "re-emitting only the end of history is a no-op");
+
+	const std::wstring older = L"the budget for next year is approved";
+	std::wstring recent = L"some earlier words, " + older + L", and " + Words(rng, 300);
+	Merge again(recent);
+	size_t count = 0;
+	edit = again.Snapshot(older);
+	std::wstring kept = again.previousCaption;
+	Check(edit.Empty() && again.history == recent && kept == L"[caption not aligned]",
+		"an all-repeat snapshot is a no-op and leaves previousCaption");
+	again.Snapshot(older + L" unanimously");
+	for (size_t pos = again.history.find(older); pos != std::wstring::npos; pos = again.history.find(older, pos + 1)) count++;
+	Check(count == 1 && again.history == recent + L" unanimously",
+		"older text again: only what follows it is appended");
+
+	std::wstring old = older + L" " + Words(rng, REPEAT_WINDOW + 100);
+	Merge aged(old);
+	aged.Snapshot(older + L" unanimously");
+	Check(aged.history == old + L" " + older + L" unanimously", "a repeat older than REPEAT_WINDOW is not suppressed");
+}
+
+static std::wstring Folded(const std::wstring& text) {
+	std::wstring out = text;
+	for (wchar_t& ch : out) ch = (wchar_t)std::towlower(ch);
+	return out;
+}
+
+// Brute force: where the last occurrence of text's first REPEAT_MIN_CHARS
+// units (folded) ending in the last REPEAT_WINDOW units of history starts, or
+// npos. foldedTail is history from tailStart on, folded.
+static size_t LatestRepeat(const std::wstring& foldedTail, size_t tailStart, size_t historyLength, const std::wstring& text) {
+	size_t pos = foldedTail.rfind(Folded(text.substr(0, REPEAT_MIN_CHARS)));
+	if (pos == std::wstring::npos || tailStart + pos + REPEAT_MIN_CHARS + REPEAT_WINDOW < historyLength) return std::wstring::npos;
+	return tailStart + pos;
+}
+
+struct IndexStats {
+	size_t lookups = 0, found = 0, wrong = 0, missed = 0;
+	size_t aged = 0, agedFound = 0;  // history text whose every occurrence is older than the window
+};
+
+// Look up pieces of history (and text it lacks). A hit must be a real,
+// folded match within the window, as long as it goes; with exact set, every
+// repeat must also be found at its latest occurrence.
+static void Probe(std::mt19937& rng, const RepeatIndex& index, const std::wstring& history, bool exact, IndexStats& stats) {
+	size_t tailStart = history.size() > REPEAT_WINDOW + REPEAT_MIN_CHARS ? history.size() - REPEAT_WINDOW - REPEAT_MIN_CHARS : 0;
+	std::wstring foldedTail = Folded(history.substr(tailStart));
+	for (int i = 0; i < 8; i++) {
+		std::wstring text;
+		bool fromHistory = history.size() >= 80 && rng() % 4;
+		if (fromHistory) {
+			// Half from the window, half from anywhere (mostly older).
+			size_t from = rng() % 2 && history.size() > REPEAT_WINDOW ? history.size() - REPEAT_WINDOW : 0;
+			size_t start = from + rng() % (history.size() - REPEAT_MIN_CHARS - from);
+			text = history.substr(start, REPEAT_MIN_CHARS + rng() % 40);
+			if (rng() % 2) text += Words(rng, 10);
+			if (rng() % 3 == 0) for (wchar_t& ch : text) ch = (wchar_t)std::towupper(ch);
+		}
+		else {
+			text = Words(rng, 30 + rng() % 30);
+		}
+		size_t matchEnd = 0;
+		size_t length = index.LongestRepeat(history, text, matchEnd);
+		size_t expected = text.size() >= REPEAT_MIN_CHARS ? LatestRepeat(foldedTail, tailStart, history.size(), text) : std::wstring::npos;
+		stats.lookups++;
+		if (fromHistory && expected == std::wstring::npos) {
+			stats.aged++;
+			if (length) stats.agedFound++;
+		}
+		if (length) {
+			stats.found++;
+			size_t start = matchEnd - length;
+			size_t common = 0;
+			while (common < text.size() && start + common < history.size() &&
+				std::towlower(history[start + common]) == std::towlower(text[common])) common++;
+			bool inWindow = start + REPEAT_MIN_CHARS + REPEAT_WINDOW >= history.size();
+			if (common != length || !inWindow || (exact && start != expected)) stats.wrong++;
+		}
+		else if (expected != std::wstring::npos) {
+			stats.missed++;
+		}
+	}
+}
+
+// Appends grow the history and age text out of the window; with rewrites
+// mixed in, windows are forgotten; then the history is cleared again and
+// again, each time before it fills the window, so whatever a clear leaves in
+// the table piles up.
+static void CheckIndex(unsigned seed, int edits) {
+	std::mt19937 rng(seed);
+	RepeatIndex index;
+	std::wstring history;
+	IndexStats appendOnly, rewritten, afterClear;
+	std::wstring cleared;
+	bool clearedFound = false;
+	for (int phase = 0; phase < 3; phase++) {
+		IndexStats& stats = phase == 0 ? appendOnly : phase == 1 ? rewritten : afterClear;
+		size_t sinceClear = 0;
+		for (int i = 0; i < edits / 3; i++) {
+			if (phase == 2 && (i == 0 || history.size() > REPEAT_WINDOW / 2)) {
+				cleared = history.substr(history.size() - 100);
+				index.Clear();
+				history.clear();
+				sinceClear = 0;
+			}
+			HistoryEdit edit;
+			size_t back = phase == 1 && rng() % 3 == 0 ? (std::min)(history.size(), (size_t)(1 + rng() % 60)) : 0;
+			edit.offset = history.size() - back;
+			edit.removed = back;
+			history.resize(edit.offset);
+			// Often a copy of earlier text, recent or long gone.
+			if (history.size() > 200 && rng() % 3 == 0) {
+				size_t from = rng() % 2 ? history.size() - 200 + rng() % 150 : rng() % (history.size() - 50);
+				history += L' ' + history.substr(from, 30 + rng() % 20);
+			}
+			else {
+				history += L' ' + Words(rng, 5 + rng() % 60);
+			}
+			edit.inserted = history.size() - edit.offset;
+			index.OnEdit(edit, history);
+			if (i % 7 == 0) Probe(rng, index, history, phase != 1, stats);
+			if (phase == 2 && sinceClear++ < 10) {
+				size_t matchEnd = 0;
+				for (size_t start = 0; start + REPEAT_MIN_CHARS <= cleared.size(); start += 10) {
+					if (index.LongestRepeat(history, cleared.substr(start), matchEnd)) clearedFound = true;
+				}
+			}
+		}
+	}
+	printf("index: %zu/%zu/%zu lookups (appends, rewrites, after a clear), %zu/%zu/%zu found\n",
+		appendOnly.lookups, rewritten.lookups, afterClear.lookups, appendOnly.found, rewritten.found, afterClear.found);
+	Check(appendOnly.found > 0 && !appendOnly.wrong && !appendOnly.missed,
+		"appends: every repeat in the window is found, at its latest occurrence");
+	Check(appendOnly.aged > 0 && !appendOnly.agedFound && !rewritten.agedFound && !afterClear.agedFound,
+		"eviction: text older than REPEAT_WINDOW is not found");
+	Check(rewritten.found > 0 && !rewritten.wrong, "rewrites: a repeat found is real, in the window, as long as it goes");
+	Check(!clearedFound, "after a clear: the cleared text is not found");
+	Check(afterClear.found > 0 && !afterClear.wrong && !afterClear.missed,
+		"after a clear: the new history is found, all of it");
+}
+
+int main(int argc, char** argv) {
+	unsigned seed = 1;
+	int edits = 30000;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (!std::strcmp(argv[i], "--seed")) seed = (unsigned)std::atoi(argv[i + 1]);
+		else if (!std::strcmp(argv[i], "--edits")) edits = std::atoi(argv[i + 1]);
+		else {
+			fprintf(stderr, "usage: %s [--seed N] [--edits N]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	CheckFallback();
+	CheckIndex(seed, edits);
+	return g_failures ? 1 : 0;
+}
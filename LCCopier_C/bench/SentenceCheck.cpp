@@ -0,0 +1,146 @@
+// Checks for the SentenceIndex: a terminator Live Caption adds to the tail
+// later splits the open sentence and a rewrite that removes it joins them
+// again, a lower-case word after a terminator continues the sentence, and a
+// sentence without one is split after SENTENCE_MAX_CHARS. A run of random
+// appends and tail rewrites compares StartOfLast with an index built from
+// scratch over the same history after every edit.
+//
+// Build and run on Linux (from LCCopier_C/bench):
+//   g++ -std=c++17 -O2 -I.. SentenceCheck.cpp ../SentenceIndex.cpp -o sentence_check
+//   ./sentence_check                  exit code 1 if a check fails
+//   ./sentence_check --seed 7 --edits 100000
+#include "SentenceIndex.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+static int g_failures = 0;
+
+static void Check(bool ok, const char* what) {
+	printf("%-70s %s\n", what, ok ? "ok" : "FAILED");
+	if (!ok) g_failures++;
+}
+
+// A history fed to the index the way UpdateCaptionHistory does.
+struct Session {
+	SentenceIndex sentences;
+	std::wstring history;
+
+	// Replace history from offset on with text.
+	void Edit(size_t offset, const std::wstring& text) {
+		HistoryEdit edit;
+		edit.offset = offset;
+		edit.removed = history.size() - offset;
+		history.resize(offset);
+		history += text;
+		edit.inserted = text.size();
+		sentences.OnEdit(edit, history);
+	}
+	void Append(const std::wstring& text) { Edit(history.size(), text); }
+
+	// The last n sentences, as DoCopyLastSentences takes them (without trailing space).
+	std::wstring Last(size_t n) const {
+		size_t end = history.size();
+		while (end > 0 && history[end - 1] == L' ') end--;
+		size_t start = sentences.StartOfLast(n, history.size());
+		return start < end ? history.substr(start, end - start) : std::wstring();
+	}
+};
+
+static void CheckLateTerminator() {
+	Session s;
+	s.Append(L"We met on Monday. The budget is approved");
+	s.Append(L" We start");
+	Check(s.sentences.Count() == 2 && s.Last(1) == L"The budget is approved We start", "without a terminator the sentence stays open");
+	// Live Caption punctuates the tail after the fact.
+	s.Edit(40, L". We start");
+	Check(s.sentences.Count() == 3 && s.Last(1) == L"We start" && s.Last(2) == L"The budget is approved. We start",
+		"a late \".\" splits the open sentence");
+	s.Edit(40, L" we start tomorrow");
+	Check(s.sentences.Count() == 2 && s.Last(1) == L"The budget is approved we start tomorrow",
+		"a rewrite that removes it joins them again");
+	s.Edit(40, L"? Yes.");
+	Check(s.sentences.Count() == 3 && s.Last(1) == L"Yes.", "and another terminator splits them again");
+}
+
+static void CheckContinuation() {
+	Session s;
+	s.Append(L"Bring the usual items, e.g. the slides and notes. Then");
+	Check(s.sentences.Count() == 2 && s.Last(2) == L"Bring the usual items, e.g. the slides and notes. Then",
+		"a lower-case word after a terminator continues the sentence");
+	s.Append(L" leave. \"Why?\" he asked. It is 3.5 km. U.S. law");
+	Check(s.Last(1) == L"U.S. law" && s.Last(2) == L"It is 3.5 km. U.S. law" && s.Last(3) == L"\"Why?\" he asked. It is 3.5 km. U.S. law",
+		"closers, decimals and abbreviations followed by a capital");
+	s.Append(L"。これ！それ");
+	Check(s.Last(1) == L"それ" && s.Last(2) == L"これ！それ", "full-width terminators need no space after them");
+	s.Append(L"\nnext line");
+	Check(s.Last(1) == L"next line", "a line break ends a sentence");
+}
+
+static void CheckMaxChars() {
+	Session s;
+	std::wstring words;
+	while (words.size() < SENTENCE_MAX_CHARS + 50) words += L"word ";
+	s.Append(L"Start " + words);
+	Check(s.sentences.Count() == 2 && s.sentences.StartOfLast(1, s.history.size()) > SENTENCE_MAX_CHARS &&
+		s.sentences.StartOfLast(1, s.history.size()) <= SENTENCE_MAX_CHARS + 6,
+		"a sentence without a terminator is split after SENTENCE_MAX_CHARS");
+	// Appended a unit at a time, the split lands in the same place.
+	Session t;
+	for (wchar_t ch : s.history) t.Append(std::wstring(1, ch));
+	Check(t.sentences.Count() == 2 && t.sentences.StartOfLast(1, t.history.size()) == s.sentences.StartOfLast(1, s.history.size()),
+		"and in the same place when it arrives a unit at a time");
+}
+
+static void CheckRandom(unsigned seed, int edits) {
+	static const wchar_t* const kPieces[] = {
+		L" the", L" meeting", L" We", L" It", L" e.g.", L" 3.5", L" U.S.", L".", L"?", L"!", L"…", L"\"", L")",
+		L" \"Why?\"", L"\n", L" ", L"。", L"？", L" next", L" Done."
+	};
+	std::mt19937 rng(seed);
+	Session s;
+	size_t mismatches = 0, compared = 0, longest = 0;
+	for (int i = 0; i < edits; i++) {
+		// A from-scratch index rescans everything; restart now and then to keep it short.
+		if (s.history.size() > 4000) s = Session();
+		size_t back = rng() % 3 == 0 ? (std::min)(s.history.size(), (size_t)(rng() % 40)) : 0;
+		std::wstring text;
+		for (size_t n = rng() % 6; n; n--) text += kPieces[rng() % (sizeof(kPieces) / sizeof(kPieces[0]))];
+		if (!back && text.empty()) continue;
+		s.Edit(s.history.size() - back, text);
+
+		SentenceIndex scratch;
+		HistoryEdit all;
+		all.inserted = s.history.size();
+		scratch.OnEdit(all, s.history);
+		bool same = scratch.Count() == s.sentences.Count();
+		for (size_t n = 1; same && n <= scratch.Count() + 1; n++) {
+			same = scratch.StartOfLast(n, s.history.size()) == s.sentences.StartOfLast(n, s.history.size());
+		}
+		if (!same) mismatches++;
+		compared++;
+		longest = (std::max)(longest, (size_t)s.sentences.Count());
+	}
+	printf("random: %zu edits compared with a from-scratch index, up to %zu sentences\n", compared, longest);
+	Check(compared > 0 && mismatches == 0, "after random tail edits StartOfLast matches a from-scratch scan");
+}
+
+int main(int argc, char** argv) {
+	unsigned seed = 1;
+	int edits = 30000;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (!std::strcmp(argv[i], "--seed")) seed = (unsigned)std::atoi(argv[i + 1]);
+		else if (!std::strcmp(argv[i], "--edits")) edits = std::atoi(argv[i + 1]);
+		else {
+			fprintf(stderr, "usage: %s [--seed N] [--edits N]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	CheckLateTerminator();
+	CheckContinuation();
+	CheckMaxChars();
+	CheckRandom(seed, edits);
+	return g_failures ? 1 : 0;
+}
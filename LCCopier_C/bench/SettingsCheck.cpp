@@ -0,0 +1,204 @@
+// Checks for the settings blob: random settings survive a round trip, and a
+// damaged blob (any single corrupted byte, any truncation, a newer version)
+// is refused without touching the settings it was meant to fill in.
+//
+// Build and run on Linux (from LCCopier_C/bench):
+//   g++ -std=c++17 -O2 -I.. SettingsCheck.cpp ../AppSettings.cpp -o settings_check
+//   ./settings_check                  exit code 1 if a check fails
+//   ./settings_check --seed 7 --count 100000
+//
+// Also covered: the CRC-32 check value, and blobs from other versions of the
+// format: unknown tags and value shapes are skipped, missing tags keep the
+// caller's values.
+#include "AppSettings.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+static int g_failures = 0;
+
+static void Check(bool ok, const char* what) {
+	printf("%-70s %s\n", what, ok ? "ok" : "FAILED");
+	if (!ok) g_failures++;
+}
+
+static bool SameHotkey(const HotkeyConfig& a, const HotkeyConfig& b) {
+	return a.ctrl == b.ctrl && a.shift == b.shift && a.alt == b.alt && a.win == b.win && a.vkCode == b.vkCode;
+}
+
+static bool Same(const AppSettings& a, const AppSettings& b) {
+	return a.darkMode == b.darkMode && a.setTop == b.setTop && a.setInvisible == b.setInvisible &&
+		a.middleButtonPaste == b.middleButtonPaste && a.middleButtonReplaceAll == b.middleButtonReplaceAll &&
+		a.incrementalPaste == b.incrementalPaste && a.transparency == b.transparency &&
+		SameHotkey(a.autoCopyHotkey, b.autoCopyHotkey) && SameHotkey(a.autoDeleteHotkey, b.autoDeleteHotkey) &&
+		a.textSize == b.textSize && a.textColor == b.textColor && a.bgColor == b.bgColor &&
+		a.selectedBgColor == b.selectedBgColor && a.transcriptLog == b.transcriptLog &&
+		a.transcriptFlushMs == b.transcriptFlushMs && a.transcriptRotateMB == b.transcriptRotateMB;
+}
+
+static HotkeyConfig RandomHotkey(std::mt19937& rng) {
+	HotkeyConfig hk = {};
+	uint32_t bits = rng();
+	hk.ctrl = bits & 1;
+	hk.shift = bits & 2;
+	hk.alt = bits & 4;
+	hk.win = bits & 8;
+	hk.vkCode = rng() % 256;
+	return hk;
+}
+
+static AppSettings RandomSettings(std::mt19937& rng) {
+	AppSettings s = {};
+	uint32_t bits = rng();
+	s.darkMode = bits & 1;
+	s.setTop = bits & 2;
+	s.setInvisible = bits & 4;
+	s.middleButtonPaste = bits & 8;
+	s.middleButtonReplaceAll = bits & 16;
+	s.incrementalPaste = bits & 32;
+	s.transcriptLog = bits & 64;
+	s.transparency = (int)(rng() % 256);
+	s.autoCopyHotkey = RandomHotkey(rng);
+	s.autoDeleteHotkey = RandomHotkey(rng);
+	s.textSize = (int)(rng() % 200) - 20;  // out of range values are the loader's business, not the format's
+	s.textColor = rng() & 0xFFFFFF;
+	s.bgColor = rng() & 0xFFFFFF;
+	s.selectedBgColor = rng() & 0xFFFFFF;
+	s.transcriptFlushMs = (int)rng();
+	s.transcriptRotateMB = (int)rng();
+	return s;
+}
+
+// A blob around an arbitrary payload, with a correct header.
+static std::vector<uint8_t> Blob(const std::vector<uint8_t>& payload, uint16_t version = SETTINGS_BLOB_VERSION) {
+	std::vector<uint8_t> out;
+	auto put32 = [&out](uint32_t v) { for (int shift = 0; shift < 32; shift += 8) out.push_back((uint8_t)(v >> shift)); };
+	put32(SETTINGS_BLOB_MAGIC);
+	out.push_back((uint8_t)version);
+	out.push_back((uint8_t)(version >> 8));
+	out.push_back(0);
+	out.push_back(0);
+	put32((uint32_t)payload.size());
+	put32(Crc32(payload.data(), payload.size()));
+	out.insert(out.end(), payload.begin(), payload.end());
+	return out;
+}
+
+static void PutEntry(std::vector<uint8_t>& payload, uint16_t tag, const std::vector<uint8_t>& value) {
+	payload.push_back((uint8_t)tag);
+	payload.push_back((uint8_t)(tag >> 8));
+	payload.push_back((uint8_t)value.size());
+	payload.push_back((uint8_t)(value.size() >> 8));
+	payload.insert(payload.end(), value.begin(), value.end());
+}
+
+static void CheckCrc() {
+	const char* text = "123456789";
+	Check(Crc32((const uint8_t*)text, 9) == 0xCBF43926u && Crc32(nullptr, 0) == 0, "CRC-32 of \"123456789\" is the standard check value");
+}
+
+static void CheckRoundTrip(unsigned seed, int count) {
+	std::mt19937 rng(seed);
+	bool same = true, fits = true;
+	for (int i = 0; i < count && same; i++) {
+		AppSettings settings = RandomSettings(rng);
+		std::vector<uint8_t> blob = SerializeSettings(settings);
+		fits = fits && blob.size() <= SETTINGS_BLOB_MAX_BYTES;
+		AppSettings loaded = RandomSettings(rng);
+		same = DeserializeSettings(blob.data(), blob.size(), loaded) && Same(loaded, settings);
+	}
+	printf("round trip: %d random settings\n", count);
+	Check(same, "random settings come back unchanged");
+	Check(fits, "the blob stays under SETTINGS_BLOB_MAX_BYTES");
+}
+
+static void CheckDamage(unsigned seed, int blobs) {
+	std::mt19937 rng(seed);
+	bool corruptRefused = true, truncRefused = true, untouched = true;
+	for (int i = 0; i < blobs; i++) {
+		std::vector<uint8_t> blob = SerializeSettings(RandomSettings(rng));
+		AppSettings before = RandomSettings(rng);
+		for (size_t at = 0; at < blob.size(); at++) {
+			std::vector<uint8_t> bad = blob;
+			bad[at] ^= (uint8_t)(1 + rng() % 255);
+			AppSettings loaded = before;
+			corruptRefused = corruptRefused && !DeserializeSettings(bad.data(), bad.size(), loaded);
+			untouched = untouched && Same(loaded, before);
+		}
+		for (size_t size = 0; size < blob.size(); size++) {
+			AppSettings loaded = before;
+			truncRefused = truncRefused && !DeserializeSettings(blob.data(), size, loaded);
+			untouched = untouched && Same(loaded, before);
+		}
+		// Trailing bytes, as a registry value larger than what was written.
+		std::vector<uint8_t> longer = blob;
+		longer.push_back(0);
+		AppSettings loaded = before;
+		truncRefused = truncRefused && !DeserializeSettings(longer.data(), longer.size(), loaded);
+		untouched = untouched && Same(loaded, before);
+	}
+	Check(corruptRefused, "every single corrupted byte is refused");
+	Check(truncRefused, "every truncation, and trailing bytes, are refused");
+	Check(untouched, "a refused blob leaves the settings untouched");
+}
+
+static void CheckVersions() {
+	std::mt19937 rng(3);
+	AppSettings defaults = RandomSettings(rng);
+
+	// A newer writer: an unknown tag, a known tag with a value shape this
+	// version does not know, and one known value.
+	std::vector<uint8_t> payload;
+	PutEntry(payload, 999, { 1, 2, 3 });
+	PutEntry(payload, 10, { 1, 2, 3, 4, 5, 6, 7, 8 });  // TagTextSize, wider
+	PutEntry(payload, 1, { 1, 0, 0, 0 });                // TagDarkMode
+	std::vector<uint8_t> blob = Blob(payload);
+	AppSettings loaded = defaults;
+	AppSettings expected = defaults;
+	expected.darkMode = true;
+	Check(DeserializeSettings(blob.data(), blob.size(), loaded) && Same(loaded, expected),
+		"unknown tags and shapes are skipped, missing tags keep their values");
+
+	std::vector<uint8_t> newer = Blob(payload, SETTINGS_BLOB_VERSION + 1);
+	std::vector<uint8_t> zero = Blob(payload, 0);
+	loaded = defaults;
+	bool refused = !DeserializeSettings(newer.data(), newer.size(), loaded) && !DeserializeSettings(zero.data(), zero.size(), loaded);
+	Check(refused && Same(loaded, defaults), "a newer format version (or version 0) is refused");
+
+	// An entry running past the end, with a correct checksum over it.
+	std::vector<uint8_t> overrun;
+	PutEntry(overrun, 1, { 1, 0, 0, 0 });
+	overrun[2] = 40;
+	blob = Blob(overrun);
+	loaded = defaults;
+	Check(!DeserializeSettings(blob.data(), blob.size(), loaded) && Same(loaded, defaults), "an entry longer than the payload is refused");
+
+	std::vector<uint8_t> huge(SETTINGS_BLOB_MAX_BYTES, 0);
+	blob = Blob(huge);
+	loaded = defaults;
+	Check(!DeserializeSettings(blob.data(), blob.size(), loaded), "a blob over SETTINGS_BLOB_MAX_BYTES is refused");
+
+	blob = Blob({});
+	loaded = defaults;
+	Check(DeserializeSettings(blob.data(), blob.size(), loaded) && Same(loaded, defaults), "an empty payload keeps every value");
+}
+
+int main(int argc, char** argv) {
+	unsigned seed = 1;
+	int count = 10000;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (!std::strcmp(argv[i], "--seed")) seed = (unsigned)std::atoi(argv[i + 1]);
+		else if (!std::strcmp(argv[i], "--count")) count = std::atoi(argv[i + 1]);
+		else {
+			fprintf(stderr, "usage: %s [--seed N] [--count N]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	CheckCrc();
+	CheckRoundTrip(seed, count);
+	CheckDamage(seed, count / 100 + 1);
+	CheckVersions();
+	return g_failures ? 1 : 0;
+}
@@ -0,0 +1,94 @@
+// Checks for the Unix side of the StreamServer endpoint: a socket left behind
+// by a crashed server is replaced, a live server is not, and nothing at the
+// path that is not a socket (a file, a symlink) is ever deleted. The socket
+// is the user's only (0600) and goes away on Stop.
+//
+// Build and run on Linux (from LCCopier_C/bench):
+//   g++ -std=c++17 -O2 -pthread -I.. StreamCheck.cpp ../CaptionStream.cpp ../CaptionText.cpp ../StreamServer.cpp -o stream_check
+//   ./stream_check                    exit code 1 if a check fails
+#include "StreamServer.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static int g_failures = 0;
+
+static void Check(bool ok, const char* what) {
+	printf("%-70s %s\n", what, ok ? "ok" : "FAILED");
+	if (!ok) g_failures++;
+}
+
+static std::string ReadFile(const std::string& path) {
+	std::ifstream in(path, std::ios::binary);
+	return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+static bool CanConnect(const std::string& path) {
+	sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+	memcpy(addr.sun_path, path.c_str(), path.size());
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	bool ok = connect(fd, (sockaddr*)&addr, sizeof(addr)) == 0;
+	close(fd);
+	return ok;
+}
+
+// A socket file nobody listens on, as a crashed server leaves it.
+static void StaleSocket(const std::string& path) {
+	sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+	memcpy(addr.sun_path, path.c_str(), path.size());
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0) perror("bind");
+	close(fd);
+}
+
+int main() {
+	char directory[] = "/tmp/stream_check.XXXXXX";
+	if (!mkdtemp(directory)) {
+		perror("mkdtemp");
+		return 2;
+	}
+	std::string path = std::string(directory) + "/captions.sock";
+	std::string file = std::string(directory) + "/notes.txt";
+	CaptionStream stream;
+
+	{
+		std::ofstream(path) << "not a socket";
+		StreamServer server(stream);
+		Check(!server.Start(path) && ReadFile(path) == "not a socket", "a regular file at the endpoint is left alone");
+		unlink(path.c_str());
+	}
+	{
+		std::ofstream(file) << "keep me";
+		if (symlink(file.c_str(), path.c_str()) != 0) perror("symlink");
+		StreamServer server(stream);
+		struct stat link;
+		Check(!server.Start(path) && lstat(path.c_str(), &link) == 0 && S_ISLNK(link.st_mode) && ReadFile(file) == "keep me",
+			"a symlink at the endpoint is left alone, and its target");
+		unlink(path.c_str());
+	}
+	{
+		StaleSocket(path);
+		StreamServer server(stream);
+		struct stat socketStat;
+		bool started = server.Start(path);
+		Check(started && CanConnect(path), "a stale socket is replaced");
+		Check(stat(path.c_str(), &socketStat) == 0 && S_ISSOCK(socketStat.st_mode) && (socketStat.st_mode & 0777) == 0600,
+			"the socket is the user's only");
+		StreamServer second(stream);
+		Check(!second.Start(path) && CanConnect(path), "a live server is not replaced");
+		server.Stop();
+		Check(access(path.c_str(), F_OK) != 0, "Stop removes the socket");
+	}
+
+	unlink(file.c_str());
+	rmdir(directory);
+	return g_failures ? 1 : 0;
+}
@@ -0,0 +1,149 @@
+// Replays a caption snapshot stream through the merge and the subtitle
+// exporter, headlessly, and writes the resulting SRT / WebVTT files. The
+// stream is either recorded by the app (LiveCaption.exe --record) or made up
+// by CaptionSynth.
+//
+// Build and run on Linux (from LCCopier_C/bench):
+//   g++ -std=c++17 -O2 -I.. SubtitleReplay.cpp CaptionSynth.cpp ../CaptionMerge.cpp ../CaptionText.cpp ../SubtitleExport.cpp -o subtitle_replay
+//   ./subtitle_replay --snapshots LCCopier_snapshots_20250101_120000.txt --srt out.srt --vtt out.vtt
+//   ./subtitle_replay --minutes 30 --seed 3 --srt out.srt
+//
+// Prints cue statistics and checks that cues are ordered, do not overlap and
+// respect the length limits.
+#include "CaptionMerge.h"
+#include "CaptionSynth.h"
+#include "CaptionText.h"
+#include "SubtitleExport.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#define REPLAY_TICK_MS 400  // poll interval assumed between recorded snapshots
+
+struct Snapshot {
+	uint64_t ms;
+	std::wstring text;
+};
+
+static bool LoadSnapshots(const char* path, std::vector<Snapshot>& out) {
+	FILE* f = fopen(path, "rb");
+	if (!f) return false;
+	std::string line;
+	int ch;
+	for (;;) {
+		ch = fgetc(f);
+		if (ch == EOF || ch == '\n') {
+			Snapshot s;
+			if (ParseSnapshotLine(line, s.ms, s.text)) out.push_back(std::move(s));
+			line.clear();
+			if (ch == EOF) break;
+		}
+		else {
+			line += (char)ch;
+		}
+	}
+	fclose(f);
+	return !out.empty();
+}
+
+static bool WriteFile(const char* path, const std::string& data) {
+	FILE* f = fopen(path, "wb");
+	if (!f) return false;
+	bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+	return fclose(f) == 0 && ok;
+}
+
+// Parse "HH:MM:SS,mmm --> HH:MM:SS,mmm" lines back out of the SRT output.
+static int CheckCues(const std::string& srt) {
+	int problems = 0;
+	unsigned long long lastEnd = 0, cues = 0, totalMs = 0, maxMs = 0;
+	size_t pos = 0;
+	while ((pos = srt.find(" --> ", pos)) != std::string::npos) {
+		size_t lineStart = srt.rfind('\n', pos);
+		lineStart = lineStart == std::string::npos ? 0 : lineStart + 1;
+		unsigned h1, m1, s1, f1, h2, m2, s2, f2;
+		if (sscanf(srt.c_str() + lineStart, "%u:%u:%u,%u --> %u:%u:%u,%u", &h1, &m1, &s1, &f1, &h2, &m2, &s2, &f2) != 8) {
+			problems++;
+			pos += 5;
+			continue;
+		}
+		unsigned long long start = ((h1 * 60ull + m1) * 60 + s1) * 1000 + f1;
+		unsigned long long end = ((h2 * 60ull + m2) * 60 + s2) * 1000 + f2;
+		if (end <= start || start < lastEnd) problems++;
+		// Text lines follow up to the blank line.
+		size_t text = srt.find('\n', pos) + 1;
+		size_t blank = srt.find("\r\n\r\n", text);
+		for (size_t line = text; line < blank;) {
+			size_t next = srt.find("\r\n", line);
+			std::wstring decoded = DecodeUtf8(srt.substr(line, next - line));
+			if (decoded.size() > SUBTITLE_MAX_CHARS) problems++;
+			line = next + 2;
+		}
+		lastEnd = end;
+		cues++;
+		totalMs += end - start;
+		if (end - start > maxMs) maxMs = end - start;
+		pos = blank;
+	}
+	printf("cues %llu, mean duration %.0f ms, max %llu ms, last ends at %llu ms, problems %d\n",
+		cues, cues ? (double)totalMs / cues : 0.0, maxMs, lastEnd, problems);
+	return problems;
+}
+
+int main(int argc, char** argv) {
+	const char* snapshotsPath = nullptr;
+	const char* srtPath = nullptr;
+	const char* vttPath = nullptr;
+	SynthOptions synthOptions;
+	double minutes = 10;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (!strcmp(argv[i], "--snapshots")) snapshotsPath = argv[i + 1];
+		else if (!strcmp(argv[i], "--srt")) srtPath = argv[i + 1];
+		else if (!strcmp(argv[i], "--vtt")) vttPath = argv[i + 1];
+		else if (!strcmp(argv[i], "--minutes")) minutes = atof(argv[i + 1]);
+		else if (!strcmp(argv[i], "--seed")) synthOptions.seed = (uint32_t)strtoul(argv[i + 1], nullptr, 10);
+		else {
+			fprintf(stderr, "usage: %s [--snapshots FILE | --minutes M --seed N] [--srt FILE] [--vtt FILE]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	std::vector<Snapshot> snapshots;
+	if (snapshotsPath) {
+		if (!LoadSnapshots(snapshotsPath, snapshots)) {
+			fprintf(stderr, "no snapshots in %s\n", snapshotsPath);
+			return 2;
+		}
+	}
+	else {
+		CaptionSynth synth({}, synthOptions);
+		std::wstring last;
+		while (synth.ElapsedMs() < (uint64_t)(minutes * 60000)) {
+			const std::wstring& text = synth.Next();
+			if (text != last) snapshots.push_back(Snapshot{ synth.ElapsedMs(), text });
+			last = text;
+		}
+	}
+
+	SubtitleExporter exporter;
+	std::wstring history, previous;
+	uint64_t now = snapshots.front().ms;
+	for (const Snapshot& s : snapshots) {
+		// Recorded streams only hold changed snapshots; tick through the gaps.
+		for (; now + REPLAY_TICK_MS < s.ms; now += REPLAY_TICK_MS) exporter.OnTick(history, now);
+		now = s.ms;
+		if (!s.text.empty()) exporter.OnEdit(MergeCaptionSnapshot(history, previous, s.text), history, now);
+		exporter.OnTick(history, now);
+	}
+	exporter.Finish(history, now);
+
+	std::string srt, vtt;
+	exporter.TakeSrt(srt);
+	exporter.TakeVtt(vtt);
+	if (srtPath && !WriteFile(srtPath, srt)) fprintf(stderr, "cannot write %s\n", srtPath);
+	if (vttPath && !WriteFile(vttPath, vtt)) fprintf(stderr, "cannot write %s\n", vttPath);
+	printf("%zu snapshots, %.1f minutes, history %zu chars\n", snapshots.size(), (now - snapshots.front().ms) / 60000.0, history.size());
+	return CheckCues(srt) ? 1 : 0;
+}
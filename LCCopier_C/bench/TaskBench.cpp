@@ -0,0 +1,233 @@
+// Checks and benchmarks for the background task scheduler. The main thread
+// plays the UI thread: the wake function signals it the way PostMessageW
+// wakes the window, and it runs the completions.
+//
+// Build and run on Linux (from LCCopier_C/bench):
+//   g++ -std=c++20 -O2 -pthread -I.. TaskBench.cpp ../TaskScheduler.cpp -o task_bench
+//   ./task_bench                      checks, then throughput and round-trip latency
+//   ./task_bench --threads 4 --tasks 1000000
+//
+// Exit code 1 if a check fails: every task runs once, cancelled tasks and
+// their completions do not run, Idle tasks wait for SetIdle, work posted from
+// inside the pool is stolen by idle workers, and a coroutine hops between the
+// pool and the owner thread.
+#include "TaskScheduler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static double MsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// The owner thread's message queue, reduced to what WM_APP_TASKS_DONE needs.
+class Owner {
+public:
+	void Wake() {
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			m_posted = true;
+		}
+		m_cv.notify_one();
+	}
+	// Run completions until done() holds or timeoutMs passes.
+	template <class Pred>
+	bool PumpUntil(TaskScheduler& tasks, Pred done, double timeoutMs = 10000) {
+		auto start = std::chrono::steady_clock::now();
+		while (!done()) {
+			if (MsSince(start) > timeoutMs) return false;
+			std::unique_lock<std::mutex> lock(m_lock);
+			m_cv.wait_for(lock, std::chrono::milliseconds(10), [&] { return m_posted; });
+			m_posted = false;
+			lock.unlock();
+			tasks.RunCompletions();
+		}
+		return true;
+	}
+
+private:
+	std::mutex m_lock;
+	std::condition_variable m_cv;
+	bool m_posted = false;
+};
+
+static int g_failures = 0;
+
+static void Check(bool ok, const char* what) {
+	printf("%-58s %s\n", what, ok ? "ok" : "FAILED");
+	if (!ok) g_failures++;
+}
+
+static void CheckEveryTaskRunsOnce(unsigned threads, size_t count) {
+	Owner owner;
+	TaskScheduler tasks;
+	tasks.Start(threads, [&] { owner.Wake(); });
+	std::vector<std::atomic<int>> runs(count);
+	std::atomic<size_t> ran{ 0 };
+	size_t completed = 0;
+	for (size_t i = 0; i < count; i++) {
+		TaskPriority priority = i % 3 == 0 ? TaskPriority::High : TaskPriority::Normal;
+		tasks.Post(priority, [&, i] { runs[i]++; ran++; }, [&] { completed++; });
+	}
+	bool finished = owner.PumpUntil(tasks, [&] { return completed == count; });
+	bool once = true;
+	for (auto& r : runs) once = once && r == 1;
+	Check(finished && once && ran == count, "every task and completion runs once");
+	tasks.Stop();
+}
+
+static void CheckCancelAndIdle(unsigned threads) {
+	Owner owner;
+	TaskScheduler tasks;
+	tasks.Start(threads, [&] { owner.Wake(); });
+	const size_t count = 1000;
+	std::atomic<size_t> ran{ 0 };
+	size_t completed = 0;
+	std::vector<CancelToken> tokens(count);
+	for (size_t i = 0; i < count; i++) tasks.Post(TaskPriority::Idle, [&] { ran++; }, [&] { completed++; }, tokens[i]);
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	Check(ran == 0, "idle tasks wait while the owner is busy");
+	for (size_t i = 0; i < count; i += 2) tokens[i].Cancel();
+	tasks.SetIdle(true);
+	bool finished = owner.PumpUntil(tasks, [&] { return completed == count / 2; });
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	tasks.RunCompletions();
+	Check(finished && ran == count / 2 && completed == count / 2, "cancelled tasks and their completions are dropped");
+
+	// Cancelled after running but before the owner gets to the completion.
+	std::atomic<bool> workDone{ false };
+	bool doneRan = false;
+	CancelToken late;
+	tasks.Post(TaskPriority::Normal, [&] { workDone = true; }, [&] { doneRan = true; }, late);
+	while (!workDone) std::this_thread::yield();
+	late.Cancel();
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	tasks.RunCompletions();
+	Check(!doneRan, "a completion cancelled before it runs is skipped");
+	tasks.Stop();
+}
+
+static void CheckStealing(unsigned threads) {
+	if (threads < 2) return;
+	Owner owner;
+	TaskScheduler tasks;
+	tasks.Start(threads, [&] { owner.Wake(); });
+	const size_t count = 20000;
+	std::atomic<size_t> ran{ 0 };
+	std::mutex seenLock;
+	std::vector<std::thread::id> seen;
+	tasks.Post(TaskPriority::Normal, [&] {
+		// Lands on this worker's lane; the rest of the pool has to steal it.
+		for (size_t i = 0; i < count; i++) {
+			tasks.Post(TaskPriority::Normal, [&] {
+				volatile unsigned spin = 0;
+				for (int k = 0; k < 2000; k++) spin = spin + k;
+				std::lock_guard<std::mutex> lock(seenLock);
+				if (std::find(seen.begin(), seen.end(), std::this_thread::get_id()) == seen.end()) seen.push_back(std::this_thread::get_id());
+				ran++;
+			});
+		}
+	});
+	bool finished = owner.PumpUntil(tasks, [&] { return ran == count; });
+	Check(finished && seen.size() > 1, "work posted inside the pool is stolen");
+	tasks.Stop();
+}
+
+static BackgroundJob HopThreads(TaskScheduler& tasks, std::thread::id owner, bool& onWorker, bool& backOnOwner, bool& finished) {
+	co_await tasks.Resume(TaskPriority::Normal);
+	onWorker = std::this_thread::get_id() != owner;
+	co_await tasks.ResumeOnOwner();
+	backOnOwner = std::this_thread::get_id() == owner;
+	finished = true;
+}
+
+static void CheckCoroutine(unsigned threads) {
+	Owner owner;
+	TaskScheduler tasks;
+	tasks.Start(threads, [&] { owner.Wake(); });
+	bool onWorker = false, backOnOwner = false, finished = false;
+	HopThreads(tasks, std::this_thread::get_id(), onWorker, backOnOwner, finished);
+	bool done = owner.PumpUntil(tasks, [&] { return finished; });
+	Check(done && onWorker && backOnOwner, "a coroutine hops to the pool and back to the owner");
+	tasks.Stop();
+}
+
+static void CheckStopDrains(unsigned threads) {
+	TaskScheduler tasks;
+	tasks.Start(threads, nullptr);
+	std::atomic<size_t> ran{ 0 };
+	for (int i = 0; i < 100; i++) tasks.Post(TaskPriority::Idle, [&] { ran++; });
+	tasks.Stop();
+	Check(ran == 100, "stop runs the idle tasks still queued");
+}
+
+static void BenchThroughput(unsigned threads, size_t count) {
+	Owner owner;
+	TaskScheduler tasks;
+	tasks.Start(threads, [&] { owner.Wake(); });
+	std::atomic<size_t> ran{ 0 };
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < count; i++) tasks.Post(TaskPriority::Normal, [&] { ran++; });
+	owner.PumpUntil(tasks, [&] { return ran == count; }, 60000);
+	double outsideMs = MsSince(start);
+
+	ran = 0;
+	start = std::chrono::steady_clock::now();
+	tasks.Post(TaskPriority::Normal, [&] {
+		for (size_t i = 0; i < count; i++) tasks.Post(TaskPriority::Normal, [&] { ran++; });
+	});
+	owner.PumpUntil(tasks, [&] { return ran == count; }, 60000);
+	double insideMs = MsSince(start);
+	tasks.Stop();
+	printf("throughput, %u threads: posted by owner %.2f M tasks/s, fan-out inside the pool %.2f M tasks/s\n",
+		threads, count / outsideMs / 1000.0, count / insideMs / 1000.0);
+}
+
+// Post from the owner, work on a worker, completion back on the owner.
+static void BenchRoundTrip(unsigned threads) {
+	Owner owner;
+	TaskScheduler tasks;
+	tasks.Start(threads, [&] { owner.Wake(); });
+	std::vector<double> samples;
+	for (int i = 0; i < 2000; i++) {
+		bool done = false;
+		auto start = std::chrono::steady_clock::now();
+		tasks.Post(TaskPriority::High, [] {}, [&] { done = true; });
+		owner.PumpUntil(tasks, [&] { return done; });
+		samples.push_back(MsSince(start) * 1000.0);
+	}
+	tasks.Stop();
+	std::sort(samples.begin(), samples.end());
+	printf("round trip, %u threads: median %.1f us, p99 %.1f us\n", threads,
+		samples[samples.size() / 2], samples[samples.size() * 99 / 100]);
+}
+
+int main(int argc, char** argv) {
+	unsigned threads = (std::min)(std::max(2u, std::thread::hardware_concurrency()), (unsigned)TASK_MAX_THREADS);
+	size_t count = 200000;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (!std::strcmp(argv[i], "--threads")) threads = (unsigned)std::atoi(argv[i + 1]);
+		else if (!std::strcmp(argv[i], "--tasks")) count = (size_t)std::atoll(argv[i + 1]);
+		else {
+			fprintf(stderr, "usage: %s [--threads N] [--tasks N]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	CheckEveryTaskRunsOnce(threads, count);
+	CheckCancelAndIdle(threads);
+	CheckStealing(threads);
+	CheckCoroutine(threads);
+	CheckStopDrains(threads);
+
+	for (unsigned t = 1; t <= threads; t *= 2) BenchThroughput(t, count);
+	BenchRoundTrip(threads);
+	return g_failures ? 1 : 0;
+}
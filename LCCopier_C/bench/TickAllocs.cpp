@@ -0,0 +1,298 @@
+// Checks that a steady-state poll tick does not allocate. Runs the portable
+// part of the WM_TIMER tick (capture buffer, UI chrome check, change test,
+// UpdateCaptionHistory with every consumer it feeds, then the stream, subtitle
+// and transcript log ticks, traced and timed as in the app) over the synthetic
+// Live Caption stream, counting operator new calls with the replacement
+// allocator in Metrics.cpp, the counter behind the app's "allocations"
+// diagnostics line. Subtitles, the transcript log (into a temporary
+// directory), phrase triggers and tracing are all on. The keepalive's flushes
+// of subtitle and trace output run between ticks, uncounted, as they run on
+// their own timer in the app.
+//
+// Two steps of the app's tick are not portable and are left out: the
+// clipboard provider's OnSourceChanging, which returns at once unless a paste
+// payload is on offer, and FireTriggers, which only runs when a phrase fires;
+// the phrases here do not occur in the generated speech.
+//
+// The stream is replayed twice. The first pass grows every buffer to its
+// working size; the second replays the same snapshots after a clear, which is
+// the steady state a long session runs in. Any allocation in the second pass
+// is a regression. A worker thread allocates throughout, as the task pool,
+// the transcript writer and the capture threads do in the app; the count is
+// per thread, so none of that is charged to the tick.
+//
+// A tick's cost depends on the history behind it, so each pass runs against
+// a long session: once the caption display has filled, --prefill-hours of
+// earlier speech go in front of the history (not counted), and the stream is
+// spoken from a generated corpus that does not repeat, so the merge keeps
+// appending. A pass that ends with less history than the prefill plus half of
+// what was spoken fails the check instead of vouching for ticks on a short
+// history.
+//
+// Build and run on Linux (from LCCopier_C/bench):
+//   g++ -std=c++17 -O2 -pthread -I.. TickAllocs.cpp CaptionSynth.cpp ../CaptionMerge.cpp ../CaptionText.cpp ../CaptionStream.cpp ../Metrics.cpp ../PasteCursor.cpp ../PhraseTriggers.cpp ../RevisionJournal.cpp ../SentenceIndex.cpp ../SubtitleExport.cpp ../Tracer.cpp ../TranscriptArchive.cpp ../TranscriptLog.cpp -o tick_allocs
+//   ./tick_allocs                     30 minutes on 2 hours of history; exit code 1 if a steady tick allocated
+//   ./tick_allocs --minutes 120 --prefill-hours 8 --seed 7
+#include "CaptionMerge.h"
+#include "CaptionStream.h"
+#include "CaptionSynth.h"
+#include "CaptionText.h"
+#include "Metrics.h"
+#include "PasteCursor.h"
+#include "PhraseTriggers.h"
+#include "RevisionJournal.h"
+#include "SentenceIndex.h"
+#include "SubtitleExport.h"
+#include "Tracer.h"
+#include "TranscriptLog.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define PREFILL_AFTER_TICKS 150   // a minute in: the display holds full lines by then
+#define KEEPALIVE_MS        1000  // IDT_HOOK_KEEPALIVE, which flushes subtitle and trace output
+
+// What the tick touches, named after the app's globals.
+struct TickState {
+	std::wstring captureText;
+	std::wstring lastCaptionText;
+	std::wstring captionHistory;
+	std::wstring previousCaption;
+	RepeatIndex repeats;
+	PasteCursor pasteCursor;
+	SentenceIndex sentences;
+	CaptionStream captionStream;
+	RevisionJournal journal;
+	SubtitleExporter subtitles;
+	TranscriptLog transcriptLog;
+	PhraseTriggers triggers;
+	std::vector<TriggerHit> triggersFired;
+	MetricsRegistry metrics;
+	uint64_t snapshotSeq = 0;
+
+	// DoClearHistory, minus the undo stack: everything keeps its capacity.
+	void Clear(uint64_t nowMs) {
+		HistoryEdit cleared;
+		cleared.removed = captionHistory.size();
+		captionHistory.clear();
+		captionStream.Publish(cleared, captionHistory);
+		journal.OnEdit(cleared, captionHistory, nowMs);
+		sentences.Clear();
+		repeats.Clear();
+		triggers.Reset();
+		subtitles.OnEdit(cleared, captionHistory, nowMs);
+		transcriptLog.OnEdit(cleared, captionHistory, nowMs);
+		captureText.clear();
+		lastCaptionText.clear();
+		previousCaption.clear();
+		pasteCursor.Reset(0);
+	}
+
+	// Earlier speech in front of the history, as one edit to every consumer.
+	void Prefill(const std::wstring& earlier, uint64_t nowMs) {
+		HistoryEdit edit;
+		edit.offset = 0;
+		edit.removed = captionHistory.size();
+		captionHistory.insert(0, earlier);
+		edit.inserted = captionHistory.size();
+		repeats.OnEdit(edit, captionHistory);
+		Feed(edit, nowMs);
+	}
+
+	// UpdateCaptionHistory's consumers, in its order.
+	void Feed(const HistoryEdit& edit, uint64_t nowMs) {
+		pasteCursor.OnEdit(edit);
+		sentences.OnEdit(edit, captionHistory);
+		captionStream.Publish(edit, captionHistory);
+		journal.OnEdit(edit, captionHistory, nowMs);
+		subtitles.OnEdit(edit, captionHistory, nowMs);
+		transcriptLog.OnEdit(edit, captionHistory, nowMs);
+		triggers.OnEdit(edit, captionHistory, triggersFired);
+		triggersFired.clear();
+	}
+};
+
+// The portable steps of a poll tick, in the app's order. snapshot stands in
+// for the UI Automation text, which the app reads into the reused buffer.
+static void Tick(TickState& s, const std::wstring& snapshot, uint64_t nowMs) {
+	uint64_t id = ++s.snapshotSeq;
+	TraceAsyncBegin("snapshot", "snapshot", id);
+	StageTimer tickTimer(s.metrics, MetricStage::Tick, id);
+	{
+		StageTimer timer(s.metrics, MetricStage::Capture, id);
+		if (!snapshot.empty() && !IsUiChrome(snapshot.c_str())) s.captureText.assign(snapshot);
+		else s.captureText.clear();
+	}
+	bool changed;
+	{
+		StageTimer timer(s.metrics, MetricStage::Delta, id);
+		changed = s.captureText != s.lastCaptionText;
+	}
+	if (changed) {
+		if (!s.captureText.empty()) {
+			StageTimer timer(s.metrics, MetricStage::Merge, id);
+			HistoryEdit edit = MergeCaptionSnapshot(s.captionHistory, s.previousCaption, s.captureText, &s.repeats);
+			s.Feed(edit, nowMs);
+		}
+		s.lastCaptionText.swap(s.captureText);
+	}
+	TraceAsyncEnd("snapshot", "snapshot", id);
+	s.captionStream.Service(s.captionHistory);
+	s.subtitles.OnTick(s.captionHistory, nowMs);
+	s.transcriptLog.OnTick(s.captionHistory, nowMs);
+}
+
+// The keepalive's flushes, into buffers that are written and emptied.
+struct Keepalive {
+	std::string srt, vtt, trace;
+	uint64_t lastMs = 0;
+
+	void Run(TickState& s, uint64_t nowMs) {
+		if (nowMs - lastMs < KEEPALIVE_MS) return;
+		lastMs = nowMs;
+		s.subtitles.TakeSrt(srt);
+		s.subtitles.TakeVtt(vtt);
+		TraceDrain(trace);
+		srt.clear();
+		vtt.clear();
+		trace.clear();
+	}
+};
+
+static std::wstring Join(const std::vector<std::wstring>& words) {
+	std::wstring text;
+	for (const std::wstring& word : words) {
+		text += word;
+		text += L' ';
+	}
+	return text;
+}
+
+static std::atomic<bool> g_stopWorker{ false };
+static std::atomic<uint64_t> g_workerAllocations{ 0 };
+
+static void Worker() {
+	std::vector<std::wstring> lines;
+	while (!g_stopWorker.load(std::memory_order_relaxed)) {
+		uint64_t before = AllocationCount();
+		for (int i = 0; i < 64; i++) lines.emplace_back(100, L'w');
+		lines.clear();
+		lines.shrink_to_fit();
+		g_workerAllocations.fetch_add(AllocationCount() - before, std::memory_order_relaxed);
+		std::this_thread::yield();
+	}
+}
+
+struct PassResult {
+	uint64_t ticks = 0;
+	uint64_t allocations = 0;
+	uint64_t allocatingTicks = 0;
+	uint64_t firstAllocatingTick = 0;
+	size_t historyChars = 0;
+	size_t spokenChars = 0;
+};
+
+// The synth allocates as it goes, and the prefill once; only the ticks are counted.
+// Times run on from startMs, so the second pass continues the session.
+static PassResult RunPass(TickState& state, Keepalive& keepalive, const std::vector<std::wstring>& corpus,
+	const std::wstring& earlier, const SynthOptions& options, double minutes, uint64_t startMs) {
+	CaptionSynth synth(corpus, options);
+	PassResult result;
+	while (synth.ElapsedMs() < (uint64_t)(minutes * 60000)) {
+		const std::wstring& snapshot = synth.Next();
+		uint64_t nowMs = startMs + synth.ElapsedMs();
+		uint64_t before = AllocationCount();
+		Tick(state, snapshot, nowMs);
+		uint64_t allocations = AllocationCount() - before;
+		result.ticks++;
+		if (allocations) {
+			if (!result.allocatingTicks) result.firstAllocatingTick = result.ticks;
+			result.allocatingTicks++;
+			result.allocations += allocations;
+		}
+		if (result.ticks == PREFILL_AFTER_TICKS) state.Prefill(earlier, nowMs);
+		keepalive.Run(state, nowMs);
+	}
+	result.historyChars = state.captionHistory.size();
+	result.spokenChars = synth.GroundTruth().size();
+	return result;
+}
+
+static void Usage(const char* program) {
+	fprintf(stderr, "usage: %s [--seed N] [--minutes M] [--prefill-hours H] [--silence P]\n", program);
+}
+
+int main(int argc, char** argv) {
+	SynthOptions synth;
+	double minutes = 30;
+	double prefillHours = 2;
+	for (int i = 1; i < argc; i++) {
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (!value) {
+			Usage(argv[0]);
+			return 2;
+		}
+		if (!std::strcmp(arg, "--seed")) synth.seed = (uint32_t)std::strtoul(value, nullptr, 10);
+		else if (!std::strcmp(arg, "--minutes")) minutes = std::atof(value);
+		else if (!std::strcmp(arg, "--prefill-hours")) prefillHours = std::atof(value);
+		else if (!std::strcmp(arg, "--silence")) synth.silenceProbability = std::atof(value);
+		else {
+			Usage(argv[0]);
+			return 2;
+		}
+		i++;
+	}
+
+	// Enough words that the corpus does not come round again within the run.
+	size_t spokenWords = (size_t)(minutes * 60 * synth.wordsPerSecond * 1.5) + 1000;
+	std::vector<std::wstring> corpus = CaptionSynth::GenerateWords(synth.seed, spokenWords);
+	std::wstring earlier = Join(CaptionSynth::GenerateWords(synth.seed + 1, (size_t)(prefillHours * 3600 * synth.wordsPerSecond)));
+
+	char logDirectory[] = "/tmp/tick_allocs.XXXXXX";
+	if (!mkdtemp(logDirectory)) {
+		perror("mkdtemp");
+		return 2;
+	}
+	std::thread worker(Worker);
+	TickState state;
+	Keepalive keepalive;
+	state.triggers.Compile({ TriggerPhrase{ L"action item" }, TriggerPhrase{ L"follow up" } });
+	TranscriptLogOptions log;
+	log.directory = std::filesystem::path(logDirectory).wstring() + L'/';
+	state.transcriptLog.Start(log);
+	TraceEnable(true);
+
+	uint64_t warmMs = (uint64_t)(minutes * 60000);
+	PassResult warm = RunPass(state, keepalive, corpus, earlier, synth, minutes, 0);
+	state.Clear(warmMs);
+	PassResult steady = RunPass(state, keepalive, corpus, earlier, synth, minutes, warmMs + KEEPALIVE_MS);
+	TraceEnable(false);
+	state.transcriptLog.Stop();
+	std::filesystem::remove_all(logDirectory);
+	g_stopWorker = true;
+	worker.join();
+
+	size_t minimumChars = earlier.size() + steady.spokenChars / 2;
+	printf("%llu ticks per pass, %zu history chars (%zu prefilled, %zu spoken)\n", (unsigned long long)warm.ticks,
+		steady.historyChars, earlier.size(), steady.spokenChars);
+	printf("warm-up: %llu allocations in %llu ticks\n", (unsigned long long)warm.allocations,
+		(unsigned long long)warm.allocatingTicks);
+	printf("steady:  %llu allocations in %llu ticks", (unsigned long long)steady.allocations,
+		(unsigned long long)steady.allocatingTicks);
+	if (steady.allocatingTicks) printf(", first at tick %llu", (unsigned long long)steady.firstAllocatingTick);
+	printf("\n");
+	printf("worker:  %llu allocations meanwhile, not counted\n", (unsigned long long)g_workerAllocations.load());
+	if (steady.historyChars < minimumChars) {
+		printf("history: %zu chars, under the %zu needed for a long session; the result does not count\n",
+			steady.historyChars, minimumChars);
+		return 1;
+	}
+	return steady.allocations ? 1 : 0;
+}
@@ -0,0 +1,279 @@
+// Checks for the TranscriptLog writer, with small rotate and buffer sizes so
+// every path is reached in a few batches: the day file rolls over at
+// midnight, a file that reaches the rotate size continues in the next part
+// (skipping parts an earlier session already filled), text beyond the buffer
+// limit is dropped and marked where the log resumes, a batch that cannot be
+// written is retried with the next one, and the session header stays out of
+// the archive. The log takes the day from time(); the check defines its own,
+// so it can move the clock to tomorrow.
+//
+// Build and run on Linux (from LCCopier_C/bench):
+//   g++ -std=c++17 -O2 -pthread -I.. TranscriptCheck.cpp ../CaptionText.cpp ../TranscriptArchive.cpp ../TranscriptLog.cpp -o transcript_check
+//   ./transcript_check                exit code 1 if a check fails
+#include "CaptionText.h"
+#include "TranscriptLog.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+static int g_failures = 0;
+
+static void Check(bool ok, const char* what) {
+	printf("%-70s %s\n", what, ok ? "ok" : "FAILED");
+	if (!ok) g_failures++;
+}
+
+static std::atomic<long long> g_clockShift{ 0 };
+
+extern "C" time_t time(time_t* out) noexcept {
+	timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+	time_t shifted = now.tv_sec + (time_t)g_clockShift.load();
+	if (out) *out = shifted;
+	return shifted;
+}
+
+// yyyymmdd of the (shifted) clock, as the log names its files.
+static std::string Day() {
+	time_t now = time(nullptr);
+	struct tm local;
+	localtime_r(&now, &local);
+	char day[32];
+	snprintf(day, sizeof(day), "%04d%02d%02d", local.tm_year + 1900, local.tm_mon + 1, local.tm_mday);
+	return day;
+}
+
+static std::string ReadFile(const std::string& path) {
+	std::ifstream in(path, std::ios::binary);
+	return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+// "\n[session yyyy-mm-dd hh:mm:ss]\n" lines taken out, and how many there were.
+static std::string WithoutHeaders(const std::string& text, size_t* headers = nullptr) {
+	std::string out;
+	size_t count = 0, from = 0;
+	for (size_t at; (at = text.find("\n[session ", from)) != std::string::npos; from = text.find("]\n", at) + 2) {
+		out.append(text, from, at - from);
+		count++;
+	}
+	out.append(text, from, std::string::npos);
+	if (headers) *headers = count;
+	return out;
+}
+
+static std::string Marker(size_t dropped) {
+	char marker[64];
+	snprintf(marker, sizeof(marker), "\n[%zu bytes dropped]\n", dropped);
+	return marker;
+}
+
+struct Counters {
+	unsigned long long queued = 0, written = 0, batches = 0, dropped = 0, errors = 0;
+	size_t largest = 0, pending = 0;
+};
+
+static Counters Count(TranscriptLog& log) {
+	Counters c;
+	std::wstring text = log.Describe();
+	swscanf(text.c_str(), L"transcript log: %llu bytes queued, %llu written in %llu batches (largest %zu), %zu pending, "
+		L"%llu dropped, %llu write errors", &c.queued, &c.written, &c.batches, &c.largest, &c.pending, &c.dropped, &c.errors);
+	return c;
+}
+
+// A log fed whole sentences as the session ends them (Finish), so each Say
+// queues exactly its text.
+struct Session {
+	TranscriptLog log;
+	std::wstring history;
+
+	bool Start(const TranscriptLogOptions& options) {
+		history.clear();
+		return log.Start(options);
+	}
+	void Say(const std::string& text) {
+		history += DecodeUtf8(text);
+		log.Finish(history);
+	}
+	// Wait (up to five seconds) until the writer has got that far.
+	template <typename Done> bool WaitFor(Done done) {
+		for (int i = 0; i < 1000; i++) {
+			if (done(Count(log))) return true;
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+		return false;
+	}
+	bool Written(unsigned long long bytes) {
+		return WaitFor([&](const Counters& c) { return c.written >= bytes; });
+	}
+};
+
+static TranscriptLogOptions Options(const std::string& directory, uint32_t flushIntervalMs) {
+	TranscriptLogOptions options;
+	options.directory = DecodeUtf8(directory);
+	options.prefix = L"log";
+	options.flushIntervalMs = flushIntervalMs;
+	return options;
+}
+
+static std::string ArchiveText(const std::string& directory) {
+	TranscriptArchive archive;
+	if (archive.Load(DecodeUtf8(directory)) != 1) return "[" + std::to_string(archive.SessionCount()) + " sessions]";
+	size_t bytes = 0;
+	const char* text = archive.Text(0, bytes);
+	return text ? std::string(text, bytes) : "[damaged]";
+}
+
+static void CheckDaily(const std::string& root) {
+	std::string directory = root + "/daily/", archive = root + "/daily_archive/";
+	std::filesystem::create_directories(directory);
+	std::filesystem::create_directories(archive);
+	TranscriptLogOptions options = Options(directory, 20);
+	options.archiveDirectory = DecodeUtf8(archive);
+	Session s;
+	s.Start(options);
+	const std::string monday = "Late on Monday. ", tuesday = "Early on Tuesday.";
+	std::string today = Day();
+	s.Say(monday);
+	bool first = s.Written(monday.size() + 1);
+	g_clockShift += 24 * 60 * 60;
+	std::string tomorrow = Day();
+	s.Say(tuesday);
+	s.log.Stop();
+	g_clockShift = 0;
+
+	size_t headers = 0;
+	std::string before = ReadFile(directory + "log_" + today + ".txt"), after = ReadFile(directory + "log_" + tomorrow + ".txt");
+	Check(first && WithoutHeaders(before, &headers) == monday && headers == 1 && before.find("\n[session ") == 0,
+		"the day file is <prefix>_<yyyymmdd>.txt and starts with the session");
+	Check(after == tuesday, "after midnight the text goes on in the next day's file");
+	Check(ArchiveText(archive) == monday + tuesday, "the archive has the session's text, without its header");
+}
+
+static void CheckParts(const std::string& root) {
+	std::string directory = root + "/parts/";
+	std::filesystem::create_directories(directory);
+	std::string day = Day(), name = directory + "log_" + day;
+	std::ofstream(name + ".txt", std::ios::binary) << std::string(100, 'x');
+	std::ofstream(name + "_2.txt", std::ios::binary) << std::string(50, 'y');
+	TranscriptLogOptions options = Options(directory, 20);
+	options.rotateBytes = 100;
+
+	const std::string first = "In the first session";
+	{
+		Session s;
+		s.Start(options);
+		s.Say(first);
+		s.log.Stop();
+	}
+	std::string part2 = ReadFile(name + "_2.txt");
+	Check(ReadFile(name + ".txt") == std::string(100, 'x') && part2.compare(0, 50, std::string(50, 'y')) == 0 &&
+		WithoutHeaders(part2.substr(50)) == first && part2.size() >= 100,
+		"a full file is skipped; the first part with room is appended to");
+
+	const std::string one = "Then a second session, forty bytes long.", two = " And then forty more to go past the size.";
+	Session s;
+	s.Start(options);
+	s.Say(one);
+	bool written = s.Written(one.size() + 1);
+	s.Say(two);
+	s.log.Stop();
+	std::string part3 = ReadFile(name + "_3.txt");
+	size_t headers = 0;
+	Check(written && ReadFile(name + "_2.txt") == part2 && WithoutHeaders(part3, &headers) == one && headers == 1,
+		"a file filled by an earlier session is skipped too");
+	Check(ReadFile(name + "_4.txt") == two && !std::filesystem::exists(name + "_5.txt"),
+		"a batch that would pass the rotate size starts the next part");
+}
+
+static void CheckDrops(const std::string& root) {
+	std::string directory = root + "/drops/";
+	std::filesystem::create_directories(directory);
+	// Nothing is written before Stop, so the buffer only fills.
+	TranscriptLogOptions options = Options(directory, 60000);
+	options.bufferBytes = 64;
+	Session s;
+	s.Start(options);
+	const std::string kept = "This fits the buffer", lost = "and this is too much", late = "Late.";
+	s.Say(kept);
+	s.Say(lost);
+	s.Say(late);
+	Counters c = Count(s.log);
+	size_t dropped = lost.size() + Marker(lost.size()).size() + late.size();
+	Check(c.queued == kept.size() && c.dropped == dropped, "text past the buffer limit is dropped and counted, marker and all");
+	s.log.Stop();
+	std::string file = directory + "log_" + Day() + ".txt";
+	Check(WithoutHeaders(ReadFile(file)) == kept, "what was buffered before is kept");
+
+	// This time the writer drains the buffer, so text after the marker fits.
+	const std::string next = "Next one.", after = " And on.";
+	options.flushIntervalMs = 20;
+	unsigned long long before = Count(s.log).written;
+	s.Start(options);
+	s.Say(next);
+	bool written = s.Written(before + Marker(dropped).size() + next.size() + 1);
+	s.Say(after);
+	s.log.Stop();
+	size_t headers = 0;
+	Check(written && WithoutHeaders(ReadFile(file), &headers) == kept + Marker(dropped) + next + after && headers == 2,
+		"the next text logged is preceded by a [N bytes dropped] marker, once");
+	Check(Count(s.log).dropped == dropped, "and the marker itself is not counted as dropped");
+}
+
+static void CheckRetry(const std::string& root) {
+	std::string directory = root + "/retry/", archive = root + "/retry_archive/";
+	std::filesystem::create_directories(archive);
+	TranscriptLogOptions options = Options(directory, 20);
+	options.archiveDirectory = DecodeUtf8(archive);
+	Session s;
+	s.Start(options);
+	const std::string one = "Said while the disk was away. ", two = "Said after it came back.";
+	s.Say(one);
+	// The directory is not there yet, so the file cannot be opened.
+	bool failed = s.WaitFor([](const Counters& c) { return c.errors >= 2; });
+	Counters c = Count(s.log);
+	Check(failed && c.written == 0 && c.pending > one.size() && c.dropped == 0, "a batch that cannot be written stays buffered");
+	std::filesystem::create_directories(directory);
+	s.Say(two);
+	bool written = s.Written(one.size() + two.size() + 1);
+	s.log.Stop();
+	size_t headers = 0;
+	Check(written && WithoutHeaders(ReadFile(directory + "log_" + Day() + ".txt"), &headers) == one + two && headers == 1,
+		"and is written, in order, once the file can be opened");
+	Check(ArchiveText(archive) == one + two, "the archive skips the header of a batch that was retried");
+}
+
+static void CheckQuickStop(const std::string& root) {
+	std::string directory = root + "/quick/", archive = root + "/quick_archive/";
+	std::filesystem::create_directories(directory);
+	std::filesystem::create_directories(archive);
+	TranscriptLogOptions options = Options(directory, 60000);
+	options.archiveDirectory = DecodeUtf8(archive);
+	Session s;
+	const std::string text = "Stopped at once.";
+	s.Start(options);
+	s.Say(text);
+	s.log.Stop();
+	Check(WithoutHeaders(ReadFile(directory + "log_" + Day() + ".txt")) == text && ArchiveText(archive) == text,
+		"Stop right after Start still writes the buffer and the archive");
+}
+
+int main() {
+	char root[] = "/tmp/transcript_check.XXXXXX";
+	if (!mkdtemp(root)) {
+		perror("mkdtemp");
+		return 2;
+	}
+	CheckDaily(root);
+	CheckParts(root);
+	CheckDrops(root);
+	CheckRetry(root);
+	CheckQuickStop(root);
+	std::filesystem::remove_all(root);
+	return g_failures ? 1 : 0;
+}
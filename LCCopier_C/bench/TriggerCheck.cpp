@@ -0,0 +1,248 @@
+// Checks for the phrase triggers: hits are found across edits, fire once,
+// survive rewrites and shifts, and match whole words only. Besides the cases
+// below, a run of random appends and tail rewrites compares the hits kept with
+// a brute-force scan of the history after every edit.
+//
+// Build and run on Linux (from LCCopier_C/bench):
+//   g++ -std=c++17 -O2 -I.. TriggerCheck.cpp ../PhraseTriggers.cpp -o trigger_check
+//   ./trigger_check                   exit code 1 if a check fails
+//   ./trigger_check --seed 7 --edits 200000
+#include "PhraseTriggers.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwctype>
+#include <random>
+#include <tuple>
+
+static int g_failures = 0;
+
+static void Check(bool ok, const char* what) {
+	printf("%-70s %s\n", what, ok ? "ok" : "FAILED");
+	if (!ok) g_failures++;
+}
+
+// A history fed to the triggers the way UpdateCaptionHistory does, with
+// every hit that fired.
+struct Session {
+	PhraseTriggers triggers;
+	std::wstring history;
+	std::vector<TriggerHit> fired;
+
+	explicit Session(const std::vector<TriggerPhrase>& phrases) { triggers.Compile(phrases); }
+
+	// Replace history from offset on with text.
+	void Edit(size_t offset, const std::wstring& text) {
+		HistoryEdit edit;
+		edit.offset = offset;
+		edit.removed = history.size() - offset;
+		history.resize(offset);
+		history += text;
+		edit.inserted = text.size();
+		triggers.OnEdit(edit, history, fired);
+	}
+	void Append(const std::wstring& text) { Edit(history.size(), text); }
+
+	// DoClearHistory.
+	void Clear() {
+		history.clear();
+		triggers.Reset();
+	}
+
+	// DoUndoClear: earlier text in front of the history.
+	void Prepend(const std::wstring& earlier) {
+		history.insert(0, earlier);
+		triggers.Prepend(earlier.size(), earlier.size(), history, fired);
+	}
+
+	size_t Fired(size_t phrase) const {
+		return (size_t)std::count_if(fired.begin(), fired.end(), [&](const TriggerHit& hit) { return hit.phrase == phrase; });
+	}
+	bool FiredAt(size_t phrase, size_t start, size_t end) const {
+		return std::any_of(fired.begin(), fired.end(), [&](const TriggerHit& hit) {
+			return hit.phrase == phrase && hit.start == start && hit.end == end;
+		});
+	}
+	bool Kept(size_t phrase, size_t start, size_t end) const {
+		for (const TriggerHit& hit : triggers.Hits()) {
+			if (hit.phrase == phrase && hit.start == start && hit.end == end) return true;
+		}
+		return false;
+	}
+};
+
+static std::vector<TriggerPhrase> Phrases(std::initializer_list<const wchar_t*> texts) {
+	std::vector<TriggerPhrase> phrases;
+	for (const wchar_t* text : texts) phrases.push_back(TriggerPhrase{ text });
+	return phrases;
+}
+
+static void CheckSplitPhrase() {
+	Session s(Phrases({ L"action item" }));
+	s.Append(L"that is an act");
+	s.Append(L"ion it");
+	Check(s.fired.empty(), "a partial phrase does not fire");
+	s.Append(L"em");
+	Check(s.fired.empty(), "a hit at the end of history waits for the next unit");
+	s.Append(L" for Bob");
+	Check(s.fired.size() == 1 && s.FiredAt(0, 11, 22), "a phrase split across edits fires once, where it is");
+}
+
+static void CheckRewrite() {
+	Session s(Phrases({ L"action item", L"bob" }));
+	s.Append(L"the action item for bob. ");
+	size_t fired = s.fired.size();
+	// The recognizer revises the tail, from inside the hit, and keeps the phrase.
+	s.Edit(11, L"item for Rob. next");
+	Check(fired == 2 && s.fired.size() == 2, "a rewrite that removes and restores a hit does not fire it again");
+	Check(s.Kept(0, 4, 15), "the restored hit is still kept for highlighting");
+	Check(!s.Kept(1, 20, 23), "a hit the rewrite removed is no longer kept");
+	// This time it changes the phrase, then restores it in a later edit.
+	s.Edit(11, L"items");
+	Check(!s.Kept(0, 4, 15), "a rewrite that breaks a hit drops it");
+	s.Edit(11, L"item. ");
+	Check(s.Fired(0) == 2 && s.Kept(0, 4, 15), "a hit restored by a later edit is a new hit");
+}
+
+static void CheckRewind() {
+	Session s(Phrases({ L"action item", L"follow up" }));
+	s.Append(L"first an action item, ready ");
+	size_t restart = s.history.size();
+	// Exactly TRIGGER_REWIND_UNITS after "follow ": the state before the
+	// oldest one kept expects "up".
+	std::wstring filler = L"follow ";
+	while (filler.size() < 7 + TRIGGER_REWIND_UNITS) filler += L"filler words ";
+	filler.resize(7 + TRIGGER_REWIND_UNITS);
+	s.Append(filler);
+	Check(s.Fired(0) == 1, "the first hit fired");
+	// Rewrite from before the states kept: the scan restarts there, from the root.
+	const std::wstring rewrite = L"up on the action item, and we follow up. ";
+	s.Edit(restart, rewrite);
+	size_t at = s.history.find(L"follow up", restart);
+	Check(s.Fired(1) == 1 && s.FiredAt(1, at, at + 9), "a rewrite past TRIGGER_REWIND_UNITS rescans from the root state");
+	Check(s.Fired(0) == 2, "and finds the hits after it");
+	Check(s.Kept(0, 9, 20), "the hit before it is kept");
+	at = s.history.find(L"action item", restart);
+	Check(s.Kept(0, at, at + 11), "the hit it found is kept, where it is");
+	// And the same rewrite again: everything after the offset was seen already.
+	s.Edit(restart, rewrite);
+	Check(s.Fired(0) == 2 && s.Fired(1) == 1, "repeating the rewrite fires nothing new");
+}
+
+static void CheckWholeWords() {
+	Session s(Phrases({ L"item", L"Action Item" }));
+	s.Append(L"items, subitem, item2 and xaction item ");
+	Check(s.Fired(1) == 0 && s.Fired(0) == 1, "only whole words match (\"items\", \"subitem\" do not)");
+	s.Append(L"; ACTION ITEM.");
+	Check(s.Fired(1) == 1 && s.Fired(0) == 2, "matching folds case");
+}
+
+static void CheckWhitespace() {
+	Session s(Phrases({ L"action  item" }));
+	s.Append(L"an action \r\n\t item and an action");
+	s.Append(L"   ");
+	s.Append(L"item.");
+	Check(s.Fired(0) == 2, "a whitespace run matches a single space, also across edits");
+	Check(s.FiredAt(0, 3, 18), "the hit covers the whole run");
+}
+
+static void CheckPrepend() {
+	Session s(Phrases({ L"action item" }));
+	s.Append(L"an action item; another action it");
+	const std::wstring earlier = L"earlier text with an action item. ";
+	s.Prepend(earlier);
+	size_t shift = earlier.size();
+	Check(s.fired.size() == 1 && s.Kept(0, shift + 3, shift + 14), "a kept hit moves with the prepended text");
+	Check(s.Kept(0, 21, 32), "a hit in the prepended text is kept again, without firing");
+	s.Append(L"em now");
+	Check(s.fired.size() == 2 && s.FiredAt(0, shift + 24, shift + 35), "a phrase in progress completes at the shifted offset");
+	s.Edit(shift + 31, L"item!");
+	Check(s.fired.size() == 2 && s.Kept(0, shift + 24, shift + 35), "a rewrite after the shift resumes from the right state");
+}
+
+// Brute force: the folded, whitespace-collapsed history, searched for each
+// phrase, keeping whole-word hits that have a unit after them.
+static std::vector<TriggerHit> Reference(const std::vector<TriggerPhrase>& phrases, const std::wstring& history) {
+	std::wstring folded;
+	std::vector<size_t> at;
+	for (size_t i = 0; i < history.size(); i++) {
+		bool space = std::iswspace(history[i]) != 0;
+		if (space && i > 0 && std::iswspace(history[i - 1])) continue;
+		folded += space ? L' ' : (wchar_t)std::towlower(history[i]);
+		at.push_back(i);
+	}
+	std::vector<TriggerHit> hits;
+	for (size_t p = 0; p < phrases.size(); p++) {
+		std::wstring key;
+		for (wchar_t ch : phrases[p].text) key += (wchar_t)std::towlower(ch);
+		for (size_t pos = folded.find(key); pos != std::wstring::npos; pos = folded.find(key, pos + 1)) {
+			size_t start = at[pos], end = at[pos + key.size() - 1] + 1;
+			if (start > 0 && std::iswalnum(history[start - 1])) continue;
+			if (end == history.size() || std::iswalnum(history[end])) continue;
+			hits.push_back(TriggerHit{ p, start, end });
+		}
+	}
+	return hits;
+}
+
+static bool Before(const TriggerHit& a, const TriggerHit& b) {
+	return std::tie(a.end, a.start, a.phrase) < std::tie(b.end, b.start, b.phrase);
+}
+
+static void CheckRandom(unsigned seed, int edits) {
+	std::vector<TriggerPhrase> phrases = Phrases({ L"ab ca", L"bad", L"cab", L"a b c", L"dab" });
+	Session s(phrases);
+	std::mt19937 rng(seed);
+	size_t mismatches = 0, compared = 0;
+	for (int i = 0; i < edits; i++) {
+		// The brute force rescans everything; a clear now and then keeps it short.
+		if (s.history.size() > 3000) s.Clear();
+		size_t back = rng() % 3 == 0 ? (std::min)(s.history.size(), (size_t)(rng() % 30)) : 0;
+		std::wstring text;
+		for (size_t n = rng() % 12; n; n--) {
+			unsigned r = rng() % 9;
+			text += r < 4 ? (wchar_t)(L'a' + r) : r < 7 ? L' ' : r == 7 ? L'\n' : L'A';
+		}
+		if (!back && text.empty()) continue;
+		s.Edit(s.history.size() - back, text);
+		std::vector<TriggerHit> expected = Reference(phrases, s.history);
+		std::sort(expected.begin(), expected.end(), Before);
+		std::vector<TriggerHit> kept;
+		for (const TriggerHit& hit : s.triggers.Hits()) kept.push_back(hit);
+		std::sort(kept.begin(), kept.end(), Before);
+		size_t n = (std::min)(expected.size(), (size_t)TRIGGER_KEEP_HITS);
+		bool same = kept.size() == n;
+		for (size_t k = 0; same && k < n; k++) {
+			const TriggerHit& a = kept[k];
+			const TriggerHit& b = expected[expected.size() - n + k];
+			same = a.phrase == b.phrase && a.start == b.start && a.end == b.end;
+		}
+		if (!same) mismatches++;
+		compared++;
+	}
+	printf("random: %zu edits compared with a brute-force scan, %zu hits fired\n", compared, s.fired.size());
+	Check(compared > 0 && mismatches == 0, "after random tail edits the hits kept match a full scan");
+}
+
+int main(int argc, char** argv) {
+	unsigned seed = 1;
+	int edits = 20000;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (!std::strcmp(argv[i], "--seed")) seed = (unsigned)std::atoi(argv[i + 1]);
+		else if (!std::strcmp(argv[i], "--edits")) edits = std::atoi(argv[i + 1]);
+		else {
+			fprintf(stderr, "usage: %s [--seed N] [--edits N]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	CheckSplitPhrase();
+	CheckRewrite();
+	CheckRewind();
+	CheckWholeWords();
+	CheckWhitespace();
+	CheckPrepend();
+	CheckRandom(seed, edits);
+	return g_failures ? 1 : 0;
+}
@@ -0,0 +1,379 @@
+// Checks for undoing a clear: the cleared history comes back in front of the
+// text that arrived since, and every consumer DoUndoClear updates must end up
+// where one fed the combined history from scratch would. Random sessions
+// (appends, tail rewrites, poll ticks, a clear, more text, the undo, more
+// text) compare the sentence table, the trigger hits kept and fired, the
+// subtitle words and the transcript log's words with such a reference. The
+// paste cursor has no reference; it is checked to keep what was pasted since
+// the clear.
+//
+// Build and run on Linux (from LCCopier_C/bench):
+//   g++ -std=c++17 -O2 -pthread -I.. UndoCheck.cpp ../CaptionText.cpp ../PasteCursor.cpp ../PhraseTriggers.cpp ../SentenceIndex.cpp ../SubtitleExport.cpp ../TranscriptArchive.cpp ../TranscriptLog.cpp -o undo_check
+//   ./undo_check                      exit code 1 if a check fails
+//   ./undo_check --seed 7 --sessions 200
+#include "CaptionText.h"
+#include "PasteCursor.h"
+#include "PhraseTriggers.h"
+#include "SentenceIndex.h"
+#include "SubtitleExport.h"
+#include "TranscriptLog.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <unistd.h>
+
+static int g_failures = 0;
+
+static void Check(bool ok, const char* what) {
+	printf("%-70s %s\n", what, ok ? "ok" : "FAILED");
+	if (!ok) g_failures++;
+}
+
+static std::vector<TriggerPhrase> Phrases() {
+	std::vector<TriggerPhrase> phrases;
+	for (const wchar_t* text : { L"action item", L"follow up", L"bob" }) phrases.push_back(TriggerPhrase{ text });
+	return phrases;
+}
+
+static std::vector<std::string> Words(const std::string& text) {
+	std::istringstream in(text);
+	return std::vector<std::string>(std::istream_iterator<std::string>(in), std::istream_iterator<std::string>());
+}
+
+// The log files in directory, oldest part first, without the session headers.
+static std::string ReadLog(const std::string& directory) {
+	std::vector<std::string> names;
+	for (const auto& entry : std::filesystem::directory_iterator(directory)) names.push_back(entry.path().string());
+	std::sort(names.begin(), names.end());
+	std::string text;
+	for (const std::string& name : names) {
+		std::ifstream in(name, std::ios::binary);
+		std::string line;
+		while (std::getline(in, line)) {
+			if (line.compare(0, 9, "[session ") != 0) text += line + "\n";
+		}
+	}
+	return text;
+}
+
+static std::string SrtWords(const std::string& srt) {
+	std::istringstream in(srt);
+	std::string line, text;
+	while (std::getline(in, line)) {
+		if (!line.empty() && line.back() == '\r') line.pop_back();
+		if (line.empty() || line.find(" --> ") != std::string::npos || line.find_first_not_of("0123456789") == std::string::npos) continue;
+		text += line + "\n";
+	}
+	return text;
+}
+
+// The app's consumers of the caption history, fed the way UpdateCaptionHistory,
+// DoClearHistory and DoUndoClear feed them.
+struct App {
+	std::wstring history;
+	PasteCursor pasteCursor;
+	SentenceIndex sentences;
+	PhraseTriggers triggers;
+	SubtitleExporter subtitles;
+	TranscriptLog transcriptLog;
+	std::vector<TriggerHit> fired;     // every hit fired, moved with the history on undo
+	size_t firedAtClear = 0;
+	size_t firedOnUndo = 0;
+	std::string srt;
+	std::wstring cleared;
+	SentenceIndex clearedSentences;
+
+	explicit App(const std::string& logDirectory) {
+		triggers.Compile(Phrases());
+		TranscriptLogOptions log;
+		log.directory = DecodeUtf8(logDirectory + "/");
+		transcriptLog.Start(log);
+	}
+
+	void Edit(size_t offset, const std::wstring& text, uint64_t nowMs) {
+		HistoryEdit edit;
+		edit.offset = offset;
+		edit.removed = history.size() - offset;
+		history.resize(offset);
+		history += text;
+		edit.inserted = text.size();
+		pasteCursor.OnEdit(edit);
+		sentences.OnEdit(edit, history);
+		subtitles.OnEdit(edit, history, nowMs);
+		transcriptLog.OnEdit(edit, history, nowMs);
+		triggers.OnEdit(edit, history, fired);
+	}
+	void Tick(uint64_t nowMs) {
+		subtitles.OnTick(history, nowMs);
+		transcriptLog.OnTick(history, nowMs);
+		subtitles.TakeSrt(srt);
+	}
+
+	void Clear(uint64_t nowMs) {
+		subtitles.Finish(history, nowMs);
+		transcriptLog.Finish(history);
+		HistoryEdit edit;
+		edit.removed = history.size();
+		firedAtClear = fired.size();
+		cleared = std::move(history);
+		clearedSentences = std::move(sentences);
+		history.clear();
+		sentences.Clear();
+		triggers.Reset();
+		subtitles.OnEdit(edit, history, nowMs);
+		transcriptLog.OnEdit(edit, history, nowMs);
+		pasteCursor.Reset(0);
+	}
+	void Undo() {
+		size_t earlierLength = cleared.size();
+		size_t prefix = earlierLength;
+		std::wstring restored = std::move(cleared);
+		if (!history.empty()) {
+			restored += L' ';
+			prefix++;
+			restored += history;
+		}
+		history.swap(restored);
+		for (size_t i = firedAtClear; i < fired.size(); i++) {
+			fired[i].start += prefix;
+			fired[i].end += prefix;
+		}
+		sentences.Prepend(std::move(clearedSentences), history);
+		subtitles.OnPrepend(prefix);
+		transcriptLog.OnPrepend(prefix);
+		pasteCursor.OnPrepend(prefix);
+		size_t before = fired.size();
+		triggers.Prepend(prefix, earlierLength, history, fired);
+		firedOnUndo = fired.size() - before;
+	}
+	void Finish(uint64_t nowMs) {
+		subtitles.Finish(history, nowMs);
+		subtitles.TakeSrt(srt);
+		transcriptLog.Finish(history);
+		transcriptLog.Stop();
+	}
+};
+
+// The same consumers, fed the final history in one edit.
+struct Reference {
+	SentenceIndex sentences;
+	PhraseTriggers triggers;
+	SubtitleExporter subtitles;
+	TranscriptLog transcriptLog;
+	std::vector<TriggerHit> fired;
+	std::string srt;
+
+	Reference(const std::wstring& history, const std::string& logDirectory, uint64_t nowMs) {
+		triggers.Compile(Phrases());
+		TranscriptLogOptions log;
+		log.directory = DecodeUtf8(logDirectory + "/");
+		transcriptLog.Start(log);
+		HistoryEdit edit;
+		edit.inserted = history.size();
+		sentences.OnEdit(edit, history);
+		triggers.OnEdit(edit, history, fired);
+		subtitles.OnEdit(edit, history, nowMs);
+		subtitles.Finish(history, nowMs);
+		subtitles.TakeSrt(srt);
+		transcriptLog.OnEdit(edit, history, nowMs);
+		transcriptLog.Finish(history);
+		transcriptLog.Stop();
+	}
+};
+
+static std::wstring Phrase(std::mt19937& rng) {
+	static const wchar_t* const kWords[] = {
+		L"the", L"meeting", L"action", L"item", L"follow", L"up", L"with", L"Bob", L"bobby", L"e.g.", L"so",
+		L"We", L"It", L"Next", L"done.", L"now?", L"yes!", L"items", L"later.", L"and", L"3.5", L"U.S."
+	};
+	std::wstring text;
+	for (unsigned n = 1 + rng() % 6; n; n--) {
+		text += L' ';
+		text += kWords[rng() % (sizeof(kWords) / sizeof(kWords[0]))];
+	}
+	return text;
+}
+
+// Appends and tail rewrites, each followed by a poll tick.
+static void Speak(std::mt19937& rng, App& app, int edits, uint64_t& nowMs) {
+	size_t said = app.history.size();
+	for (int i = 0; i < edits; i++) {
+		nowMs += 100 + rng() % 400;
+		size_t offset = app.history.size();
+		if (rng() % 4 == 0) {
+			// The recognizer revises the last few units, never more than it just said.
+			offset -= (std::min)(offset - said, (size_t)(1 + rng() % 12));
+			while (offset > said && app.history[offset - 1] != L' ') offset--;
+		}
+		app.Edit(offset, Phrase(rng), nowMs);
+		app.Tick(nowMs);
+	}
+}
+
+static bool SameHits(const RingQueue<TriggerHit>& a, const RingQueue<TriggerHit>& b) {
+	if (a.size() != b.size()) return false;
+	for (size_t i = 0; i < a.size(); i++) {
+		if (a[i].phrase != b[i].phrase || a[i].start != b[i].start || a[i].end != b[i].end) return false;
+	}
+	return true;
+}
+
+static size_t CountFired(const std::vector<TriggerHit>& fired, const TriggerHit& hit) {
+	return (size_t)std::count_if(fired.begin(), fired.end(), [&](const TriggerHit& f) {
+		return f.phrase == hit.phrase && f.start == hit.start && f.end == hit.end;
+	});
+}
+
+static std::string TempDirectory() {
+	char path[] = "/tmp/undo_check_XXXXXX";
+	if (!mkdtemp(path)) {
+		perror("mkdtemp");
+		exit(2);
+	}
+	return path;
+}
+
+static void CheckSessions(unsigned seed, int sessions) {
+	std::mt19937 rng(seed);
+	size_t sentenceMismatches = 0, hitMismatches = 0, firedMismatches = 0, subtitleMismatches = 0, logMismatches = 0;
+	size_t hitsCompared = 0, firedOnUndo = 0, joined = 0;
+	for (int session = 0; session < sessions; session++) {
+		std::string appLog = TempDirectory(), referenceLog = TempDirectory();
+		uint64_t nowMs = 1000;
+		{
+			App app(appLog);
+			Speak(rng, app, 5 + rng() % 40, nowMs);
+			// Sometimes long enough that the earlier text has settled, sometimes not.
+			nowMs += rng() % 2 ? 5000 : 200;
+			app.Tick(nowMs);
+			app.Clear(nowMs);
+			Speak(rng, app, rng() % 20, nowMs);
+			if (!app.history.empty()) joined++;
+			app.Undo();
+			firedOnUndo += app.firedOnUndo;
+			Speak(rng, app, rng() % 20, nowMs);
+			nowMs += 100;
+			app.Finish(nowMs);
+
+			Reference reference(app.history, referenceLog, nowMs);
+			bool same = app.sentences.Count() == reference.sentences.Count();
+			for (size_t n = 1; same && n <= reference.sentences.Count(); n++) {
+				same = app.sentences.StartOfLast(n, app.history.size()) == reference.sentences.StartOfLast(n, app.history.size());
+			}
+			if (!same) sentenceMismatches++;
+			if (!SameHits(app.triggers.Hits(), reference.triggers.Hits())) hitMismatches++;
+			// Hits still in the history fired exactly once, unless a rewrite
+			// broke one and a later edit restored it (then it is a new hit).
+			for (const TriggerHit& hit : reference.fired) {
+				if (CountFired(app.fired, hit) == 0) firedMismatches++;
+			}
+			hitsCompared += reference.fired.size();
+			std::string historyUtf8;
+			AppendUtf8(historyUtf8, app.history);
+			if (Words(SrtWords(app.srt)) != Words(SrtWords(reference.srt)) || Words(SrtWords(reference.srt)) != Words(historyUtf8)) {
+				subtitleMismatches++;
+			}
+			if (Words(ReadLog(appLog)) != Words(ReadLog(referenceLog)) || Words(ReadLog(referenceLog)) != Words(historyUtf8)) {
+				logMismatches++;
+			}
+		}
+		std::filesystem::remove_all(appLog);
+		std::filesystem::remove_all(referenceLog);
+	}
+	printf("sessions: %d (%zu with text since the clear), %zu trigger hits, %zu fired on undo\n",
+		sessions, joined, hitsCompared, firedOnUndo);
+	Check(joined > 0 && !sentenceMismatches, "sentences: the table matches a scan of the combined history");
+	Check(hitsCompared > 0 && !hitMismatches, "triggers: the hits kept match a scan of the combined history");
+	Check(!firedMismatches, "triggers: every hit in the combined history fired");
+	Check(!subtitleMismatches, "subtitles: every word of the combined history is in a cue, once");
+	Check(!logMismatches, "transcript log: every word of the combined history is logged, once");
+}
+
+// Deterministic cases for what the random sessions cannot tell apart.
+static void CheckJoins() {
+	std::string logDirectory = TempDirectory();
+	{
+		// A sentence left open by the clear continues into the text after it.
+		App app(logDirectory);
+		app.Edit(0, L"We meet at noon. The action", 1000);
+		app.Clear(1100);
+		app.Edit(0, L"item for Bob. next week", 1200);
+		app.Undo();
+		Check(app.sentences.Count() == 2 && app.sentences.StartOfLast(1, app.history.size()) == 17,
+			"undo: a sentence open at the clear continues after it");
+		Check(app.firedOnUndo == 1 && app.fired.back().phrase == 0 && app.fired.back().start == 21,
+			"undo: a phrase across the join fires once");
+		Check(app.fired.size() == 2 && app.triggers.Hits().size() == 2,
+			"undo: the hit since the clear is kept and does not fire again");
+		app.Finish(1300);
+	}
+	{
+		// An earlier hit that fired stays quiet; one still waiting on its next unit fires.
+		App app(logDirectory);
+		app.Edit(0, L"an action item, then follow up", 1000);
+		app.Clear(1100);
+		app.Undo();
+		Check(app.fired.size() == 1 && app.firedOnUndo == 0 && app.triggers.Hits().size() == 1,
+			"undo with nothing since: hits kept again, nothing fires at the end");
+		app.Edit(app.history.size(), L" now", 1200);
+		Check(app.fired.size() == 2 && app.fired.back().phrase == 1, "and the waiting hit fires on the next unit");
+		app.Finish(1300);
+	}
+	std::filesystem::remove_all(logDirectory);
+}
+
+// PasteCursor: pasting continues after what went out since the clear.
+static void CheckPasteCursor() {
+	std::string logDirectory = TempDirectory();
+	App app(logDirectory);
+	app.Edit(0, L"before the clear", 1000);
+	app.pasteCursor.MarkPasted(0, app.history);
+	app.Clear(1100);
+	app.Edit(0, L"after the clear", 1200);
+	PasteCursor::Delta delta = app.pasteCursor.Pending(app.history);
+	app.pasteCursor.OnPasted(delta, std::wstring_view(app.history).substr(delta.start, delta.length));
+	app.Edit(app.history.size(), L" and more", 1300);
+	app.Undo();
+	size_t prefix = std::wstring(L"before the clear ").size();
+	delta = app.pasteCursor.Pending(app.history);
+	Check(delta.start == prefix + 15 && delta.length == 9 && !delta.retract && !delta.rewritten,
+		"paste cursor: after undo only the text not yet pasted is pending");
+	app.Edit(prefix + 10, L"CLEAR and more", 1400);
+	delta = app.pasteCursor.Pending(app.history);
+	Check(delta.start == prefix + 10 && delta.retract == 5 && delta.rewritten,
+		"paste cursor: a rewrite of text pasted since the clear is retracted");
+
+	App quiet(logDirectory);
+	quiet.Edit(0, L"before the clear", 1000);
+	quiet.Clear(1100);
+	quiet.Undo();
+	delta = quiet.pasteCursor.Pending(quiet.history);
+	Check(delta.start == quiet.history.size() && delta.length == 0, "paste cursor: undo with nothing since leaves nothing pending");
+	app.Finish(1500);
+	quiet.Finish(1500);
+	std::filesystem::remove_all(logDirectory);
+}
+
+int main(int argc, char** argv) {
+	unsigned seed = 1;
+	int sessions = 300;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (!std::strcmp(argv[i], "--seed")) seed = (unsigned)std::atoi(argv[i + 1]);
+		else if (!std::strcmp(argv[i], "--sessions")) sessions = std::atoi(argv[i + 1]);
+		else {
+			fprintf(stderr, "usage: %s [--seed N] [--sessions N]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	CheckJoins();
+	CheckPasteCursor();
+	CheckSessions(seed, sessions);
+	return g_failures ? 1 : 0;
+}